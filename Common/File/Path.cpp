@@ -7,6 +7,7 @@
 #include "Common/File/Path.h"
 #include "Common/File/AndroidContentURI.h"
 #include "Common/File/FileUtil.h"
+#include "Common/File/PathCaseCache.h"
 #include "Common/StringUtils.h"
 #include "Common/Log.h"
 #include "Common/Data/Encoding/Utf8.h"
@@ -446,23 +447,25 @@ bool Path::ComputePathTo(const Path &other, std::string &path) const {
 	}
 }
 
-static bool FixFilenameCase(const std::string &path, std::string &filename) {
+static bool FixFilenameCase(const std::string &path, std::string &filename, PathCaseCache *cache) {
 #if _WIN32
 	// We don't support case-insensitive file systems on Windows.
 	return true;
 #else
 
 	// Are we lucky?
-	if (File::Exists(Path(path + filename)))
+	if (File::Exists(Path(path + "/" + filename)))
 		return true;
 
+	if (cache)
+		return cache->FixFilenameCase(path, filename);
+
 	size_t filenameSize = filename.size();  // size in bytes, not characters
 	for (size_t i = 0; i < filenameSize; i++)
 	{
 		filename[i] = tolower(filename[i]);
 	}
 
-	//TODO: lookup filename in cache for "path"
 	struct dirent *result = NULL;
 
 	DIR *dirp = opendir(path.c_str());
@@ -496,7 +499,7 @@ static bool FixFilenameCase(const std::string &path, std::string &filename) {
 #endif
 }
 
-bool FixPathCase(const Path &realBasePath, std::string &path, FixPathCaseBehavior behavior) {
+bool FixPathCase(const Path &realBasePath, std::string &path, FixPathCaseBehavior behavior, PathCaseCache *cache) {
 #if _WIN32
 	return true;
 #else
@@ -534,7 +537,7 @@ bool FixPathCase(const Path &realBasePath, std::string &path, FixPathCaseBehavio
 			std::string component = path.substr(start, i - start);
 
 			// Fix case and stop on nonexistant path component
-			if (FixFilenameCase(fullPath, component) == false) {
+			if (FixFilenameCase(fullPath, component, cache) == false) {
 				// Still counts as success if partial matches allowed or if this
 				// is the last component and only the ones before it are required
 				return (behavior == FPC_PARTIAL_ALLOWED || (behavior == FPC_PATH_MUST_EXIST && i >= len));
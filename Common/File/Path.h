@@ -158,4 +158,7 @@ enum FixPathCaseBehavior {
 	FPC_PARTIAL_ALLOWED,  // don't care how many exist (mkdir recursive)
 };
 
-bool FixPathCase(const Path &basePath, std::string &path, FixPathCaseBehavior behavior);
+class PathCaseCache;
+
+// If a cache is passed, directory listings are kept in it between calls. See PathCaseCache.h.
+bool FixPathCase(const Path &basePath, std::string &path, FixPathCaseBehavior behavior, PathCaseCache *cache = nullptr);
@@ -0,0 +1,110 @@
+#include "ppsspp_config.h"
+
+#include <cctype>
+#include <ctime>
+
+#include "Common/File/Path.h"
+#include "Common/File/PathCaseCache.h"
+
+#if HOST_IS_CASE_SENSITIVE
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+// Just a safety net for games that wander around a lot of directories.
+static const size_t MAX_CACHED_DIRS = 1024;
+// How long after a change to a directory its mtime might not change again. Generous for FAT.
+static const int64_t MTIME_SETTLE_NS = 2000000000LL;
+
+#if HOST_IS_CASE_SENSITIVE
+static bool GetDirMTime(const std::string &dir, int64_t *mtime) {
+	struct stat st;
+	if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+		return false;
+#if defined(__APPLE__)
+	*mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+	*mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+static int64_t WallClockNS() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static std::string ToLowerName(const std::string &name) {
+	std::string lower = name;
+	for (char &c : lower) {
+		c = tolower(c);
+	}
+	return lower;
+}
+#endif
+
+bool PathCaseCache::FixFilenameCase(const std::string &dir, std::string &filename) {
+#if HOST_IS_CASE_SENSITIVE
+	int64_t mtime;
+	if (!GetDirMTime(dir, &mtime)) {
+		std::lock_guard<std::mutex> guard(lock_);
+		dirs_.erase(dir);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(lock_);
+	auto iter = dirs_.find(dir);
+	if (iter != dirs_.end() && iter->second.mtime == mtime && !iter->second.racy) {
+		stats_.hits++;
+	} else {
+		DIR *dirp = opendir(dir.c_str());
+		if (!dirp) {
+			if (iter != dirs_.end())
+				dirs_.erase(iter);
+			return false;
+		}
+
+		if (iter == dirs_.end()) {
+			if (dirs_.size() >= MAX_CACHED_DIRS)
+				dirs_.clear();
+			iter = dirs_.emplace(dir, Listing{}).first;
+		}
+		Listing &listing = iter->second;
+		listing.mtime = mtime;
+		listing.racy = mtime >= WallClockNS() - MTIME_SETTLE_NS;
+		listing.names.clear();
+
+		struct dirent *result;
+		while ((result = readdir(dirp))) {
+			std::string name = result->d_name;
+			listing.names[ToLowerName(name)] = std::move(name);
+		}
+		closedir(dirp);
+		stats_.reads++;
+	}
+
+	auto name = iter->second.names.find(ToLowerName(filename));
+	if (name == iter->second.names.end())
+		return false;
+	filename = name->second;
+	return true;
+#else
+	return true;
+#endif
+}
+
+void PathCaseCache::Invalidate(const std::string &dir) {
+	std::lock_guard<std::mutex> guard(lock_);
+	dirs_.erase(dir);
+}
+
+void PathCaseCache::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	dirs_.clear();
+}
+
+PathCaseCache::Stats PathCaseCache::GetStats() {
+	std::lock_guard<std::mutex> guard(lock_);
+	return stats_;
+}
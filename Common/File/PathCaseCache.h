@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Remembers directory listings for FixPathCase, so lookups in big directories don't list them every time.
+//
+// A listing is read again when the directory's modification time changes. Since that may be coarse,
+// whoever owns the cache should also Invalidate() the directories it adds or removes entries in.
+class PathCaseCache {
+public:
+	// Replaces filename with the real name of a case-insensitive match in dir (a host path.)
+	// If several names match, the last one listed wins, like without the cache.
+	bool FixFilenameCase(const std::string &dir, std::string &filename);
+
+	void Invalidate(const std::string &dir);
+	void Clear();
+
+	struct Stats {
+		int hits;
+		int reads;
+	};
+	Stats GetStats();
+
+private:
+	struct Listing {
+		int64_t mtime;
+		// If the directory changed in the same mtime tick as the listing, a later change might not show.
+		bool racy;
+		// Lowercase name to real name.
+		std::unordered_map<std::string, std::string> names;
+	};
+
+	std::mutex lock_;
+	std::unordered_map<std::string, Listing> dirs_;
+	Stats stats_{};
+};
@@ -51,6 +51,9 @@ struct FrameTimeData {
 	double desiredPresentTime;
 	double earliestPresentTime;
 	double presentMargin;
+
+	// FrameTrace frame that was submitted in this frame, if tracing.
+	uint64_t traceFrame;
 };
 constexpr size_t FRAME_TIME_HISTORY_LENGTH = 32;
 
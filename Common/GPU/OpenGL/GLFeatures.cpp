@@ -3,6 +3,7 @@
 #include <cstring>
 #include <set>
 
+#include "ext/xxhash.h"
 #include "Common/StringUtils.h"
 
 #if PPSSPP_API(ANY_GL)
@@ -204,6 +205,9 @@ bool CheckGLExtensions() {
 
 	INFO_LOG(Log::G3D, "GPU Vendor : %s ; renderer: %s version str: %s ; GLSL version str: %s", cvendor ? cvendor : "N/A", renderer, versionStr ? versionStr : "N/A", glslVersionStr ? glslVersionStr : "N/A");
 
+	std::string driverString = StringFromFormat("%s|%s|%s", cvendor ? cvendor : "", renderer, versionStr);
+	gl_extensions.driverHash = XXH3_64bits(driverString.data(), driverString.size());
+
 	strncpy(gl_extensions.model, renderer, sizeof(gl_extensions.model));
 	gl_extensions.model[sizeof(gl_extensions.model) - 1] = 0;
 
@@ -381,6 +385,7 @@ bool CheckGLExtensions() {
 	gl_extensions.KHR_texture_compression_astc_ldr = g_set_gl_extensions.count("GL_KHR_texture_compression_astc_ldr") != 0;
 	gl_extensions.EXT_texture_compression_s3tc = g_set_gl_extensions.count("GL_EXT_texture_compression_s3tc") != 0;
 	gl_extensions.OES_texture_compression_astc = g_set_gl_extensions.count("GL_OES_texture_compression_astc") != 0;
+	gl_extensions.ARB_get_program_binary = g_set_gl_extensions.count("GL_ARB_get_program_binary") != 0;
 
 	if (gl_extensions.IsGLES) {
 		gl_extensions.EXT_blend_func_extended = g_set_gl_extensions.count("GL_EXT_blend_func_extended") != 0;
@@ -451,6 +456,7 @@ bool CheckGLExtensions() {
 	if (gl_extensions.GLES3) {
 		gl_extensions.EXT_blend_minmax = true;
 		gl_extensions.EXT_unpack_subimage = true;
+		gl_extensions.ARB_get_program_binary = true;
 	}
 
 #if defined(__ANDROID__)
@@ -545,7 +551,7 @@ bool CheckGLExtensions() {
 			// ARB_gpu_shader5 = true;
 		}
 		if (gl_extensions.VersionGEThan(4, 1)) {
-			// ARB_get_program_binary = true;
+			gl_extensions.ARB_get_program_binary = true;
 			// ARB_separate_shader_objects = true;
 			// ARB_shader_precision = true;
 			// ARB_viewport_array = true;
@@ -607,6 +613,13 @@ bool CheckGLExtensions() {
 	}
 #endif
 
+	if (gl_extensions.ARB_get_program_binary) {
+		// Some drivers expose the API but no formats, which makes it useless.
+		GLint numProgramBinaryFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numProgramBinaryFormats);
+		gl_extensions.ARB_get_program_binary = numProgramBinaryFormats > 0;
+	}
+
 	// Check the old query API. It doesn't seem to be very reliable (can miss stuff).
 	GLint numCompressedFormats = 0;
 	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &numCompressedFormats);
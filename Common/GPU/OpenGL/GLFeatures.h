@@ -39,6 +39,8 @@ struct GLExtensions {
 	int gpuVendor;
 	char model[128];
 	int modelNumber;
+	// Hash of the vendor, renderer and version strings. Program binaries are only valid for the same value.
+	uint64_t driverHash;
 
 	bool IsGLES;
 	bool IsCoreContext;
@@ -82,6 +84,7 @@ struct GLExtensions {
 	bool ARB_shader_stencil_export;
 	bool ARB_texture_compression_bptc;
 	bool ARB_texture_compression_rgtc;
+	bool ARB_get_program_binary;  // Also core in GL 4.1 and ES 3.0. Only set if the driver has at least one format.
 
 	// KHR
 	bool KHR_texture_compression_astc_ldr;
@@ -0,0 +1,218 @@
+#include <cstring>
+
+#include "ext/xxhash.h"
+
+#include "Common/GPU/OpenGL/GLCommon.h"
+#include "Common/GPU/OpenGL/GLFeatures.h"
+#include "Common/GPU/OpenGL/GLProgramBinaryCache.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+
+struct ProgramBinaryFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t driverHash;
+	uint32_t count;
+	uint32_t padding;
+};
+
+struct ProgramBinaryFileEntry {
+	uint64_t key;
+	uint64_t dataHash;
+	uint32_t format;
+	uint32_t size;
+};
+
+static const char PROGRAM_BINARY_MAGIC[4] = { 'G', 'L', 'P', 'B' };
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+// Program binaries are typically 10-100KB. These are just sanity limits against corrupt files.
+static const uint32_t PROGRAM_BINARY_MAX_SIZE = 16 * 1024 * 1024;
+static const uint32_t PROGRAM_BINARY_MAX_COUNT = 16384;
+
+bool GLProgramBinaryCache::IsSupported() {
+	return gl_extensions.ARB_get_program_binary;
+}
+
+bool GLProgramBinaryCache::Load(const Path &filename) {
+	std::string data;
+	if (!File::ReadBinaryFileToString(filename, &data)) {
+		return false;
+	}
+
+	ProgramBinaryFileHeader header;
+	if (data.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic)) != 0 || header.version != PROGRAM_BINARY_VERSION || header.count > PROGRAM_BINARY_MAX_COUNT) {
+		WARN_LOG(Log::G3D, "Bad GL program binary cache header - ignoring");
+		return false;
+	}
+	if (header.driverHash != gl_extensions.driverHash) {
+		INFO_LOG(Log::G3D, "GL program binary cache is from a different driver - ignoring");
+		return false;
+	}
+
+	std::unordered_map<uint64_t, Entry> entries;
+	size_t pos = sizeof(header);
+	for (uint32_t i = 0; i < header.count; i++) {
+		ProgramBinaryFileEntry fileEntry;
+		if (data.size() - pos < sizeof(fileEntry)) {
+			WARN_LOG(Log::G3D, "GL program binary cache truncated - ignoring");
+			return false;
+		}
+		memcpy(&fileEntry, data.data() + pos, sizeof(fileEntry));
+		pos += sizeof(fileEntry);
+		if (fileEntry.size > PROGRAM_BINARY_MAX_SIZE || data.size() - pos < fileEntry.size) {
+			WARN_LOG(Log::G3D, "GL program binary cache truncated - ignoring");
+			return false;
+		}
+		const uint8_t *src = (const uint8_t *)data.data() + pos;
+		pos += fileEntry.size;
+		// Drivers don't necessarily validate binaries well, so let's not hand them corrupt ones.
+		if (XXH3_64bits(src, fileEntry.size) != fileEntry.dataHash) {
+			WARN_LOG(Log::G3D, "Corrupt GL program binary in cache, skipping");
+			continue;
+		}
+		Entry &entry = entries[fileEntry.key];
+		entry.format = fileEntry.format;
+		entry.data.assign(src, src + fileEntry.size);
+	}
+
+	std::lock_guard<std::mutex> guard(lock_);
+	entries_ = std::move(entries);
+	dirty_ = false;
+	INFO_LOG(Log::G3D, "Loaded %d GL program binaries (%d KB)", (int)entries_.size(), (int)(data.size() / 1024));
+	return true;
+}
+
+bool GLProgramBinaryCache::Save(const Path &filename) {
+	std::string data;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		if (!dirty_) {
+			return true;
+		}
+
+		ProgramBinaryFileHeader header{};
+		memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(header.magic));
+		header.version = PROGRAM_BINARY_VERSION;
+		header.driverHash = gl_extensions.driverHash;
+		header.count = (uint32_t)std::min(entries_.size(), (size_t)PROGRAM_BINARY_MAX_COUNT);
+
+		size_t totalSize = sizeof(header);
+		for (auto &it : entries_) {
+			totalSize += sizeof(ProgramBinaryFileEntry) + it.second.data.size();
+		}
+		data.reserve(totalSize);
+		data.append((const char *)&header, sizeof(header));
+
+		uint32_t written = 0;
+		for (auto &it : entries_) {
+			if (written++ >= header.count) {
+				break;
+			}
+			ProgramBinaryFileEntry fileEntry{};
+			fileEntry.key = it.first;
+			fileEntry.format = it.second.format;
+			fileEntry.size = (uint32_t)it.second.data.size();
+			fileEntry.dataHash = XXH3_64bits(it.second.data.data(), it.second.data.size());
+			data.append((const char *)&fileEntry, sizeof(fileEntry));
+			data.append((const char *)it.second.data.data(), it.second.data.size());
+		}
+		dirty_ = false;
+	}
+
+	// Write to a temporary file first, so a crash can't leave a half-written cache behind.
+	Path tempFilename = filename.WithExtraExtension(".tmp");
+	if (!File::WriteDataToFile(false, data.data(), data.size(), tempFilename) || !File::Rename(tempFilename, filename)) {
+		WARN_LOG(Log::G3D, "Failed to save GL program binary cache to %s", filename.c_str());
+		File::Delete(tempFilename, true);
+		return false;
+	}
+	INFO_LOG(Log::G3D, "Saved GL program binary cache (%d KB)", (int)(data.size() / 1024));
+	return true;
+}
+
+void GLProgramBinaryCache::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	entries_.clear();
+	dirty_ = false;
+}
+
+bool GLProgramBinaryCache::Get(uint64_t key, uint32_t *format, std::vector<uint8_t> *data) {
+	std::lock_guard<std::mutex> guard(lock_);
+	auto it = entries_.find(key);
+	if (it == entries_.end()) {
+		return false;
+	}
+	*format = it->second.format;
+	*data = it->second.data;
+	hits_++;
+	return true;
+}
+
+void GLProgramBinaryCache::Put(uint64_t key, uint32_t format, std::vector<uint8_t> &&data) {
+	if (data.empty() || data.size() > PROGRAM_BINARY_MAX_SIZE) {
+		return;
+	}
+	std::lock_guard<std::mutex> guard(lock_);
+	Entry &entry = entries_[key];
+	entry.format = format;
+	entry.data = std::move(data);
+	dirty_ = true;
+}
+
+void GLProgramBinaryCache::Remove(uint64_t key) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (entries_.erase(key)) {
+		dirty_ = true;
+	}
+	rejected_++;
+}
+
+bool GLProgramBinaryCache::LoadProgram(uint64_t key, GLuint *program) {
+	uint32_t format = 0;
+	std::vector<uint8_t> binary;
+	if (!Get(key, &format, &binary)) {
+		return false;
+	}
+
+	glProgramBinary(*program, (GLenum)format, binary.data(), (GLsizei)binary.size());
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(*program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus == GL_TRUE) {
+		return true;
+	}
+
+	// Normal after driver updates that keep the version string. Fall back to linking from source.
+	INFO_LOG(Log::G3D, "Program binary rejected by driver, relinking");
+	Remove(key);
+	glDeleteProgram(*program);
+	*program = glCreateProgram();
+	// Clear any error from the rejected binary.
+	glGetError();
+	return false;
+}
+
+void GLProgramBinaryCache::StoreProgram(uint64_t key, GLuint program) {
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0) {
+		return;
+	}
+
+	std::vector<uint8_t> binary(binaryLength);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, binaryLength, &written, &format, binary.data());
+	if (written > 0) {
+		binary.resize(written);
+		Put(key, (uint32_t)format, std::move(binary));
+	}
+}
+
+size_t GLProgramBinaryCache::Size() {
+	std::lock_guard<std::mutex> guard(lock_);
+	return entries_.size();
+}
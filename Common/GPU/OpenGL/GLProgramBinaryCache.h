@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/File/Path.h"
+#include "Common/GPU/OpenGL/GLCommon.h"
+
+// Linked program binaries (GL_ARB_get_program_binary / ES 3.0), keyed by whatever the user of
+// GLRenderManager::CreateProgram() passes in. The file is tied to the exact driver through
+// gl_extensions.driverHash, and the driver can still reject individual binaries later, in which
+// case the program is linked from source as usual.
+//
+// Get/Put/Remove and LoadProgram/StoreProgram are called from the GL thread, Load/Save from anywhere.
+class GLProgramBinaryCache {
+public:
+	// Requires that CheckGLExtensions() has run.
+	static bool IsSupported();
+
+	bool Load(const Path &filename);
+	// Only writes if anything changed since the last load or save.
+	bool Save(const Path &filename);
+	void Clear();
+
+	bool Get(uint64_t key, uint32_t *format, std::vector<uint8_t> *data);
+	void Put(uint64_t key, uint32_t format, std::vector<uint8_t> &&data);
+	// Call when the driver rejected a binary from Get().
+	void Remove(uint64_t key);
+
+	// Sets up *program from the cached binary for key. Returns false if there's none or the driver rejected it,
+	// in which case *program is a fresh program object to link from source as usual.
+	bool LoadProgram(uint64_t key, GLuint *program);
+	// Reads back the binary of a program that was just linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+	void StoreProgram(uint64_t key, GLuint program);
+
+	size_t Size();
+	int Hits() const { return hits_; }
+	int Rejected() const { return rejected_; }
+
+private:
+	struct Entry {
+		uint32_t format;
+		std::vector<uint8_t> data;
+	};
+
+	std::mutex lock_;
+	std::unordered_map<uint64_t, Entry> entries_;
+	bool dirty_ = false;
+	std::atomic<int> hits_{};
+	std::atomic<int> rejected_{};
+};
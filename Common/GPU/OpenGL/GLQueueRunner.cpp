@@ -194,66 +194,79 @@ void GLQueueRunner::RunInitSteps(const FastVec<GLRInitStep> &steps, bool skipGLC
 			GLRProgram *program = step.create_program.program;
 			program->program = glCreateProgram();
 			_assert_msg_(step.create_program.num_shaders > 0, "Can't create a program with zero shaders");
-			bool anyFailed = false;
-			for (int j = 0; j < step.create_program.num_shaders; j++) {
-				_dbg_assert_msg_(step.create_program.shaders[j]->shader, "Can't create a program with a null shader");
-				anyFailed = anyFailed || step.create_program.shaders[j]->failed;
-				glAttachShader(program->program, step.create_program.shaders[j]->shader);
-			}
 
-			for (const auto &iter : program->semantics_) {
-				glBindAttribLocation(program->program, iter.location, iter.attrib);
-			}
+			// Try the cached binary first. Attribute and frag data locations are part of it.
+			const bool linkedFromBinary = program->binaryKey_ && programBinaryCache_.LoadProgram(program->binaryKey_, &program->program);
+
+			if (!linkedFromBinary) {
+				bool anyFailed = false;
+				for (int j = 0; j < step.create_program.num_shaders; j++) {
+					_dbg_assert_msg_(step.create_program.shaders[j]->shader, "Can't create a program with a null shader");
+					anyFailed = anyFailed || step.create_program.shaders[j]->failed;
+					glAttachShader(program->program, step.create_program.shaders[j]->shader);
+				}
+
+				for (const auto &iter : program->semantics_) {
+					glBindAttribLocation(program->program, iter.location, iter.attrib);
+				}
 
 #if !defined(USING_GLES2)
-			if (step.create_program.support_dual_source) {
-				_dbg_assert_msg_(caps_.dualSourceBlend, "ARB/EXT_blend_func_extended required for dual src blend");
-				// Dual source alpha
-				glBindFragDataLocationIndexed(program->program, 0, 0, "fragColor0");
-				glBindFragDataLocationIndexed(program->program, 0, 1, "fragColor1");
-			} else if (gl_extensions.VersionGEThan(3, 0, 0)) {
-				glBindFragDataLocation(program->program, 0, "fragColor0");
-			}
+				if (step.create_program.support_dual_source) {
+					_dbg_assert_msg_(caps_.dualSourceBlend, "ARB/EXT_blend_func_extended required for dual src blend");
+					// Dual source alpha
+					glBindFragDataLocationIndexed(program->program, 0, 0, "fragColor0");
+					glBindFragDataLocationIndexed(program->program, 0, 1, "fragColor1");
+				} else if (gl_extensions.VersionGEThan(3, 0, 0)) {
+					glBindFragDataLocation(program->program, 0, "fragColor0");
+				}
 #elif !PPSSPP_PLATFORM(IOS)
-			if (gl_extensions.GLES3 && step.create_program.support_dual_source) {
-				// For GLES2, we use gl_SecondaryFragColorEXT as fragColor1.
-				_dbg_assert_msg_(gl_extensions.EXT_blend_func_extended, "EXT_blend_func_extended required for dual src");
-				glBindFragDataLocationIndexedEXT(program->program, 0, 0, "fragColor0");
-				glBindFragDataLocationIndexedEXT(program->program, 0, 1, "fragColor1");
-			}
+				if (gl_extensions.GLES3 && step.create_program.support_dual_source) {
+					// For GLES2, we use gl_SecondaryFragColorEXT as fragColor1.
+					_dbg_assert_msg_(gl_extensions.EXT_blend_func_extended, "EXT_blend_func_extended required for dual src");
+					glBindFragDataLocationIndexedEXT(program->program, 0, 0, "fragColor0");
+					glBindFragDataLocationIndexedEXT(program->program, 0, 1, "fragColor1");
+				}
 #endif
-			glLinkProgram(program->program);
-
-			GLint linkStatus = GL_FALSE;
-			glGetProgramiv(program->program, GL_LINK_STATUS, &linkStatus);
-			if (linkStatus != GL_TRUE) {
-				std::string infoLog = GetInfoLog(program->program, glGetProgramiv, glGetProgramInfoLog);
-
-				// TODO: Could be other than vs/fs.  Also, we're assuming order here...
-				GLRShader *vs = step.create_program.shaders[0];
-				GLRShader *fs = step.create_program.num_shaders > 1 ? step.create_program.shaders[1] : nullptr;
-				std::string vsDesc = vs->desc + (vs->failed ? " (failed)" : "");
-				std::string fsDesc = fs ? (fs->desc + (fs->failed ? " (failed)" : "")) : "(none)";
-				const char *vsCode = vs->code.c_str();
-				const char *fsCode = fs ? fs->code.c_str() : "(none)";
-				if (!anyFailed)
-					Reporting::ReportMessage("Error in shader program link: info: %s\nfs: %s\n%s\nvs: %s\n%s", infoLog.c_str(), fsDesc.c_str(), fsCode, vsDesc.c_str(), vsCode);
-
-				ERROR_LOG(Log::G3D, "Could not link program:\n %s", infoLog.c_str());
-				ERROR_LOG(Log::G3D, "VS desc:\n%s", vsDesc.c_str());
-				ERROR_LOG(Log::G3D, "FS desc:\n%s", fsDesc.c_str());
-				ERROR_LOG(Log::G3D, "VS:\n%s\n", LineNumberString(vsCode).c_str());
-				ERROR_LOG(Log::G3D, "FS:\n%s\n", LineNumberString(fsCode).c_str());
+				if (program->binaryKey_) {
+					glProgramParameteri(program->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+				}
+				glLinkProgram(program->program);
+
+				GLint linkStatus = GL_FALSE;
+				glGetProgramiv(program->program, GL_LINK_STATUS, &linkStatus);
+				if (linkStatus != GL_TRUE) {
+					std::string infoLog = GetInfoLog(program->program, glGetProgramiv, glGetProgramInfoLog);
+
+					// TODO: Could be other than vs/fs.  Also, we're assuming order here...
+					GLRShader *vs = step.create_program.shaders[0];
+					GLRShader *fs = step.create_program.num_shaders > 1 ? step.create_program.shaders[1] : nullptr;
+					std::string vsDesc = vs->desc + (vs->failed ? " (failed)" : "");
+					std::string fsDesc = fs ? (fs->desc + (fs->failed ? " (failed)" : "")) : "(none)";
+					const char *vsCode = vs->code.c_str();
+					const char *fsCode = fs ? fs->code.c_str() : "(none)";
+					if (!anyFailed)
+						Reporting::ReportMessage("Error in shader program link: info: %s\nfs: %s\n%s\nvs: %s\n%s", infoLog.c_str(), fsDesc.c_str(), fsCode, vsDesc.c_str(), vsCode);
+
+					ERROR_LOG(Log::G3D, "Could not link program:\n %s", infoLog.c_str());
+					ERROR_LOG(Log::G3D, "VS desc:\n%s", vsDesc.c_str());
+					ERROR_LOG(Log::G3D, "FS desc:\n%s", fsDesc.c_str());
+					ERROR_LOG(Log::G3D, "VS:\n%s\n", LineNumberString(vsCode).c_str());
+					ERROR_LOG(Log::G3D, "FS:\n%s\n", LineNumberString(fsCode).c_str());
 
 #ifdef _WIN32
-				OutputDebugStringUTF8(infoLog.c_str());
-				if (vsCode)
-					OutputDebugStringUTF8(LineNumberString(vsCode).c_str());
-				if (fsCode)
-					OutputDebugStringUTF8(LineNumberString(fsCode).c_str());
+					OutputDebugStringUTF8(infoLog.c_str());
+					if (vsCode)
+						OutputDebugStringUTF8(LineNumberString(vsCode).c_str());
+					if (fsCode)
+						OutputDebugStringUTF8(LineNumberString(fsCode).c_str());
 #endif
-				CHECK_GL_ERROR_IF_DEBUG();
-				break;
+					CHECK_GL_ERROR_IF_DEBUG();
+					break;
+				}
+
+				if (program->binaryKey_) {
+					programBinaryCache_.StoreProgram(program->binaryKey_, program->program);
+				}
 			}
 
 			glUseProgram(program->program);
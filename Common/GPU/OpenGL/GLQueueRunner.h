@@ -8,6 +8,7 @@
 #include "Common/GPU/OpenGL/GLCommon.h"
 #include "Common/GPU/OpenGL/GLFrameData.h"
 #include "Common/GPU/OpenGL/GLProfiler.h"
+#include "Common/GPU/OpenGL/GLProgramBinaryCache.h"
 #include "Common/GPU/DataFormat.h"
 #include "Common/GPU/Shader.h"
 #include "Common/GPU/thin3d.h"
@@ -369,6 +370,10 @@ class GLQueueRunner {
 
 	std::string GetGLString(int name) const;
 
+	GLProgramBinaryCache &GetProgramBinaryCache() {
+		return programBinaryCache_;
+	}
+
 private:
 	void InitCreateFramebuffer(const GLRInitStep &step);
 
@@ -418,6 +423,9 @@ class GLQueueRunner {
 
 	ErrorCallbackFn errorCallback_ = nullptr;
 	void *errorCallbackUserData_ = nullptr;
+
+	// Only touched from CREATE_PROGRAM init steps, and by Load/Save from the outside.
+	GLProgramBinaryCache programBinaryCache_;
 };
 
 const char *RenderCommandToString(GLRRenderCommand cmd);
@@ -6,6 +6,7 @@
 #include "Common/VR/PPSSPPVR.h"
 
 #include "Common/Log.h"
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/TimeUtil.h"
 #include "Common/MemoryUtil.h"
 #include "Common/StringUtils.h"
@@ -154,6 +155,11 @@ bool GLRenderManager::ThreadFrame() {
 			renderThreadQueue_.pop();
 		}
 
+		if (task->enqueueTime != 0.0) {
+			uint64_t traceFrame = frameTimeHistory_[frameData_[task->frame].frameId].traceFrame;
+			FrameTrace::Add(FrameTraceStage::RENDER_QUEUE, traceFrame, task->enqueueTime, time_now_d());
+		}
+
 		if (task->runType == GLRRunType::EXIT) {
 			VLOG("  PULL: Frame %d EXIT (%0.3f)", task->frame, time_now_d());
 			delete task;
@@ -395,6 +401,10 @@ void GLRenderManager::Finish() {
 	VLOG("PUSH: Finish, pushing task. curFrame = %d", curFrame);
 	GLRRenderThreadTask *task = new GLRRenderThreadTask(GLRRunType::SUBMIT);
 	task->frame = curFrame;
+	if (FrameTrace::IsEnabled()) {
+		frameTimeHistory_[frameData.frameId].traceFrame = FrameTrace::CurrentFrame();
+		task->enqueueTime = time_now_d();
+	}
 	{
 		std::unique_lock<std::mutex> lock(pushMutex_);
 		task->initSteps = std::move(initSteps_);
@@ -429,6 +439,7 @@ bool GLRenderManager::Run(GLRRenderThreadTask &task) {
 	_dbg_assert_(task.frame >= 0);
 
 	GLFrameData &frameData = frameData_[task.frame];
+	FrameTraceScope traceScope(task.runType == GLRRunType::PRESENT ? FrameTraceStage::PRESENT : FrameTraceStage::RENDER, frameTimeHistory_[frameData.frameId].traceFrame);
 
 	if (task.runType == GLRRunType::PRESENT) {
 		bool swapRequest = false;
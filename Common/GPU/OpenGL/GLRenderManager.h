@@ -150,6 +150,9 @@ class GLRProgram {
 	GLRProgramLocData *locData_;
 	bool use_clip_distance[8]{};
 
+	// If non-zero, the linked program is looked up in / stored to the program binary cache under this key.
+	uint64_t binaryKey_ = 0;
+
 	struct UniformInfo {
 		int loc_;
 	};
@@ -215,6 +218,8 @@ struct GLRRenderThreadTask {
 
 	int frame = -1;
 	GLRRunType runType;
+	// Only set while frame tracing, for the render queue delay.
+	double enqueueTime = 0.0;
 
 	// Avoid copying these by accident.
 	GLRRenderThreadTask(GLRRenderThreadTask &) = delete;
@@ -300,9 +305,12 @@ class GLRenderManager {
 
 	// Can't replace uniform initializers with direct calls to SetUniform() etc because there might
 	// not be an active render pass.
+	// A non-zero binaryKey enables the program binary cache for this program. It must identify
+	// everything that affects the linked program, including the shaders, flags and semantics.
 	GLRProgram *CreateProgram(
 		std::vector<GLRShader *> shaders, std::vector<GLRProgram::Semantic> semantics, std::vector<GLRProgram::UniformLocQuery> queries,
-		std::vector<GLRProgram::Initializer> initializers, GLRProgramLocData *locData, const GLRProgramFlags &flags) {
+		std::vector<GLRProgram::Initializer> initializers, GLRProgramLocData *locData, const GLRProgramFlags &flags,
+		uint64_t binaryKey = 0) {
 		GLRInitStep &step = initSteps_.push_uninitialized();
 		step.stepType = GLRInitStepType::CREATE_PROGRAM;
 		_assert_(shaders.size() <= ARRAY_SIZE(step.create_program.shaders));
@@ -311,6 +319,9 @@ class GLRenderManager {
 		step.create_program.program->queries_ = queries;
 		step.create_program.program->initialize_ = initializers;
 		step.create_program.program->locData_ = locData;
+		if (GLProgramBinaryCache::IsSupported()) {
+			step.create_program.program->binaryKey_ = binaryKey;
+		}
 		step.create_program.program->use_clip_distance[0] = flags.useClipDistance0;
 		step.create_program.program->use_clip_distance[1] = flags.useClipDistance1;
 		step.create_program.program->use_clip_distance[2] = flags.useClipDistance2;
@@ -831,6 +842,11 @@ class GLRenderManager {
 		return queueRunner_.GetGLString(name);
 	}
 
+	// Load/Save may be called from any thread.
+	GLProgramBinaryCache &GetProgramBinaryCache() {
+		return queueRunner_.GetProgramBinaryCache();
+	}
+
 	// Used during Android-style ugly shutdown. No need to have a way to set it back because we'll be
 	// destroyed.
 	void SetSkipGLCalls() {
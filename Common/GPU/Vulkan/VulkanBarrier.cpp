@@ -28,6 +28,14 @@ void VulkanBarrierBatch::Flush(VkCommandBuffer cmd) {
 	dependencyFlags_ = 0;
 }
 
+void VulkanBarrierBatch::Clear() {
+	imageBarriers_.clear();
+	bufferBarriers_.clear();
+	srcStageMask_ = 0;
+	dstStageMask_ = 0;
+	dependencyFlags_ = 0;
+}
+
 void VulkanBarrierBatch::TransitionImage(
 	VkImage image, int baseMip, int numMipLevels, int numLayers, VkImageAspectFlags aspectMask,
 	VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
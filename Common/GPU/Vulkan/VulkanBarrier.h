@@ -55,6 +55,8 @@ class VulkanBarrierBatch {
 	void TransitionBufferToShaderRead(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
 	
 	void Flush(VkCommandBuffer cmd);
+	// Drops the barriers without recording them.
+	void Clear();
 
 private:
 	FastVec<VkImageMemoryBarrier> imageBarriers_;
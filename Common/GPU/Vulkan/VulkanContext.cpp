@@ -1837,6 +1837,13 @@ bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *sourceCode,
 	return true;
 }
 
+uint32_t GLSLtoSPVVersion() {
+	// Bump the low byte if the SpvOptions above change.
+	const uint32_t optionsVersion = 1;
+	glslang::Version version = glslang::GetVersion();
+	return (((uint32_t)version.major & 0xFF) << 24) | (((uint32_t)version.minor & 0xFF) << 16) | (((uint32_t)version.patch & 0xFF) << 8) | optionsVersion;
+}
+
 void init_glslang() {
 	glslang::InitializeProcess();
 }
@@ -592,6 +592,8 @@ enum class GLSLVariant {
 };
 
 bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *sourceCode, GLSLVariant variant, std::vector<uint32_t> &spirv, std::string *errorMessage);
+// Identifies the glslang build (and our options), so cached GLSLtoSPV output can be invalidated.
+uint32_t GLSLtoSPVVersion();
 
 const char *VulkanColorSpaceToString(VkColorSpaceKHR colorSpace);
 const char *VulkanFormatToString(VkFormat format);
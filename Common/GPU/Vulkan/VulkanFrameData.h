@@ -38,6 +38,9 @@ struct QueueProfileContext {
 	double descWriteTime;
 	int descriptorsWritten;
 	int descriptorsDeduped;
+	// Time the render thread spent blocked on pipelines that weren't compiled yet.
+	double pipelineWaitTime = 0.0;
+	int pipelineWaits = 0;
 #ifdef _DEBUG
 	int commandCounts[11];
 #endif
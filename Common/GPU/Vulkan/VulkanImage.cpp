@@ -169,8 +169,8 @@ bool VulkanTexture::CreateDirect(int w, int h, int depth, int numMips, VkFormat
 	return true;
 }
 
-void VulkanTexture::CopyBufferToMipLevel(VkCommandBuffer cmd, TextureCopyBatch *copyBatch, int mip, int mipWidth, int mipHeight, int depthLayer, VkBuffer buffer, uint32_t offset, size_t rowLength) {
-	VkBufferImageCopy &copy_region = copyBatch->copies.push_uninitialized();
+VkBufferImageCopy VulkanTexture::GetCopyRegion(int mip, int mipWidth, int mipHeight, int depthLayer, uint32_t offset, size_t rowLength) const {
+	VkBufferImageCopy copy_region;
 	copy_region.bufferOffset = offset;
 	copy_region.bufferRowLength = (uint32_t)rowLength;
 	copy_region.bufferImageHeight = 0;  // 2D
@@ -184,7 +184,10 @@ void VulkanTexture::CopyBufferToMipLevel(VkCommandBuffer cmd, TextureCopyBatch *
 	copy_region.imageSubresource.mipLevel = mip;
 	copy_region.imageSubresource.baseArrayLayer = 0;
 	copy_region.imageSubresource.layerCount = 1;
+	return copy_region;
+}
 
+void VulkanTexture::CopyBufferToMipLevel(VkCommandBuffer cmd, TextureCopyBatch *copyBatch, int mip, int mipWidth, int mipHeight, int depthLayer, VkBuffer buffer, uint32_t offset, size_t rowLength) {
 	_dbg_assert_(mip < numMips_);
 
 	if (!copyBatch->buffer) {
@@ -194,6 +197,8 @@ void VulkanTexture::CopyBufferToMipLevel(VkCommandBuffer cmd, TextureCopyBatch *
 		FinishCopyBatch(cmd, copyBatch);
 		copyBatch->buffer = buffer;
 	}
+
+	copyBatch->copies.push_back(GetCopyRegion(mip, mipWidth, mipHeight, depthLayer, offset, rowLength));
 }
 
 void VulkanTexture::FinishCopyBatch(VkCommandBuffer cmd, TextureCopyBatch *copyBatch) {
@@ -282,13 +287,17 @@ void VulkanTexture::GenerateMips(VkCommandBuffer cmd, int firstMipToGenerate, bo
 
 void VulkanTexture::EndCreate(VkCommandBuffer cmd, bool vertexTexture, VkPipelineStageFlags prevStage, VkImageLayout layout) {
 	VulkanBarrierBatch batch;
-	VkImageMemoryBarrier *barrier = batch.Add(image_, prevStage, vertexTexture ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0);
+	EndCreate(&batch, vertexTexture, prevStage, layout);
+	batch.Flush(cmd);
+}
+
+void VulkanTexture::EndCreate(VulkanBarrierBatch *barriers, bool vertexTexture, VkPipelineStageFlags prevStage, VkImageLayout layout) {
+	VkImageMemoryBarrier *barrier = barriers->Add(image_, prevStage, vertexTexture ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0);
 	barrier->subresourceRange.levelCount = numMips_;
 	barrier->oldLayout = layout;
 	barrier->newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	barrier->srcAccessMask = prevStage == VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
 	barrier->dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	batch.Flush(cmd);
 }
 
 void VulkanTexture::PrepareForTransferDst(VkCommandBuffer cmd, int levels) {
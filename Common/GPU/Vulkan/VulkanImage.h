@@ -37,9 +37,13 @@ class VulkanTexture {
 	// If possible, will just add to the batch instead of submitting a copy.
 	void CopyBufferToMipLevel(VkCommandBuffer cmd, TextureCopyBatch *copyBatch, int mip, int mipWidth, int mipHeight, int depthLayer, VkBuffer buffer, uint32_t offset, size_t rowLength);  // rowLength is in pixels
 	void FinishCopyBatch(VkCommandBuffer cmd, TextureCopyBatch *copyBatch);
+	// The region CopyBufferToMipLevel would copy, for callers that record the copies themselves later.
+	VkBufferImageCopy GetCopyRegion(int mip, int mipWidth, int mipHeight, int depthLayer, uint32_t offset, size_t rowLength) const;
 
 	void GenerateMips(VkCommandBuffer cmd, int firstMipToGenerate, bool fromCompute);
 	void EndCreate(VkCommandBuffer cmd, bool vertexTexture, VkPipelineStageFlags prevStage, VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	// Same, but only adds the transition to the batch.
+	void EndCreate(VulkanBarrierBatch *barriers, bool vertexTexture, VkPipelineStageFlags prevStage, VkImageLayout layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
 	// For updating levels after creation. Careful with the timelines!
 	void PrepareForTransferDst(VkCommandBuffer cmd, int levels);
@@ -1103,6 +1103,10 @@ void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer c
 
 				{
 					std::lock_guard<std::mutex> lock(graphicsPipeline->mutex_);
+					double waitStart = 0.0;
+					if (profile.enabled && (!graphicsPipeline->pipeline[(size_t)rpType] || !graphicsPipeline->pipeline[(size_t)rpType]->IsReady())) {
+						waitStart = time_now_d();
+					}
 					if (!graphicsPipeline->pipeline[(size_t)rpType]) {
 						// NOTE: If render steps got merged, it can happen that, as they ended during recording,
 						// they didn't know their final render pass type so they created the wrong pipelines in EndCurRenderStep().
@@ -1113,6 +1117,10 @@ void VulkanQueueRunner::PerformRenderPass(const VKRStep &step, VkCommandBuffer c
 						graphicsPipeline->Create(vulkan_, renderPass->Get(vulkan_, rpType, fbSampleCount), rpType, fbSampleCount, time_now_d(), -1);
 					}
 					pipeline = graphicsPipeline->pipeline[(size_t)rpType]->BlockUntilReady();
+					if (waitStart != 0.0) {
+						profile.pipelineWaitTime += time_now_d() - waitStart;
+						profile.pipelineWaits++;
+					}
 				}
 
 				if (pipeline != VK_NULL_HANDLE) {
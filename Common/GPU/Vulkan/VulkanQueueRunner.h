@@ -205,6 +205,8 @@ struct VKRRenderThreadTask {
 	std::vector<VKRStep *> steps;
 	int frame = -1;
 	VKRRunType runType;
+	// Only set while frame tracing, for the render queue delay.
+	double enqueueTime = 0.0;
 
 	// Avoid copying these by accident.
 	VKRRenderThreadTask(VKRRenderThreadTask &) = delete;
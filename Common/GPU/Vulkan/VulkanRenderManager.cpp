@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <cstdint>
 
 #include <map>
 #include <sstream>
 
 #include "Common/Log.h"
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/StringUtils.h"
 #include "Common/TimeUtil.h"
 
@@ -248,7 +250,8 @@ struct SinglePipelineTask {
 
 class CreateMultiPipelinesTask : public Task {
 public:
-	CreateMultiPipelinesTask(VulkanContext *vulkan, std::vector<SinglePipelineTask> tasks) : vulkan_(vulkan), tasks_(std::move(tasks)) {
+	CreateMultiPipelinesTask(VulkanContext *vulkan, std::vector<SinglePipelineTask> tasks, TaskPriority priority, std::atomic<int> *pending, std::atomic<int> *compiled)
+		: vulkan_(vulkan), tasks_(std::move(tasks)), priority_(priority), pending_(pending), compiled_(compiled) {
 		tasksInFlight_.fetch_add(1);
 	}
 	~CreateMultiPipelinesTask() = default;
@@ -258,18 +261,23 @@ class CreateMultiPipelinesTask : public Task {
 	}
 
 	TaskPriority Priority() const override {
-		return TaskPriority::HIGH;
+		return priority_;
 	}
 
 	void Run() override {
 		for (auto &task : tasks_) {
 			task.pipeline->Create(vulkan_, task.compatibleRenderPass, task.rpType, task.sampleCount, task.scheduleTime, task.countToCompile);
+			pending_->fetch_sub(1);
+			compiled_->fetch_add(1);
 		}
 		tasksInFlight_.fetch_sub(1);
 	}
 
 	VulkanContext *vulkan_;
 	std::vector<SinglePipelineTask> tasks_;
+	TaskPriority priority_;
+	std::atomic<int> *pending_;
+	std::atomic<int> *compiled_;
 
 	// Use during shutdown to make sure there aren't any leftover tasks sitting queued.
 	// Could probably be done more elegantly. Like waiting for all tasks of a type, or saving pointers to them, or something...
@@ -556,8 +564,11 @@ void VulkanRenderManager::CompileThreadFunc() {
 
 		int countToCompile = (int)toCompile.size();
 
-		// Here we sort the pending pipelines by vertex and fragment shaders,
-		std::map<std::pair<Promise<VkShaderModule> *, Promise<VkShaderModule> *>, std::vector<SinglePipelineTask>> map;
+		// Here we sort the pending pipelines by vertex and fragment shaders, separately for urgent and background ones.
+		typedef std::map<std::pair<Promise<VkShaderModule> *, Promise<VkShaderModule> *>, std::vector<SinglePipelineTask>> PipelinesByShaders;
+		PipelinesByShaders urgentMap;
+		PipelinesByShaders backgroundMap;
+		int urgentCount = 0;
 
 		double scheduleTime = time_now_d();
 
@@ -569,6 +580,10 @@ void VulkanRenderManager::CompileThreadFunc() {
 			switch (entry.type) {
 			case CompileQueueEntry::Type::GRAPHICS:
 			{
+				PipelinesByShaders &map = entry.urgent ? urgentMap : backgroundMap;
+				if (entry.urgent) {
+					urgentCount++;
+				}
 				map[std::make_pair(entry.graphics->desc->vertexShader, entry.graphics->desc->fragmentShader)].push_back(
 					SinglePipelineTask{
 						entry.graphics,
@@ -584,13 +599,26 @@ void VulkanRenderManager::CompileThreadFunc() {
 			}
 		}
 
-		for (const auto &iter : map) {
-			auto &shaders = iter.first;
+		// Something is going to block on the urgent pipelines soon, so they go first and at high priority.
+		// Here, spreading them over all the worker threads matters more than keeping shader pairs together,
+		// so a big group for one shader pair (like many blend variants) gets split up too.
+		int numThreads = std::max(1, g_threadManager.GetNumLooperThreads());
+		size_t urgentPerTask = (size_t)std::max(1, (urgentCount + numThreads - 1) / numThreads);
+		for (const auto &iter : urgentMap) {
+			auto &entries = iter.second;
+			for (size_t i = 0; i < entries.size(); i += urgentPerTask) {
+				std::vector<SinglePipelineTask> chunk(entries.begin() + i, entries.begin() + std::min(entries.size(), i + urgentPerTask));
+				Task *task = new CreateMultiPipelinesTask(vulkan_, std::move(chunk), TaskPriority::HIGH, &pipelinesPending_, &pipelinesCompiled_);
+				g_threadManager.EnqueueTask(task);
+			}
+		}
+
+		for (const auto &iter : backgroundMap) {
 			auto &entries = iter.second;
 
 			// NOTICE_LOG(Log::G3D, "For this shader pair, we have %d pipelines to create", (int)entries.size());
 
-			Task *task = new CreateMultiPipelinesTask(vulkan_, entries);
+			Task *task = new CreateMultiPipelinesTask(vulkan_, entries, TaskPriority::NORMAL, &pipelinesPending_, &pipelinesCompiled_);
 			g_threadManager.EnqueueTask(task);
 		}
 
@@ -622,6 +650,11 @@ void VulkanRenderManager::RenderThreadFunc() {
 			renderThreadQueue_.pop();
 		}
 
+		if (task->enqueueTime != 0.0) {
+			uint64_t traceFrame = frameTimeHistory_[frameData_[task->frame].frameId].traceFrame;
+			FrameTrace::Add(FrameTraceStage::RENDER_QUEUE, traceFrame, task->enqueueTime, time_now_d());
+		}
+
 		// Oh, we got a task! We can now have pushMutex_ unlocked, allowing the host to
 		// push more work when it feels like it, and just start working.
 		if (task->runType == VKRRunType::EXIT) {
@@ -651,8 +684,12 @@ void VulkanRenderManager::PresentWaitThreadFunc() {
 	while (runCompileThread_) {
 		const uint64_t timeout = 1000000000ULL;  // 1 sec
 		if (VK_SUCCESS == vkWaitForPresentKHR(vulkan_->GetDevice(), vulkan_->GetSwapchain(), waitedId, timeout)) {
-			frameTimeHistory_[waitedId].actualPresent = time_now_d();
-			frameTimeHistory_[waitedId].waitCount++;
+			FrameTimeData &frameTimeData = frameTimeHistory_[waitedId];
+			frameTimeData.actualPresent = time_now_d();
+			frameTimeData.waitCount++;
+			if (frameTimeData.traceFrame != 0 && frameTimeData.queuePresent != 0.0) {
+				FrameTrace::Add(FrameTraceStage::DISPLAY, frameTimeData.traceFrame, frameTimeData.queuePresent, frameTimeData.actualPresent);
+			}
 			waitedId++;
 		} else {
 			// We caught up somehow, which is a bad sign (we should have blocked, right?). Maybe we should break out of the loop?
@@ -739,7 +776,20 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling, bool enableLogProfile
 
 	uint64_t queryResults[MAX_TIMESTAMP_QUERIES];
 
+	// Pipeline compile counters since the last frame. The wait time is from the last time this frame slot was used,
+	// like the rest of frameData.profile.
+	int pipelinesCompiled = pipelinesCompiled_.exchange(0);
+	int pipelinesPendingPeak;
+	{
+		std::lock_guard<std::mutex> lock(compileQueueMutex_);
+		pipelinesPendingPeak = pipelinesPendingPeak_;
+		pipelinesPendingPeak_ = pipelinesPending_;
+	}
+
 	if (enableProfiling) {
+		char pipelineStats[256];
+		snprintf(pipelineStats, sizeof(pipelineStats), "Pipelines compiled: %d (queue peak: %d, pending: %d)\nPipeline waits: %d (%0.3f ms)\n",
+			pipelinesCompiled, pipelinesPendingPeak, pipelinesPending_.load(), frameData.profile.pipelineWaits, frameData.profile.pipelineWaitTime * 1000.0);
 		// Pull the profiling results from last time and produce a summary!
 		if (!frameData.profile.timestampDescriptions.empty() && frameData.profile.timestampsEnabled) {
 			int numQueries = (int)frameData.profile.timestampDescriptions.size();
@@ -766,6 +816,7 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling, bool enableLogProfile
 				str << line;
 				snprintf(line, sizeof(line), "Resource deletions: %d\n", vulkan_->GetLastDeleteCount());
 				str << line;
+				str << pipelineStats;
 				for (int i = 0; i < numQueries - 1; i++) {
 					uint64_t diff = (queryResults[i + 1] - queryResults[i]) & timestampDiffMask;
 					double milliseconds = (double)diff * timestampConversionFactor;
@@ -796,6 +847,7 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling, bool enableLogProfile
 			str << line;
 			snprintf(line, sizeof(line), "Descriptors written: %d\n", frameData.profile.descriptorsWritten);
 			str << line;
+			str << pipelineStats;
 			frameData.profile.profileSummary = str.str();
 		}
 
@@ -813,6 +865,8 @@ void VulkanRenderManager::BeginFrame(bool enableProfiling, bool enableLogProfile
 
 	frameData.profile.descriptorsWritten = 0;
 	frameData.profile.descriptorsDeduped = 0;
+	frameData.profile.pipelineWaits = 0;
+	frameData.profile.pipelineWaitTime = 0.0;
 
 	// Must be after the fence - this performs deletes.
 	VLOG("PUSH: BeginFrame %d", curFrame);
@@ -905,7 +959,8 @@ VKRGraphicsPipeline *VulkanRenderManager::CreateGraphicsPipeline(VKRGraphicsPipe
 			// Sanity check
 			if (runCompileThread_) {
 				pipeline->pipeline[i] = Promise<VkPipeline>::CreateEmpty();
-				compileQueue_.emplace_back(pipeline, compatibleRenderPass->Get(vulkan_, rpType, sampleCount), rpType, sampleCount);
+				compileQueue_.emplace_back(pipeline, compatibleRenderPass->Get(vulkan_, rpType, sampleCount), rpType, sampleCount, false);
+				AddPendingPipeline();
 			}
 			needsCompile = true;
 		}
@@ -969,7 +1024,8 @@ void VulkanRenderManager::EndCurRenderStep() {
 
 			_assert_(renderPass);
 			compileQueueMutex_.lock();
-			compileQueue_.emplace_back(pipeline, renderPass->Get(vulkan_, rpType, sampleCount), rpType, sampleCount);
+			compileQueue_.emplace_back(pipeline, renderPass->Get(vulkan_, rpType, sampleCount), rpType, sampleCount, true);
+			AddPendingPipeline();
 			compileQueueMutex_.unlock();
 			needsCompile = true;
 		}
@@ -1541,6 +1597,11 @@ void VulkanRenderManager::Finish() {
 		}
 	}
 
+	// Lets users record anything they've been batching up into the init command buffer before it's submitted.
+	if (invalidationCallback_) {
+		invalidationCallback_(InvalidationCallbackFlags::COMMAND_BUFFER_STATE);
+	}
+
 	int curFrame = vulkan_->GetCurFrame();
 	FrameData &frameData = frameData_[curFrame];
 
@@ -1552,6 +1613,10 @@ void VulkanRenderManager::Finish() {
 	VLOG("PUSH: Frame[%d]", curFrame);
 	VKRRenderThreadTask *task = new VKRRenderThreadTask(VKRRunType::SUBMIT);
 	task->frame = curFrame;
+	if (FrameTrace::IsEnabled()) {
+		frameTimeHistory_[frameData.frameId].traceFrame = FrameTrace::CurrentFrame();
+		task->enqueueTime = time_now_d();
+	}
 	if (useRenderThread_) {
 		std::unique_lock<std::mutex> lock(pushMutex_);
 		renderThreadQueue_.push(task);
@@ -1591,6 +1656,7 @@ void VulkanRenderManager::Present() {
 // Can be called again after a VKRRunType::SYNC on the same frame.
 void VulkanRenderManager::Run(VKRRenderThreadTask &task) {
 	FrameData &frameData = frameData_[task.frame];
+	FrameTraceScope traceScope(task.runType == VKRRunType::PRESENT ? FrameTraceStage::PRESENT : FrameTraceStage::RENDER, frameTimeHistory_[frameData.frameId].traceFrame);
 
 	if (task.runType == VKRRunType::PRESENT) {
 		if (!frameData.skipSwap) {
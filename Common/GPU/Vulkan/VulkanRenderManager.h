@@ -148,8 +148,8 @@ struct VKRGraphicsPipeline {
 };
 
 struct CompileQueueEntry {
-	CompileQueueEntry(VKRGraphicsPipeline *p, VkRenderPass _compatibleRenderPass, RenderPassType _renderPassType, VkSampleCountFlagBits _sampleCount)
-		: type(Type::GRAPHICS), graphics(p), compatibleRenderPass(_compatibleRenderPass), renderPassType(_renderPassType), sampleCount(_sampleCount) {}
+	CompileQueueEntry(VKRGraphicsPipeline *p, VkRenderPass _compatibleRenderPass, RenderPassType _renderPassType, VkSampleCountFlagBits _sampleCount, bool _urgent)
+		: type(Type::GRAPHICS), compatibleRenderPass(_compatibleRenderPass), renderPassType(_renderPassType), graphics(p), sampleCount(_sampleCount), urgent(_urgent) {}
 	enum class Type {
 		GRAPHICS,
 	};
@@ -158,6 +158,9 @@ struct CompileQueueEntry {
 	RenderPassType renderPassType;
 	VKRGraphicsPipeline* graphics = nullptr;
 	VkSampleCountFlagBits sampleCount;
+	// Set for pipelines that a recorded render step will bind, so the render thread will block on them soon.
+	// The rest (shader cache loads, precompiled variants) can wait behind those.
+	bool urgent;
 };
 
 // Pending descriptor sets.
@@ -551,6 +554,13 @@ class VulkanRenderManager {
 
 	void RenderThreadFunc();
 	void CompileThreadFunc();
+	// Call with compileQueueMutex_ held, for each entry added to compileQueue_.
+	void AddPendingPipeline() {
+		int pending = pipelinesPending_.fetch_add(1) + 1;
+		if (pending > pipelinesPendingPeak_) {
+			pipelinesPendingPeak_ = pending;
+		}
+	}
 
 	void Run(VKRRenderThreadTask &task);
 
@@ -623,6 +633,11 @@ class VulkanRenderManager {
 	std::mutex compileQueueMutex_;
 	std::vector<CompileQueueEntry> compileQueue_;
 
+	// Pipelines queued or being compiled. The peak is protected by compileQueueMutex_ and reset every frame.
+	std::atomic<int> pipelinesPending_{};
+	int pipelinesPendingPeak_ = 0;
+	std::atomic<int> pipelinesCompiled_{};
+
 	// Thread for measuring presentation delay.
 	std::thread presentWaitThread_;
 
@@ -0,0 +1,270 @@
+// Copyright (c) 2025- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if !PPSSPP_PLATFORM(WINDOWS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ext/xxhash.h"
+
+#include "Common/Log.h"
+#include "Common/File/FileUtil.h"
+#include "Common/GPU/Vulkan/VulkanSpirvCache.h"
+
+// File layout: header, index sorted by key, then the SPIR-V words. All offsets are from the start of the file.
+struct SpirvCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t compilerVersion;
+	uint32_t count;
+};
+
+static const char SPIRV_CACHE_MAGIC[4] = { 'S', 'P', 'V', 'C' };
+static const uint32_t SPIRV_CACHE_VERSION = 1;
+
+SpirvCache::~SpirvCache() {
+	Unmap();
+}
+
+void SpirvCache::Unmap() {
+#if !PPSSPP_PLATFORM(WINDOWS)
+	if (mapped_ && base_) {
+		munmap((void *)base_, baseSize_);
+	}
+#endif
+	mapped_ = false;
+	base_ = nullptr;
+	baseSize_ = 0;
+	fileData_.clear();
+	fileData_.shrink_to_fit();
+	index_ = nullptr;
+	indexCount_ = 0;
+}
+
+void SpirvCache::Clear() {
+	Unmap();
+	std::lock_guard<std::mutex> guard(lock_);
+	added_.clear();
+}
+
+bool SpirvCache::Load(const Path &filename) {
+	Unmap();
+
+#if !PPSSPP_PLATFORM(WINDOWS)
+	if (filename.Type() == PathType::NATIVE) {
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED) {
+				base_ = (const uint8_t *)ptr;
+				baseSize_ = (size_t)st.st_size;
+				mapped_ = true;
+			}
+		}
+		close(fd);
+	}
+#endif
+	if (!base_) {
+		if (!File::ReadBinaryFileToString(filename, &fileData_)) {
+			return false;
+		}
+		base_ = (const uint8_t *)fileData_.data();
+		baseSize_ = fileData_.size();
+	}
+
+	SpirvCacheHeader header;
+	if (baseSize_ < sizeof(header)) {
+		Unmap();
+		return false;
+	}
+	memcpy(&header, base_, sizeof(header));
+	if (memcmp(header.magic, SPIRV_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != SPIRV_CACHE_VERSION) {
+		WARN_LOG(Log::G3D, "SPIR-V cache header mismatch - ignoring");
+		Unmap();
+		return false;
+	}
+	if (header.compilerVersion != GLSLtoSPVVersion()) {
+		INFO_LOG(Log::G3D, "SPIR-V cache is from a different glslang version - ignoring");
+		Unmap();
+		return false;
+	}
+	if ((baseSize_ - sizeof(header)) / sizeof(IndexEntry) < header.count) {
+		WARN_LOG(Log::G3D, "SPIR-V cache truncated - ignoring");
+		Unmap();
+		return false;
+	}
+
+	// The data offsets are checked lazily in Lookup, so we don't have to touch the pages here.
+	index_ = (const IndexEntry *)(base_ + sizeof(header));
+	indexCount_ = header.count;
+	INFO_LOG(Log::G3D, "Loaded SPIR-V cache index with %d modules (%d KB%s)", (int)indexCount_, (int)(baseSize_ / 1024), mapped_ ? ", mapped" : "");
+	return true;
+}
+
+bool SpirvCache::Save(const Path &filename) {
+	std::vector<IndexEntry> index;
+	std::vector<const uint32_t *> sources;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		if (added_.empty()) {
+			return true;
+		}
+
+		index.reserve(indexCount_ + added_.size());
+		sources.reserve(indexCount_ + added_.size());
+		for (uint32_t i = 0; i < indexCount_; i++) {
+			const IndexEntry &entry = index_[i];
+			// Skip anything that wouldn't pass Lookup, we'd just be writing garbage again.
+			if (entry.offset + (uint64_t)entry.size * 4 > baseSize_ || (entry.offset & 3) != 0 || added_.count(entry.key)) {
+				continue;
+			}
+			index.push_back(entry);
+			sources.push_back((const uint32_t *)(base_ + entry.offset));
+		}
+		for (auto &it : added_) {
+			IndexEntry entry{};
+			entry.key = it.first;
+			entry.dataHash = XXH3_64bits(it.second.data(), it.second.size() * sizeof(uint32_t));
+			entry.size = (uint32_t)it.second.size();
+			index.push_back(entry);
+			sources.push_back(it.second.data());
+		}
+	}
+
+	// Sort both by key, through a permutation.
+	std::vector<uint32_t> order(index.size());
+	for (uint32_t i = 0; i < (uint32_t)order.size(); i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return index[a].key < index[b].key;
+	});
+
+	SpirvCacheHeader header{};
+	memcpy(header.magic, SPIRV_CACHE_MAGIC, sizeof(header.magic));
+	header.version = SPIRV_CACHE_VERSION;
+	header.compilerVersion = GLSLtoSPVVersion();
+	header.count = (uint32_t)index.size();
+
+	size_t dataStart = sizeof(header) + index.size() * sizeof(IndexEntry);
+	size_t totalSize = dataStart;
+	std::vector<IndexEntry> sortedIndex;
+	sortedIndex.reserve(index.size());
+	for (uint32_t i : order) {
+		IndexEntry entry = index[i];
+		entry.offset = (uint32_t)totalSize;
+		totalSize += entry.size * sizeof(uint32_t);
+		sortedIndex.push_back(entry);
+	}
+	if (totalSize > 0xFFFFFFFF) {
+		ERROR_LOG(Log::G3D, "SPIR-V cache too large, not saving");
+		return false;
+	}
+
+	std::string data;
+	data.resize(totalSize);
+	memcpy(&data[0], &header, sizeof(header));
+	memcpy(&data[sizeof(header)], sortedIndex.data(), sortedIndex.size() * sizeof(IndexEntry));
+	for (size_t i = 0; i < sortedIndex.size(); i++) {
+		memcpy(&data[sortedIndex[i].offset], sources[order[i]], sortedIndex[i].size * sizeof(uint32_t));
+	}
+
+	// The old file may still be mapped, so write a new one and rename it over.
+	Path tempFilename = filename.WithExtraExtension(".tmp");
+	if (!File::WriteDataToFile(false, data.data(), data.size(), tempFilename) || !File::Rename(tempFilename, filename)) {
+		WARN_LOG(Log::G3D, "Failed to save SPIR-V cache to %s", filename.c_str());
+		File::Delete(tempFilename, true);
+		return false;
+	}
+	INFO_LOG(Log::G3D, "Saved SPIR-V cache with %d modules (%d KB)", (int)sortedIndex.size(), (int)(totalSize / 1024));
+	return true;
+}
+
+uint64_t SpirvCache::HashSource(VkShaderStageFlagBits stage, const char *code, GLSLVariant variant) {
+	uint64_t seed = ((uint64_t)stage << 32) | (uint64_t)variant;
+	return XXH3_64bits_withSeed(code, strlen(code), seed);
+}
+
+const SpirvCache::IndexEntry *SpirvCache::FindLoaded(uint64_t key) const {
+	const IndexEntry *end = index_ + indexCount_;
+	const IndexEntry *it = std::lower_bound(index_, end, key, [](const IndexEntry &entry, uint64_t k) {
+		return entry.key < k;
+	});
+	if (it != end && it->key == key) {
+		return it;
+	}
+	return nullptr;
+}
+
+bool SpirvCache::Lookup(uint64_t key, std::vector<uint32_t> *spirv) {
+	const IndexEntry *entry = index_ ? FindLoaded(key) : nullptr;
+	if (entry && entry->size != 0 && (entry->offset & 3) == 0 && entry->offset + (uint64_t)entry->size * 4 <= baseSize_) {
+		const uint8_t *data = base_ + entry->offset;
+		// A bad module could crash the driver, so it's worth verifying.
+		if (XXH3_64bits(data, entry->size * sizeof(uint32_t)) == entry->dataHash) {
+			spirv->resize(entry->size);
+			memcpy(spirv->data(), data, entry->size * sizeof(uint32_t));
+			hits_++;
+			return true;
+		}
+		WARN_LOG(Log::G3D, "Corrupt SPIR-V cache entry %016llx", (unsigned long long)key);
+	}
+
+	std::lock_guard<std::mutex> guard(lock_);
+	auto it = added_.find(key);
+	if (it != added_.end()) {
+		*spirv = it->second;
+		hits_++;
+		return true;
+	}
+	misses_++;
+	return false;
+}
+
+void SpirvCache::Insert(uint64_t key, const std::vector<uint32_t> &spirv) {
+	std::lock_guard<std::mutex> guard(lock_);
+	added_[key] = spirv;
+}
+
+size_t SpirvCache::Size() {
+	std::lock_guard<std::mutex> guard(lock_);
+	return indexCount_ + added_.size();
+}
+
+bool SpirvCache::Compile(VkShaderStageFlagBits stage, const char *code, GLSLVariant variant, std::vector<uint32_t> &spirv, std::string *errorMessage) {
+	uint64_t key = HashSource(stage, code, variant);
+	if (Lookup(key, &spirv)) {
+		return true;
+	}
+	if (!GLSLtoSPV(stage, code, variant, spirv, errorMessage)) {
+		return false;
+	}
+	Insert(key, spirv);
+	return true;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2025- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/File/Path.h"
+#include "Common/GPU/Vulkan/VulkanContext.h"
+
+// Content-addressed disk cache of GLSLtoSPV output, keyed by a hash of the GLSL source, stage and variant.
+// The whole file is invalidated when the glslang version changes.
+//
+// The file is memory-mapped (where possible) and only the index is touched at load, so loading a large
+// cache is nearly free. Lookups are thread-safe, and so is Save(), but Load() must not race with lookups.
+class SpirvCache {
+public:
+	SpirvCache() {}
+	~SpirvCache();
+
+	bool Load(const Path &filename);
+	// Writes the loaded entries plus anything new. Does nothing if nothing was added.
+	bool Save(const Path &filename);
+	void Clear();
+
+	// Same as GLSLtoSPV, but goes through the cache. Failed compiles aren't cached.
+	bool Compile(VkShaderStageFlagBits stage, const char *code, GLSLVariant variant, std::vector<uint32_t> &spirv, std::string *errorMessage);
+
+	static uint64_t HashSource(VkShaderStageFlagBits stage, const char *code, GLSLVariant variant);
+	bool Lookup(uint64_t key, std::vector<uint32_t> *spirv);
+	void Insert(uint64_t key, const std::vector<uint32_t> &spirv);
+
+	size_t Size();
+	uint64_t Hits() const { return hits_; }
+	uint64_t Misses() const { return misses_; }
+
+private:
+	struct IndexEntry {
+		uint64_t key;
+		uint64_t dataHash;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	const IndexEntry *FindLoaded(uint64_t key) const;
+	void Unmap();
+
+	// The loaded file, either mapped or read into fileData_.
+	const uint8_t *base_ = nullptr;
+	size_t baseSize_ = 0;
+	bool mapped_ = false;
+	std::string fileData_;
+	const IndexEntry *index_ = nullptr;
+	uint32_t indexCount_ = 0;
+
+	std::mutex lock_;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> added_;
+
+	std::atomic<uint64_t> hits_{};
+	std::atomic<uint64_t> misses_{};
+};
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "Common/Data/Format/JSONWriter.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
+#include "Common/Log.h"
+#include "Common/Profiler/FrameTrace.h"
+#include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
+
+// Enough for a minute or so of frames, with a handful of GE lists each.
+static const size_t FRAME_TRACE_MAX_EVENTS = 65536;
+static const size_t FRAME_TRACE_MAX_FRAMES = 1024;
+
+static const char *const g_stageNames[] = {
+	"Emu",
+	"GE list",
+	"Draw submit",
+	"Render queue",
+	"Render",
+	"Present",
+	"Display",
+};
+static_assert(sizeof(g_stageNames) / sizeof(g_stageNames[0]) == (size_t)FrameTraceStage::COUNT, "Stage names out of sync");
+
+const char *FrameTraceStageName(FrameTraceStage stage) {
+	return stage < FrameTraceStage::COUNT ? g_stageNames[(int)stage] : "N/A";
+}
+
+namespace FrameTrace {
+
+std::atomic<bool> g_enabled;
+
+static std::mutex g_lock;
+// Ring buffers, only allocated while enabled.
+static std::vector<FrameTraceEvent> g_events;
+static size_t g_eventPos;
+static std::vector<FrameTraceFrame> g_frames;
+
+static Path g_reportFilename;
+
+static std::atomic<uint64_t> g_curFrame;
+// Emu thread only.
+static double g_frameBegin;
+static double g_pendingTime[(int)FrameTraceStage::COUNT];
+static int g_pendingCount[(int)FrameTraceStage::COUNT];
+
+// Must hold g_lock. Returns nullptr if the frame has already dropped out of the history.
+static FrameTraceFrame *GetFrame(uint64_t frame) {
+	if (g_frames.empty() || frame == 0) {
+		return nullptr;
+	}
+	FrameTraceFrame &f = g_frames[frame % FRAME_TRACE_MAX_FRAMES];
+	if (f.frame == frame) {
+		return &f;
+	} else if (f.frame > frame) {
+		return nullptr;
+	}
+	f = FrameTraceFrame{};
+	f.frame = frame;
+	return &f;
+}
+
+void SetEnabled(bool enabled) {
+	std::lock_guard<std::mutex> guard(g_lock);
+	if (enabled && !g_enabled) {
+		g_events.clear();
+		g_events.reserve(FRAME_TRACE_MAX_EVENTS);
+		g_eventPos = 0;
+		g_frames.assign(FRAME_TRACE_MAX_FRAMES, FrameTraceFrame{});
+		memset(g_pendingTime, 0, sizeof(g_pendingTime));
+		memset(g_pendingCount, 0, sizeof(g_pendingCount));
+		g_frameBegin = 0.0;
+	}
+	g_enabled = enabled;
+	INFO_LOG(Log::System, "Frame trace %s", enabled ? "enabled" : "disabled");
+}
+
+void BeginFrame() {
+	uint64_t frame = ++g_curFrame;
+	if (!IsEnabled()) {
+		return;
+	}
+
+	g_frameBegin = time_now_d();
+	std::lock_guard<std::mutex> guard(g_lock);
+	FrameTraceFrame *f = GetFrame(frame);
+	if (f) {
+		f->begin = g_frameBegin;
+	}
+}
+
+void EndFrame() {
+	if (!IsEnabled() || g_frameBegin == 0.0) {
+		return;
+	}
+
+	const uint64_t frame = g_curFrame;
+	Add(FrameTraceStage::EMU, frame, g_frameBegin, time_now_d());
+
+	std::lock_guard<std::mutex> guard(g_lock);
+	FrameTraceFrame *f = GetFrame(frame);
+	for (int i = 0; i < (int)FrameTraceStage::COUNT; i++) {
+		if (f) {
+			f->time[i] += g_pendingTime[i];
+			f->count[i] += g_pendingCount[i];
+		}
+		g_pendingTime[i] = 0.0;
+		g_pendingCount[i] = 0;
+	}
+	g_frameBegin = 0.0;
+}
+
+uint64_t CurrentFrame() {
+	return g_curFrame;
+}
+
+void Add(FrameTraceStage stage, uint64_t frame, double start, double end) {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(g_lock);
+	if (g_frames.empty()) {
+		// Raced with SetEnabled.
+		return;
+	}
+	FrameTraceEvent event{ frame, start, end, stage };
+	if (g_events.size() < FRAME_TRACE_MAX_EVENTS) {
+		g_events.push_back(event);
+	} else {
+		g_events[g_eventPos] = event;
+	}
+	g_eventPos = (g_eventPos + 1) % FRAME_TRACE_MAX_EVENTS;
+
+	FrameTraceFrame *f = GetFrame(frame);
+	if (f) {
+		f->time[(int)stage] += end - start;
+		f->count[(int)stage]++;
+	}
+}
+
+void AddTime(FrameTraceStage stage, double seconds) {
+	if (!IsEnabled()) {
+		return;
+	}
+	g_pendingTime[(int)stage] += seconds;
+	g_pendingCount[(int)stage]++;
+}
+
+void GetFrames(std::vector<FrameTraceFrame> *frames, size_t maxFrames) {
+	std::lock_guard<std::mutex> guard(g_lock);
+	if (g_frames.empty()) {
+		return;
+	}
+	maxFrames = std::min(maxFrames, FRAME_TRACE_MAX_FRAMES);
+	for (uint64_t frame = g_curFrame; frame > 0 && frames->size() < maxFrames; frame--) {
+		const FrameTraceFrame &f = g_frames[frame % FRAME_TRACE_MAX_FRAMES];
+		if (f.frame != frame) {
+			break;
+		}
+		frames->push_back(f);
+	}
+}
+
+void GetEvents(std::vector<FrameTraceEvent> *events) {
+	std::lock_guard<std::mutex> guard(g_lock);
+	// Oldest first.
+	if (g_events.size() == FRAME_TRACE_MAX_EVENTS) {
+		events->insert(events->end(), g_events.begin() + g_eventPos, g_events.end());
+		events->insert(events->end(), g_events.begin(), g_events.begin() + g_eventPos);
+	} else {
+		events->insert(events->end(), g_events.begin(), g_events.end());
+	}
+}
+
+// Chrome's trace viewer sorts threads by id, so these are in pipeline order.
+static int ChromeThreadId(FrameTraceStage stage) {
+	switch (stage) {
+	case FrameTraceStage::EMU:
+	case FrameTraceStage::GE_LIST:
+	case FrameTraceStage::DRAW_SUBMIT:
+		return 1;
+	case FrameTraceStage::RENDER_QUEUE:
+		return 2;
+	case FrameTraceStage::RENDER:
+		return 3;
+	case FrameTraceStage::PRESENT:
+		return 4;
+	case FrameTraceStage::DISPLAY:
+	default:
+		return 5;
+	}
+}
+
+static std::string ChromeTimestamp(double t) {
+	return StringFromFormat("%0.3f", t * 1000000.0);
+}
+
+std::string ToChromeJSON() {
+	std::vector<FrameTraceEvent> events;
+	GetEvents(&events);
+	std::vector<FrameTraceFrame> frames;
+	GetFrames(&frames, FRAME_TRACE_MAX_FRAMES);
+
+	json::JsonWriter j;
+	j.begin();
+	j.writeString("displayTimeUnit", "ms");
+	{
+		json::JsonWriter::ArrayScope traceEvents(j, "traceEvents");
+
+		static const char *const threadNames[] = { "Emu thread", "Render queue", "Render thread", "Present", "Display" };
+		for (int i = 0; i < 5; i++) {
+			json::JsonWriter::DictScope meta(j);
+			j.writeString("name", "thread_name");
+			j.writeString("ph", "M");
+			j.writeInt("pid", 1);
+			j.writeInt("tid", i + 1);
+			json::JsonWriter::DictScope args(j, "args");
+			j.writeString("name", threadNames[i]);
+		}
+
+		for (const FrameTraceEvent &event : events) {
+			json::JsonWriter::DictScope e(j);
+			j.writeString("name", FrameTraceStageName(event.stage));
+			j.writeString("cat", "frame");
+			j.writeString("ph", "X");
+			j.writeRaw("ts", ChromeTimestamp(event.start));
+			j.writeRaw("dur", ChromeTimestamp(event.end - event.start));
+			j.writeInt("pid", 1);
+			j.writeInt("tid", ChromeThreadId(event.stage));
+			json::JsonWriter::DictScope args(j, "args");
+			j.writeUint("frame", (uint32_t)event.frame);
+		}
+
+		// The summed stages become counters, at the start of each frame.
+		for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+			if (it->begin == 0.0 || it->count[(int)FrameTraceStage::DRAW_SUBMIT] == 0) {
+				continue;
+			}
+			json::JsonWriter::DictScope e(j);
+			j.writeString("name", "Draw submit (ms)");
+			j.writeString("ph", "C");
+			j.writeRaw("ts", ChromeTimestamp(it->begin));
+			j.writeInt("pid", 1);
+			json::JsonWriter::DictScope args(j, "args");
+			j.writeFloat("ms", it->time[(int)FrameTraceStage::DRAW_SUBMIT] * 1000.0);
+		}
+	}
+	j.end();
+	return j.str();
+}
+
+bool WriteChromeJSON(const Path &filename) {
+	std::string data = ToChromeJSON();
+	if (!File::WriteStringToFile(true, data, filename)) {
+		ERROR_LOG(Log::System, "Failed to write frame trace to %s", filename.c_str());
+		return false;
+	}
+	INFO_LOG(Log::System, "Wrote frame trace to %s", filename.c_str());
+	return true;
+}
+
+void SetReportFilename(const Path &filename) {
+	g_reportFilename = filename;
+	if (!filename.empty())
+		SetEnabled(true);
+}
+
+void WriteReportIfRequested() {
+	if (g_reportFilename.empty())
+		return;
+	WriteChromeJSON(g_reportFilename);
+}
+
+}  // namespace FrameTrace
+
+double FrameTraceScope::Now() {
+	return time_now_d();
+}
+
+void FrameTraceScope::Finish() {
+	double end = time_now_d();
+	if (stage_ == FrameTraceStage::DRAW_SUBMIT) {
+		FrameTrace::AddTime(stage_, end - start_);
+	} else {
+		FrameTrace::Add(stage_, frame_ != 0 ? frame_ : FrameTrace::CurrentFrame(), start_, end);
+	}
+}
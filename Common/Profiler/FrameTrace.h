@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Path;
+
+// Per-frame timeline of the stages between the emulated CPU and the display, across the emu thread,
+// the render thread and present. Timestamps are from time_now_d().
+//
+// Everything is keyed by the emu frame number from FrameTrace::BeginFrame(). Work done later on other
+// threads (render thread, present) is attributed to the emu frame that produced it.
+//
+// Costs a relaxed atomic load per call site when disabled.
+
+enum class FrameTraceStage : uint8_t {
+	// Emu thread, from GPU BeginHostFrame to EndHostFrame.
+	EMU,
+	// Processing GE display lists, on the emu thread.
+	GE_LIST,
+	// Draw engine flushes, that is handing draws to the backend. Only summed per frame.
+	DRAW_SUBMIT,
+	// From the emu thread handing the frame over, until the render thread starts on it.
+	RENDER_QUEUE,
+	// Render thread running the frame's steps.
+	RENDER,
+	// Queueing the present (or swap).
+	PRESENT,
+	// From queueing the present until it was reported to be on screen. Only where the backend can tell.
+	DISPLAY,
+
+	COUNT,
+};
+
+const char *FrameTraceStageName(FrameTraceStage stage);
+
+struct FrameTraceEvent {
+	uint64_t frame;
+	double start;
+	double end;
+	FrameTraceStage stage;
+};
+
+struct FrameTraceFrame {
+	uint64_t frame;
+	double begin;
+	// Total seconds spent in each stage, and how many events made them up.
+	double time[(int)FrameTraceStage::COUNT];
+	int count[(int)FrameTraceStage::COUNT];
+};
+
+namespace FrameTrace {
+
+extern std::atomic<bool> g_enabled;
+
+inline bool IsEnabled() {
+	return g_enabled.load(std::memory_order_relaxed);
+}
+
+// Clears the history when enabling.
+void SetEnabled(bool enabled);
+
+// Emu thread only.
+void BeginFrame();
+void EndFrame();
+// The frame most recently begun on the emu thread, for tagging work handed to other threads.
+uint64_t CurrentFrame();
+
+void Add(FrameTraceStage stage, uint64_t frame, double start, double end);
+// For stages that happen too often to keep as separate events. Emu thread only.
+void AddTime(FrameTraceStage stage, double seconds);
+
+// Most recent frames first. Frames that are still being worked on may be incomplete.
+void GetFrames(std::vector<FrameTraceFrame> *frames, size_t maxFrames);
+void GetEvents(std::vector<FrameTraceEvent> *events);
+
+// Chrome trace event format, for chrome://tracing or Perfetto.
+std::string ToChromeJSON();
+bool WriteChromeJSON(const Path &filename);
+
+// If set, tracing is enabled and the trace is written there by WriteReportIfRequested() (at game shutdown.)
+void SetReportFilename(const Path &filename);
+void WriteReportIfRequested();
+
+}  // namespace FrameTrace
+
+// Adds the scope to the current frame (or the one given), if tracing is enabled. DRAW_SUBMIT scopes are only summed.
+class FrameTraceScope {
+public:
+	FrameTraceScope(FrameTraceStage stage, uint64_t frame = 0) : stage_(stage), active_(FrameTrace::IsEnabled()), frame_(frame) {
+		if (active_)
+			start_ = Now();
+	}
+	~FrameTraceScope() {
+		if (active_)
+			Finish();
+	}
+
+private:
+	static double Now();
+	void Finish();
+
+	FrameTraceStage stage_;
+	bool active_;
+	uint64_t frame_;
+	double start_ = 0.0;
+};
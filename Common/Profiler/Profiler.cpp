@@ -1,201 +1,191 @@
-// Ultra-lightweight category profiler with history.
+// Ultra-lightweight category profiler with history, and per-thread event rings for traces.
 
+#include <algorithm>
 #include <mutex>
 #include <vector>
 #include <cstring>
 
-#include "ppsspp_config.h"
-
-#include "Common/Render/DrawBuffer.h"
-
+#include "Common/Data/Format/JSONWriter.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
+#include "Common/Thread/ThreadUtil.h"
 #include "Common/TimeUtil.h"
 #include "Common/Profiler/Profiler.h"
+#include "Common/StringUtils.h"
 #include "Common/Log.h"
 
-#define MAX_CATEGORIES 64 // Can be any number, represents max profiled names.
 #define MAX_DEPTH 16      // Can be any number, represents max nesting depth of profiled names.
-#if PPSSPP_PLATFORM(IOS) && defined(__IPHONE_OS_VERSION_MIN_REQUIRED) && __IPHONE_OS_VERSION_MIN_REQUIRED < __IPHONE_9_0
-// iOS did not support C++ thread_local before iOS 9
-#define MAX_THREADS 1     // Can be any number, represents concurrent threads calling the profiler.
-#else
-#define MAX_THREADS 4     // Can be any number, represents concurrent threads calling the profiler.
-#endif
-#define HISTORY_SIZE 128 // Must be power of 2
-
-#ifndef _DEBUG
-// If the compiler can collapse identical strings, we don't even need the strcmp.
-#define UNIFIED_CONST_STR
-#endif
-
-struct Category {
-	const char *name;
-};
+#define MAX_THREADS 64    // Can be any number, represents threads that have ever profiled at the same time.
+#define HISTORY_SIZE 128  // Must be power of 2
+#define EVENT_RING_SIZE 32768  // Per thread, must be power of 2
 
 struct CategoryFrame {
-	CategoryFrame() {
-		memset(time_taken, 0, sizeof(time_taken));
-		memset(count, 0, sizeof(count));
-	}
-	float time_taken[MAX_CATEGORIES];
-	int count[MAX_CATEGORIES];
+	float time_taken[PROFILER_NUM_CATEGORIES];
+	int count[PROFILER_NUM_CATEGORIES];
 };
 
-struct Profiler {
-	int historyPos;
-	int depth[MAX_THREADS];
-	int parentCategory[MAX_THREADS][MAX_DEPTH];
-	double eventStart[MAX_THREADS][MAX_CATEGORIES];
-	double curFrameStart;
+struct ProfilerEvent {
+	double start;
+	double end;
+	int category;
 };
 
-static Profiler profiler;
-static Category categories[MAX_CATEGORIES];
-static std::mutex categoriesLock;
-static int threadIdAfterLast = 0;
+struct ProfilerThread {
+	// Protected by threadsLock, apart from the owner clearing it on exit.
+	std::atomic<bool> inUse;
+	char name[32];
+
+	// Only touched by the owning thread.
+	int depth;
+	int stackCategory[MAX_DEPTH];
+	double stackStart[MAX_DEPTH];
+	// When the scope at each depth last started or resumed counting its own time.
+	double stackResumed[MAX_DEPTH];
+
+	// Written by the owning thread, read (racily, it's only for display) by the overlay.
+	uint32_t historyFrame[HISTORY_SIZE];
+	CategoryFrame history[HISTORY_SIZE];
+
+	// Written by the owning thread, eventPos released after each event.
+	ProfilerEvent events[EVENT_RING_SIZE];
+	std::atomic<uint64_t> eventPos;
+};
+
+std::atomic<uint32_t> g_profilerUsers;
+
+static ProfilerThread *threads[MAX_THREADS];
+static std::atomic<int> numThreads;
 static std::mutex threadsLock;
-static CategoryFrame *history;
-#if MAX_THREADS > 1
-thread_local int profilerThreadId = -1;
-#else
-static int profilerThreadId = 0;
-#endif
-
-void internal_profiler_init() {
-	memset(&profiler, 0, sizeof(profiler));
-#if MAX_THREADS == 1
-	threadIdAfterLast = 1;
-#endif
-	for (int i = 0; i < MAX_THREADS; i++) {
-		for (int j = 0; j < MAX_DEPTH; j++) {
-			profiler.parentCategory[i][j] = -1;
-		}
+static std::atomic<uint32_t> curFrame;
+static Path traceFilename;
+
+// Releases the thread's buffer for reuse by a later thread when it exits.
+struct ProfilerThreadRef {
+	~ProfilerThreadRef() {
+		if (thread)
+			thread->inUse = false;
 	}
-	history = new CategoryFrame[HISTORY_SIZE * MAX_THREADS];
+	ProfilerThread *thread = nullptr;
+	bool full = false;
+};
+thread_local ProfilerThreadRef profilerThread;
+
+void Profiler_SetEnabled(ProfilerUser user, bool enabled) {
+	if (enabled)
+		g_profilerUsers.fetch_or((uint32_t)user);
+	else
+		g_profilerUsers.fetch_and(~(uint32_t)user);
 }
 
-static int internal_profiler_find_thread() {
-	int thread_id = profilerThreadId;
-	if (thread_id != -1) {
-		return thread_id;
+static void ResetThread(ProfilerThread *t) {
+	const char *name = GetCurrentThreadName();
+	truncate_cpy(t->name, name && name[0] ? name : "Unnamed thread");
+	t->depth = 0;
+	for (int i = 0; i < HISTORY_SIZE; i++) {
+		t->historyFrame[i] = 0xFFFFFFFF;
 	}
+	t->eventPos.store(0, std::memory_order_release);
+}
 
-	std::lock_guard<std::mutex> guard(threadsLock);
-	if (threadIdAfterLast < MAX_THREADS) {
-		thread_id = threadIdAfterLast++;
-		profilerThreadId = thread_id;
-		return thread_id;
+static ProfilerThread *internal_profiler_find_thread() {
+	ProfilerThreadRef &ref = profilerThread;
+	if (ref.thread || ref.full) {
+		return ref.thread;
 	}
 
-	// Just keep reusing the last one.
-	return threadIdAfterLast - 1;
-}
-
-int internal_profiler_find_cat(const char *category_name, bool create_missing) {
-	int i;
-	for (i = 0; i < MAX_CATEGORIES; i++) {
-		const char *catname = categories[i].name;
-		if (!catname)
+	std::lock_guard<std::mutex> guard(threadsLock);
+	int count = numThreads.load();
+	for (int i = 0; i < count; i++) {
+		if (!threads[i]->inUse) {
+			ref.thread = threads[i];
 			break;
-#ifdef UNIFIED_CONST_STR
-		if (catname == category_name) {
-#else
-		if (!strcmp(catname, category_name)) {
-#endif
-			return i;
 		}
 	}
-
-	if (i < MAX_CATEGORIES && category_name && create_missing) {
-		std::lock_guard<std::mutex> guard(categoriesLock);
-		int race_check = internal_profiler_find_cat(category_name, false);
-		if (race_check == -1)
-			categories[i].name = category_name;
-		return i;
+	if (!ref.thread) {
+		if (count >= MAX_THREADS) {
+			// Just don't profile this one.
+			WARN_LOG(Log::System, "profiler: too many threads, not profiling %s", GetCurrentThreadName());
+			ref.full = true;
+			return nullptr;
+		}
+		ref.thread = new ProfilerThread();
+		threads[count] = ref.thread;
+		numThreads.store(count + 1);
 	}
-
-	return -1;
-}
-
-// Suspend, also used to prepare for leaving.
-static void internal_profiler_suspend(int thread_id, int category, double now) {
-	double diff = now - profiler.eventStart[thread_id][category];
-	history[MAX_THREADS * profiler.historyPos + thread_id].time_taken[category] += (float)diff;
-	profiler.eventStart[thread_id][category] = 0.0;
+	ref.thread->inUse = true;
+	ResetThread(ref.thread);
+	return ref.thread;
 }
 
-// Resume, also used as part of entering.
-static void internal_profiler_resume(int thread_id, int category, double now) {
-	profiler.eventStart[thread_id][category] = now;
+static void AddTime(ProfilerThread *t, int category, double seconds, bool finished) {
+	uint32_t frame = curFrame.load(std::memory_order_relaxed);
+	int slot = frame & (HISTORY_SIZE - 1);
+	if (t->historyFrame[slot] != frame) {
+		memset(&t->history[slot], 0, sizeof(CategoryFrame));
+		t->historyFrame[slot] = frame;
+	}
+	t->history[slot].time_taken[category] += (float)seconds;
+	if (finished)
+		t->history[slot].count[category]++;
 }
 
-int internal_profiler_enter(const char *category_name, int *out_thread_id) {
-	int category = internal_profiler_find_cat(category_name, true);
-	int thread_id = internal_profiler_find_thread();
-	if (category == -1 || !history) {
-		return category;
+void internal_profiler_enter(int category) {
+	ProfilerThread *t = internal_profiler_find_thread();
+	if (!t) {
+		return;
 	}
 
-	int &depth = profiler.depth[thread_id];
-	if (profiler.eventStart[thread_id][category] == 0.0f) {
-		double now = time_now_d();
-		int parent = profiler.parentCategory[thread_id][depth];
-		// Temporarily suspend the parent on entering a child.
-		if (parent != -1) {
-			internal_profiler_suspend(thread_id, parent, now);
-		}
-		internal_profiler_resume(thread_id, category, now);
-	} else {
-		DEBUG_LOG(Log::System, "profiler: recursive enter (%i - %s)", category, category_name);
+	int depth = t->depth++;
+	if (depth >= MAX_DEPTH) {
+		return;
 	}
 
-	depth++;
-	profiler.parentCategory[thread_id][depth] = category;
-
-	*out_thread_id = thread_id;
-	return category;
+	double now = time_now_d();
+	// Temporarily suspend the parent on entering a child.
+	if (depth > 0) {
+		AddTime(t, t->stackCategory[depth - 1], now - t->stackResumed[depth - 1], false);
+	}
+	t->stackCategory[depth] = category;
+	t->stackStart[depth] = now;
+	t->stackResumed[depth] = now;
 }
 
-void internal_profiler_leave(int thread_id, int category) {
-	if (category == -1 || !history) {
+void internal_profiler_leave(int category) {
+	ProfilerThread *t = profilerThread.thread;
+	if (!t) {
 		return;
 	}
 
-	int &depth = profiler.depth[thread_id];
-	if (category < 0 || category >= MAX_CATEGORIES) {
-		ERROR_LOG(Log::System, "Bad category index %d", category);
-		depth--;
+	int depth = --t->depth;
+	_assert_msg_(depth >= 0, "Profiler enter/leave mismatch!");
+	if (depth >= MAX_DEPTH) {
 		return;
 	}
+	_dbg_assert_(t->stackCategory[depth] == category);
 
 	double now = time_now_d();
-
-	depth--;
-	_assert_msg_(depth >= 0, "Profiler enter/leave mismatch!");
-
-	int parent = profiler.parentCategory[thread_id][depth];
-	// When there's recursion, we don't suspend or resume.
-	if (parent != category) {
-		internal_profiler_suspend(thread_id, category, now);
-		history[MAX_THREADS * profiler.historyPos + thread_id].count[category]++;
-
-		if (parent != -1) {
-			// Resume tracking the parent.
-			internal_profiler_resume(thread_id, parent, now);
-		}
+	AddTime(t, category, now - t->stackResumed[depth], true);
+	if (depth > 0) {
+		// Resume tracking the parent.
+		t->stackResumed[depth - 1] = now;
 	}
+
+	uint64_t pos = t->eventPos.load(std::memory_order_relaxed);
+	ProfilerEvent &event = t->events[pos & (EVENT_RING_SIZE - 1)];
+	event.start = t->stackStart[depth];
+	event.end = now;
+	event.category = category;
+	t->eventPos.store(pos + 1, std::memory_order_release);
 }
 
 void internal_profiler_end_frame() {
-	int thread_id = internal_profiler_find_thread();
-	_assert_msg_(profiler.depth[thread_id] == 0, "Can't be inside a profiler scope at end of frame!");
-	profiler.curFrameStart = time_now_d();
-	profiler.historyPos++;
-	profiler.historyPos &= (HISTORY_SIZE - 1);
-	memset(&history[MAX_THREADS * profiler.historyPos], 0, sizeof(CategoryFrame) * MAX_THREADS);
+	ProfilerThread *t = profilerThread.thread;
+	_assert_msg_(!t || t->depth == 0, "Can't be inside a profiler scope at end of frame!");
+	curFrame++;
 }
 
 const char *Profiler_GetCategoryName(int i) {
-	return i >= 0 ? categories[i].name : "N/A";
+	return i >= 0 && i < PROFILER_NUM_CATEGORIES ? g_profilerCategoryNames[i] : "N/A";
 }
 
 int Profiler_GetHistoryLength() {
@@ -203,32 +193,33 @@ int Profiler_GetHistoryLength() {
 }
 
 int Profiler_GetNumCategories() {
-	for (int i = 0; i < MAX_CATEGORIES; i++) {
-		if (!categories[i].name)
-			return i;
-	}
-	return 0;
+	return PROFILER_NUM_CATEGORIES;
 }
 
 int Profiler_GetNumThreads() {
-	return threadIdAfterLast;
+	return numThreads;
 }
 
-void Profiler_GetSlowestThreads(int *data, int count) {
-	int numCategories = Profiler_GetNumCategories();
-	for (int i = 0; i < HISTORY_SIZE; i++) {
-		int x = i - count + profiler.historyPos + 1;
-		while (x < 0)
-			x += HISTORY_SIZE;
-		while (x >= HISTORY_SIZE)
-			x -= HISTORY_SIZE;
+// Returns nullptr if the thread didn't profile anything in the frame.
+static const CategoryFrame *GetHistoryFrame(int thread, int i, int count) {
+	uint32_t frame = curFrame - (count - 1) + i;
+	const ProfilerThread *t = threads[thread];
+	int slot = frame & (HISTORY_SIZE - 1);
+	return t->historyFrame[slot] == frame ? &t->history[slot] : nullptr;
+}
 
+void Profiler_GetSlowestThreads(int *data, int count) {
+	int threadCount = numThreads;
+	for (int i = 0; i < count; i++) {
 		float slowestTime = 0.0f;
 		data[i] = 0;
-		for (int thread = 0; thread < threadIdAfterLast; ++thread) {
+		for (int thread = 0; thread < threadCount; ++thread) {
+			const CategoryFrame *frame = GetHistoryFrame(thread, i, count);
+			if (!frame)
+				continue;
 			float sum = 0.0f;
-			for (int c = 0; c < numCategories; ++c) {
-				sum += history[MAX_THREADS * x + thread].time_taken[c];
+			for (int c = 0; c < PROFILER_NUM_CATEGORIES; ++c) {
+				sum += frame->time_taken[c];
 			}
 			if (sum > slowestTime) {
 				slowestTime = sum;
@@ -239,25 +230,98 @@ void Profiler_GetSlowestThreads(int *data, int count) {
 }
 
 void Profiler_GetSlowestHistory(int category, int *slowestThreads, float *data, int count) {
-	for (int i = 0; i < HISTORY_SIZE; i++) {
-		int x = i - count + profiler.historyPos + 1;
-		while (x < 0)
-			x += HISTORY_SIZE;
-		while (x >= HISTORY_SIZE)
-			x -= HISTORY_SIZE;
-
-		int thread = slowestThreads[i];
-		data[i] = history[MAX_THREADS * x + thread].time_taken[category];
+	for (int i = 0; i < count; i++) {
+		const CategoryFrame *frame = slowestThreads[i] < numThreads ? GetHistoryFrame(slowestThreads[i], i, count) : nullptr;
+		data[i] = frame ? frame->time_taken[category] : 0.0f;
 	}
 }
 
 void Profiler_GetHistory(int category, int thread, float *data, int count) {
-	for (int i = 0; i < HISTORY_SIZE; i++) {
-		int x = i - count + profiler.historyPos + 1;
-		while (x < 0)
-			x += HISTORY_SIZE;
-		while (x >= HISTORY_SIZE)
-			x -= HISTORY_SIZE;
-		data[i] = history[MAX_THREADS * x + thread].time_taken[category];
+	for (int i = 0; i < count; i++) {
+		const CategoryFrame *frame = thread < numThreads ? GetHistoryFrame(thread, i, count) : nullptr;
+		data[i] = frame ? frame->time_taken[category] : 0.0f;
+	}
+}
+
+// Copies out what's in the ring, skipping anything the owner may have overwritten while copying.
+static void CopyEvents(const ProfilerThread *t, std::vector<ProfilerEvent> *events) {
+	uint64_t end = t->eventPos.load(std::memory_order_acquire);
+	uint64_t start = end > EVENT_RING_SIZE ? end - EVENT_RING_SIZE : 0;
+	events->clear();
+	for (uint64_t pos = start; pos < end; pos++) {
+		events->push_back(t->events[pos & (EVENT_RING_SIZE - 1)]);
+	}
+	uint64_t after = t->eventPos.load(std::memory_order_acquire);
+	if (after > EVENT_RING_SIZE && after - EVENT_RING_SIZE > start) {
+		size_t overwritten = (size_t)std::min(after - EVENT_RING_SIZE - start, (uint64_t)events->size());
+		events->erase(events->begin(), events->begin() + overwritten);
 	}
 }
+
+static std::string ChromeTimestamp(double t) {
+	return StringFromFormat("%0.3f", t * 1000000.0);
+}
+
+std::string Profiler_GetChromeTrace() {
+	json::JsonWriter j;
+	j.begin();
+	j.writeString("displayTimeUnit", "ms");
+	{
+		json::JsonWriter::ArrayScope traceEvents(j, "traceEvents");
+
+		// Keeps threads from being reset under us, the owners keep recording.
+		std::lock_guard<std::mutex> guard(threadsLock);
+		std::vector<ProfilerEvent> events;
+		events.reserve(EVENT_RING_SIZE);
+		int threadCount = numThreads;
+		for (int i = 0; i < threadCount; i++) {
+			const ProfilerThread *t = threads[i];
+			CopyEvents(t, &events);
+			if (events.empty())
+				continue;
+
+			{
+				json::JsonWriter::DictScope meta(j);
+				j.writeString("name", "thread_name");
+				j.writeString("ph", "M");
+				j.writeInt("pid", 1);
+				j.writeInt("tid", i + 1);
+				json::JsonWriter::DictScope args(j, "args");
+				j.writeString("name", t->name);
+			}
+
+			for (const ProfilerEvent &event : events) {
+				json::JsonWriter::DictScope e(j);
+				j.writeString("name", Profiler_GetCategoryName(event.category));
+				j.writeString("ph", "X");
+				j.writeRaw("ts", ChromeTimestamp(event.start));
+				j.writeRaw("dur", ChromeTimestamp(event.end - event.start));
+				j.writeInt("pid", 1);
+				j.writeInt("tid", i + 1);
+			}
+		}
+	}
+	j.end();
+	return j.str();
+}
+
+bool Profiler_WriteChromeTrace(const Path &filename) {
+	std::string data = Profiler_GetChromeTrace();
+	if (!File::WriteStringToFile(true, data, filename)) {
+		ERROR_LOG(Log::System, "Failed to write profiler trace to %s", filename.c_str());
+		return false;
+	}
+	INFO_LOG(Log::System, "Wrote profiler trace to %s", filename.c_str());
+	return true;
+}
+
+void Profiler_SetTraceFilename(const Path &filename) {
+	traceFilename = filename;
+	Profiler_SetEnabled(ProfilerUser::TRACE, !filename.empty());
+}
+
+void Profiler_WriteTraceIfRequested() {
+	if (traceFilename.empty())
+		return;
+	Profiler_WriteChromeTrace(traceFilename);
+}
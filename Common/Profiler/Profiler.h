@@ -1,18 +1,95 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <string>
+#include <type_traits>
 
-// #define USE_PROFILER
+class Path;
 
-#ifdef USE_PROFILER
+// Always compiled in. While nothing has it enabled, a scope costs a relaxed atomic load and a branch.
+//
+// While enabled, each thread records its scopes into its own ring of events (only the first scope on a
+// thread takes a lock), which can be dumped as Chrome trace JSON for chrome://tracing or Perfetto.
+// Exclusive time per category is also summed per frame, for the frame profile overlay.
 
-class DrawBuffer;
+// Every category used with PROFILE_THIS_SCOPE must be listed here, so scopes get their index at compile time.
+constexpr const char *const g_profilerCategoryNames[] = {
+	"advance",
+	"applydrawstate",
+	"bezier",
+	"bin_clut",
+	"bin_drain",
+	"bin_drain_single",
+	"bin_state",
+	"block",
+	"decodetex",
+	"draw_px",
+	"draw_rect_px",
+	"draw_tri",
+	"draw_tri_px",
+	"execprim",
+	"flush",
+	"Flush",
+	"gpu_call",
+	"gpuloop",
+	"io_rw",
+	"jit",
+	"jitc",
+	"jithash",
+	"light",
+	"mixer",
+	"pipelinebuild",
+	"read_vert",
+	"renderman_q",
+	"ReplayFramebuf",
+	"ReplayLoad",
+	"ReplayMemcpy",
+	"ReplayMemset",
+	"sampler",
+	"shadercomp",
+	"shaderlink",
+	"soft",
+	"soft_runloop",
+	"spline",
+	"syscall",
+	"texhash",
+	"timing",
+};
+
+constexpr int PROFILER_NUM_CATEGORIES = (int)(sizeof(g_profilerCategoryNames) / sizeof(g_profilerCategoryNames[0]));
+
+constexpr bool ProfilerStrEqual(const char *a, const char *b) {
+	return *a == *b && (*a == '\0' || ProfilerStrEqual(a + 1, b + 1));
+}
+
+// Returns -1 if the category isn't listed.
+constexpr int ProfilerCategoryId(const char *name, int start = 0) {
+	return start >= PROFILER_NUM_CATEGORIES ? -1 : (ProfilerStrEqual(g_profilerCategoryNames[start], name) ? start : ProfilerCategoryId(name, start + 1));
+}
+
+// Independent reasons to keep the profiler on. It's on while any of them is.
+enum class ProfilerUser : uint32_t {
+	OVERLAY = 1,
+	TRACE = 2,
+};
+
+extern std::atomic<uint32_t> g_profilerUsers;
+
+inline bool Profiler_IsEnabled() {
+	return g_profilerUsers.load(std::memory_order_relaxed) != 0;
+}
+
+void Profiler_SetEnabled(ProfilerUser user, bool enabled);
+
+inline bool Profiler_IsTracing() {
+	return (g_profilerUsers.load(std::memory_order_relaxed) & (uint32_t)ProfilerUser::TRACE) != 0;
+}
 
-void internal_profiler_init();
 void internal_profiler_end_frame();
 
-int internal_profiler_enter(const char *category_name, int *thread_id);  // Returns the category number.
-void internal_profiler_leave(int thread_id, int category);
+void internal_profiler_enter(int category);
+void internal_profiler_leave(int category);
 
 const char *Profiler_GetCategoryName(int i);
 int Profiler_GetNumCategories();
@@ -22,27 +99,29 @@ void Profiler_GetSlowestThreads(int *data, int count);
 void Profiler_GetSlowestHistory(int category, int *slowestThreads, float *data, int count);
 void Profiler_GetHistory(int category, int thread, float *data, int count);
 
+// Chrome trace event format, of whatever is still in the per-thread rings.
+std::string Profiler_GetChromeTrace();
+bool Profiler_WriteChromeTrace(const Path &filename);
+
+// If set, the profiler is kept on and the trace is written there by Profiler_WriteTraceIfRequested() (at game shutdown.)
+void Profiler_SetTraceFilename(const Path &filename);
+void Profiler_WriteTraceIfRequested();
+
 class ProfileThis {
 public:
-	ProfileThis(const char *category) {
-		cat_ = internal_profiler_enter(category, &thread_);
+	ProfileThis(int category) : category_(Profiler_IsEnabled() ? category : -1) {
+		if (category_ >= 0)
+			internal_profiler_enter(category_);
 	}
 	~ProfileThis() {
-		internal_profiler_leave(thread_, cat_);
+		if (category_ >= 0)
+			internal_profiler_leave(category_);
 	}
 private:
-	int cat_;
-	int thread_;
+	int category_;
 };
 
-#define PROFILE_INIT() internal_profiler_init();
-#define PROFILE_THIS_SCOPE(cat) ProfileThis _profile_scoped(cat);
+#define PROFILE_THIS_SCOPE(cat) \
+	static_assert(ProfilerCategoryId(cat) >= 0, "Profiler category " cat " must be listed in Profiler.h"); \
+	ProfileThis _profile_scoped(std::integral_constant<int, ProfilerCategoryId(cat)>::value);
 #define PROFILE_END_FRAME() internal_profiler_end_frame();
-
-#else
-
-#define PROFILE_INIT()
-#define PROFILE_THIS_SCOPE(cat)
-#define PROFILE_END_FRAME()
-
-#endif
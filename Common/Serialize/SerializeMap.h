@@ -29,24 +29,42 @@ void DoMap(PointerWrap &p, M &x, typename M::mapped_type &default_val) {
 	switch (p.mode) {
 	case PointerWrap::MODE_READ:
 	{
-		// Clear before the guard below can bail out: for a map of pointers, our caller has
-		// already deleted every value, so leaving them in place would be a use-after-free.
-		x.clear();
 		// Guard against an attacker-controlled count driving an enormous number of
 		// loop iterations/allocations, same spirit as DoVector's guard.
 		constexpr size_t minElemSize = SerializeMinElemSize<typename M::key_type>() + SerializeMinElemSize<typename M::mapped_type>();
 		if (number > p.Remaining() / minElemSize) {
+			// Clear even when bailing out: for a map of pointers, our caller has already
+			// deleted every value, so leaving them in place would be a use-after-free.
+			x.clear();
 			p.SetError(PointerWrap::ERROR_FAILURE);
 			return;
 		}
+		// As long as the keys come in the same order as the ones we already have (the usual
+		// case when loading states repeatedly, like rewind), load into the existing entries
+		// instead of freeing and reallocating every node.
+		typename M::iterator itr = x.begin();
+		bool reusing = true;
 		while (number > 0) {
 			typename M::key_type first = typename M::key_type();
 			Do(p, first);
-			typename M::mapped_type second = default_val;
-			Do(p, second);
-			x[first] = second;
+			if (reusing && itr != x.end() && itr->first == first) {
+				itr->second = default_val;
+				Do(p, itr->second);
+				++itr;
+			} else {
+				if (reusing) {
+					x.erase(itr, x.end());
+					reusing = false;
+				}
+				typename M::mapped_type second = default_val;
+				Do(p, second);
+				x[first] = second;
+			}
 			--number;
 		}
+		if (reusing) {
+			x.erase(itr, x.end());
+		}
 		break;
 	}
 	case PointerWrap::MODE_WRITE:
@@ -109,24 +127,42 @@ void DoMultimap(PointerWrap &p, M &x, typename M::mapped_type &default_val) {
 	switch (p.mode) {
 	case PointerWrap::MODE_READ:
 	{
-		// Clear before the guard below can bail out: for a map of pointers, our caller has
-		// already deleted every value, so leaving them in place would be a use-after-free.
-		x.clear();
 		// Guard against an attacker-controlled count driving an enormous number of
 		// loop iterations/allocations, same spirit as DoVector's guard.
 		constexpr size_t minElemSize = SerializeMinElemSize<typename M::key_type>() + SerializeMinElemSize<typename M::mapped_type>();
 		if (number > p.Remaining() / minElemSize) {
+			// Clear even when bailing out: for a map of pointers, our caller has already
+			// deleted every value, so leaving them in place would be a use-after-free.
+			x.clear();
 			p.SetError(PointerWrap::ERROR_FAILURE);
 			return;
 		}
+		// As long as the keys come in the same order as the ones we already have (the usual
+		// case when loading states repeatedly, like rewind), load into the existing entries
+		// instead of freeing and reallocating every node.
+		typename M::iterator itr = x.begin();
+		bool reusing = true;
 		while (number > 0) {
 			typename M::key_type first = typename M::key_type();
 			Do(p, first);
-			typename M::mapped_type second = default_val;
-			Do(p, second);
-			x.insert(std::make_pair(first, second));
+			if (reusing && itr != x.end() && itr->first == first) {
+				itr->second = default_val;
+				Do(p, itr->second);
+				++itr;
+			} else {
+				if (reusing) {
+					x.erase(itr, x.end());
+					reusing = false;
+				}
+				typename M::mapped_type second = default_val;
+				Do(p, second);
+				x.insert(std::make_pair(first, second));
+			}
 			--number;
 		}
+		if (reusing) {
+			x.erase(itr, x.end());
+		}
 		break;
 	}
 	case PointerWrap::MODE_WRITE:
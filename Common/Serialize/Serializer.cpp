@@ -15,6 +15,7 @@
 // Official SVN repository and contact information can be found at
 // http://code.google.com/p/dolphin-emu/
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <snappy-c.h>
@@ -33,6 +34,35 @@ enum class SerializeCompressType {
 
 static constexpr SerializeCompressType SAVE_TYPE = SerializeCompressType::ZSTD;
 
+// How much to grow the arena by at a time, at least. Capacity is grown geometrically by the
+// vector itself, this only limits how often we come back here and how much gets zero-filled.
+static constexpr size_t ARENA_GROW_STEP = 256 * 1024;
+
+PointerWrap::PointerWrap(std::vector<u8> *arena) : ptr(&arenaPtr_), mode(MODE_WRITE), arena_(arena) {
+	// Start out with whatever size the last save ended up with, usually about right.
+	ptrStart_ = arena->data();
+	arenaPtr_ = ptrStart_;
+	arenaEnd_ = ptrStart_ + arena->size();
+}
+
+void PointerWrap::GrowArena(size_t size) {
+	size_t offset = Offset();
+	arena_->resize(std::max(offset + size, arena_->size() + ARENA_GROW_STEP));
+	ptrStart_ = arena_->data();
+	arenaPtr_ = ptrStart_ + offset;
+	arenaEnd_ = ptrStart_ + arena_->size();
+}
+
+bool PointerWrap::FinishArena() {
+	_assert_(arena_ != nullptr);
+	if (error == ERROR_FAILURE) {
+		return false;
+	}
+	// Keeps the capacity for next time.
+	arena_->resize(Offset());
+	return true;
+}
+
 void PointerWrap::RewindForWrite(u8 *writePtr) {
 	_assert_(mode == MODE_MEASURE);
 	// Switch to writing mode, save the size for later checking and start again.
@@ -85,7 +115,7 @@ PointerWrapSection PointerWrap::Section(const char *title, int minVer, int ver)
 				SetError(ERROR_FAILURE);
 				return PointerWrapSection(*this, -1, title);
 			}
-		} else {
+		} else if (!arena_) {
 			WARN_LOG(Log::SaveState, "Writing savestate without checkpoints. This is OK but should be fixed.");
 		}
 		curCheckpoint_++;
@@ -140,7 +170,10 @@ bool PointerWrap::ExpectVoid(void *data, int size) {
 			return false;
 		if (memcmp(data, *ptr, size) != 0) return false;
 		break;
-	case MODE_WRITE: memcpy(*ptr, data, size); break;
+	case MODE_WRITE:
+		EnsureWrite(size);
+		memcpy(*ptr, data, size);
+		break;
 	case MODE_MEASURE: break;  // MODE_MEASURE - don't need to do anything
 	case MODE_VERIFY:
 		if (!CheckRead(size))
@@ -165,7 +198,10 @@ void PointerWrap::DoVoid(void *data, int size) {
 			return;
 		memcpy(data, *ptr, size);
 		break;
-	case MODE_WRITE: memcpy(*ptr, data, size); break;
+	case MODE_WRITE:
+		EnsureWrite(size);
+		memcpy(*ptr, data, size);
+		break;
 	case MODE_MEASURE: break;  // MODE_MEASURE - don't need to do anything
 	case MODE_VERIFY:
 		if (!CheckRead(size))
@@ -205,7 +241,10 @@ void Do(PointerWrap &p, std::string &x) {
 		// exists within stringLen bytes for corrupted savestate data.
 		x.assign((const char *)*p.ptr, stringLen - 1);
 		break;
-	case PointerWrap::MODE_WRITE: memcpy(*p.ptr, x.c_str(), stringLen); break;
+	case PointerWrap::MODE_WRITE:
+		p.EnsureWrite(stringLen);
+		memcpy(*p.ptr, x.c_str(), stringLen);
+		break;
 	case PointerWrap::MODE_MEASURE: break;
 	case PointerWrap::MODE_NOOP: break;
 	case PointerWrap::MODE_VERIFY: _dbg_assert_msg_(!strcmp(x.c_str(), (char*)*p.ptr), "Savestate verification failure: \"%s\" != \"%s\" (at %p).\n", x.c_str(), (char *)*p.ptr, p.ptr); break;
@@ -218,7 +257,7 @@ void Do(PointerWrap &p, std::wstring &x) {
 	Do(p, stringLen);
 
 	// The length is in bytes, so it has to be a whole number of characters, and at least the NUL
-	// terminator. Otherwise read() below computes a negative character count.
+	// terminator. Otherwise the read below computes a negative character count.
 	if (stringLen < (int)sizeof(wchar_t) || (stringLen % sizeof(wchar_t)) != 0 || stringLen > MAX_SANE_STRING_LENGTH) {
 		WARN_LOG(Log::SaveState, "Savestate failure: bad stringLen %d", stringLen);
 		p.SetError(PointerWrap::ERROR_FAILURE);
@@ -230,20 +269,19 @@ void Do(PointerWrap &p, std::wstring &x) {
 			return;
 	}
 
-	auto read = [&]() {
-		std::wstring r;
-		// In case unaligned, use memcpy.
-		r.resize((stringLen / sizeof(wchar_t)) - 1);
-		memcpy(&r[0], *p.ptr, stringLen - sizeof(wchar_t));
-		return r;
-	};
-
 	switch (p.mode) {
-	case PointerWrap::MODE_READ: x = read(); break;
-	case PointerWrap::MODE_WRITE: memcpy(*p.ptr, x.c_str(), stringLen); break;
+	case PointerWrap::MODE_READ:
+		// Read in place, to reuse x's storage.
+		x.resize((stringLen / sizeof(wchar_t)) - 1);
+		memcpy(&x[0], *p.ptr, stringLen - sizeof(wchar_t));
+		break;
+	case PointerWrap::MODE_WRITE:
+		p.EnsureWrite(stringLen);
+		memcpy(*p.ptr, x.c_str(), stringLen);
+		break;
 	case PointerWrap::MODE_MEASURE: break;
 	case PointerWrap::MODE_NOOP: break;
-	case PointerWrap::MODE_VERIFY: _dbg_assert_msg_(x == read(), "Savestate verification failure: \"%ls\" != \"%ls\" (at %p).\n", x.c_str(), read().c_str(), p.ptr); break;
+	case PointerWrap::MODE_VERIFY: _dbg_assert_msg_(memcmp(x.c_str(), *p.ptr, stringLen) == 0, "Savestate verification failure: \"%ls\" (at %p).\n", x.c_str(), p.ptr); break;
 	}
 	(*p.ptr) += stringLen;
 }
@@ -253,7 +291,7 @@ void Do(PointerWrap &p, std::u16string &x) {
 	Do(p, stringLen);
 
 	// The length is in bytes, so it has to be a whole number of characters, and at least the NUL
-	// terminator. Otherwise read() below computes a negative character count.
+	// terminator. Otherwise the read below computes a negative character count.
 	if (stringLen < (int)sizeof(char16_t) || (stringLen % sizeof(char16_t)) != 0 || stringLen > MAX_SANE_STRING_LENGTH) {
 		WARN_LOG(Log::SaveState, "Savestate failure: bad stringLen %d", stringLen);
 		p.SetError(PointerWrap::ERROR_FAILURE);
@@ -265,20 +303,19 @@ void Do(PointerWrap &p, std::u16string &x) {
 			return;
 	}
 
-	auto read = [&]() {
-		std::u16string r;
-		// In case unaligned, use memcpy.
-		r.resize((stringLen / sizeof(char16_t)) - 1);
-		memcpy(&r[0], *p.ptr, stringLen - sizeof(char16_t));
-		return r;
-	};
-
 	switch (p.mode) {
-	case PointerWrap::MODE_READ: x = read(); break;
-	case PointerWrap::MODE_WRITE: memcpy(*p.ptr, x.c_str(), stringLen); break;
+	case PointerWrap::MODE_READ:
+		// Read in place, to reuse x's storage.
+		x.resize((stringLen / sizeof(char16_t)) - 1);
+		memcpy(&x[0], *p.ptr, stringLen - sizeof(char16_t));
+		break;
+	case PointerWrap::MODE_WRITE:
+		p.EnsureWrite(stringLen);
+		memcpy(*p.ptr, x.c_str(), stringLen);
+		break;
 	case PointerWrap::MODE_MEASURE: break;
 	case PointerWrap::MODE_NOOP: break;
-	case PointerWrap::MODE_VERIFY: _dbg_assert_msg_(x == read(), "Savestate verification failure: (at %p).\n", p.ptr); break;
+	case PointerWrap::MODE_VERIFY: _dbg_assert_msg_(memcmp(x.c_str(), *p.ptr, stringLen) == 0, "Savestate verification failure: (at %p).\n", p.ptr); break;
 	}
 	(*p.ptr) += stringLen;
 }
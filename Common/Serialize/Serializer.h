@@ -117,6 +117,16 @@ class PointerWrap
 		}
 	}
 
+	// Single pass save into a growable buffer, no measure pass needed. The vector's existing
+	// storage is reused, so saving repeatedly into the same vector doesn't reallocate.
+	// Call FinishArena() afterwards to trim it to the written size.
+	// Must not be copied, ptr points inside the object.
+	explicit PointerWrap(std::vector<u8> *arena);
+	PointerWrap(const PointerWrap &) = delete;
+	PointerWrap &operator =(const PointerWrap &) = delete;
+
+	bool FinishArena();
+
 	bool Failed() const {
 		return error == ERROR_FAILURE;
 	}
@@ -149,9 +159,18 @@ class PointerWrap
 
 	void SkipBytes(size_t bytes) {
 		// Should work in all modes.
+		if (mode == MODE_WRITE)
+			EnsureWrite(bytes);
 		*ptr += bytes;
 	}
 
+	// Makes room for 'size' more bytes when saving into an arena. Anything that writes
+	// through *ptr directly in MODE_WRITE has to call this first, DoVoid() already does.
+	void EnsureWrite(size_t size) {
+		if (arena_ && (size_t)(arenaEnd_ - *ptr) < size)
+			GrowArena(size);
+	}
+
 	size_t Offset() const { return *ptr - ptrStart_; }
 
 	// Restrict reads (MODE_READ / MODE_VERIFY) to not go past the end of the
@@ -181,10 +200,15 @@ class PointerWrap
 	}
 
 private:
+	void GrowArena(size_t size);
+
 	const char *firstBadSectionTitle_ = nullptr;
 	const char *curTitle_;
 	u8 *ptrStart_;
 	u8 *end_ = nullptr;
+	std::vector<u8> *arena_ = nullptr;
+	u8 *arenaPtr_ = nullptr;
+	u8 *arenaEnd_ = nullptr;
 	std::vector<SerializeCheckpoint> checkpoints_;
 	size_t curCheckpoint_ = 0;
 	size_t measuredSize_ = 0;
@@ -261,22 +285,14 @@ class CChunkFileReader
 		}
 	}
 
-	// Duplicate of the above but takes and modifies a vector. Less invasive
-	// than modifying the rewind manager to keep things in something else than vectors.
+	// Like the above but saves into a vector, in a single pass. The vector grows as needed
+	// and its previous storage is reused, which is what the rewind manager wants.
 	template<class T>
 	static Error MeasureAndSavePtr(T &_class, std::vector<u8> *saved)
 	{
-		u8 *ptr = nullptr;
-		PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
+		PointerWrap p(saved);
 		_class.DoState(p);
-		_assert_(p.error == PointerWrap::ERROR_NONE);
-
-		size_t measuredSize = p.Offset();
-		saved->resize(measuredSize);
-		u8 *data = saved->data();
-		p.RewindForWrite(data);
-		_class.DoState(p);
-		if (p.CheckAfterWrite()) {
+		if (p.FinishArena()) {
 			return ERROR_NONE;
 		} else {
 			saved->clear();
@@ -139,6 +139,18 @@ class Promise {
 		}
 	}
 
+	// Like Poll, but also works for non-nullable T, and for promises that are ready with a null value.
+	bool IsReady() {
+		std::lock_guard<std::mutex> guard(readyMutex_);
+		if (!ready_ && rx_->Poll(&data_)) {
+			rx_->Release();
+			rx_ = nullptr;
+			ready_ = true;
+			task_ = nullptr;
+		}
+		return ready_;
+	}
+
 	T BlockUntilReady() {
 		uint32_t sentinel = sentinel_;
 		_assert_msg_(sentinel == 0xffc0ffee, "%08x", sentinel);
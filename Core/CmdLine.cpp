@@ -4,8 +4,14 @@
 #include "Core/Config.h"
 #include "Core/CmdLine.h"
 #include "Core/WebServer.h"
+#include "Core/Debugger/FunctionProfiler.h"
+#include "Core/Debugger/MemAccessStats.h"
+#include "Core/FileLoaders/BlockCache.h"
 #include "Core/Util/PathUtil.h"
+#include "GPU/Common/DepthRaster.h"
 #include "Common/File/FileUtil.h"
+#include "Common/Profiler/FrameTrace.h"
+#include "Common/Profiler/Profiler.h"
 #include "Common/StringUtils.h"
 #include "Common/Log/LogManager.h"
 
@@ -182,6 +188,7 @@ static const CommandLineParam g_autoParams[] = {
 	{POFF(stateToLoad), CmdParamType::String, "state", '\0', "Load state from specified file"},
 	{POFF(compare), CmdParamType::Bool, "compare", 'c', "Enable comparison mode", CmdLineMode::Headless},
 	{POFF(bench), CmdParamType::Bool, "bench", 'b', "Enable benchmark mode", CmdLineMode::Headless},
+	{POFF(benchRewind), CmdParamType::Bool, "bench-rewind", '\0', "Time full and rewind save states while running", CmdLineMode::Headless},
 	{POFF(oldAtrac), CmdParamType::Bool, "old-atrac", '\0', "Use old ATRAC decoder"},
 	{POFF(log), CmdParamType::String, "log", '\0', "Output log to FILE", CmdLineMode::Application},
 	{POFF(enableLogging), CmdParamType::Bool, "log", '\0', "Full log output, not just emulated printfs", CmdLineMode::Headless},
@@ -200,6 +207,12 @@ static const CommandLineParam g_autoParams[] = {
 	{POFF(debuggerPort), CmdParamType::Int, "debugger", '\0', "Enable the WebSocket debugger on this port (0 = pick automatically); see docs/WebSocketDebugger.md"},
 	{POFF(autoSaveLoadSymbols), CmdParamType::Bool, "auto-save-load-symbols", '\0', "Auto save/load per-module and per-game symbol files (see bAutoSaveLoadSymbols)", CmdLineMode::Both},
 	{POFF(bootVSH), CmdParamType::Bool, "vsh", '\0', "Boot the VSH (requires files dumped from a PSP in the flash0 directory)"},
+	{POFF(blockCacheTrace), CmdParamType::String, "block-cache-trace", '\0', "Write a CSV trace of file block cache accesses into DIR", CmdLineMode::Both},
+	{POFF(profileFunctions), CmdParamType::String, "profile-functions", '\0', "Write the hottest guest functions, with their hashes and any replacements, to FILE on exit", CmdLineMode::Both},
+	{POFF(memAccessStats), CmdParamType::String, "mem-access-stats", '\0', "Count slow-path memory accesses and fastmem faults per guest PC, and write them to FILE on exit", CmdLineMode::Both},
+	{POFF(depthRasterRecord), CmdParamType::String, "depth-raster-record", '\0', "Record the software depth raster input to FILE, for the DepthRaster unit test", CmdLineMode::Both},
+	{POFF(frameTrace), CmdParamType::String, "frame-trace", '\0', "Write a per-frame timing trace (Chrome trace JSON) to FILE on exit", CmdLineMode::Both},
+	{POFF(profileTrace), CmdParamType::String, "profile-trace", '\0', "Profile native code by category and write a Chrome trace JSON to FILE on exit", CmdLineMode::Both},
 	{POFF(memReadAction), CmdParamType::Enum, "memread", '\0', "Set the action for memory read exceptions", CmdLineMode::Both, g_ExceptionActionValues, ARRAY_SIZE(g_ExceptionActionValues)},
 	{POFF(memWriteAction), CmdParamType::Enum, "memwrite", '\0', "Set the action for memory write exceptions", CmdLineMode::Both, g_ExceptionActionValues, ARRAY_SIZE(g_ExceptionActionValues)},
 	{POFF(breakAction), CmdParamType::Enum, "break", '\0', "Set the action for break exceptions", CmdLineMode::Both, g_ExceptionActionValues, ARRAY_SIZE(g_ExceptionActionValues)},
@@ -555,6 +568,30 @@ void CommandLineOptions::ApplyToConfig() const {
 		g_Config.DoNotSaveSetting(&g_Config.iInternalResolution);
 	}
 
+	if (blockCacheTrace.has_value()) {
+		BlockCache::SetTraceDirectory(Path(blockCacheTrace.value()));
+	}
+
+	if (profileFunctions.has_value()) {
+		FunctionProfiler::SetReportFilename(Path(profileFunctions.value()));
+	}
+
+	if (memAccessStats.has_value()) {
+		MemAccessStats::SetReportFilename(Path(memAccessStats.value()));
+	}
+
+	if (depthRasterRecord.has_value()) {
+		DepthRasterSetRecordFile(Path(depthRasterRecord.value()));
+	}
+
+	if (frameTrace.has_value()) {
+		FrameTrace::SetReportFilename(Path(frameTrace.value()));
+	}
+
+	if (profileTrace.has_value()) {
+		Profiler_SetTraceFilename(Path(profileTrace.value()));
+	}
+
 	if (memReadAction.has_value()) {
 		g_Config.iExceptionActionMemRead = memReadAction.value();
 		g_Config.DoNotSaveSetting(&g_Config.iExceptionActionMemRead);
@@ -73,6 +73,25 @@ struct CommandLineOptions {
 	// (the default) to take whatever file list names each file first.
 	std::optional<std::string> unpackUpdaterModel;
 
+	// Write a CSV of every block cache access per loaded file into this directory (see Core/FileLoaders/BlockCache.h),
+	// for tuning block and readahead sizes.
+	std::optional<std::string> blockCacheTrace;
+	// Sample guest code while running and write the hottest functions, with their hashes and any
+	// replacements already hooked, to this file on shutdown (see Core/Debugger/FunctionProfiler.h.)
+	std::optional<std::string> profileFunctions;
+	// Count slow-path guest memory accesses and fastmem faults by PC, and write the top ones to this
+	// file on shutdown (see Core/Debugger/MemAccessStats.h.)
+	std::optional<std::string> memAccessStats;
+	// Append every batch sent to the software depth rasterizer to this file, for running through
+	// TestDepthRaster (see GPU/Common/DepthRaster.h.)
+	std::optional<std::string> depthRasterRecord;
+	// Trace emu, GE, render thread and present timing per frame, and write it as Chrome trace JSON to
+	// this file on shutdown (see Common/Profiler/FrameTrace.h.)
+	std::optional<std::string> frameTrace;
+	// Keep the profiler on and write what its per-thread buffers hold, as Chrome trace JSON, to this file
+	// on shutdown (see Common/Profiler/Profiler.h.)
+	std::optional<std::string> profileTrace;
+
 	std::optional<int> memReadAction;
 	std::optional<int> memWriteAction;
 	std::optional<int> breakAction;
@@ -107,6 +126,7 @@ struct CommandLineOptions {
 	// Headless options
 	std::optional<bool> compare;
 	std::optional<bool> bench;
+	std::optional<bool> benchRewind;
 	std::optional<bool> verbose;
 	std::optional<double> timeout;
 	std::optional<bool> printEqualLines;
@@ -237,6 +237,8 @@ struct Config : public ConfigBlock {
 	bool bShrinkIfWindowSmall;
 	bool bSeparateSASThread;
 	int iIOTimingMethod;
+	// Serve small sequential sceIoReads from a per-file buffer the io thread fills ahead.
+	bool bIOReadahead;
 	int iLockedCPUSpeed;
 	bool bAutoSaveSymbolMap;
 	bool bCompressSymbols;
@@ -340,12 +342,14 @@ struct Config : public ConfigBlock {
 	int bHighQualityDepth;
 	bool bReplaceTextures;
 	bool bSaveNewTextures;
+	bool bReplaceTexturesDecodeCache;  // Keeps decoded PNG replacements in the cache directory, for faster loading.
 	int iReplacementTextureLoadSpeed;
 	bool bIgnoreTextureFilenames;
 	int iTexScalingLevel; // 0 = auto, 1 = off, 2 = 2x, ..., 5 = 5x
 	int iTexScalingType; // 0 = xBRZ, 1 = Hybrid
 	bool bTexDeposterize;
 	bool bTexHardwareScaling;
+	bool bTexComputeDecode;  // Vulkan only: decode CLUT and swizzled textures with compute shaders instead of on the CPU.
 	int iFpsLimit1;
 	int iFpsLimit2;
 	int iAnalogFpsLimit;
@@ -404,6 +408,7 @@ struct Config : public ConfigBlock {
 	int iAudioBufferSize;
 	bool bFillAudioGaps;
 	int iAudioPlaybackMode;
+	int iAudioLatencyMs;  // For the classic mode. 0 = adjust automatically.
 
 	// Legacy volume settings, 0-10. These get auto-upgraded and should not be used.
 	int iLegacyGameVolume;
@@ -262,9 +262,7 @@ enum class DebugOverlay : int {
 	DEBUG_STATS,
 	FRAME_GRAPH,
 	FRAME_TIMING,
-#ifdef USE_PROFILER
 	FRAME_PROFILE,
-#endif
 	CONTROL,
 	Audio,
 	GPU_PROFILE,
@@ -30,6 +30,7 @@
 #include "Core/CoreTiming.h"
 #include "Core/Core.h"
 #include "Core/Config.h"
+#include "Core/Debugger/FunctionProfiler.h"
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/HLE/__sceAudio.h"
 #include "Core/MIPS/MIPS.h"
@@ -417,12 +418,26 @@ void ForceCheck(MIPSState *mips) {
 #endif
 }
 
+static void ShortenSliceTo(MIPSState *mips, s64 ticks) {
+	const s64 remaining = ticks - globalTimer;
+	if (remaining > 0 && remaining < slicelength) {
+		const int diff = (int)remaining - slicelength;
+		slicelength += diff;
+		mips->downcount += diff;
+	}
+}
+
 void Advance(MIPSState *mips) {
 	PROFILE_THIS_SCOPE("advance");
 	int cyclesExecuted = slicelength - mips->downcount;
 	globalTimer += cyclesExecuted;
 	mips->downcount = slicelength;
 
+	s64 profilerSampleTicks = 0;
+	if (FunctionProfiler::g_active) {
+		profilerSampleTicks = FunctionProfiler::Tick(mips->pc, globalTimer);
+	}
+
 	// Debugger deadline - see SetBreakDeadlineTicks. Checked before the events so the break lands
 	// on the requested tick rather than after whatever the events do.
 	if (breakDeadlineTicks && globalTimer >= breakDeadlineTicks) {
@@ -453,12 +468,11 @@ void Advance(MIPSState *mips) {
 	// Shorten the slice so we come back exactly on the deadline instead of up to a whole slice
 	// past it - the point of cpu.runUntilTime is that it stops at a reproducible place.
 	if (breakDeadlineTicks) {
-		const s64 remaining = breakDeadlineTicks - globalTimer;
-		if (remaining > 0 && remaining < slicelength) {
-			const int diff = (int)remaining - slicelength;
-			slicelength += diff;
-			mips->downcount += diff;
-		}
+		ShortenSliceTo(mips, breakDeadlineTicks);
+	}
+	// Same for the profiler, so it samples at even intervals.
+	if (profilerSampleTicks) {
+		ShortenSliceTo(mips, profilerSampleTicks);
 	}
 }
 
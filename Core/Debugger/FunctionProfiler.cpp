@@ -0,0 +1,178 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/Debugger/FunctionProfiler.h"
+#include "Core/Debugger/SymbolMap.h"
+#include "Core/HLE/ReplaceTables.h"
+#include "Core/MIPS/MIPSAnalyst.h"
+
+namespace FunctionProfiler {
+
+bool g_active = false;
+
+static std::mutex samplesLock;
+static std::unordered_map<u32, u64> samples;
+static u64 totalCycles;
+static s64 nextSampleTicks = -1;
+static Path reportFilename;
+
+void Start() {
+	g_active = true;
+}
+
+void Stop() {
+	g_active = false;
+}
+
+void Clear() {
+	std::lock_guard<std::mutex> guard(samplesLock);
+	samples.clear();
+	totalCycles = 0;
+	nextSampleTicks = -1;
+}
+
+s64 Tick(u32 pc, s64 ticks) {
+	// First time, or time went backwards (new game or a loaded state.)
+	if (nextSampleTicks < 0 || nextSampleTicks > ticks + SAMPLE_INTERVAL_CYCLES) {
+		nextSampleTicks = ticks + SAMPLE_INTERVAL_CYCLES;
+		return nextSampleTicks;
+	}
+	if (ticks >= nextSampleTicks) {
+		// Normally just one, unless the slice couldn't end on time, like when idling to an event.
+		// Then the PC was there the whole time anyway.
+		const s64 points = 1 + (ticks - nextSampleTicks) / SAMPLE_INTERVAL_CYCLES;
+		Sample(pc, (u64)points * SAMPLE_INTERVAL_CYCLES);
+		nextSampleTicks += points * SAMPLE_INTERVAL_CYCLES;
+	}
+	return nextSampleTicks;
+}
+
+void Sample(u32 pc, u64 cycles) {
+	std::lock_guard<std::mutex> guard(samplesLock);
+	samples[pc] += cycles;
+	totalCycles += cycles;
+}
+
+std::vector<HotFunction> GetHotFunctions(size_t maxCount) {
+	std::unordered_map<u32, u64> pcs;
+	u64 total;
+	{
+		std::lock_guard<std::mutex> guard(samplesLock);
+		pcs = samples;
+		total = totalCycles;
+	}
+
+	// Functions are looked up per distinct PC, which is far fewer than samples.
+	std::unordered_map<u32, HotFunction> funcs;
+	for (const auto &it : pcs) {
+		MIPSAnalyst::AnalyzedFunction f;
+		if (!MIPSAnalyst::GetAnalyzedFunctionAt(it.first, &f))
+			continue;
+
+		auto existing = funcs.find(f.start);
+		if (existing != funcs.end()) {
+			existing->second.cycles += it.second;
+			continue;
+		}
+
+		HotFunction &hot = funcs[f.start];
+		hot.start = f.start;
+		hot.size = f.size;
+		hot.hash = f.hash;
+		hot.hasHash = f.hasHash;
+		hot.cycles = it.second;
+		hot.percent = 0.0;
+
+		const char *hashName = f.hasHash ? MIPSAnalyst::LookupHash(f.hash, f.size) : nullptr;
+		if (hashName) {
+			hot.name = hashName;
+		} else {
+			hot.name = g_symbolMap ? g_symbolMap->GetLabelString(f.start) : "";
+			if (hot.name.empty())
+				hot.name = f.name;
+		}
+	}
+
+	std::vector<HotFunction> result;
+	result.reserve(funcs.size());
+	for (auto &it : funcs)
+		result.push_back(std::move(it.second));
+	std::sort(result.begin(), result.end(), [](const HotFunction &a, const HotFunction &b) {
+		return a.cycles > b.cycles;
+	});
+	if (result.size() > maxCount)
+		result.resize(maxCount);
+
+	// Only look at the code of the ones we're reporting.
+	for (HotFunction &hot : result) {
+		hot.percent = total == 0 ? 0.0 : (double)hot.cycles * 100.0 / (double)total;
+		if (!hot.hasHash)
+			continue;
+		std::vector<int> indexes = GetReplacementFuncIndexes(hot.hash, hot.size);
+		if (!indexes.empty()) {
+			const ReplacementTableEntry *entry = GetReplacementFunc(indexes[0]);
+			hot.replacement = entry->name;
+			if (entry->flags & REPFLAG_DISABLED)
+				hot.replacement += " (disabled)";
+		}
+	}
+	return result;
+}
+
+void SetReportFilename(const Path &filename) {
+	reportFilename = filename;
+	if (!filename.empty())
+		Start();
+}
+
+bool WriteReport(const Path &filename, size_t maxCount) {
+	std::vector<HotFunction> funcs = GetHotFunctions(maxCount);
+
+	FILE *file = File::OpenCFile(filename, "wt");
+	if (!file) {
+		WARN_LOG(Log::Debugger, "Could not write function profile: %s", filename.c_str());
+		return false;
+	}
+
+	// Lines starting with # are skipped by LoadHashMap(), so a line can be turned into a hash map entry
+	// (hash:size = name) once someone has checked what the function really is.
+	fprintf(file, "# rank, start, size, hash, cycles, percent, name, replacement\n");
+	int rank = 1;
+	for (const HotFunction &hot : funcs) {
+		fprintf(file, "# %d, %08x, %d, %016llx, %llu, %.2f, %s, %s\n", rank++, hot.start, hot.size, (unsigned long long)hot.hash, (unsigned long long)hot.cycles, hot.percent, hot.name.c_str(), hot.replacement.c_str());
+	}
+	fclose(file);
+
+	INFO_LOG(Log::Debugger, "Wrote function profile (%d functions) to %s", (int)funcs.size(), filename.c_str());
+	return true;
+}
+
+void WriteReportIfRequested() {
+	if (reportFilename.empty())
+		return;
+	WriteReport(reportFilename, 200);
+	Clear();
+}
+
+}  // namespace FunctionProfiler
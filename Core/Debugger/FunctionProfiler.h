@@ -0,0 +1,70 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+
+// Sampling profiler of guest code, to find hot functions worth replacing (see ReplaceTables.)
+//
+// The PC is sampled every SAMPLE_INTERVAL_CYCLES of emulated time. CoreTiming ends a slice on each
+// sample point, so this works the same with every CPU core, and the PC isn't just wherever an event
+// or syscall happened to end a slice. Costs nothing when disabled. Samples are only mapped to
+// MIPSAnalyst functions when a report is made.
+
+namespace FunctionProfiler {
+
+extern bool g_active;
+
+// About 45 us at 222 MHz.
+static const int SAMPLE_INTERVAL_CYCLES = 10000;
+
+void Start();
+void Stop();
+void Clear();
+
+// Called from CoreTiming::Advance() with the current time, only when g_active is set. Samples pc if
+// a sample point was reached, and returns the tick of the next one, for the slice to end on.
+s64 Tick(u32 pc, s64 ticks);
+// Charges cycles to pc.
+void Sample(u32 pc, u64 cycles);
+
+struct HotFunction {
+	u32 start;
+	u32 size;
+	u64 hash;
+	bool hasHash;
+	std::string name;
+	u64 cycles;
+	double percent;
+	// Name of the replacement already hooked here, if any, with " (disabled)" if it won't run.
+	std::string replacement;
+};
+
+// Sorted by cycles, hottest first.
+std::vector<HotFunction> GetHotFunctions(size_t maxCount);
+
+// If set, a report is written there by WriteReportIfRequested() (at game shutdown.)
+void SetReportFilename(const Path &filename);
+bool WriteReport(const Path &filename, size_t maxCount);
+void WriteReportIfRequested();
+
+}  // namespace FunctionProfiler
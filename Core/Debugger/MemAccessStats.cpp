@@ -0,0 +1,219 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/Debugger/MemAccessStats.h"
+#include "Core/Debugger/SymbolMap.h"
+#include "Core/MemMap.h"
+
+namespace MemAccessStats {
+
+std::atomic<bool> g_active;
+
+struct Counts {
+	u64 counts[(int)Kind::COUNT];
+};
+
+struct PendingEvent {
+	// Set to the ring position + 1 once the rest is written.
+	std::atomic<u32> ready;
+	u32 pc;
+	u32 address;
+	Kind kind;
+};
+
+static constexpr u32 RING_SIZE = 16384;
+// Slow accesses (but not faults) count the pending events once there are this many.
+static constexpr u32 DRAIN_THRESHOLD = RING_SIZE / 2;
+
+// Record() can't lock or allocate in the fault handler, so events go through this ring first.
+// Any thread can add, they're only taken out with statsLock held.
+static PendingEvent ring[RING_SIZE];
+static std::atomic<u32> ringHead;
+static std::atomic<u32> ringTail;
+static std::atomic<u32> droppedEvents;
+
+static std::mutex statsLock;
+// Keyed by pc << 8 | region.
+static std::unordered_map<u64, Counts> stats;
+static Path reportFilename;
+
+void Start() {
+	g_active = true;
+}
+
+void Stop() {
+	g_active = false;
+}
+
+static void DrainLocked();
+
+void Clear() {
+	std::lock_guard<std::mutex> guard(statsLock);
+	DrainLocked();
+	stats.clear();
+	droppedEvents = 0;
+}
+
+static Region ClassifyAddress(u32 address) {
+	if (Memory::IsVRAMAddress(address))
+		return Region::VRAM;
+	if (Memory::IsScratchpadAddress(address))
+		return Region::SCRATCHPAD;
+	if (Memory::IsRAMAddress(address))
+		return Region::RAM;
+	return Region::INVALID;
+}
+
+// Must hold statsLock.
+static void DrainLocked() {
+	u32 tail = ringTail.load(std::memory_order_relaxed);
+	const u32 head = ringHead.load(std::memory_order_acquire);
+	for (; tail != head; ++tail) {
+		const PendingEvent &ev = ring[tail & (RING_SIZE - 1)];
+		if (ev.ready.load(std::memory_order_acquire) != tail + 1) {
+			// Claimed, but not written yet.
+			break;
+		}
+		const u64 key = ((u64)ev.pc << 8) | (u64)ClassifyAddress(ev.address);
+		auto it = stats.find(key);
+		if (it == stats.end())
+			it = stats.emplace(key, Counts{}).first;
+		it->second.counts[(int)ev.kind]++;
+	}
+	ringTail.store(tail, std::memory_order_release);
+}
+
+void Record(Kind kind, u32 pc, u32 address) {
+	// Faults can't lock, so they get dropped if the ring is full. Anything else makes room.
+	const bool canDrain = kind != Kind::FAULT;
+	u32 pos = ringHead.load(std::memory_order_relaxed);
+	while (true) {
+		if (pos - ringTail.load(std::memory_order_acquire) >= RING_SIZE) {
+			if (!canDrain) {
+				droppedEvents++;
+				return;
+			}
+			std::lock_guard<std::mutex> guard(statsLock);
+			DrainLocked();
+			pos = ringHead.load(std::memory_order_relaxed);
+			continue;
+		}
+		if (ringHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			break;
+	}
+
+	PendingEvent &ev = ring[pos & (RING_SIZE - 1)];
+	ev.pc = pc;
+	ev.address = address;
+	ev.kind = kind;
+	ev.ready.store(pos + 1, std::memory_order_release);
+
+	if (canDrain && pos + 1 - ringTail.load(std::memory_order_relaxed) >= DRAIN_THRESHOLD) {
+		// Not worth waiting for, if someone is already reading the stats.
+		std::unique_lock<std::mutex> guard(statsLock, std::try_to_lock);
+		if (guard.owns_lock())
+			DrainLocked();
+	}
+}
+
+const char *RegionName(Region region) {
+	switch (region) {
+	case Region::RAM: return "RAM";
+	case Region::VRAM: return "VRAM";
+	case Region::SCRATCHPAD: return "Scratchpad";
+	case Region::INVALID: return "Invalid";
+	default: return "?";
+	}
+}
+
+std::vector<HotSpot> GetHotSpots(size_t maxCount) {
+	std::vector<HotSpot> result;
+	{
+		std::lock_guard<std::mutex> guard(statsLock);
+		DrainLocked();
+		result.reserve(stats.size());
+		for (const auto &it : stats) {
+			HotSpot spot{};
+			spot.pc = (u32)(it.first >> 8);
+			spot.region = (Region)(it.first & 0xFF);
+			memcpy(spot.counts, it.second.counts, sizeof(spot.counts));
+			for (u64 count : spot.counts)
+				spot.total += count;
+			result.push_back(spot);
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [](const HotSpot &a, const HotSpot &b) {
+		return a.total > b.total;
+	});
+	if (result.size() > maxCount)
+		result.resize(maxCount);
+
+	// Only look up names for the ones we're reporting.
+	if (g_symbolMap) {
+		for (HotSpot &spot : result)
+			spot.name = g_symbolMap->GetDescription(spot.pc);
+	}
+	return result;
+}
+
+void SetReportFilename(const Path &filename) {
+	reportFilename = filename;
+	if (!filename.empty())
+		Start();
+}
+
+bool WriteReport(const Path &filename, size_t maxCount) {
+	std::vector<HotSpot> spots = GetHotSpots(maxCount);
+
+	FILE *file = File::OpenCFile(filename, "wt");
+	if (!file) {
+		WARN_LOG(Log::Debugger, "Could not write memory access stats: %s", filename.c_str());
+		return false;
+	}
+
+	if (droppedEvents != 0)
+		fprintf(file, "# %u accesses were dropped, because they came faster than they could be counted\n", droppedEvents.load());
+	fprintf(file, "# rank, pc, region, slow reads, slow writes, faults, name\n");
+	int rank = 1;
+	for (const HotSpot &spot : spots) {
+		fprintf(file, "%d, %08x, %s, %llu, %llu, %llu, %s\n", rank++, spot.pc, RegionName(spot.region),
+			(unsigned long long)spot.counts[(int)Kind::SLOW_READ], (unsigned long long)spot.counts[(int)Kind::SLOW_WRITE],
+			(unsigned long long)spot.counts[(int)Kind::FAULT], spot.name.c_str());
+	}
+	fclose(file);
+
+	INFO_LOG(Log::Debugger, "Wrote memory access stats (%d locations) to %s", (int)spots.size(), filename.c_str());
+	return true;
+}
+
+void WriteReportIfRequested() {
+	if (reportFilename.empty())
+		return;
+	WriteReport(reportFilename, 500);
+	Clear();
+}
+
+}  // namespace MemAccessStats
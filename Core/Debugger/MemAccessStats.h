@@ -0,0 +1,81 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+
+// Counts guest memory accesses that didn't take a fast path, by guest PC and memory region.
+//
+// That's the checked Memory::ReadOrException_* / WriteOrException_* / GetPointer*OrException
+// functions (used by HLE and by JITs without fastmem), and faults taken by fastmem code.
+// Meant to show which code would benefit from a fast path. Costs a flag check when disabled.
+//
+// The PC is currentMIPS->pc, which JITs only keep up to date around slow calls, so for fastmem
+// faults it's approximate.
+
+namespace MemAccessStats {
+
+extern std::atomic<bool> g_active;
+
+enum class Kind {
+	SLOW_READ,
+	SLOW_WRITE,
+	FAULT,
+	COUNT,
+};
+
+enum class Region {
+	RAM,
+	VRAM,
+	SCRATCHPAD,
+	INVALID,
+	COUNT,
+};
+
+void Start();
+void Stop();
+void Clear();
+
+// Only call when g_active is set. FAULT is recorded without locking or allocating, so it's safe
+// in the fault handler, but may be dropped if too many pile up before the stats are next read.
+void Record(Kind kind, u32 pc, u32 address);
+
+const char *RegionName(Region region);
+
+struct HotSpot {
+	u32 pc;
+	Region region;
+	u64 counts[(int)Kind::COUNT];
+	u64 total;
+	std::string name;
+};
+
+// Sorted by total count, most first.
+std::vector<HotSpot> GetHotSpots(size_t maxCount);
+
+// If set, a report is written there by WriteReportIfRequested() (at game shutdown.)
+void SetReportFilename(const Path &filename);
+bool WriteReport(const Path &filename, size_t maxCount);
+void WriteReportIfRequested();
+
+}  // namespace MemAccessStats
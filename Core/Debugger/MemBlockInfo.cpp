@@ -18,9 +18,12 @@
 #include <algorithm>
 #include <atomic>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 
 #include "Common/Log.h"
 #include "Common/Serialize/Serializer.h"
@@ -36,15 +39,86 @@
 #include "Common/StringUtils.h"
 #include "Core/Debugger/SymbolMap.h"
 
+// Tags are interned into this table, so slabs and pending notifications only carry a small ID.
+// Many tags are unique per address (copies, fallback tags), so IDs no slab references anymore
+// are swept.  A swept ID is only quarantined at first, and freed by the following sweep, so an
+// ID a notifying thread picked up just before the sweep stays valid until it gets flushed.
+// Get() and Sweep() must be called with pendingReadMutex held.
+class MemTagTable {
+public:
+	MemTagTable();
+	~MemTagTable();
+
+	// Tags longer than MAX_TAG_LEN are truncated, matching what save states can hold.
+	uint32_t Intern(const char *tag, size_t len);
+	const char *Get(uint32_t id, size_t *len = nullptr) const;
+	void Reset();
+
+	// Upper bound of IDs handed out so far, to size the used flags passed to Sweep().
+	uint32_t Size() const {
+		return count_.load(std::memory_order_acquire);
+	}
+	bool NeedsSweep() const {
+		return internsSinceSweep_.load(std::memory_order_relaxed) >= SWEEP_INTERVAL;
+	}
+	// IDs at or past used.size() are assumed to be in use.
+	void Sweep(const std::vector<uint8_t> &used);
+
+	uint32_t Generation() const {
+		return generation_.load(std::memory_order_acquire);
+	}
+
+	static constexpr uint32_t EMPTY = 0;
+	// Stands in for any tag that didn't fit, only if every ID is still referenced.
+	static constexpr uint32_t DROPPED = 1;
+	// Passed to MemSlabMap::Mark() to keep the existing tag.
+	static constexpr uint32_t KEEP = 0xFFFFFFFF;
+	static constexpr size_t MAX_TAG_LEN = 127;
+
+private:
+	enum class EntryState : uint8_t {
+		FREE,
+		LIVE,
+		QUARANTINED,
+	};
+
+	struct Entry {
+		char *str;
+		uint32_t len;
+		EntryState state;
+	};
+
+	static constexpr uint32_t CHUNK_SHIFT = 12;
+	static constexpr uint32_t CHUNK_SIZE = 1 << CHUNK_SHIFT;
+	static constexpr uint32_t MAX_CHUNKS = 64;
+	static constexpr uint32_t SWEEP_INTERVAL = 16384;
+
+	Entry &At(uint32_t id) const {
+		return chunks_[id >> CHUNK_SHIFT][id & (CHUNK_SIZE - 1)];
+	}
+	void Clear();
+
+	std::mutex lock_;
+	std::unordered_map<std::string_view, uint32_t> ids_;
+	// Chunks are published before count_, so Get() doesn't need the lock.
+	Entry *chunks_[MAX_CHUNKS]{};
+	std::atomic<uint32_t> count_{};
+	std::vector<uint32_t> freeIds_;
+	std::atomic<uint32_t> internsSinceSweep_{};
+	std::atomic<uint32_t> generation_{};
+	bool warnedFull_ = false;
+};
+
 class MemSlabMap {
 public:
 	MemSlabMap();
 	~MemSlabMap();
 
-	bool Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, const char *tag, size_t tagLen);
+	bool Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, uint32_t tagId);
 	bool Find(MemBlockFlags flags, uint32_t addr, uint32_t size, std::vector<MemBlockInfo> &results);
-	// Note that the returned pointer gets invalidated as soon as Mark is called.
+	// Returns an interned tag, which is only valid while pendingReadMutex is held.
 	const char *FastFindWriteTag(MemBlockFlags flags, uint32_t addr, uint32_t size, size_t *tagLen);
+	void MarkUsedTags(std::vector<uint8_t> &used) const;
 	void Reset();
 	void DoState(PointerWrap &p);
 
@@ -54,11 +128,8 @@ class MemSlabMap {
 		uint32_t end = 0;
 		uint64_t ticks = 0;
 		uint32_t pc = 0;
+		uint32_t tagId = MemTagTable::EMPTY;
 		bool allocated = false;
-		// Intentionally not save stated.
-		bool bulkStorage = false;
-		uint8_t tagLen;
-		char tag[128]{};
 		Slab *prev = nullptr;
 		Slab *next = nullptr;
 
@@ -68,6 +139,7 @@ class MemSlabMap {
 	static constexpr uint32_t MAX_SIZE = 0x40000000;
 	static constexpr uint32_t SLICES = 65536;
 	static constexpr uint32_t SLICE_SIZE = MAX_SIZE / SLICES;
+	static constexpr size_t SLABS_PER_CHUNK = 1024;
 
 	Slab *FindSlab(uint32_t addr);
 	void Clear();
@@ -78,10 +150,15 @@ class MemSlabMap {
 	void Merge(Slab *a, Slab *b);
 	void FillHeads(Slab *slab);
 
+	// Slabs are fixed size, so they're carved out of chunks and recycled through a free list.
+	Slab *AllocSlab();
+	void FreeSlab(Slab *slab);
+
 	Slab *first_ = nullptr;
 	Slab *lastFind_ = nullptr;
 	std::vector<Slab *> heads_;
-	Slab *bulkStorage_ = nullptr;
+	std::vector<std::unique_ptr<Slab[]>> slabChunks_;
+	Slab *freeSlabs_ = nullptr;
 };
 
 struct PendingNotifyMem {
@@ -91,33 +168,222 @@ struct PendingNotifyMem {
 	uint32_t copySrc;
 	uint64_t ticks;
 	uint32_t pc;
-	uint8_t tagLen;
-	char tag[127];
+	// For copies, this is the prefix.  The real tag is computed on flush.
+	uint32_t tagId;
 };
 
-// 160 KB.
-static constexpr size_t MAX_PENDING_NOTIFIES = 1024;
-static constexpr size_t MAX_PENDING_NOTIFIES_THREAD = 1000;
+// Each thread that notifies gets its own single producer, single consumer ring, so
+// notifying never takes a lock.  The consumer is whoever holds pendingReadMutex.
+struct PendingNotifyRing {
+	static constexpr uint32_t SIZE = 1024;
+
+	std::atomic<uint32_t> head{};
+	std::atomic<uint32_t> tail{};
+	// Address ranges of what's pending, split so VRAM doesn't make the RAM range cover everything.
+	std::atomic<uint32_t> minAddr1{ 0xFFFFFFFF };
+	std::atomic<uint32_t> maxAddr1{};
+	std::atomic<uint32_t> minAddr2{ 0xFFFFFFFF };
+	std::atomic<uint32_t> maxAddr2{};
+	PendingNotifyMem items[SIZE];
+};
+
+struct PendingNotifyRingHolder {
+	~PendingNotifyRingHolder();
+	PendingNotifyRing *ring = nullptr;
+};
+
+// Holds a copy of the text, so a sweep or Reset() can't leave it pointing at freed memory.
+struct TagCacheEntry {
+	uint32_t id;
+	uint8_t len;
+	char str[59];
+};
+
+// 32 KB per notifying thread, plus 16 KB of tag cache.
+static constexpr uint32_t FLUSH_PENDING_THRESHOLD = 768;
+static constexpr size_t TAG_CACHE_SIZE = 256;
+static MemTagTable tagTable;
 static MemSlabMap allocMap;
 static MemSlabMap suballocMap;
 static MemSlabMap writeMap;
 static MemSlabMap textureMap;
-static std::vector<PendingNotifyMem> pendingNotifies;
-static std::atomic<uint32_t> pendingNotifyMinAddr1;
-static std::atomic<uint32_t> pendingNotifyMaxAddr1;
-static std::atomic<uint32_t> pendingNotifyMinAddr2;
-static std::atomic<uint32_t> pendingNotifyMaxAddr2;
-// To prevent deadlocks, acquire Read before Write if you're going to acquire both.
-static std::mutex pendingWriteMutex;
+static std::vector<PendingNotifyRing *> pendingRings;
+static std::mutex pendingRingsMutex;
+// Only accessed with pendingReadMutex held.
+static std::vector<PendingNotifyMem> flushBatch;
+static std::vector<uint8_t> usedTags;
+// Held while flushing or reading the slab maps.  Notifying doesn't need it.
 static std::mutex pendingReadMutex;
 static int detailedOverride;
 
+static thread_local PendingNotifyRingHolder localRing;
+static thread_local TagCacheEntry tagCache[TAG_CACHE_SIZE];
+static thread_local uint32_t tagCacheGeneration = 0xFFFFFFFF;
+
 static std::thread flushThread;
 static std::atomic<bool> flushThreadRunning;
 static std::atomic<bool> flushThreadPending;
 static std::mutex flushLock;
 static std::condition_variable flushCond;
 
+MemTagTable::MemTagTable() {
+	Reset();
+}
+
+MemTagTable::~MemTagTable() {
+	Clear();
+}
+
+uint32_t MemTagTable::Intern(const char *tag, size_t len) {
+	if (len > MAX_TAG_LEN)
+		len = MAX_TAG_LEN;
+	// Strings can have embedded nulls from truncated buffers, treat those as the end.
+	len = strnlen(tag, len);
+	if (len == 0)
+		return EMPTY;
+
+	std::lock_guard<std::mutex> guard(lock_);
+	auto it = ids_.find(std::string_view(tag, len));
+	if (it != ids_.end())
+		return it->second;
+
+	uint32_t id;
+	if (!freeIds_.empty()) {
+		id = freeIds_.back();
+		freeIds_.pop_back();
+	} else {
+		id = count_.load(std::memory_order_relaxed);
+		if (id >= MAX_CHUNKS * CHUNK_SIZE) {
+			if (!warnedFull_) {
+				WARN_LOG(Log::MemMap, "MemBlockInfo tag table full, new tags will show as \"%s\"", At(DROPPED).str);
+				warnedFull_ = true;
+			}
+			return DROPPED;
+		}
+		if ((id & (CHUNK_SIZE - 1)) == 0) {
+			chunks_[id >> CHUNK_SHIFT] = new Entry[CHUNK_SIZE]{};
+		}
+	}
+
+	char *str = new char[len + 1];
+	memcpy(str, tag, len);
+	str[len] = '\0';
+	At(id) = Entry{ str, (uint32_t)len, EntryState::LIVE };
+	ids_[std::string_view(str, len)] = id;
+	if (id >= count_.load(std::memory_order_relaxed))
+		count_.store(id + 1, std::memory_order_release);
+	internsSinceSweep_.fetch_add(1, std::memory_order_relaxed);
+	return id;
+}
+
+const char *MemTagTable::Get(uint32_t id, size_t *len) const {
+	if (id >= count_.load(std::memory_order_acquire) || At(id).state == EntryState::FREE) {
+		if (len)
+			*len = 0;
+		return "";
+	}
+	const Entry &entry = At(id);
+	if (len)
+		*len = entry.len;
+	return entry.str;
+}
+
+void MemTagTable::Sweep(const std::vector<uint8_t> &used) {
+	std::lock_guard<std::mutex> guard(lock_);
+	bool quarantined = false;
+	uint32_t count = count_.load(std::memory_order_relaxed);
+	for (uint32_t id = DROPPED + 1; id < count; ++id) {
+		Entry &entry = At(id);
+		bool inUse = id >= used.size() || used[id] != 0;
+		std::string_view str(entry.str, entry.len);
+		if (entry.state == EntryState::QUARANTINED) {
+			if (inUse) {
+				// Was still in flight when swept.  If the text was interned again meanwhile, both IDs stay valid.
+				ids_.emplace(str, id);
+				entry.state = EntryState::LIVE;
+			} else {
+				delete[] entry.str;
+				entry = Entry{ nullptr, 0, EntryState::FREE };
+				freeIds_.push_back(id);
+			}
+		} else if (entry.state == EntryState::LIVE && !inUse) {
+			auto it = ids_.find(str);
+			if (it != ids_.end() && it->second == id)
+				ids_.erase(it);
+			entry.state = EntryState::QUARANTINED;
+			quarantined = true;
+		}
+	}
+	internsSinceSweep_ = 0;
+	// The per-thread caches may hold quarantined IDs, which must not be handed out again.
+	if (quarantined)
+		generation_++;
+}
+
+void MemTagTable::Clear() {
+	for (Entry *&chunk : chunks_) {
+		if (chunk) {
+			for (uint32_t i = 0; i < CHUNK_SIZE; ++i) {
+				if (chunk[i].state != EntryState::FREE)
+					delete[] chunk[i].str;
+			}
+		}
+		delete[] chunk;
+		chunk = nullptr;
+	}
+	ids_.clear();
+	freeIds_.clear();
+	count_ = 0;
+	internsSinceSweep_ = 0;
+}
+
+void MemTagTable::Reset() {
+	std::lock_guard<std::mutex> guard(lock_);
+	Clear();
+	warnedFull_ = false;
+
+	// ID 0 is always the empty tag, and ID 1 the placeholder for dropped tags.
+	static const char droppedTag[] = "(tag table full)";
+	const size_t droppedLen = sizeof(droppedTag) - 1;
+	chunks_[0] = new Entry[CHUNK_SIZE]{};
+	At(EMPTY) = Entry{ new char[1]{}, 0, EntryState::LIVE };
+	At(DROPPED) = Entry{ new char[droppedLen + 1], (uint32_t)droppedLen, EntryState::LIVE };
+	memcpy(At(DROPPED).str, droppedTag, droppedLen + 1);
+	ids_[std::string_view(At(DROPPED).str, droppedLen)] = DROPPED;
+	count_.store(2, std::memory_order_release);
+	// Invalidates the per-thread caches.
+	generation_++;
+}
+
+// Most tags are repeated constantly, so check a small per-thread cache before taking the table lock.
+static uint32_t InternTag(const char *tag, size_t len) {
+	if (len > MemTagTable::MAX_TAG_LEN)
+		len = MemTagTable::MAX_TAG_LEN;
+	uint32_t generation = tagTable.Generation();
+	if (tagCacheGeneration != generation) {
+		memset(tagCache, 0, sizeof(tagCache));
+		tagCacheGeneration = generation;
+	}
+
+	// FNV-1a, the tags are short.
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < len; ++i)
+		hash = (hash ^ (uint8_t)tag[i]) * 16777619U;
+
+	TagCacheEntry &entry = tagCache[hash & (TAG_CACHE_SIZE - 1)];
+	if (entry.id != MemTagTable::EMPTY && entry.len == len && memcmp(entry.str, tag, len) == 0)
+		return entry.id;
+
+	uint32_t id = tagTable.Intern(tag, len);
+	// Only cache exact matches, since Intern() may have trimmed at an embedded null.
+	if (len <= sizeof(entry.str) && id != MemTagTable::DROPPED && strnlen(tag, len) == len) {
+		entry.id = id;
+		entry.len = (uint8_t)len;
+		memcpy(entry.str, tag, len);
+	}
+	return id;
+}
+
 MemSlabMap::MemSlabMap() {
 	Reset();
 }
@@ -126,7 +392,7 @@ MemSlabMap::~MemSlabMap() {
 	Clear();
 }
 
-bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, const char *tag, size_t tagLen) {
+bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, uint32_t tagId) {
 	uint32_t end = addr + size;
 	Slab *slab = FindSlab(addr);
 	Slab *firstMatch = nullptr;
@@ -143,8 +409,8 @@ bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc,
 			slab->ticks = ticks;
 			slab->pc = pc;
 		}
-		if (tag)
-			slab->tagLen = (uint8_t)truncate_cpy_len(slab->tag, tag, tagLen);
+		if (tagId != MemTagTable::KEEP)
+			slab->tagId = tagId;
 
 		// Move on to the next one.
 		if (firstMatch == nullptr)
@@ -165,8 +431,10 @@ bool MemSlabMap::Find(MemBlockFlags flags, uint32_t addr, uint32_t size, std::ve
 	Slab *slab = FindSlab(addr);
 	bool found = false;
 	while (slab != nullptr && slab->start < end) {
-		if (slab->pc != 0 || slab->tag[0] != '\0') {
-			results.push_back({ flags, slab->start, slab->end - slab->start, slab->ticks, slab->pc, slab->tag, slab->allocated });
+		if (slab->pc != 0 || slab->tagId != MemTagTable::EMPTY) {
+			size_t tagLen;
+			const char *tag = tagTable.Get(slab->tagId, &tagLen);
+			results.push_back({ flags, slab->start, slab->end - slab->start, slab->ticks, slab->pc, std::string(tag, tagLen), slab->allocated });
 			found = true;
 		}
 		slab = slab->next;
@@ -178,19 +446,25 @@ const char *MemSlabMap::FastFindWriteTag(MemBlockFlags flags, uint32_t addr, uin
 	uint32_t end = addr + size;
 	Slab *slab = FindSlab(addr);
 	while (slab != nullptr && slab->start < end) {
-		if (slab->pc != 0 || slab->tag[0] != '\0') {
-			*tagLen = slab->tagLen;
-			return slab->tag;
+		if (slab->pc != 0 || slab->tagId != MemTagTable::EMPTY) {
+			return tagTable.Get(slab->tagId, tagLen);
 		}
 		slab = slab->next;
 	}
 	return nullptr;
 }
 
+void MemSlabMap::MarkUsedTags(std::vector<uint8_t> &used) const {
+	for (const Slab *slab = first_; slab != nullptr; slab = slab->next) {
+		if (slab->tagId < used.size())
+			used[slab->tagId] = 1;
+	}
+}
+
 void MemSlabMap::Reset() {
 	Clear();
 
-	first_ = new Slab();
+	first_ = AllocSlab();
 	first_->end = MAX_SIZE;
 	lastFind_ = first_;
 
@@ -204,25 +478,21 @@ void MemSlabMap::DoState(PointerWrap &p) {
 
 	int count = 0;
 	if (p.mode == p.MODE_READ) {
-		// Since heads_ is a static size, let's avoid clearing it.
-		// This helps in case a debugger call happens concurrently.
-		Slab *old = first_;
-		Slab *oldBulk = bulkStorage_;
+		// Readers hold pendingReadMutex, same as us, so it's safe to tear down the old slabs first.
+		Clear();
 		Do(p, count);
 
-		first_ = new Slab();
+		first_ = AllocSlab();
 		first_->DoState(p);
 		lastFind_ = first_;
 		--count;
 
+		heads_.resize(SLICES, first_);
 		FillHeads(first_);
 
-		bulkStorage_ = new Slab[count];
-
 		Slab *slab = first_;
 		for (int i = 0; i < count; ++i) {
-			slab->next = &bulkStorage_[i];
-			slab->next->bulkStorage = true;
+			slab->next = AllocSlab();
 			slab->next->DoState(p);
 
 			slab->next->prev = slab;
@@ -230,15 +500,6 @@ void MemSlabMap::DoState(PointerWrap &p) {
 
 			FillHeads(slab);
 		}
-
-		// Now that it's entirely disconnected, delete the old slabs.
-		while (old != nullptr) {
-			Slab *next = old->next;
-			if (!old->bulkStorage)
-				delete old;
-			old = next;
-		}
-		delete [] oldBulk;
 	} else {
 		for (Slab *slab = first_; slab != nullptr; slab = slab->next)
 			++count;
@@ -267,33 +528,52 @@ void MemSlabMap::Slab::DoState(PointerWrap &p) {
 	Do(p, ticks);
 	Do(p, pc);
 	Do(p, allocated);
+	// The format still stores the tag text, IDs are only meaningful within a session.
+	char tag[MemTagTable::MAX_TAG_LEN + 1]{};
+	if (p.mode != p.MODE_READ) {
+		size_t tagLen;
+		const char *str = tagTable.Get(tagId, &tagLen);
+		memcpy(tag, str, tagLen);
+	}
 	if (s >= 3) {
 		Do(p, tag);
-		tagLen = (uint8_t)strnlen(tag, sizeof(tag) - 1);
+		if (p.mode == p.MODE_READ)
+			tagId = InternTag(tag, strnlen(tag, sizeof(tag) - 1));
 	} else if (s >= 2) {
 		char shortTag[32];
 		Do(p, shortTag);
-		memcpy(tag, shortTag, sizeof(shortTag));
-		tagLen = (uint8_t)strnlen(tag, sizeof(shortTag) - 1);
+		tagId = InternTag(shortTag, strnlen(shortTag, sizeof(shortTag) - 1));
 	} else {
 		std::string stringTag;
 		Do(p, stringTag);
-		tagLen = (uint8_t)std::min(stringTag.size(), sizeof(tag) - 1);
-		memcpy(tag, stringTag.data(), tagLen);
-		tag[tagLen] = '\0';
+		tagId = InternTag(stringTag.data(), stringTag.size());
 	}
 }
 
+MemSlabMap::Slab *MemSlabMap::AllocSlab() {
+	if (!freeSlabs_) {
+		slabChunks_.emplace_back(new Slab[SLABS_PER_CHUNK]);
+		Slab *chunk = slabChunks_.back().get();
+		for (size_t i = 0; i < SLABS_PER_CHUNK; ++i) {
+			chunk[i].next = freeSlabs_;
+			freeSlabs_ = &chunk[i];
+		}
+	}
+	Slab *slab = freeSlabs_;
+	freeSlabs_ = slab->next;
+	*slab = Slab();
+	return slab;
+}
+
+void MemSlabMap::FreeSlab(Slab *slab) {
+	slab->prev = nullptr;
+	slab->next = freeSlabs_;
+	freeSlabs_ = slab;
+}
+
 void MemSlabMap::Clear() {
-	Slab *s = first_;
-	while (s != nullptr) {
-		Slab *next = s->next;
-		if (!s->bulkStorage)
-			delete s;
-		s = next;
-	}
-	delete [] bulkStorage_;
-	bulkStorage_ = nullptr;
+	slabChunks_.clear();
+	freeSlabs_ = nullptr;
 	first_ = nullptr;
 	lastFind_ = nullptr;
 	heads_.clear();
@@ -317,15 +597,13 @@ MemSlabMap::Slab *MemSlabMap::FindSlab(uint32_t addr) {
 }
 
 MemSlabMap::Slab *MemSlabMap::Split(Slab *slab, uint32_t size) {
-	Slab *next = new Slab();
+	Slab *next = AllocSlab();
 	next->start = slab->start + size;
 	next->end = slab->end;
 	next->ticks = slab->ticks;
 	next->pc = slab->pc;
 	next->allocated = slab->allocated;
-	next->tagLen = (uint8_t)std::min<size_t>(slab->tagLen, sizeof(next->tag) - 1);
-	memcpy(next->tag, slab->tag, next->tagLen);
-	next->tag[next->tagLen] = '\0';
+	next->tagId = slab->tagId;
 	next->prev = slab;
 	next->next = slab->next;
 
@@ -345,7 +623,8 @@ bool MemSlabMap::Same(const Slab *a, const Slab *b) {
 		return false;
 	if (a->pc != b->pc)
 		return false;
-	if (strcmp(a->tag, b->tag))
+	// Interned, so equal tags have equal IDs.
+	if (a->tagId != b->tagId)
 		return false;
 	return true;
 }
@@ -388,8 +667,7 @@ void MemSlabMap::Merge(Slab *a, Slab *b) {
 	}
 	if (lastFind_ == b)
 		lastFind_ = a;
-	if (!b->bulkStorage)
-		delete b;
+	FreeSlab(b);
 }
 
 void MemSlabMap::FillHeads(Slab *slab) {
@@ -412,50 +690,114 @@ void MemSlabMap::FillHeads(Slab *slab) {
 
 size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, size_t prefixLen, uint32_t start, uint32_t size);
 
+// Duplicates are common (e.g. the same buffer written repeatedly), so merge with the last few.
+static inline bool MergeRecentMemInfo(std::vector<PendingNotifyMem> &batch, size_t ringStart, const PendingNotifyMem &info) {
+	if (info.copySrc != 0 || batch.size() < ringStart + 4)
+		return false;
+
+	for (size_t i = 1; i <= 4; ++i) {
+		auto &prev = batch[batch.size() - i];
+		if (prev.copySrc != 0)
+			return false;
+
+		if (prev.flags != info.flags)
+			continue;
+
+		if (prev.start >= info.start + info.size || prev.start + prev.size <= info.start)
+			continue;
+
+		// This means there's overlap, but not a match, so we can't combine any.
+		if (prev.start != info.start || prev.size > info.size)
+			return false;
+
+		prev.tagId = info.tagId;
+		prev.size = info.size;
+		prev.ticks = info.ticks;
+		prev.pc = info.pc;
+		return true;
+	}
+
+	return false;
+}
+
 void FlushPendingMemInfo() {
 	// This lock prevents us from another thread reading while we're busy flushing.
 	std::lock_guard<std::mutex> guard(pendingReadMutex);
-	std::vector<PendingNotifyMem> thisBatch;
+	flushBatch.clear();
+	size_t ringCount;
 	{
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		thisBatch = std::move(pendingNotifies);
-		pendingNotifies.clear();
-		pendingNotifies.reserve(MAX_PENDING_NOTIFIES);
+		std::lock_guard<std::mutex> guard(pendingRingsMutex);
+		ringCount = pendingRings.size();
+		for (PendingNotifyRing *ring : pendingRings) {
+			uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+			uint32_t head = ring->head.load(std::memory_order_acquire);
+			size_t ringStart = flushBatch.size();
+			for (uint32_t i = tail; i != head; ++i) {
+				const PendingNotifyMem &info = ring->items[i & (PendingNotifyRing::SIZE - 1)];
+				if (!MergeRecentMemInfo(flushBatch, ringStart, info))
+					flushBatch.push_back(info);
+			}
+			ring->tail.store(head, std::memory_order_release);
+		}
+	}
 
-		pendingNotifyMinAddr1 = 0xFFFFFFFF;
-		pendingNotifyMaxAddr1 = 0;
-		pendingNotifyMinAddr2 = 0xFFFFFFFF;
-		pendingNotifyMaxAddr2 = 0;
+	// Each ring is in order, but interleave threads by time so later notifications win.
+	if (ringCount > 1) {
+		std::stable_sort(flushBatch.begin(), flushBatch.end(), [](const PendingNotifyMem &a, const PendingNotifyMem &b) {
+			return a.ticks < b.ticks;
+		});
 	}
 
-	for (const auto &info : thisBatch) {
+	for (const auto &info : flushBatch) {
 		if (info.copySrc != 0) {
 			char tagData[128];
-			size_t tagSize = FormatMemWriteTagAtNoFlush(tagData, sizeof(tagData), info.tag, info.tagLen, info.copySrc, info.size);
-			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, tagData, tagSize);
+			size_t prefixLen;
+			const char *prefix = tagTable.Get(info.tagId, &prefixLen);
+			size_t tagSize = FormatMemWriteTagAtNoFlush(tagData, sizeof(tagData), prefix, prefixLen, info.copySrc, info.size);
+			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, InternTag(tagData, tagSize));
 			continue;
 		}
 
 		if (info.flags & MemBlockFlags::ALLOC) {
-			allocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag, info.tagLen);
+			allocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tagId);
 		} else if (info.flags & MemBlockFlags::FREE) {
 			// Maintain the previous allocation tag for debugging.
-			allocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr, 0);
-			suballocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr, 0);
+			allocMap.Mark(info.start, info.size, info.ticks, 0, false, MemTagTable::KEEP);
+			suballocMap.Mark(info.start, info.size, info.ticks, 0, false, MemTagTable::KEEP);
 		}
 		if (info.flags & MemBlockFlags::SUB_ALLOC) {
-			suballocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag, info.tagLen);
+			suballocMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tagId);
 		} else if (info.flags & MemBlockFlags::SUB_FREE) {
 			// Maintain the previous allocation tag for debugging.
-			suballocMap.Mark(info.start, info.size, info.ticks, 0, false, nullptr, 0);
+			suballocMap.Mark(info.start, info.size, info.ticks, 0, false, MemTagTable::KEEP);
 		}
 		if (info.flags & MemBlockFlags::TEXTURE) {
-			textureMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag, info.tagLen);
+			textureMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tagId);
 		}
 		if (info.flags & MemBlockFlags::WRITE) {
-			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag, info.tagLen);
+			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tagId);
 		}
 	}
+
+	if (tagTable.NeedsSweep()) {
+		// Everything notified before now is in the maps, so whatever they don't reference is unused.
+		usedTags.assign(tagTable.Size(), 0);
+		allocMap.MarkUsedTags(usedTags);
+		suballocMap.MarkUsedTags(usedTags);
+		writeMap.MarkUsedTags(usedTags);
+		textureMap.MarkUsedTags(usedTags);
+		tagTable.Sweep(usedTags);
+	}
+}
+
+PendingNotifyRingHolder::~PendingNotifyRingHolder() {
+	if (!ring)
+		return;
+	// Don't lose anything this thread notified before exiting.
+	FlushPendingMemInfo();
+	std::lock_guard<std::mutex> guard(pendingRingsMutex);
+	pendingRings.erase(std::remove(pendingRings.begin(), pendingRings.end(), ring), pendingRings.end());
+	delete ring;
 }
 
 static inline uint32_t NormalizeAddress(uint32_t addr) {
@@ -464,33 +806,81 @@ static inline uint32_t NormalizeAddress(uint32_t addr) {
 	return addr & 0x3FFFFFFF;
 }
 
-static inline bool MergeRecentMemInfo(const PendingNotifyMem &info, size_t copyLength) {
-	if (pendingNotifies.size() < 4)
-		return false;
+static inline void AtomicMin(std::atomic<uint32_t> &v, uint32_t value, bool reset) {
+	// Only the owning thread writes these, so no compare-exchange is needed.
+	if (reset || value < v.load(std::memory_order_relaxed))
+		v.store(value, std::memory_order_relaxed);
+}
 
-	for (size_t i = 1; i <= 4; ++i) {
-		auto &prev = pendingNotifies[pendingNotifies.size() - i];
-		if (prev.copySrc != 0)
-			return false;
+static inline void AtomicMax(std::atomic<uint32_t> &v, uint32_t value, bool reset) {
+	if (reset || value > v.load(std::memory_order_relaxed))
+		v.store(value, std::memory_order_relaxed);
+}
 
-		if (prev.flags != info.flags)
-			continue;
+static void PushPendingMemInfo(const PendingNotifyMem &info) {
+	PendingNotifyRing *ring = localRing.ring;
+	if (!ring) {
+		ring = new PendingNotifyRing();
+		std::lock_guard<std::mutex> guard(pendingRingsMutex);
+		pendingRings.push_back(ring);
+		localRing.ring = ring;
+	}
 
-		if (prev.start >= info.start + info.size || prev.start + prev.size <= info.start)
-			continue;
+	uint32_t head = ring->head.load(std::memory_order_relaxed);
+	uint32_t tail = ring->tail.load(std::memory_order_acquire);
+	if (head - tail >= PendingNotifyRing::SIZE) {
+		// The flush thread is behind, do it ourselves.
+		FlushPendingMemInfo();
+		tail = ring->tail.load(std::memory_order_acquire);
+	}
 
-		// This means there's overlap, but not a match, so we can't combine any.
-		if (prev.start != info.start || prev.size > info.size)
-			return false;
+	// If the ring was drained, the old range no longer means anything.
+	bool reset = head == tail;
+	if (info.start < 0x08000000) {
+		AtomicMin(ring->minAddr1, info.start, reset);
+		AtomicMax(ring->maxAddr1, info.start + info.size, reset);
+		if (reset) {
+			ring->minAddr2.store(0xFFFFFFFF, std::memory_order_relaxed);
+			ring->maxAddr2.store(0, std::memory_order_relaxed);
+		}
+	} else {
+		AtomicMin(ring->minAddr2, info.start, reset);
+		AtomicMax(ring->maxAddr2, info.start + info.size, reset);
+		if (reset) {
+			ring->minAddr1.store(0xFFFFFFFF, std::memory_order_relaxed);
+			ring->maxAddr1.store(0, std::memory_order_relaxed);
+		}
+	}
 
-		memcpy(prev.tag, info.tag, copyLength + 1);
-		prev.size = info.size;
-		prev.ticks = info.ticks;
-		prev.pc = info.pc;
-		return true;
+	ring->items[head & (PendingNotifyRing::SIZE - 1)] = info;
+	ring->head.store(head + 1, std::memory_order_release);
+
+	// Only wake the flush thread once per batch.
+	if (head + 1 - tail == FLUSH_PENDING_THRESHOLD) {
+		{
+			std::lock_guard<std::mutex> guard(flushLock);
+			flushThreadPending = true;
+		}
+		flushCond.notify_one();
 	}
+}
 
-	return false;
+// Flushes if anything pending might overlap the range, so queries see up to date info.
+static void FlushPendingMemInfoFor(uint32_t start, uint32_t size) {
+	bool needFlush = false;
+	{
+		std::lock_guard<std::mutex> guard(pendingRingsMutex);
+		for (PendingNotifyRing *ring : pendingRings) {
+			if (ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_relaxed))
+				continue;
+			if (ring->minAddr1.load(std::memory_order_relaxed) < start + size && ring->maxAddr1.load(std::memory_order_relaxed) >= start)
+				needFlush = true;
+			if (ring->minAddr2.load(std::memory_order_relaxed) < start + size && ring->maxAddr2.load(std::memory_order_relaxed) >= start)
+				needFlush = true;
+		}
+	}
+	if (needFlush)
+		FlushPendingMemInfo();
 }
 
 void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_t pc, const char *tagStr, size_t strLength) {
@@ -500,42 +890,13 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 	// Clear the uncached and kernel bits.
 	start = NormalizeAddress(start);
 
-	bool needFlush = false;
 	// When the setting is off, we skip smaller info to keep things fast.
 	if (MemBlockInfoDetailed(size) && flags != MemBlockFlags::READ) {
 		PendingNotifyMem info{ flags, start, size };
 		info.ticks = CoreTiming::GetTicks(currentMIPS);
 		info.pc = pc;
-
-		size_t copyLength = strLength;
-		if (copyLength >= sizeof(info.tag)) {
-			copyLength = sizeof(info.tag) - 1;
-		}
-		memcpy(info.tag, tagStr, copyLength);
-		info.tag[copyLength] = 0;
-		info.tagLen = (uint8_t)copyLength;
-
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		// Sometimes we get duplicates, quickly check.
-		if (!MergeRecentMemInfo(info, copyLength)) {
-			if (start < 0x08000000) {
-				pendingNotifyMinAddr1 = std::min(pendingNotifyMinAddr1.load(), start);
-				pendingNotifyMaxAddr1 = std::max(pendingNotifyMaxAddr1.load(), start + size);
-			} else {
-				pendingNotifyMinAddr2 = std::min(pendingNotifyMinAddr2.load(), start);
-				pendingNotifyMaxAddr2 = std::max(pendingNotifyMaxAddr2.load(), start + size);
-			}
-			pendingNotifies.push_back(info);
-		}
-		needFlush = pendingNotifies.size() > MAX_PENDING_NOTIFIES_THREAD;
-	}
-
-	if (needFlush) {
-		{
-			std::lock_guard<std::mutex> guard(flushLock);
-			flushThreadPending = true;
-		}
-		flushCond.notify_one();
+		info.tagId = InternTag(tagStr, strLength);
+		PushPendingMemInfo(info);
 	}
 
 	if (!(flags & MemBlockFlags::SKIP_MEMCHECK)) {
@@ -555,7 +916,6 @@ void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const c
 	if (size == 0)
 		return;
 
-	bool needsFlush = false;
 	if (g_breakpoints.HasMemChecks()) {
 		// This will cause a flush, but it's needed to trigger memchecks with proper data.
 		char tagData[128];
@@ -570,39 +930,16 @@ void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const c
 		info.copySrc = srcPtr;
 		info.ticks = CoreTiming::GetTicks(currentMIPS);
 		info.pc = currentMIPS->pc;
-
 		// Store the prefix for now.  The correct tag will be calculated on flush.
-		info.tagLen = (uint8_t)std::min(sizeof(info.tag), prefixLen);
-		memcpy(info.tag, prefix, info.tagLen);
-
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		if (destPtr < 0x08000000) {
-			pendingNotifyMinAddr1 = std::min(pendingNotifyMinAddr1.load(), destPtr);
-			pendingNotifyMaxAddr1 = std::max(pendingNotifyMaxAddr1.load(), destPtr + size);
-		} else {
-			pendingNotifyMinAddr2 = std::min(pendingNotifyMinAddr2.load(), destPtr);
-			pendingNotifyMaxAddr2 = std::max(pendingNotifyMaxAddr2.load(), destPtr + size);
-		}
-		pendingNotifies.push_back(info);
-		needsFlush = pendingNotifies.size() > MAX_PENDING_NOTIFIES_THREAD;
-	}
-
-	if (needsFlush) {
-		{
-			std::lock_guard<std::mutex> guard(flushLock);
-			flushThreadPending = true;
-		}
-		flushCond.notify_one();
+		info.tagId = InternTag(prefix, prefixLen);
+		PushPendingMemInfo(info);
 	}
 }
 
 std::vector<MemBlockInfo> FindMemInfo(uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
 
-	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-		FlushPendingMemInfo();
-	if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-		FlushPendingMemInfo();
+	FlushPendingMemInfoFor(start, size);
 
 	// pendingReadMutex doesn't just guard the pending queue - it's also what keeps
 	// the background flush thread's Mark() calls (which mutate the slab maps'
@@ -620,10 +957,7 @@ std::vector<MemBlockInfo> FindMemInfo(uint32_t start, uint32_t size) {
 std::vector<MemBlockInfo> FindMemInfoByFlag(MemBlockFlags flags, uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
 
-	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-		FlushPendingMemInfo();
-	if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-		FlushPendingMemInfo();
+	FlushPendingMemInfoFor(start, size);
 
 	// See the comment in FindMemInfo() above.
 	std::lock_guard<std::mutex> guard(pendingReadMutex);
@@ -639,26 +973,10 @@ std::vector<MemBlockInfo> FindMemInfoByFlag(MemBlockFlags flags, uint32_t start,
 	return results;
 }
 
-static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint32_t size, size_t *tagLen, bool flush = true) {
+// Must be called with pendingReadMutex held, and the tag copied before releasing it.
+static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint32_t size, size_t *tagLen) {
 	start = NormalizeAddress(start);
 
-	// See the comment in FindMemInfo() above. Note: the returned tag pointer is
-	// only valid until the next Mark() call per FastFindWriteTag()'s own contract,
-	// so callers must treat it as transient exactly as they already do.
-	//
-	// flush=false means we're being called from FormatMemWriteTagAtNoFlush(), which
-	// is only ever called from within FlushPendingMemInfo() - which already holds
-	// pendingReadMutex for its whole body. Locking it again here would deadlock (or
-	// be undefined behavior, since it's a plain non-recursive std::mutex), so only
-	// take the lock ourselves when we might not already be holding it.
-	std::unique_lock<std::mutex> guard(pendingReadMutex, std::defer_lock);
-	if (flush) {
-		if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-			FlushPendingMemInfo();
-		if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-			FlushPendingMemInfo();
-		guard.lock();
-	}
 	if (flags & MemBlockFlags::ALLOC) {
 		const char *tag = allocMap.FastFindWriteTag(MemBlockFlags::ALLOC, start, size, tagLen);
 		if (tag)
@@ -684,27 +1002,21 @@ static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint3
 }
 
 size_t FormatMemWriteTagAt(char *buf, size_t sz, const char *prefix, size_t prefixLen, uint32_t start, uint32_t size) {
-	size_t tagLen;
-	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size, &tagLen);
-	if (tag && strcmp(tag, "MemInit") != 0) {
-		return truncate_cat(buf, sz, prefix, prefixLen, tag, tagLen);
-	}
-	// Fall back to alloc and texture, especially for VRAM.  We prefer write above.
-	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size, &tagLen);
-	if (tag) {
-		return truncate_cat(buf, sz, prefix, prefixLen, tag, tagLen);
-	}
-	return snprintf(buf, sz, "%s%08x_size_%08x", prefix, start, size);
+	FlushPendingMemInfoFor(NormalizeAddress(start), size);
+	// See the comment in FindMemInfo() above.  Also keeps the tag from being swept while we copy it.
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	return FormatMemWriteTagAtNoFlush(buf, sz, prefix, prefixLen, start, size);
 }
 
+// Only called from FlushPendingMemInfo(), or with pendingReadMutex otherwise held.
 size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, size_t prefixLen, uint32_t start, uint32_t size) {
 	size_t tagLen;
-	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size, &tagLen, false);
+	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size, &tagLen);
 	if (tag && strcmp(tag, "MemInit") != 0) {
 		return truncate_cat(buf, sz, prefix, prefixLen, tag, tagLen);
 	}
 	// Fall back to alloc and texture, especially for VRAM.  We prefer write above.
-	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size, &tagLen, false);
+	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size, &tagLen);
 	if (tag) {
 		return truncate_cat(buf, sz, prefix, prefixLen, tag, tagLen);
 	}
@@ -727,12 +1039,7 @@ static void FlushMemInfoThread() {
 
 void MemBlockInfoInit() {
 	std::lock_guard<std::mutex> guard(pendingReadMutex);
-	std::lock_guard<std::mutex> guardW(pendingWriteMutex);
-	pendingNotifies.reserve(MAX_PENDING_NOTIFIES);
-	pendingNotifyMinAddr1 = 0xFFFFFFFF;
-	pendingNotifyMaxAddr1 = 0;
-	pendingNotifyMinAddr2 = 0xFFFFFFFF;
-	pendingNotifyMaxAddr2 = 0;
+	flushBatch.reserve(PendingNotifyRing::SIZE);
 
 	flushThreadRunning = true;
 	flushThreadPending = false;
@@ -742,12 +1049,15 @@ void MemBlockInfoInit() {
 void MemBlockInfoShutdown() {
 	{
 		std::lock_guard<std::mutex> guard(pendingReadMutex);
-		std::lock_guard<std::mutex> guardW(pendingWriteMutex);
+		std::lock_guard<std::mutex> guardR(pendingRingsMutex);
 		allocMap.Reset();
 		suballocMap.Reset();
 		writeMap.Reset();
 		textureMap.Reset();
-		pendingNotifies.clear();
+		for (PendingNotifyRing *ring : pendingRings)
+			ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+		// Nothing references tags anymore.
+		tagTable.Reset();
 	}
 
 	if (flushThreadRunning.load()) {
@@ -64,6 +64,9 @@ void SymbolMap::Clear() {
 	activeModuleEnds.clear();
 	modules.clear();
 	activeNeedUpdate_ = false;
+	activeShadowed_ = false;
+	activeLabelNames_.clear();
+	activeLabelNamesNeedUpdate_ = true;
 }
 
 bool SymbolMap::LoadSymbolMap(const Path &filename) {
@@ -80,6 +83,9 @@ bool SymbolMap::LoadSymbolMap(const Path &filename) {
 	if (f == Z_NULL)
 		return false;
 
+	// Everything is copied to the active tables in one go at the end, rather than one by one.
+	activeNeedUpdate_ = true;
+
 	//char temp[256];
 	//fgets(temp,255,f); //.text section layout
 	//fgets(temp,255,f); //  Starting        Virtual
@@ -780,12 +786,18 @@ void SymbolMap::AddModule(const char *name, u32 address, u32 size, u32 crc) {
 				continue;
 
 			// Just reactivate that one.
+			const bool wasActive = IsModuleActive(module.index);
 			module.start = address;
 			module.size = size;
 			if (crc != 0)
 				module.crc = crc;
-			activeModuleEnds.emplace(module.start + module.size, module);
-			activeNeedUpdate_ = true;
+			const bool added = activeModuleEnds.emplace(module.start + module.size, module).second;
+			if (wasActive) {
+				// Its symbols may be active at the old address too, let the rebuild sort it out.
+				activeNeedUpdate_ = true;
+			} else if (added) {
+				ActivateModuleSymbols(module.index, module.start);
+			}
 			return;
 		}
 	}
@@ -798,13 +810,20 @@ void SymbolMap::AddModule(const char *name, u32 address, u32 size, u32 crc) {
 	mod.index = (int)modules.size() + 1;
 
 	modules.push_back(mod);
-	activeModuleEnds.emplace(mod.start + mod.size, mod);
-	activeNeedUpdate_ = true;
+	if (activeModuleEnds.emplace(mod.start + mod.size, mod).second)
+		ActivateModuleSymbols(mod.index, mod.start);
 }
 
 void SymbolMap::UnloadModule(u32 address, u32 size) {
-	activeModuleEnds.erase(address + size);
-	activeNeedUpdate_ = true;
+	auto iter = activeModuleEnds.find(address + size);
+	if (iter == activeModuleEnds.end())
+		return;
+	const ModuleEntry module = iter->second;
+	activeModuleEnds.erase(iter);
+	if (IsModuleActive(module.index))
+		activeNeedUpdate_ = true;
+	else
+		DeactivateModuleSymbols(module.index, module.start);
 }
 
 u32 SymbolMap::GetModuleRelativeAddr(u32 address, int moduleIndex) const {
@@ -933,8 +952,7 @@ void SymbolMap::AddFunction(const char* name, u32 address, u32 size, int moduleI
 		// Refresh the active item if it exists.
 		auto active = activeFunctions.find(address);
 		if (active != activeFunctions.end() && active->second.module == moduleIndex) {
-			activeFunctions.erase(active);
-			activeFunctions.emplace(address, existing->second);
+			activeFunctions.replace(active, existing->second);
 		}
 	} else {
 		FunctionEntry func;
@@ -944,8 +962,9 @@ void SymbolMap::AddFunction(const char* name, u32 address, u32 size, int moduleI
 		func.module = moduleIndex;
 		functions[symbolKey] = func;
 
-		if (IsModuleActive(moduleIndex)) {
-			activeFunctions.emplace(address, func);
+		if (!activeNeedUpdate_ && IsModuleActive(moduleIndex)) {
+			if (!activeFunctions.emplace(address, func).second)
+				activeShadowed_ = true;
 		}
 	}
 
@@ -1068,6 +1087,8 @@ void SymbolMap::UpdateActiveSymbols() {
 	activeFunctions.clear();
 	activeLabels.clear();
 	activeData.clear();
+	activeShadowed_ = false;
+	activeLabelNamesNeedUpdate_ = true;
 
 	// On startup and shutdown, we can skip the rest.  Tiny optimization.
 	// Note: deliberately not skipping when only activeModuleEnds is empty. Symbols with module
@@ -1084,37 +1105,110 @@ void SymbolMap::UpdateActiveSymbols() {
 		activeModuleIndexes[it->second.index] = it->second.start;
 	}
 
+	std::vector<std::pair<u32, FunctionEntry>> activeFunctionList;
+	activeFunctionList.reserve(functions.size());
 	for (auto it = functions.begin(), end = functions.end(); it != end; ++it) {
 		const auto mod = activeModuleIndexes.find(it->second.module);
 		if (it->second.module == 0) {
-			activeFunctions.emplace(it->second.start, it->second);
+			activeFunctionList.emplace_back(it->second.start, it->second);
 		} else if (mod != activeModuleIndexes.end()) {
-			activeFunctions.emplace(mod->second + it->second.start, it->second);
+			activeFunctionList.emplace_back(mod->second + it->second.start, it->second);
 		}
 	}
+	if (activeFunctions.Merge(activeFunctionList))
+		activeShadowed_ = true;
 
 	for (auto it = labels.begin(), end = labels.end(); it != end; ++it) {
 		const auto mod = activeModuleIndexes.find(it->second.module);
+		bool added = true;
 		if (it->second.module == 0) {
-			activeLabels.emplace(it->second.addr, it->second);
+			added = activeLabels.emplace(it->second.addr, it->second).second;
 		} else if (mod != activeModuleIndexes.end()) {
-			activeLabels.emplace(mod->second + it->second.addr, it->second);
+			added = activeLabels.emplace(mod->second + it->second.addr, it->second).second;
 		}
+		if (!added)
+			activeShadowed_ = true;
 	}
 
+	std::vector<std::pair<u32, DataEntry>> activeDataList;
+	activeDataList.reserve(data.size());
 	for (auto it = data.begin(), end = data.end(); it != end; ++it) {
 		const auto mod = activeModuleIndexes.find(it->second.module);
 		if (it->second.module == 0) {
-			activeData.emplace(it->second.start, it->second);
+			activeDataList.emplace_back(it->second.start, it->second);
 		} else if (mod != activeModuleIndexes.end()) {
-			activeData.emplace(mod->second + it->second.start, it->second);
+			activeDataList.emplace_back(mod->second + it->second.start, it->second);
 		}
 	}
+	if (activeData.Merge(activeDataList))
+		activeShadowed_ = true;
 
 	AssignFunctionIndices();
 	activeNeedUpdate_ = false;
 }
 
+// Copies the symbols of a module that just became active to the active tables, the same way
+// UpdateActiveSymbols() would have.
+void SymbolMap::ActivateModuleSymbols(int moduleIndex, u32 start) {
+	if (activeNeedUpdate_)
+		return;
+
+	const SymbolKey first(moduleIndex, 0);
+	const SymbolKey last(moduleIndex, 0xFFFFFFFF);
+
+	std::vector<std::pair<u32, FunctionEntry>> moduleFunctions;
+	for (auto it = functions.lower_bound(first), end = functions.upper_bound(last); it != end; ++it)
+		moduleFunctions.emplace_back(start + it->second.start, it->second);
+	if (activeFunctions.Merge(moduleFunctions))
+		activeShadowed_ = true;
+
+	for (auto it = labels.lower_bound(first), end = labels.upper_bound(last); it != end; ++it) {
+		auto active = activeLabels.emplace(start + it->second.addr, it->second);
+		if (!active.second) {
+			activeShadowed_ = true;
+			if (active.first->second.module > moduleIndex) {
+				activeLabels.erase(active.first);
+				activeLabels.emplace(start + it->second.addr, it->second);
+			}
+		}
+		activeLabelNamesNeedUpdate_ = true;
+	}
+
+	std::vector<std::pair<u32, DataEntry>> moduleData;
+	for (auto it = data.lower_bound(first), end = data.upper_bound(last); it != end; ++it)
+		moduleData.emplace_back(start + it->second.start, it->second);
+	if (activeData.Merge(moduleData))
+		activeShadowed_ = true;
+
+	AssignFunctionIndices();
+}
+
+// Drops the symbols of a module that was just unloaded from the active tables.
+void SymbolMap::DeactivateModuleSymbols(int moduleIndex, u32 start) {
+	if (activeNeedUpdate_)
+		return;
+	if (activeShadowed_) {
+		// Some of its symbols may be hiding another module's, which would have to come back.
+		activeNeedUpdate_ = true;
+		return;
+	}
+
+	activeFunctions.RemoveModule(moduleIndex);
+	activeData.RemoveModule(moduleIndex);
+
+	const SymbolKey first(moduleIndex, 0);
+	const SymbolKey last(moduleIndex, 0xFFFFFFFF);
+	for (auto it = labels.lower_bound(first), end = labels.upper_bound(last); it != end; ++it) {
+		auto active = activeLabels.find(start + it->second.addr);
+		if (active != activeLabels.end() && active->second.module == moduleIndex) {
+			activeLabels.erase(active);
+			activeLabelNamesNeedUpdate_ = true;
+		}
+	}
+
+	AssignFunctionIndices();
+}
+
 bool SymbolMap::SetFunctionSize(u32 startAddress, u32 newSize) {
 	if (activeNeedUpdate_)
 		UpdateActiveSymbols();
@@ -1126,8 +1220,7 @@ bool SymbolMap::SetFunctionSize(u32 startAddress, u32 newSize) {
 		auto func = functions.find(symbolKey);
 		if (func != functions.end()) {
 			func->second.size = newSize;
-			activeFunctions.erase(funcInfo);
-			activeFunctions.emplace(startAddress, func->second);
+			activeFunctions.replace(funcInfo, func->second);
 		}
 	}
 
@@ -1160,6 +1253,7 @@ bool SymbolMap::RemoveFunction(u32 startAddress, bool removeName) {
 				labels.erase(labelIt2);
 			}
 			activeLabels.erase(labelIt);
+			activeLabelNamesNeedUpdate_ = true;
 		}
 	}
 
@@ -1200,6 +1294,7 @@ void SymbolMap::AddLabel(const char* name, u32 address, int moduleIndex, bool up
 			if (active != activeLabels.end() && active->second.module == moduleIndex) {
 				activeLabels.erase(active);
 				activeLabels.emplace(address, label);
+				activeLabelNamesNeedUpdate_ = true;
 			}
 		} else if (nameChanged) {
 			// Module/address didn't change, but the name did - activeLabels still needs a
@@ -1209,6 +1304,7 @@ void SymbolMap::AddLabel(const char* name, u32 address, int moduleIndex, bool up
 			if (active != activeLabels.end()) {
 				activeLabels.erase(active);
 				activeLabels.emplace(address, existing->second);
+				activeLabelNamesNeedUpdate_ = true;
 			}
 		}
 	} else {
@@ -1218,8 +1314,10 @@ void SymbolMap::AddLabel(const char* name, u32 address, int moduleIndex, bool up
 		truncate_cpy(label.name, name);
 
 		labels[symbolKey] = label;
-		if (IsModuleActive(moduleIndex)) {
-			activeLabels.emplace(address, label);
+		if (!activeNeedUpdate_ && IsModuleActive(moduleIndex)) {
+			if (!activeLabels.emplace(address, label).second)
+				activeShadowed_ = true;
+			activeLabelNamesNeedUpdate_ = true;
 		}
 	}
 }
@@ -1243,6 +1341,7 @@ void SymbolMap::SetLabelName(const char* name, u32 address) {
 			if (active != activeLabels.end() && active->second.module == label->second.module) {
 				activeLabels.erase(active);
 				activeLabels.emplace(address, label->second);
+				activeLabelNamesNeedUpdate_ = true;
 			}
 		}
 	}
@@ -1274,18 +1373,31 @@ std::string SymbolMap::GetLabelString(u32 address) {
 	return label;
 }
 
+static std::string LabelNameKey(const char *name) {
+	std::string key = name;
+	for (char &c : key)
+		c = tolower((unsigned char)c);
+	return key;
+}
+
 bool SymbolMap::GetLabelValue(const char* name, u32& dest) {
 	if (activeNeedUpdate_)
 		UpdateActiveSymbols();
 
-	for (const auto &[key, label] : activeLabels) {
-		if (equalsNoCase(name, label.name)) {
-			dest = key;
-			return true;
-		}
+	if (activeLabelNamesNeedUpdate_) {
+		activeLabelNames_.clear();
+		activeLabelNames_.reserve(activeLabels.size());
+		// In address order, so the lowest address keeps a name that's used more than once.
+		for (const auto &[key, label] : activeLabels)
+			activeLabelNames_.emplace(LabelNameKey(label.name), key);
+		activeLabelNamesNeedUpdate_ = false;
 	}
 
-	return false;
+	auto it = activeLabelNames_.find(LabelNameKey(name));
+	if (it == activeLabelNames_.end())
+		return false;
+	dest = it->second;
+	return true;
 }
 
 void SymbolMap::AddData(u32 address, u32 size, DataType type, int moduleIndex) {
@@ -1316,8 +1428,7 @@ void SymbolMap::AddData(u32 address, u32 size, DataType type, int moduleIndex) {
 		// Refresh the active item if it exists.
 		auto active = activeData.find(address);
 		if (active != activeData.end() && active->second.module == moduleIndex) {
-			activeData.erase(active);
-			activeData.emplace(address, existing->second);
+			activeData.replace(active, existing->second);
 		}
 	} else {
 		DataEntry entry;
@@ -1327,8 +1438,9 @@ void SymbolMap::AddData(u32 address, u32 size, DataType type, int moduleIndex) {
 		entry.module = moduleIndex;
 
 		data[symbolKey] = entry;
-		if (IsModuleActive(moduleIndex)) {
-			activeData.emplace(address, entry);
+		if (!activeNeedUpdate_ && IsModuleActive(moduleIndex)) {
+			if (!activeData.emplace(address, entry).second)
+				activeShadowed_ = true;
 		}
 	}
 }
@@ -1418,6 +1530,7 @@ bool SymbolMap::RemoveData(u32 startAddress, bool removeName) {
 				labels.erase(labelIt2);
 			}
 			activeLabels.erase(labelIt);
+			activeLabelNamesNeedUpdate_ = true;
 		}
 	}
 
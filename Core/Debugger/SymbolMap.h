@@ -17,9 +17,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <vector>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 #include "Common/CommonTypes.h"
 #include "Common/File/Path.h"
@@ -79,10 +82,12 @@ typedef struct HWND__ *HWND;
 //  - The "active" tables (activeFunctions/activeLabels/activeData) are a derived, read-only
 //    cache: just the master entries belonging to currently-loaded modules, flattened to plain
 //    absolute addresses. Nearly every query (GetFunctionStart, GetSymbolType, ...) reads only
-//    from these, so lookups are a single cheap map access with no per-call module resolution,
+//    from these, so lookups are a single binary search with no per-call module resolution,
 //    and a stale/unloaded module's symbols can never shadow whatever's actually live right now.
-// The active tables are rebuilt lazily by UpdateActiveSymbols() - AddModule/UnloadModule just
-// set activeNeedUpdate_, and the rebuild happens on the next query.
+//    If two active modules have a symbol at the same address, the lower module index wins.
+// AddModule/UnloadModule add or remove just that module's symbols from the active tables. A full
+// rebuild by UpdateActiveSymbols() only happens lazily, on the next query after something sets
+// activeNeedUpdate_ (loading a symbol file, or a module change that can't be done in place.)
 //
 // Module index 0 is reserved to mean "unknown module" and is always treated as active - it
 // exists for backward compatibility with old flat (non-per-module) symbol files, and for
@@ -195,6 +200,8 @@ class SymbolMap {
 
 private:
 	void AssignFunctionIndices();
+	void ActivateModuleSymbols(int moduleIndex, u32 start);
+	void DeactivateModuleSymbols(int moduleIndex, u32 start);
 	const char *GetLabelName(u32 address);
 	const char *GetLabelNameRel(u32 relAddress, int moduleIndex) const;
 
@@ -228,11 +235,87 @@ class SymbolMap {
 		u32 crc = 0;
 	};
 
+	// A sorted array of entries by absolute address, with the parts of the std::map interface the
+	// active tables use. Lookups by containing address are most of what the debugger does, and a
+	// binary search over an array is a lot kinder to the cache than walking tree nodes.
+	template <typename T>
+	class AddressTable {
+	public:
+		typedef std::pair<u32, T> value_type;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+		typedef typename std::vector<value_type>::const_reverse_iterator const_reverse_iterator;
+
+		const_iterator begin() const { return entries_.begin(); }
+		const_iterator end() const { return entries_.end(); }
+		const_reverse_iterator rbegin() const { return entries_.rbegin(); }
+		const_reverse_iterator rend() const { return entries_.rend(); }
+		size_t size() const { return entries_.size(); }
+		bool empty() const { return entries_.empty(); }
+		void clear() { entries_.clear(); }
+
+		const_iterator lower_bound(u32 key) const {
+			return std::lower_bound(entries_.begin(), entries_.end(), key, [](const value_type &e, u32 k) { return e.first < k; });
+		}
+		const_iterator upper_bound(u32 key) const {
+			return std::upper_bound(entries_.begin(), entries_.end(), key, [](u32 k, const value_type &e) { return k < e.first; });
+		}
+		const_iterator find(u32 key) const {
+			auto it = lower_bound(key);
+			return it != entries_.end() && it->first == key ? it : entries_.end();
+		}
+
+		// Like std::map, doesn't replace an existing entry.
+		std::pair<const_iterator, bool> emplace(u32 key, const T &value) {
+			auto it = lower_bound(key);
+			if (it != entries_.end() && it->first == key)
+				return std::make_pair(it, false);
+			return std::make_pair(const_iterator(entries_.emplace(it, key, value)), true);
+		}
+		void replace(const_iterator it, const T &value) {
+			entries_[it - entries_.begin()].second = value;
+		}
+		const_iterator erase(const_iterator it) {
+			return entries_.erase(it);
+		}
+
+		// Adds entries in one pass. Returns true if any address was already taken, in which case
+		// the entry with the lower module index is kept. The added entries don't need to be in order,
+		// they usually come in (module, relative address) order, which isn't address order.
+		bool Merge(std::vector<value_type> &added) {
+			auto less = [](const value_type &a, const value_type &b) {
+				return a.first < b.first || (a.first == b.first && a.second.module < b.second.module);
+			};
+			std::sort(added.begin(), added.end(), less);
+			std::vector<value_type> merged;
+			merged.reserve(entries_.size() + added.size());
+			std::merge(entries_.begin(), entries_.end(), added.begin(), added.end(), std::back_inserter(merged), less);
+			auto last = std::unique(merged.begin(), merged.end(), [](const value_type &a, const value_type &b) { return a.first == b.first; });
+			bool collided = last != merged.end();
+			merged.erase(last, merged.end());
+			entries_.swap(merged);
+			return collided;
+		}
+		void RemoveModule(int module) {
+			entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [module](const value_type &e) { return e.second.module == module; }), entries_.end());
+		}
+
+	private:
+		std::vector<value_type> entries_;
+	};
+
 	// These are flattened, read-only copies of the actual data in active modules only.
-	std::map<u32, const FunctionEntry> activeFunctions;
+	AddressTable<FunctionEntry> activeFunctions;
 	std::map<u32, const LabelEntry> activeLabels;
-	std::map<u32, const DataEntry> activeData;
+	AddressTable<DataEntry> activeData;
 	bool activeNeedUpdate_ = false;
+	// Set when two active modules had symbols at the same address. Taking one of them away then
+	// needs a full rebuild, to bring back what it was hiding.
+	bool activeShadowed_ = false;
+
+	// Lowercase label name to the lowest active address with that name, for GetLabelValue().
+	// Rebuilt on the next lookup after activeLabels changes.
+	std::unordered_map<std::string, u32> activeLabelNames_;
+	bool activeLabelNamesNeedUpdate_ = true;
 
 	// This is indexed by the end address of the module.
 	std::map<u32, const ModuleEntry> activeModuleEnds;
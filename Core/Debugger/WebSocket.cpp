@@ -57,6 +57,7 @@
 #include "Core/Debugger/WebSocket/BreakpointSubscriber.h"
 #include "Core/Debugger/WebSocket/CPUCoreSubscriber.h"
 #include "Core/Debugger/WebSocket/DisasmSubscriber.h"
+#include "Core/Debugger/WebSocket/FrameTraceSubscriber.h"
 #include "Core/Debugger/WebSocket/GameSubscriber.h"
 #include "Core/Debugger/WebSocket/GPUBufferSubscriber.h"
 #include "Core/Debugger/WebSocket/GPUDisasmSubscriber.h"
@@ -77,6 +78,7 @@ static const std::vector<SubscriberInit> subscribers({
 	&WebSocketBreakpointInit,
 	&WebSocketCPUCoreInit,
 	&WebSocketDisasmInit,
+	&WebSocketFrameTraceInit,
 	&WebSocketGameInit,
 	&WebSocketGPUBufferInit,
 	&WebSocketGPUDisasmInit,
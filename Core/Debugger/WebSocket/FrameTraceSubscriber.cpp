@@ -0,0 +1,99 @@
+// Copyright (c) 2026- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+#include <vector>
+
+#include "Common/Profiler/FrameTrace.h"
+#include "Core/Debugger/WebSocket/FrameTraceSubscriber.h"
+#include "Core/Debugger/WebSocket/WebSocketUtils.h"
+
+DebuggerSubscriber *WebSocketFrameTraceInit(DebuggerEventHandlerMap &map) {
+	map["frametrace.enable"] = &WebSocketFrameTraceEnable;
+	map["frametrace.get"] = &WebSocketFrameTraceGet;
+	map["frametrace.chrome"] = &WebSocketFrameTraceChrome;
+	return nullptr;
+}
+
+// Enable or disable the per-frame trace (frametrace.enable)
+//
+// Parameters:
+//  - enable: optional boolean, pass false to stop tracing.  Enabling clears the history.
+//
+// Response (same event name):
+//  - enabled: boolean, whether tracing is now on.
+void WebSocketFrameTraceEnable(DebuggerRequest &req) {
+	bool enable = true;
+	if (!req.ParamBool("enable", &enable, DebuggerParamType::OPTIONAL))
+		return;
+
+	FrameTrace::SetEnabled(enable);
+
+	JsonWriter &json = req.Respond();
+	json.writeBool("enabled", FrameTrace::IsEnabled());
+}
+
+// Get per-stage times for recent frames (frametrace.get)
+//
+// Parameters:
+//  - count: optional number of frames, defaults to 60.
+//
+// Response (same event name):
+//  - enabled: boolean, whether tracing is on.
+//  - frames: array of objects, most recent first, each with properties:
+//     - frame: number, the emu frame.
+//     - stages: object with a property per stage, each an object with:
+//        - ms: number, total milliseconds spent in the stage for this frame.
+//        - count: number of times the stage ran in this frame.
+//
+// Note: the most recent frames are usually still in flight on the render thread or display,
+// so their later stages may be missing.
+void WebSocketFrameTraceGet(DebuggerRequest &req) {
+	uint32_t count = 60;
+	if (!req.ParamU32("count", &count, false, DebuggerParamType::OPTIONAL))
+		return;
+
+	std::vector<FrameTraceFrame> frames;
+	FrameTrace::GetFrames(&frames, count);
+
+	JsonWriter &json = req.Respond();
+	json.writeBool("enabled", FrameTrace::IsEnabled());
+	json.pushArray("frames");
+	for (const FrameTraceFrame &f : frames) {
+		json.pushDict();
+		json.writeUint("frame", (uint32_t)f.frame);
+		json.pushDict("stages");
+		for (int i = 0; i < (int)FrameTraceStage::COUNT; i++) {
+			json.pushDict(FrameTraceStageName((FrameTraceStage)i));
+			json.writeFloat("ms", f.time[i] * 1000.0);
+			json.writeInt("count", f.count[i]);
+			json.pop();
+		}
+		json.pop();
+		json.pop();
+	}
+	json.pop();
+}
+
+// Get the recorded trace in Chrome trace event format (frametrace.chrome)
+//
+// No parameters.
+//
+// Response (same event name):
+//  - trace: string, JSON for chrome://tracing or Perfetto.
+void WebSocketFrameTraceChrome(DebuggerRequest &req) {
+	JsonWriter &json = req.Respond();
+	json.writeString("trace", FrameTrace::ToChromeJSON());
+}
@@ -22,6 +22,7 @@
 #include "Common/Data/Encoding/Utf8.h"
 #include "Common/StringUtils.h"
 #include "Core/Core.h"
+#include "Core/Debugger/MemAccessStats.h"
 #include "Core/Debugger/WebSocket/MemorySubscriber.h"
 #include "Core/Debugger/WebSocket/WebSocketUtils.h"
 #include "Core/HLE/ReplaceTables.h"
@@ -42,6 +43,7 @@ DebuggerSubscriber *WebSocketMemoryInit(DebuggerEventHandlerMap &map) {
 	map["memory.write_u32"] = &WebSocketMemoryWriteU32;
 	map["memory.write"] = &WebSocketMemoryWrite;
 	map["memory.search"] = &WebSocketMemorySearch;
+	map["memory.accessStats"] = &WebSocketMemoryAccessStats;
 
 	return nullptr;
 }
@@ -612,3 +614,67 @@ void WebSocketMemorySearch(DebuggerRequest &req) {
 		json.writeBool("truncated", truncated);
 	});
 }
+
+// Count and list slow-path memory accesses and fastmem faults by PC (memory.accessStats)
+//
+// Counting is off until enabled here (or with --mem-access-stats.)  Slow-path accesses are those
+// that go through the checked Memory functions - HLE, and JITs without fastmem.
+//
+// Parameters:
+//  - enable: optional boolean, start or stop counting.
+//  - clear: optional boolean, reset counts before responding.
+//  - count: optional unsigned integer, how many locations to list (default 100.)
+//
+// Response (same event name):
+//  - active: boolean, whether counting is on.
+//  - locations: array of objects, most accesses first, each with:
+//     - pc: unsigned integer address of the instruction (approximate for faults.)
+//     - region: string, 'RAM', 'VRAM', 'Scratchpad', or 'Invalid'.
+//     - name: string, function or symbol at pc.
+//     - slowReads: unsigned integer count.
+//     - slowWrites: unsigned integer count.
+//     - faults: unsigned integer count.
+void WebSocketMemoryAccessStats(DebuggerRequest &req) {
+	if (!currentDebugMIPS->isAlive() || !Memory::IsActive())
+		return req.Fail("CPU not started");
+
+	if (req.HasParam("enable")) {
+		bool enable = false;
+		if (!req.ParamBool("enable", &enable))
+			return;
+		if (enable)
+			MemAccessStats::Start();
+		else
+			MemAccessStats::Stop();
+	}
+
+	bool clear = false;
+	if (!req.ParamBool("clear", &clear, DebuggerParamType::OPTIONAL))
+		return;
+	if (clear)
+		MemAccessStats::Clear();
+
+	uint32_t count = 100;
+	if (!req.ParamU32("count", &count, false, DebuggerParamType::OPTIONAL))
+		return;
+
+	// Names come from the symbol map, which is owned by the CPU thread.
+	Core_RunOnCPUThread([&] {
+		std::vector<MemAccessStats::HotSpot> spots = MemAccessStats::GetHotSpots(count);
+
+		JsonWriter &json = req.Respond();
+		json.writeBool("active", MemAccessStats::g_active);
+		json.pushArray("locations");
+		for (const auto &spot : spots) {
+			json.pushDict();
+			json.writeUint("pc", spot.pc);
+			json.writeString("region", MemAccessStats::RegionName(spot.region));
+			json.writeString("name", spot.name);
+			json.writeFloat("slowReads", (double)spot.counts[(int)MemAccessStats::Kind::SLOW_READ]);
+			json.writeFloat("slowWrites", (double)spot.counts[(int)MemAccessStats::Kind::SLOW_WRITE]);
+			json.writeFloat("faults", (double)spot.counts[(int)MemAccessStats::Kind::FAULT]);
+			json.pop();
+		}
+		json.pop();
+	});
+}
@@ -31,3 +31,4 @@ void WebSocketMemoryWriteU16(DebuggerRequest &req);
 void WebSocketMemoryWriteU32(DebuggerRequest &req);
 void WebSocketMemoryWrite(DebuggerRequest &req);
 void WebSocketMemorySearch(DebuggerRequest &req);
+void WebSocketMemoryAccessStats(DebuggerRequest &req);
@@ -0,0 +1,466 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "Core/FileLoaders/BlockCache.h"
+
+static std::mutex g_traceDirLock;
+static Path g_traceDir;
+
+RamBlockTier::RamBlockTier(size_t maxBlocks) {
+	maxBlocksPerShard_ = std::max((size_t)1, maxBlocks / SHARD_COUNT);
+}
+
+RamBlockTier::~RamBlockTier() {
+	Clear();
+}
+
+bool RamBlockTier::Read(s64 block, size_t offset, size_t bytes, u8 *dest) {
+	Shard &shard = ShardFor(block);
+	std::lock_guard<std::mutex> guard(shard.lock);
+	auto it = shard.blocks.find(block);
+	if (it == shard.blocks.end()) {
+		return false;
+	}
+	it->second.lastUse = ++generation_;
+	memcpy(dest, it->second.ptr + offset, bytes);
+	return true;
+}
+
+bool RamBlockTier::Write(s64 block, const u8 *src, bool readingAhead) {
+	Shard &shard = ShardFor(block);
+	std::lock_guard<std::mutex> guard(shard.lock);
+	if (shard.blocks.find(block) != shard.blocks.end()) {
+		// Someone else got there first, keep the existing one.
+		return true;
+	}
+
+	if (shard.blocks.size() >= maxBlocksPerShard_) {
+		if (readingAhead) {
+			return false;
+		}
+
+		// Evict the least recently used block in this shard only.
+		auto oldest = shard.blocks.begin();
+		for (auto it = shard.blocks.begin(); it != shard.blocks.end(); ++it) {
+			if (it->second.lastUse < oldest->second.lastUse) {
+				oldest = it;
+			}
+		}
+		delete[] oldest->second.ptr;
+		shard.blocks.erase(oldest);
+		--size_;
+	}
+
+	u8 *buf = new u8[BLOCK_CACHE_BLOCK_SIZE];
+	memcpy(buf, src, BLOCK_CACHE_BLOCK_SIZE);
+	// Readahead blocks count as older than anything actually read, so they go first.
+	shard.blocks[block] = Entry{ buf, readingAhead ? 0 : ++generation_ };
+	++size_;
+	return true;
+}
+
+bool RamBlockTier::Contains(s64 block) {
+	Shard &shard = ShardFor(block);
+	std::lock_guard<std::mutex> guard(shard.lock);
+	return shard.blocks.find(block) != shard.blocks.end();
+}
+
+bool RamBlockTier::HasSpaceFor(size_t blocks) {
+	return size_ + blocks <= maxBlocksPerShard_ * SHARD_COUNT;
+}
+
+void RamBlockTier::Clear() {
+	for (Shard &shard : shards_) {
+		std::lock_guard<std::mutex> guard(shard.lock);
+		for (auto &it : shard.blocks) {
+			delete[] it.second.ptr;
+		}
+		shard.blocks.clear();
+	}
+	size_ = 0;
+}
+
+FullFileBlockTier::FullFileBlockTier(s64 filesize) {
+	blockCount_ = (size_t)((filesize + BLOCK_CACHE_BLOCK_SIZE - 1) >> BLOCK_CACHE_BLOCK_SHIFT);
+	// Overallocate for the last block.
+	data_ = (u8 *)malloc(blockCount_ << BLOCK_CACHE_BLOCK_SHIFT);
+	if (!data_) {
+		ERROR_LOG(Log::IO, "Failed to allocate cache for Cache full ISO in RAM! Will fall back to regular reads.");
+		blockCount_ = 0;
+	}
+	state_.reset(new std::atomic<u8>[blockCount_]);
+	for (size_t i = 0; i < blockCount_; ++i) {
+		state_[i].store(STATE_EMPTY, std::memory_order_relaxed);
+	}
+	remaining_ = blockCount_;
+}
+
+FullFileBlockTier::~FullFileBlockTier() {
+	free(data_);
+}
+
+bool FullFileBlockTier::Read(s64 block, size_t offset, size_t bytes, u8 *dest) {
+	if (block < 0 || (size_t)block >= blockCount_ || state_[block].load(std::memory_order_acquire) != STATE_READY) {
+		return false;
+	}
+	memcpy(dest, data_ + ((size_t)block << BLOCK_CACHE_BLOCK_SHIFT) + offset, bytes);
+	return true;
+}
+
+bool FullFileBlockTier::Write(s64 block, const u8 *src, bool readingAhead) {
+	if (block < 0 || (size_t)block >= blockCount_) {
+		return false;
+	}
+	u8 expected = STATE_EMPTY;
+	if (!state_[block].compare_exchange_strong(expected, STATE_WRITING, std::memory_order_acquire)) {
+		// Another thread is caching it. Only report success once it's readable, or the caller's
+		// next Read would miss and come up short.
+		while (expected == STATE_WRITING) {
+			std::this_thread::yield();
+			expected = state_[block].load(std::memory_order_acquire);
+		}
+		return expected == STATE_READY;
+	}
+	memcpy(data_ + ((size_t)block << BLOCK_CACHE_BLOCK_SHIFT), src, BLOCK_CACHE_BLOCK_SIZE);
+	state_[block].store(STATE_READY, std::memory_order_release);
+	--remaining_;
+	return true;
+}
+
+bool FullFileBlockTier::Contains(s64 block) {
+	return block >= 0 && (size_t)block < blockCount_ && state_[block].load(std::memory_order_acquire) == STATE_READY;
+}
+
+void FullFileBlockTier::Clear() {
+	for (size_t i = 0; i < blockCount_; ++i) {
+		state_[i].store(STATE_EMPTY, std::memory_order_relaxed);
+	}
+	remaining_ = blockCount_;
+}
+
+s64 FullFileBlockTier::NextMissingBlock(s64 start) const {
+	for (size_t i = (size_t)std::max(start, (s64)0); i < blockCount_; ++i) {
+		if (state_[i].load(std::memory_order_relaxed) == STATE_EMPTY) {
+			return (s64)i;
+		}
+	}
+	return -1;
+}
+
+class BlockCacheReadAheadTask : public Task {
+public:
+	BlockCacheReadAheadTask(BlockCache *cache) : cache_(cache) {}
+
+	TaskType Type() const override {
+		return TaskType::IO_BLOCKING;
+	}
+	TaskPriority Priority() const override {
+		return TaskPriority::LOW;
+	}
+	void Run() override {
+		cache_->RunReadAhead();
+	}
+	bool Cancellable() const override {
+		return true;
+	}
+	void Cancel() override {
+		std::lock_guard<std::mutex> guard(cache_->aheadLock_);
+		cache_->aheadPending_ = false;
+		cache_->aheadCond_.notify_all();
+	}
+
+private:
+	BlockCache *cache_;
+};
+
+BlockCache::BlockCache(FileLoader *backend, s64 filesize, BlockCacheTier *tier, ReadAheadMode mode)
+	: backend_(backend), filesize_(filesize), tier_(tier), mode_(mode) {
+	std::lock_guard<std::mutex> guard(g_traceDirLock);
+	tracing_ = !g_traceDir.empty();
+}
+
+BlockCache::~BlockCache() {
+	Shutdown();
+}
+
+void BlockCache::SetTraceDirectory(const Path &dir) {
+	std::lock_guard<std::mutex> guard(g_traceDirLock);
+	g_traceDir = dir;
+}
+
+size_t BlockCache::ReadAt(s64 absolutePos, size_t bytes, void *data, FileLoader::Flags flags) {
+	if (absolutePos >= filesize_) {
+		return 0;
+	} else if (absolutePos + (s64)bytes > filesize_) {
+		bytes = (size_t)(filesize_ - absolutePos);
+	}
+	if (bytes == 0) {
+		return 0;
+	}
+
+	if ((flags & FileLoader::Flags::HINT_UNCACHED) != 0) {
+		return backend_->ReadAt(absolutePos, bytes, data, flags);
+	}
+
+	u8 *p = (u8 *)data;
+	size_t readSize = ReadFromCache(absolutePos, bytes, p);
+	// While in case the cache size is too small for the entire read.
+	while (readSize < bytes) {
+		if (!FillBlocks(absolutePos + readSize, bytes - readSize, flags, false)) {
+			// The tier couldn't take the blocks (e.g. the disk cache file is full or failing), so read the rest directly.
+			readSize += backend_->ReadAt(absolutePos + readSize, bytes - readSize, p + readSize, flags);
+			break;
+		}
+		size_t bytesFromCache = ReadFromCache(absolutePos + readSize, bytes - readSize, p + readSize);
+		readSize += bytesFromCache;
+		if (bytesFromCache == 0) {
+			// We can't read any more.
+			break;
+		}
+	}
+
+	StartReadAhead(absolutePos + readSize);
+	return readSize;
+}
+
+size_t BlockCache::ReadFromCache(s64 pos, size_t bytes, u8 *data) {
+	s64 startBlock = pos >> BLOCK_CACHE_BLOCK_SHIFT;
+	s64 endBlock = (pos + bytes - 1) >> BLOCK_CACHE_BLOCK_SHIFT;
+	size_t offset = (size_t)(pos - (startBlock << BLOCK_CACHE_BLOCK_SHIFT));
+	size_t readSize = 0;
+
+	for (s64 i = startBlock; i <= endBlock; ++i) {
+		size_t toRead = std::min(bytes - readSize, (size_t)BLOCK_CACHE_BLOCK_SIZE - offset);
+		if (!tier_->Read(i, offset, toRead, data + readSize)) {
+			misses_++;
+			if (tracing_)
+				Trace(TraceKind::MISS, i, 1);
+			return readSize;
+		}
+		hits_++;
+		if (tracing_)
+			Trace(TraceKind::HIT, i, 1);
+		readSize += toRead;
+
+		// Don't need an offset after the first read.
+		offset = 0;
+	}
+	return readSize;
+}
+
+bool BlockCache::FillBlocks(s64 pos, size_t bytes, FileLoader::Flags flags, bool readingAhead) {
+	s64 startBlock = pos >> BLOCK_CACHE_BLOCK_SHIFT;
+	s64 endBlock = (pos + bytes - 1) >> BLOCK_CACHE_BLOCK_SHIFT;
+
+	size_t blocksToRead = 0;
+	for (s64 i = startBlock; i <= endBlock && blocksToRead < MAX_BLOCKS_PER_READ; ++i) {
+		if (tier_->Contains(i)) {
+			break;
+		}
+		++blocksToRead;
+	}
+	if (blocksToRead == 0) {
+		// Filled in by someone else meanwhile.
+		return true;
+	}
+	if (readingAhead && !tier_->HasSpaceFor(blocksToRead)) {
+		return false;
+	}
+
+	s64 filePos = startBlock << BLOCK_CACHE_BLOCK_SHIFT;
+	std::unique_ptr<u8[]> buf(new u8[blocksToRead << BLOCK_CACHE_BLOCK_SHIFT]);
+	size_t readBytes = backend_->ReadAt(filePos, blocksToRead << BLOCK_CACHE_BLOCK_SHIFT, buf.get(), flags);
+	backendReads_++;
+
+	// Only cache blocks we actually fully read - a short/failed read (e.g. a dropped
+	// connection on a Remote ISO) must not be cached as if valid. The exception is the
+	// last block of the file, which is naturally short; zero the unused tail of it.
+	size_t blocksRead = readBytes >> BLOCK_CACHE_BLOCK_SHIFT;
+	if ((readBytes & (BLOCK_CACHE_BLOCK_SIZE - 1)) != 0 && filePos + (s64)readBytes == filesize_) {
+		memset(buf.get() + readBytes, 0, (blocksRead + 1) * BLOCK_CACHE_BLOCK_SIZE - readBytes);
+		++blocksRead;
+	}
+
+	size_t stored = 0;
+	for (size_t i = 0; i < blocksRead; ++i) {
+		if (!tier_->Write(startBlock + (s64)i, buf.get() + (i << BLOCK_CACHE_BLOCK_SHIFT), readingAhead)) {
+			break;
+		}
+		++stored;
+	}
+
+	if (readingAhead) {
+		readAheadBlocks_ += stored;
+		if (tracing_ && stored != 0)
+			Trace(TraceKind::READAHEAD, startBlock, (u32)stored);
+	}
+	return stored != 0;
+}
+
+void BlockCache::StartReadAhead(s64 pos) {
+	if (mode_ == ReadAheadMode::WINDOW && !tier_->HasSpaceFor(BLOCK_READAHEAD)) {
+		// Not enough space to readahead.
+		return;
+	}
+	if (tier_->IsComplete()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(aheadLock_);
+	aheadPos_ = pos;
+	if (aheadPending_ || shutdown_) {
+		// Already going.
+		return;
+	}
+	aheadCancel_ = false;
+	QueueReadAheadTask();
+}
+
+void BlockCache::QueueReadAheadTask() {
+	// Must hold aheadLock_.
+	if (!g_threadManager.IsInitialized()) {
+		return;
+	}
+	aheadPending_ = true;
+	g_threadManager.EnqueueTask(new BlockCacheReadAheadTask(this));
+}
+
+void BlockCache::RunReadAhead() {
+	s64 pos;
+	{
+		std::lock_guard<std::mutex> guard(aheadLock_);
+		pos = aheadPos_;
+		// Next time, start from the beginning again unless a read moves it.
+		aheadPos_ = 0;
+	}
+
+	if (mode_ == ReadAheadMode::WINDOW) {
+		s64 startBlock = pos >> BLOCK_CACHE_BLOCK_SHIFT;
+		for (s64 i = startBlock; i < startBlock + BLOCK_READAHEAD; ++i) {
+			if ((i << BLOCK_CACHE_BLOCK_SHIFT) >= filesize_) {
+				break;
+			}
+			if (!tier_->Contains(i)) {
+				if (aheadCancel_) {
+					break;
+				}
+				s64 endPos = std::min((startBlock + BLOCK_READAHEAD) << BLOCK_CACHE_BLOCK_SHIFT, filesize_);
+				FillBlocks(i << BLOCK_CACHE_BLOCK_SHIFT, (size_t)(endPos - (i << BLOCK_CACHE_BLOCK_SHIFT)), FileLoader::Flags::NONE, true);
+				break;
+			}
+		}
+	} else {
+		FullFileBlockTier *tier = static_cast<FullFileBlockTier *>(tier_.get());
+		s64 next = pos >> BLOCK_CACHE_BLOCK_SHIFT;
+		for (int n = 0; n < READAHEAD_READS_PER_TASK; ++n) {
+			next = tier->NextMissingBlock(next);
+			if (next < 0) {
+				// Wrap around to anything skipped before the last read position.
+				next = tier->NextMissingBlock(0);
+			}
+			if (next < 0 || aheadCancel_) {
+				break;
+			}
+			s64 endPos = std::min((next + MAX_BLOCKS_PER_READ) << BLOCK_CACHE_BLOCK_SHIFT, filesize_);
+			if (!FillBlocks(next << BLOCK_CACHE_BLOCK_SHIFT, (size_t)(endPos - (next << BLOCK_CACHE_BLOCK_SHIFT)), FileLoader::Flags::NONE, true)) {
+				break;
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(aheadLock_);
+	// For the whole file, keep going in short tasks so we don't hog a pool thread.
+	if (mode_ == ReadAheadMode::WHOLE_FILE && !aheadCancel_ && !shutdown_ && !tier_->IsComplete()) {
+		g_threadManager.EnqueueTask(new BlockCacheReadAheadTask(this));
+		return;
+	}
+	aheadPending_ = false;
+	aheadCond_.notify_all();
+}
+
+void BlockCache::Cancel() {
+	std::lock_guard<std::mutex> guard(aheadLock_);
+	aheadCancel_ = true;
+}
+
+void BlockCache::Shutdown() {
+	{
+		std::unique_lock<std::mutex> guard(aheadLock_);
+		if (shutdown_) {
+			return;
+		}
+		shutdown_ = true;
+		aheadCancel_ = true;
+		// We can't delete while the task is running, so have to wait.
+		// This should only happen from the menu.
+		aheadCond_.wait(guard, [this] { return !aheadPending_; });
+	}
+
+	if (tracing_) {
+		WriteTrace();
+	}
+	DEBUG_LOG(Log::Loader, "Block cache for %s: %llu hits, %llu misses, %llu backend reads, %llu blocks read ahead",
+		backend_->GetPath().ToVisualString().c_str(), (unsigned long long)hits_, (unsigned long long)misses_,
+		(unsigned long long)backendReads_, (unsigned long long)readAheadBlocks_);
+	tier_->Clear();
+}
+
+BlockCache::Stats BlockCache::GetStats() const {
+	return Stats{ hits_, misses_, backendReads_, readAheadBlocks_ };
+}
+
+void BlockCache::Trace(TraceKind kind, s64 block, u32 count) {
+	std::lock_guard<std::mutex> guard(traceLock_);
+	trace_.push_back(TraceEvent{ time_now_d(), block, count, kind });
+}
+
+void BlockCache::WriteTrace() {
+	Path dir;
+	{
+		std::lock_guard<std::mutex> guard(g_traceDirLock);
+		dir = g_traceDir;
+	}
+	if (dir.empty()) {
+		return;
+	}
+
+	Path filename = dir / (backend_->GetPath().GetFilename() + ".blocktrace.csv");
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f) {
+		WARN_LOG(Log::Loader, "Unable to write block cache trace to %s", filename.c_str());
+		return;
+	}
+
+	static const char *const kindNames[] = { "hit", "miss", "readahead" };
+	std::lock_guard<std::mutex> guard(traceLock_);
+	fprintf(f, "time,kind,block,count\n");
+	for (const TraceEvent &ev : trace_) {
+		fprintf(f, "%f,%s,%lld,%u\n", ev.time, kindNames[(int)ev.kind], (long long)ev.block, ev.count);
+	}
+	fclose(f);
+	INFO_LOG(Log::Loader, "Wrote %d block cache trace events to %s", (int)trace_.size(), filename.c_str());
+	trace_.clear();
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+#include "Core/Loaders.h"
+
+// Shared block cache used by the caching file loaders.
+//
+// The cache itself only knows about fixed-size blocks of the underlying file. Where the
+// blocks are kept is decided by a tier (RAM with LRU eviction, the whole file in RAM, or the
+// persistent cache file of DiskCachingFileLoader),
+// and readahead is scheduled as short tasks on g_threadManager instead of a thread per loader.
+
+enum {
+	BLOCK_CACHE_BLOCK_SIZE = 65536,
+	BLOCK_CACHE_BLOCK_SHIFT = 16,
+};
+
+class BlockCacheTier {
+public:
+	virtual ~BlockCacheTier() {}
+
+	// Copies part of a cached block into dest. Returns false if the block isn't cached.
+	virtual bool Read(s64 block, size_t offset, size_t bytes, u8 *dest) = 0;
+	// Stores a full block. When readingAhead is set, the tier should refuse rather than evict.
+	virtual bool Write(s64 block, const u8 *src, bool readingAhead) = 0;
+	virtual bool Contains(s64 block) = 0;
+	// Whether there's room for this many more blocks without evicting anything.
+	virtual bool HasSpaceFor(size_t blocks) = 0;
+	// Returns true when no more blocks can usefully be added (e.g. the entire file is cached.)
+	virtual bool IsComplete() { return false; }
+	virtual void Clear() = 0;
+};
+
+// Bounded RAM cache, split into shards with their own locks so readahead and reads
+// on different blocks don't contend. Least recently used blocks within a shard are evicted.
+class RamBlockTier : public BlockCacheTier {
+public:
+	explicit RamBlockTier(size_t maxBlocks);
+	~RamBlockTier();
+
+	bool Read(s64 block, size_t offset, size_t bytes, u8 *dest) override;
+	bool Write(s64 block, const u8 *src, bool readingAhead) override;
+	bool Contains(s64 block) override;
+	bool HasSpaceFor(size_t blocks) override;
+	void Clear() override;
+
+private:
+	enum {
+		SHARD_COUNT = 16,
+	};
+
+	struct Entry {
+		u8 *ptr;
+		u64 lastUse;
+	};
+
+	struct Shard {
+		std::mutex lock;
+		std::unordered_map<s64, Entry> blocks;
+	};
+
+	Shard &ShardFor(s64 block) {
+		return shards_[(size_t)block & (SHARD_COUNT - 1)];
+	}
+
+	Shard shards_[SHARD_COUNT];
+	size_t maxBlocksPerShard_;
+	std::atomic<u64> generation_{};
+	std::atomic<size_t> size_{};
+};
+
+// Keeps the entire file in RAM. Blocks are published with a per-block atomic state, so
+// reads of cached blocks never take a lock.
+class FullFileBlockTier : public BlockCacheTier {
+public:
+	explicit FullFileBlockTier(s64 filesize);
+	~FullFileBlockTier();
+
+	bool IsValid() const {
+		return data_ != nullptr;
+	}
+
+	bool Read(s64 block, size_t offset, size_t bytes, u8 *dest) override;
+	bool Write(s64 block, const u8 *src, bool readingAhead) override;
+	bool Contains(s64 block) override;
+	bool HasSpaceFor(size_t blocks) override {
+		return true;
+	}
+	bool IsComplete() override {
+		return remaining_ == 0;
+	}
+	void Clear() override;
+
+	// Returns the first block at or after start that hasn't been cached, or -1.
+	s64 NextMissingBlock(s64 start) const;
+
+private:
+	enum : u8 {
+		STATE_EMPTY = 0,
+		STATE_WRITING = 1,
+		STATE_READY = 2,
+	};
+
+	u8 *data_ = nullptr;
+	std::unique_ptr<std::atomic<u8>[]> state_;
+	size_t blockCount_ = 0;
+	std::atomic<size_t> remaining_{};
+};
+
+class BlockCache {
+public:
+	enum class ReadAheadMode {
+		// Read a few blocks after each read.
+		WINDOW,
+		// Keep reading in the background until the tier is complete.
+		WHOLE_FILE,
+	};
+
+	// Does not take ownership of the backend, but does take ownership of the tier.
+	BlockCache(FileLoader *backend, s64 filesize, BlockCacheTier *tier, ReadAheadMode mode);
+	~BlockCache();
+
+	size_t ReadAt(s64 absolutePos, size_t bytes, void *data, FileLoader::Flags flags);
+
+	// Stops any in-progress readahead. A later read will start it again.
+	void Cancel();
+	// Waits for readahead to finish. No reads may happen after this.
+	void Shutdown();
+
+	struct Stats {
+		u64 hits;
+		u64 misses;
+		u64 backendReads;
+		u64 readAheadBlocks;
+	};
+	Stats GetStats() const;
+
+	// When set, every cache access is recorded and written as a CSV into this directory on
+	// shutdown, which is useful for tuning block and readahead sizes.
+	static void SetTraceDirectory(const Path &dir);
+
+private:
+	enum {
+		MAX_BLOCKS_PER_READ = 16,
+		BLOCK_READAHEAD = 4,
+		// For WHOLE_FILE, how many backend reads a single task does before yielding the thread.
+		READAHEAD_READS_PER_TASK = 8,
+	};
+
+	enum class TraceKind : u8 {
+		HIT,
+		MISS,
+		READAHEAD,
+	};
+
+	struct TraceEvent {
+		double time;
+		s64 block;
+		u32 count;
+		TraceKind kind;
+	};
+
+	size_t ReadFromCache(s64 pos, size_t bytes, u8 *data);
+	// Returns false if nothing could be stored (error, or no room when reading ahead.)
+	bool FillBlocks(s64 pos, size_t bytes, FileLoader::Flags flags, bool readingAhead);
+	void StartReadAhead(s64 pos);
+	void QueueReadAheadTask();
+	void RunReadAhead();
+	void Trace(TraceKind kind, s64 block, u32 count);
+	void WriteTrace();
+
+	FileLoader *backend_;
+	s64 filesize_;
+	std::unique_ptr<BlockCacheTier> tier_;
+	ReadAheadMode mode_;
+
+	std::mutex aheadLock_;
+	std::condition_variable aheadCond_;
+	s64 aheadPos_ = 0;
+	bool aheadPending_ = false;
+	std::atomic<bool> aheadCancel_{};
+	bool shutdown_ = false;
+
+	std::atomic<u64> hits_{};
+	std::atomic<u64> misses_{};
+	std::atomic<u64> backendReads_{};
+	std::atomic<u64> readAheadBlocks_{};
+
+	bool tracing_ = false;
+	std::mutex traceLock_;
+	std::vector<TraceEvent> trace_;
+
+	friend class BlockCacheReadAheadTask;
+};
@@ -17,13 +17,14 @@
 
 #pragma once
 
-#include <map>
+#include <memory>
 #include <mutex>
-#include <thread>
 
 #include "Common/CommonTypes.h"
 #include "Core/Loaders.h"
 
+class BlockCache;
+
 class CachingFileLoader : public ProxiedFileLoader {
 public:
 	CachingFileLoader(FileLoader *backend);
@@ -41,37 +42,15 @@ class CachingFileLoader : public ProxiedFileLoader {
 
 private:
 	void Prepare();
-	void InitCache();
-	void ShutdownCache();
-	size_t ReadFromCache(s64 pos, size_t bytes, void *data);
-	// Guaranteed to read at least one block into the cache.
-	void SaveIntoCache(s64 pos, size_t bytes, Flags flags, bool readingAhead = false);
-	bool MakeCacheSpaceFor(size_t blocks, bool readingAhead);
-	void StartReadAhead(s64 pos);
 
 	enum {
-		BLOCK_SIZE = 65536,
-		BLOCK_SHIFT = 16,
-		MAX_BLOCKS_PER_READ = 16,
 		MAX_BLOCKS_CACHED = 4096, // 256 MB
-		BLOCK_READAHEAD = 4,
 	};
 
 	s64 filesize_ = 0;
 	int exists_ = -1;
 	int isDirectory_ = -1;
-	u64 generation_ = 0;
-	u64 oldestGeneration_ = 0;
-	size_t cacheSize_ = 0;
-
-	struct BlockInfo {
-		u8 *ptr;
-		u64 generation;
-	};
 
-	std::map<s64, BlockInfo> blocks_;
-	std::recursive_mutex blocksMutex_;
-	bool aheadThreadRunning_ = false;
-	std::thread aheadThread_;
+	std::unique_ptr<BlockCache> cache_;
 	std::once_flag preparedFlag_;
 };
@@ -30,6 +30,7 @@
 #include "Common/File/Path.h"
 #include "Common/Log.h"
 #include "Common/CommonWindows.h"
+#include "Core/FileLoaders/BlockCache.h"
 #include "Core/FileLoaders/DiskCachingFileLoader.h"
 #include "Core/System.h"
 
@@ -44,6 +45,30 @@ static const u32 CACHE_SPACE_FLEX = 4;
 
 Path DiskCachingFileLoaderCache::cacheDir_;
 
+// Storage tier for BlockCache backed by the cache file. The cache file is shared by all loaders of the
+// same path and outlives them, so this doesn't own it, and clearing the tier keeps the data for next time.
+class DiskBlockTier : public BlockCacheTier {
+public:
+	explicit DiskBlockTier(DiskCachingFileLoaderCache *cache) : cache_(cache) {}
+
+	bool Read(s64 block, size_t offset, size_t bytes, u8 *dest) override {
+		return cache_->ReadFromCache((block << BLOCK_CACHE_BLOCK_SHIFT) + offset, bytes, dest) == bytes;
+	}
+	bool Write(s64 block, const u8 *src, bool readingAhead) override {
+		return cache_->WriteBlock(block, src, !readingAhead);
+	}
+	bool Contains(s64 block) override {
+		return cache_->ContainsBlock(block);
+	}
+	bool HasSpaceFor(size_t blocks) override {
+		return cache_->HasSpaceFor(blocks);
+	}
+	void Clear() override {}
+
+private:
+	DiskCachingFileLoaderCache *cache_;
+};
+
 std::map<Path, DiskCachingFileLoaderCache *> DiskCachingFileLoader::caches_;
 std::mutex DiskCachingFileLoader::cachesMutex_;
 
@@ -85,36 +110,17 @@ s64 DiskCachingFileLoader::FileSize() {
 
 size_t DiskCachingFileLoader::ReadAt(s64 absolutePos, size_t bytes, void *data, Flags flags) {
 	Prepare();
-	size_t readSize;
-
 	if (absolutePos >= filesize_) {
 		bytes = 0;
 	} else if (absolutePos + (s64)bytes >= filesize_) {
 		bytes = (size_t)(filesize_ - absolutePos);
 	}
 
-	if (cache_ && cache_->IsValid() && (flags & Flags::HINT_UNCACHED) == 0) {
-		readSize = cache_->ReadFromCache(absolutePos, bytes, data);
-		// While in case the cache size is too small for the entire read.
-		while (readSize < bytes) {
-			readSize += cache_->SaveIntoCache(backend_, absolutePos + readSize, bytes - readSize, (u8 *)data + readSize, flags);
-			// We're done, nothing more to read.
-			if (readSize == bytes) {
-				break;
-			}
-			// If there are already-cached blocks afterward, we have to read them.
-			size_t bytesFromCache = cache_->ReadFromCache(absolutePos + readSize, bytes - readSize, (u8 *)data + readSize);
-			readSize += bytesFromCache;
-			if (bytesFromCache == 0) {
-				// We can't read any more.
-				break;
-			}
-		}
-	} else {
-		readSize = backend_->ReadAt(absolutePos, bytes, data, flags);
+	if (blockCache_) {
+		// Whatever the cache file can't take (full or failing to write) is read directly from the backend.
+		return blockCache_->ReadAt(absolutePos, bytes, data, flags);
 	}
-
-	return readSize;
+	return backend_->ReadAt(absolutePos, bytes, data, flags);
 }
 
 std::vector<Path> DiskCachingFileLoader::GetCachedPathsInUse() {
@@ -142,9 +148,15 @@ void DiskCachingFileLoader::InitCache() {
 
 	cache_ = entry;
 	cache_->AddRef();
+	if (cache_->IsValid()) {
+		blockCache_.reset(new BlockCache(backend_, filesize_, new DiskBlockTier(cache_), BlockCache::ReadAheadMode::WINDOW));
+	}
 }
 
 void DiskCachingFileLoader::ShutdownCache() {
+	// Readahead may still be writing into the cache file.
+	blockCache_.reset();
+
 	std::lock_guard<std::mutex> guard(cachesMutex_);
 
 	if (cache_->Release()) {
@@ -254,93 +266,45 @@ size_t DiskCachingFileLoaderCache::ReadFromCache(s64 pos, size_t bytes, void *da
 	return readSize;
 }
 
-size_t DiskCachingFileLoaderCache::SaveIntoCache(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags) {
+bool DiskCachingFileLoaderCache::WriteBlock(s64 block, const u8 *src, bool evict) {
+	static_assert((int)DEFAULT_BLOCK_SIZE == (int)BLOCK_CACHE_BLOCK_SIZE, "Cache file blocks must match BlockCache blocks");
 	std::lock_guard<std::mutex> guard(lock_);
 
-	if (!f_) {
-		// Just to keep things working.
-		return backend->ReadAt(pos, bytes, data, flags);
+	if (!f_ || block < 0 || (size_t)block >= indexCount_) {
+		return false;
 	}
-
-	size_t cacheStartPos = (size_t)(pos / blockSize_);
-	size_t cacheEndPos = (size_t)((pos + bytes - 1) / blockSize_);
-	size_t readSize = 0;
-	size_t offset = (size_t)(pos - (cacheStartPos * (u64)blockSize_));
-	u8 *p = (u8 *)data;
-
-	size_t blocksToRead = 0;
-	for (size_t i = cacheStartPos; i <= cacheEndPos; ++i) {
-		auto &info = index_[i];
-		if (info.block != INVALID_BLOCK) {
-			break;
-		}
-		++blocksToRead;
-		if (blocksToRead >= MAX_BLOCKS_PER_READ) {
-			break;
-		}
+	auto &info = index_[(size_t)block];
+	if (info.block != INVALID_BLOCK) {
+		// Written by another loader of the same file meanwhile.
+		return true;
 	}
-
-	if (!MakeCacheSpaceFor(blocksToRead) || blocksToRead == 0) {
-		return 0;
+	if (cacheSize_ + 1 > maxBlocks_ && (!evict || !MakeCacheSpaceFor(1))) {
+		return false;
 	}
 
-	if (blocksToRead == 1) {
-		auto &info = index_[cacheStartPos];
-
-		u8 *buf = new u8[blockSize_];
-		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blockSize_, buf, flags);
-
-		// A short/failed read (e.g. a dropped Remote ISO connection) must not be
-		// cached or returned as if it were valid data - only a full block counts.
-		if (readBytes == (size_t)blockSize_) {
-			// Check if it was written while we were busy.  Might happen if we thread.
-			if (info.block == INVALID_BLOCK) {
-				info.block = AllocateBlock((u32)cacheStartPos);
-				WriteBlockData(info, buf);
-				WriteIndexData((u32)cacheStartPos, info);
-			}
-
-			size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-			memcpy(p + readSize, buf + offset, toRead);
-			readSize += toRead;
-		}
-
-		delete [] buf;
-	} else {
-		u8 *wholeRead = new u8[blocksToRead * blockSize_];
-		size_t readBytes = backend->ReadAt(cacheStartPos * (u64)blockSize_, blocksToRead * blockSize_, wholeRead, flags);
-		// Only the whole blocks the backend actually delivered are valid; stop at
-		// the first short/missing one instead of caching (and returning) whatever
-		// was left over in the rest of `wholeRead` from a partial or failed read.
-		size_t wholeBlocksRead = readBytes / (size_t)blockSize_;
-
-		for (size_t i = 0; i < wholeBlocksRead; ++i) {
-			auto &info = index_[cacheStartPos + i];
-			// Check if it was written while we were busy.  Might happen if we thread.
-			if (info.block == INVALID_BLOCK) {
-				info.block = AllocateBlock((u32)cacheStartPos + (u32)i);
-				WriteBlockData(info, wholeRead + (i * blockSize_));
-				// TODO: Doing each index together would probably be better.
-				WriteIndexData((u32)cacheStartPos + (u32)i, info);
-			}
-
-			size_t toRead = std::min(bytes - readSize, (size_t)blockSize_ - offset);
-			memcpy(p + readSize, wholeRead + (i * blockSize_) + offset, toRead);
-			readSize += toRead;
-			// The initial `offset` only applies to the first block of this batch.
-			offset = 0;
-		}
-		delete[] wholeRead;
+	info.block = AllocateBlock((u32)block);
+	if (info.block == INVALID_BLOCK) {
+		return false;
 	}
-
-	cacheSize_ += blocksToRead;
+	WriteBlockData(info, src);
+	WriteIndexData((u32)block, info);
+	++cacheSize_;
 	++generation_;
 
 	if (generation_ == std::numeric_limits<u16>::max()) {
 		RebalanceGenerations();
 	}
+	return true;
+}
 
-	return readSize;
+bool DiskCachingFileLoaderCache::ContainsBlock(s64 block) {
+	std::lock_guard<std::mutex> guard(lock_);
+	return f_ && block >= 0 && (size_t)block < indexCount_ && index_[(size_t)block].block != INVALID_BLOCK;
+}
+
+bool DiskCachingFileLoaderCache::HasSpaceFor(size_t blocks) {
+	std::lock_guard<std::mutex> guard(lock_);
+	return f_ && cacheSize_ + blocks <= maxBlocks_;
 }
 
 bool DiskCachingFileLoaderCache::MakeCacheSpaceFor(size_t blocks) {
@@ -539,6 +503,9 @@ bool DiskCachingFileLoaderCache::LoadCacheFile(const Path &path) {
 	} else if (header.maxBlocks < MAX_BLOCKS_LOWER_BOUND || header.maxBlocks > MAX_BLOCKS_UPPER_BOUND) {
 		// This means it's not in our safety bounds, reject.
 		valid = false;
+	} else if (header.blockSize != DEFAULT_BLOCK_SIZE) {
+		// Reads go through BlockCache, which uses its own fixed block size.
+		valid = false;
 	}
 
 	// If it's valid, retain the file pointer.
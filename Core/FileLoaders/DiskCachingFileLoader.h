@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <mutex>
 
 #include "Common/CommonTypes.h"
@@ -26,6 +27,7 @@
 #include "Common/Swap.h"
 #include "Core/Loaders.h"
 
+class BlockCache;
 class DiskCachingFileLoaderCache;
 
 class DiskCachingFileLoader : public ProxiedFileLoader {
@@ -52,6 +54,8 @@ class DiskCachingFileLoader : public ProxiedFileLoader {
 	std::once_flag preparedFlag_;
 	s64 filesize_ = 0;
 	DiskCachingFileLoaderCache *cache_ = nullptr;
+	// Reads through cache_ as its storage tier.
+	std::unique_ptr<BlockCache> blockCache_;
 
 	// We don't support concurrent disk cache access (we use memory cached indexes.)
 	// So we have to ensure there's only one of these per.
@@ -81,8 +85,10 @@ class DiskCachingFileLoaderCache {
 	}
 
 	size_t ReadFromCache(s64 pos, size_t bytes, void *data);
-	// Guaranteed to read at least one block into the cache.
-	size_t SaveIntoCache(FileLoader *backend, s64 pos, size_t bytes, void *data, FileLoader::Flags flags);
+	// Stores a full block. If the cache is full, evicts old blocks when evict is set, otherwise fails.
+	bool WriteBlock(s64 block, const u8 *src, bool evict);
+	bool ContainsBlock(s64 block);
+	bool HasSpaceFor(size_t blocks);
 
 	bool HasData() const;
 
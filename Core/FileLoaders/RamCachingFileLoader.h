@@ -17,13 +17,13 @@
 
 #pragma once
 
-#include <vector>
-#include <mutex>
-#include <thread>
+#include <memory>
 
 #include "Common/CommonTypes.h"
 #include "Core/Loaders.h"
 
+class BlockCache;
+
 class RamCachingFileLoader : public ProxiedFileLoader {
 public:
 	RamCachingFileLoader(FileLoader *backend);
@@ -42,31 +42,10 @@ class RamCachingFileLoader : public ProxiedFileLoader {
 	void Cancel() override;
 
 private:
-	void InitCache();
-	void ShutdownCache();
-	size_t ReadFromCache(s64 pos, size_t bytes, void *data);
-	// Guaranteed to read at least one block into the cache.
-	void SaveIntoCache(s64 pos, size_t bytes, Flags flags);
-	void StartReadAhead(s64 pos);
-	u32 NextAheadBlock();
-
-	enum {
-		BLOCK_SIZE = 65536,
-		BLOCK_SHIFT = 16,
-		MAX_BLOCKS_PER_READ = 16,
-		BLOCK_READAHEAD = 4,
-	};
-
 	s64 filesize_ = 0;
-	u8 *cache_ = nullptr;
 	int exists_ = -1;
 	int isDirectory_ = -1;
 
-	std::vector<u8> blocks_;
-	std::mutex blocksMutex_;
-	u32 aheadRemaining_ = 0;
-	s64 aheadPos_ = 0;
-	std::thread aheadThread_;
-	bool aheadThreadRunning_ = false;
-	bool aheadCancel_ = false;
+	// Null if the file couldn't fit in RAM, in which case reads go straight to the backend.
+	std::unique_ptr<BlockCache> cache_;
 };
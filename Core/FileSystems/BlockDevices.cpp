@@ -367,24 +367,27 @@ UDFFileBlockDevice::UDFFileBlockDevice(FileLoader *fileLoader)
 
 UDFFileBlockDevice::~UDFFileBlockDevice() = default;
 
+// Returns how many of count blocks from block are contiguous in the image (0 if out of range.)
+u32 UDFFileBlockDevice::MapBlocks(u32 block, u32 count, u32 *sourceBlock) const {
+	if (block < layer0_.numBlocks) {
+		*sourceBlock = layer0_.startBlock + block;
+		return std::min(count, layer0_.numBlocks - block);
+	}
+	u32 layer1Block = block - layer0_.numBlocks;
+	if (layer1Block < layer1_.numBlocks) {
+		*sourceBlock = layer1_.startBlock + layer1Block;
+		return std::min(count, layer1_.numBlocks - layer1Block);
+	}
+	return 0;
+}
+
 bool UDFFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
-	if ((u32)blockNumber >= numBlocks_) {
+	u32 sourceBlock = 0;
+	if (MapBlocks((u32)blockNumber, 1, &sourceBlock) == 0) {
 		memset(outPtr, 0, GetBlockSize());
 		return false;
 	}
 
-	u32 sourceBlock = 0;
-	if ((u32)blockNumber < layer0_.numBlocks) {
-		sourceBlock = layer0_.startBlock + blockNumber;
-	} else {
-		u32 layer1Block = (u32)blockNumber - layer0_.numBlocks;
-		if (layer1Block >= layer1_.numBlocks) {
-			memset(outPtr, 0, GetBlockSize());
-			return false;
-		}
-		sourceBlock = layer1_.startBlock + layer1Block;
-	}
-
 	FileLoader::Flags flags = uncached ? FileLoader::Flags::HINT_UNCACHED : FileLoader::Flags::NONE;
 	size_t retval = fileLoader_->ReadAt((u64)sourceBlock * (u64)GetBlockSize(), 1, GetBlockSize(), outPtr, flags);
 	if (retval != GetBlockSize()) {
@@ -395,11 +398,23 @@ bool UDFFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
 }
 
 bool UDFFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
-	for (int i = 0; i < count; ++i) {
-		if (!ReadBlock(minBlock + i, outPtr)) {
+	// Each layer is contiguous, so this is usually a single read.
+	while (count > 0) {
+		u32 sourceBlock = 0;
+		u32 runBlocks = MapBlocks(minBlock, (u32)count, &sourceBlock);
+		if (runBlocks == 0) {
+			memset(outPtr, 0, (size_t)count * GetBlockSize());
 			return false;
 		}
-		outPtr += GetBlockSize();
+
+		size_t retval = fileLoader_->ReadAt((u64)sourceBlock * (u64)GetBlockSize(), GetBlockSize(), runBlocks, outPtr);
+		if (retval != runBlocks) {
+			DEBUG_LOG(Log::FileSystem, "Could not read %u UDF-wrapped blocks at %u from source block %u", runBlocks, minBlock, sourceBlock);
+			return false;
+		}
+		minBlock += runBlocks;
+		count -= (int)runBlocks;
+		outPtr += (size_t)runBlocks * GetBlockSize();
 	}
 	return true;
 }
@@ -451,33 +466,46 @@ ISOContainerFileBlockDevice::ISOContainerFileBlockDevice(FileLoader *fileLoader)
 
 ISOContainerFileBlockDevice::~ISOContainerFileBlockDevice() = default;
 
-bool ISOContainerFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
-	if ((u32)blockNumber >= numBlocks_ || !outerBlockDevice_) {
-		memset(outPtr, 0, GetBlockSize());
-		return false;
+// Returns how many of count blocks from block are contiguous in the container (0 if out of range.)
+u32 ISOContainerFileBlockDevice::MapBlocks(u32 block, u32 count, u32 *sourceBlock) const {
+	if (block < layer0_.numBlocks) {
+		*sourceBlock = layer0_.startBlock + block;
+		return std::min(count, layer0_.numBlocks - block);
 	}
+	u32 layer1Block = block - layer0_.numBlocks;
+	if (layer1Block < layer1_.numBlocks) {
+		*sourceBlock = layer1_.startBlock + layer1Block;
+		return std::min(count, layer1_.numBlocks - layer1Block);
+	}
+	return 0;
+}
 
+bool ISOContainerFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
 	u32 sourceBlock = 0;
-	if ((u32)blockNumber < layer0_.numBlocks) {
-		sourceBlock = layer0_.startBlock + blockNumber;
-	} else {
-		u32 layer1Block = (u32)blockNumber - layer0_.numBlocks;
-		if (layer1Block >= layer1_.numBlocks) {
-			memset(outPtr, 0, GetBlockSize());
-			return false;
-		}
-		sourceBlock = layer1_.startBlock + layer1Block;
+	if (!outerBlockDevice_ || MapBlocks((u32)blockNumber, 1, &sourceBlock) == 0) {
+		memset(outPtr, 0, GetBlockSize());
+		return false;
 	}
 
 	return outerBlockDevice_->ReadBlock(sourceBlock, outPtr, uncached);
 }
 
 bool ISOContainerFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
-	for (int i = 0; i < count; ++i) {
-		if (!ReadBlock(minBlock + i, outPtr)) {
+	// Each layer is a contiguous file in the container, so this is usually a single read.
+	while (count > 0) {
+		u32 sourceBlock = 0;
+		u32 runBlocks = outerBlockDevice_ ? MapBlocks(minBlock, (u32)count, &sourceBlock) : 0;
+		if (runBlocks == 0) {
+			memset(outPtr, 0, (size_t)count * GetBlockSize());
 			return false;
 		}
-		outPtr += GetBlockSize();
+
+		if (!outerBlockDevice_->ReadBlocks(sourceBlock, (int)runBlocks, outPtr)) {
+			return false;
+		}
+		minBlock += runBlocks;
+		count -= (int)runBlocks;
+		outPtr += (size_t)runBlocks * GetBlockSize();
 	}
 	return true;
 }
@@ -1176,15 +1204,35 @@ bool CHDFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr, bool uncached) {
 }
 
 bool CHDFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr) {
+	if (!impl_->chd) {
+		ERROR_LOG(Log::Loader, "ReadBlocks: CHD not open. %s", fileLoader_->GetPath().c_str());
+		return false;
+	}
 	if (minBlock >= numBlocks) {
 		memset(outPtr, 0, GetBlockSize() * count);
 		return false;
 	}
 
-	for (int i = 0; i < count; i++) {
-		if (!ReadBlock(minBlock + i, outPtr + i * GetBlockSize())) {
+	const u32 blockSize = GetBlockSize();
+	const bool hunksAreBlocks = impl_->header->unitbytes == blockSize && impl_->header->hunkbytes == blocksPerHunk * blockSize;
+	for (int i = 0; i < count; ) {
+		const u32 block = minBlock + i;
+		const u32 hunk = block / blocksPerHunk;
+		// Whole hunks can be decompressed straight into the output, skipping readBuffer.
+		if (hunksAreBlocks && hunk != currentHunk && (block % blocksPerHunk) == 0 && (u32)(count - i) >= blocksPerHunk && block + blocksPerHunk <= numBlocks) {
+			chd_error err = chd_read(impl_->chd, hunk, outPtr + (size_t)i * blockSize);
+			if (err != CHDERR_NONE) {
+				ERROR_LOG(Log::Loader, "CHD read failed: %d %d %s", block, hunk, chd_error_string(err));
+				NotifyReadError();
+			}
+			i += blocksPerHunk;
+			continue;
+		}
+
+		if (!ReadBlock(block, outPtr + (size_t)i * blockSize)) {
 			return false;
 		}
+		i++;
 	}
 	return true;
 }
@@ -121,6 +121,8 @@ class UDFFileBlockDevice : public BlockDevice {
 		u32 numBlocks = 0;
 	};
 
+	u32 MapBlocks(u32 block, u32 count, u32 *sourceBlock) const;
+
 	Extent layer0_{};
 	Extent layer1_{};
 	u32 numBlocks_ = 0;
@@ -144,6 +146,8 @@ class ISOContainerFileBlockDevice : public BlockDevice {
 		u32 numBlocks = 0;
 	};
 
+	u32 MapBlocks(u32 block, u32 count, u32 *sourceBlock) const;
+
 	std::shared_ptr<BlockDevice> outerBlockDevice_;
 	Extent layer0_{};
 	Extent layer1_{};
@@ -131,6 +131,13 @@ Path DirectoryFileSystem::GetLocalPath(std::string_view internalPath) const {
 	return basePath / internalPath;
 }
 
+// Our own changes might land within the directory's mtime granularity, so don't wait to notice them.
+void DirectoryFileSystem::InvalidateCaseCache(const Path &localPath) {
+	if (flags & FileSystemFlags::CASE_SENSITIVE) {
+		caseCache_.Invalidate(localPath.NavigateUp().ToString());
+	}
+}
+
 bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, FileAccess access, u32 &error) {
 	error = 0;
 
@@ -142,7 +149,7 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 	if (fileSystemFlags_ & FileSystemFlags::CASE_SENSITIVE) {
 		if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 			DEBUG_LOG(Log::FileSystem, "Checking case for path %s", fileName.c_str());
-			if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
+			if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST, caseCache_)) {
 				error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 				return false;  // or go on and attempt (for a better error code than just 0?)
 			}
@@ -296,7 +303,7 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 
 	if (fileSystemFlags_ & FileSystemFlags::CASE_SENSITIVE) {
 		if (!success && !(access & FILEACCESS_CREATE)) {
-			if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
+			if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST, caseCache_)) {
 				error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 				return false;
 			}
@@ -356,6 +363,10 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 	if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 		MemoryStick_NotifyWrite();
 	}
+	if (success && (access & FILEACCESS_CREATE) && caseCache_) {
+		// Might have added a file.
+		caseCache_->Invalidate(fullName.NavigateUp().ToString());
+	}
 
 	return success;
 }
@@ -527,10 +538,15 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 		// Must fix case BEFORE attempting, because MkDir would create
 		// duplicate (different case) directories
 		std::string fixedCase = dirname;
-		if (!FixPathCase(basePath, fixedCase, FPC_PARTIAL_ALLOWED)) {
+		if (!FixPathCase(basePath, fixedCase, FPC_PARTIAL_ALLOWED, &caseCache_)) {
 			result = false;
 		} else {
-			result = File::CreateFullPath(GetLocalPath(fixedCase));
+			Path localPath = GetLocalPath(fixedCase);
+			result = File::CreateFullPath(localPath);
+			// Any of the levels may have been created.
+			for (Path dir = localPath; dir != basePath && dir.StartsWith(basePath); dir = dir.NavigateUp()) {
+				InvalidateCaseCache(dir);
+			}
 		}
 	} else {
 		result = File::CreateFullPath(GetLocalPath(dirname));
@@ -545,19 +561,22 @@ bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 	if (flags & FileSystemFlags::CASE_SENSITIVE) {
 		// Maybe we're lucky?
 		if (File::DeleteDirRecursively(fullName)) {
+			InvalidateCaseCache(fullName);
 			MemoryStick_NotifyWrite();
 			return (bool)ReplayApplyDisk(ReplayAction::RMDIR, true, CoreTiming::GetGlobalTimeUs());
 		}
 
 		// Nope, fix case and try again.  Should we try again?
 		std::string fullPath = dirname;
-		if (!FixPathCase(basePath, fullPath, FPC_FILE_MUST_EXIST))
+		if (!FixPathCase(basePath, fullPath, FPC_FILE_MUST_EXIST, &caseCache_))
 			return (bool)ReplayApplyDisk(ReplayAction::RMDIR, false, CoreTiming::GetGlobalTimeUs());
 
 		fullName = GetLocalPath(fullPath);
 	}
 
 	bool result = File::DeleteDirRecursively(fullName);
+	if (result)
+		InvalidateCaseCache(fullName);
 	MemoryStick_NotifyWrite();
 	return ReplayApplyDisk(ReplayAction::RMDIR, result, CoreTiming::GetGlobalTimeUs()) != 0;
 }
@@ -583,7 +602,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 	if (flags & FileSystemFlags::CASE_SENSITIVE) {
 		// In case TO should overwrite a file with different case.  Check error code?
-		if (!FixPathCase(basePath, fullTo, FPC_PATH_MUST_EXIST))
+		if (!FixPathCase(basePath, fullTo, FPC_PATH_MUST_EXIST, &caseCache_))
 			return ReplayApplyDisk(ReplayAction::FILE_RENAME, -1, CoreTiming::GetGlobalTimeUs());
 	}
 
@@ -595,7 +614,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 		if (!retValue) {
 			// May have failed due to case sensitivity on FROM, so try again.  Check error code?
 			std::string fullFromPath = from;
-			if (!FixPathCase(basePath, fullFromPath, FPC_FILE_MUST_EXIST))
+			if (!FixPathCase(basePath, fullFromPath, FPC_FILE_MUST_EXIST, &caseCache_))
 				return ReplayApplyDisk(ReplayAction::FILE_RENAME, -1, CoreTiming::GetGlobalTimeUs());
 			fullFrom = GetLocalPath(fullFromPath);
 
@@ -603,6 +622,11 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 		}
 	}
 
+	if (retValue) {
+		// Both are in the same directory.
+		InvalidateCaseCache(fullToPath);
+	}
+
 	// TODO: Better error codes.
 	int result = retValue ? 0 : (int)SCE_KERNEL_ERROR_ERRNO_FILE_ALREADY_EXISTS;
 	MemoryStick_NotifyWrite();
@@ -618,13 +642,15 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 		if (!retValue) {
 			// May have failed due to case sensitivity, so try again.  Try even if it fails?
 			std::string fullNamePath = filename;
-			if (!FixPathCase(basePath, fullNamePath, FPC_FILE_MUST_EXIST))
+			if (!FixPathCase(basePath, fullNamePath, FPC_FILE_MUST_EXIST, &caseCache_))
 				return (bool)ReplayApplyDisk(ReplayAction::FILE_REMOVE, false, CoreTiming::GetGlobalTimeUs());
 			localPath = GetLocalPath(fullNamePath);
 
 			retValue = File::Delete(localPath);
 		}
 	}
+	if (retValue)
+		InvalidateCaseCache(localPath);
 
 	MemoryStick_NotifyWrite();
 	return ReplayApplyDisk(ReplayAction::FILE_REMOVE, retValue, CoreTiming::GetGlobalTimeUs()) != 0;
@@ -633,6 +659,7 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename) {
 	OpenFileEntry entry;
 	entry.hFile.fileSystemFlags_ = flags;
+	entry.hFile.caseCache_ = &caseCache_;
 	u32 err = 0;
 	bool success = entry.hFile.Open(basePath, filename, (FileAccess)(access & FILEACCESS_PSP_FLAGS), err);
 	if (err == 0 && !success) {
@@ -755,7 +782,7 @@ PSPFileInfo DirectoryFileSystem::GetFileInfo(std::string filename) {
 	Path fullName = GetLocalPath(filename);
 	if (!File::GetFileInfo(fullName, &info)) {
 		if (flags & FileSystemFlags::CASE_SENSITIVE) {
-			if (!FixPathCase(basePath, filename, FPC_FILE_MUST_EXIST))
+			if (!FixPathCase(basePath, filename, FPC_FILE_MUST_EXIST, &caseCache_))
 				return ReplayApplyDiskFileInfo(x, CoreTiming::GetGlobalTimeUs());
 			fullName = GetLocalPath(filename);
 
@@ -890,7 +917,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(std::string_view pat
 		if (!success) {
 			// TODO: Case sensitivity should be checked on a file system basis, right?
 			std::string fixedPath(path);
-			if (FixPathCase(basePath, fixedPath, FPC_FILE_MUST_EXIST)) {
+			if (FixPathCase(basePath, fixedPath, FPC_FILE_MUST_EXIST, &caseCache_)) {
 				// May have failed due to case sensitivity, try again
 				localPath = GetLocalPath(fixedPath);
 				success = File::GetFilesInDir(localPath, &files, nullptr, flags);
@@ -977,7 +1004,7 @@ u64 DirectoryFileSystem::FreeDiskSpace(const std::string &path) {
 
 	if (flags & FileSystemFlags::CASE_SENSITIVE) {
 		std::string fixedCase = path;
-		if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST)) {
+		if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST, &caseCache_)) {
 			// May have failed due to case sensitivity, try again.
 			if (free_disk_space(GetLocalPath(fixedCase), result)) {
 				return ReplayApplyDisk64(ReplayAction::FREESPACE, result, CoreTiming::GetGlobalTimeUs());
@@ -1011,6 +1038,7 @@ void DirectoryFileSystem::DoState(PointerWrap &p) {
 		u32 key;
 		OpenFileEntry entry;
 		entry.hFile.fileSystemFlags_ = flags;
+		entry.hFile.caseCache_ = &caseCache_;
 		for (u32 i = 0; i < num; i++) {
 			Do(p, key);
 			Do(p, entry.guestFilename);
@@ -22,6 +22,7 @@
 #include <map>
 
 #include "Common/File/Path.h"
+#include "Common/File/PathCaseCache.h"
 #include "Core/FileSystems/FileSystem.h"
 
 #if defined(_WIN32) && !defined(HAVE_LIBRETRO_VFS)
@@ -45,6 +46,8 @@ struct DirectoryFileHandle {
 	bool replay_ = true;
 	bool inGameDir_ = false;
 	FileSystemFlags fileSystemFlags_ = (FileSystemFlags)0;
+	// Owned by the file system, if it keeps one.
+	PathCaseCache *caseCache_ = nullptr;
 
 	DirectoryFileHandle() {}
 
@@ -103,8 +106,11 @@ class DirectoryFileSystem : public IFileSystem {
 	Path basePath;
 	IHandleAllocator *hAlloc;
 	FileSystemFlags flags;
+	// Only used if CASE_SENSITIVE.
+	PathCaseCache caseCache_;
 
 	Path GetLocalPath(std::string_view internalPath) const;
+	void InvalidateCaseCache(const Path &localPath);
 };
 
 // VFSFileSystem: Ability to map in Android APK paths as well! Does not support all features, only meant for fonts.
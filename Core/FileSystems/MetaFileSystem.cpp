@@ -21,6 +21,7 @@
 #include "Common/StringUtils.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/HLE/sceKernelThread.h"
+#include "Core/MemMap.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
 
@@ -528,6 +529,9 @@ void MetaFileSystem::CloseFile(u32 handle)
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 {
+	// The OS may write straight into RAM here, which the dirty page tracking can't catch.
+	if (size > 0)
+		Memory::DirtyPages_PrepareHostWrite(pointer, (size_t)size);
 	std::lock_guard<std::recursive_mutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
 	if (sys)
@@ -548,6 +552,8 @@ size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size)
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec)
 {
+	if (size > 0)
+		Memory::DirtyPages_PrepareHostWrite(pointer, (size_t)size);
 	std::lock_guard<std::recursive_mutex> guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
 	if (sys)
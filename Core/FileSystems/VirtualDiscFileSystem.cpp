@@ -16,12 +16,17 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include "ppsspp_config.h"
+#include <algorithm>
+#include <cstring>
 #include <ctime>
 
+#include "ext/xxhash.h"
+
 #include "Common/File/FileUtil.h"
 #include "Common/File/DirListing.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
+#include "Common/StringUtils.h"
 #include "Common/SysError.h"
 #include "Core/FileSystems/VirtualDiscFileSystem.h"
 #include "Core/FileSystems/ISOFileSystem.h"
@@ -30,6 +35,7 @@
 #include "Core/Util/PathUtil.h"
 #include "Common/Data/Encoding/Utf8.h"
 #include "Core/Config.h"
+#include "Core/System.h"
 
 #if PLATFORM_SUPPORTS_FILE_HANDLER_PLUGINS
 static bool EnableFileHandlerPlugins() {
@@ -58,6 +64,36 @@ constexpr bool EnableFileHandlerPlugins() { return false; }
 
 const std::string INDEX_FILENAME = ".ppsspp-index.lst";
 
+// Statting every file listed in the index at mount is slow for big games on slow storage, so the
+// parsed index (with sizes) is cached in a binary file: header, entries, then the strings.
+struct CachedFileListIndexHeader {
+	char magic[4];
+	u32 version;
+	u64 indexSize;
+	u64 indexMTime;
+	s32 indexMTimeUs;
+	u32 handlersEnabled;
+	u32 count;
+	u32 currentBlockIndex;
+	// The base path is first in the strings.
+	u32 basePathLength;
+};
+
+struct CachedFileListIndexEntry {
+	u32 firstBlock;
+	u32 totalSize;
+	u32 nameOffset;
+	u16 nameLength;
+	// The handler name, if any, follows the file name.
+	u16 handlerLength;
+};
+
+static const char CACHED_INDEX_MAGIC[4] = { 'V', 'D', 'I', 'X' };
+static const u32 CACHED_INDEX_VERSION = 1;
+
+// Files read through the whole disc that stay open.
+static const size_t MAX_BLOCK_READ_FILES = 4;
+
 VirtualDiscFileSystem::VirtualDiscFileSystem(IHandleAllocator *_hAlloc, const Path &_basePath)
 	: basePath(_basePath), currentBlockIndex(0) {
 	hAlloc = _hAlloc;
@@ -70,6 +106,7 @@ VirtualDiscFileSystem::~VirtualDiscFileSystem() {
 			iter->second.Close();
 		}
 	}
+	CloseBlockReadFiles();
 	for (auto iter = handlers.begin(), end = handlers.end(); iter != end; ++iter) {
 		delete iter->second;
 	}
@@ -77,7 +114,14 @@ VirtualDiscFileSystem::~VirtualDiscFileSystem() {
 
 void VirtualDiscFileSystem::LoadFileListIndex() {
 	const Path filename = basePath / INDEX_FILENAME;
-	if (!File::Exists(filename)) {
+	File::FileInfo indexInfo;
+	if (!File::GetFileInfo(filename, &indexInfo) || indexInfo.isDirectory) {
+		return;
+	}
+
+	const Path cacheFilename = CachedFileListIndexPath();
+	if (!cacheFilename.empty() && LoadCachedFileListIndex(cacheFilename, indexInfo)) {
+		RebuildFileListLookups();
 		return;
 	}
 
@@ -86,6 +130,8 @@ void VirtualDiscFileSystem::LoadFileListIndex() {
 		return;
 	}
 
+	std::vector<std::string> handlerNames;
+
 	static const int MAX_LINE_SIZE = 2048;
 	char linebuf[MAX_LINE_SIZE]{};
 	while (fgets(linebuf, MAX_LINE_SIZE, f)) {
@@ -119,26 +165,14 @@ void VirtualDiscFileSystem::LoadFileListIndex() {
 		}
 
 		// Check if there's a handler specified.
+		std::string handler;
 		size_t handler_pos = line.find(':', filename_pos);
 		if (handler_pos != line.npos) {
 			entry.fileName = line.substr(filename_pos, handler_pos - filename_pos);
-#if PLATFORM_SUPPORTS_FILE_HANDLER_PLUGINS
-			if (EnableFileHandlerPlugins()) {
-				std::string handler = line.substr(handler_pos + 1);
-				size_t trunc = handler.find_last_not_of("\r\n");
-				if (trunc != handler.npos && trunc != handler.size())
-					handler.resize(trunc + 1);
-
-				if (handlers.find(handler) == handlers.end())
-					handlers[handler] = new Handler(handler.c_str(), this);
-				if (handlers[handler]->IsValid())
-					entry.handler = handlers[handler];
-			} else {
-				ERROR_LOG(Log::FileSystem, "File handler plugins are disabled, ignoring handler %s for file %s", line.substr(handler_pos + 1).c_str(), entry.fileName.c_str());
-			}
-#else
-			ERROR_LOG(Log::FileSystem, "File handler plugins are not supported on this platform, ignoring handler %s for file %s", line.substr(handler_pos + 1).c_str(), entry.fileName.c_str());
-#endif
+			handler = line.substr(handler_pos + 1);
+			size_t trunc = handler.find_last_not_of("\r\n");
+			if (trunc != handler.npos && trunc != handler.size())
+				handler.resize(trunc + 1);
 		} else {
 			entry.fileName = line.substr(filename_pos);
 		}
@@ -155,6 +189,8 @@ void VirtualDiscFileSystem::LoadFileListIndex() {
 			ERROR_LOG(Log::FileSystem, "Ignoring index entry with parent directory reference: %s", entry.fileName.c_str());
 			continue;
 		}
+		if (!handler.empty())
+			SetEntryHandler(entry, handler);
 
 		entry.firstBlock = (u32)strtol(line.c_str(), NULL, 16);
 		if (entry.handler != NULL && entry.handler->IsValid()) {
@@ -175,10 +211,227 @@ void VirtualDiscFileSystem::LoadFileListIndex() {
 			currentBlockIndex = nextBlock;
 		}
 
+		entry.sizeChecked = true;
 		fileList.push_back(entry);
+		handlerNames.push_back(handler);
 	}
 
 	fclose(f);
+	RebuildFileListLookups();
+
+	if (!cacheFilename.empty())
+		SaveCachedFileListIndex(cacheFilename, indexInfo, handlerNames);
+}
+
+void VirtualDiscFileSystem::SetEntryHandler(FileListEntry &entry, const std::string &handler) {
+#if PLATFORM_SUPPORTS_FILE_HANDLER_PLUGINS
+	if (EnableFileHandlerPlugins()) {
+		if (handlers.find(handler) == handlers.end())
+			handlers[handler] = new Handler(handler.c_str(), this);
+		if (handlers[handler]->IsValid())
+			entry.handler = handlers[handler];
+	} else {
+		ERROR_LOG(Log::FileSystem, "File handler plugins are disabled, ignoring handler %s for file %s", handler.c_str(), entry.fileName.c_str());
+	}
+#else
+	ERROR_LOG(Log::FileSystem, "File handler plugins are not supported on this platform, ignoring handler %s for file %s", handler.c_str(), entry.fileName.c_str());
+#endif
+}
+
+Path VirtualDiscFileSystem::CachedFileListIndexPath() const {
+	const Path cacheDir = GetSysDirectory(DIRECTORY_APP_CACHE);
+	if (cacheDir.empty())
+		return Path();
+	const std::string &base = basePath.ToString();
+	return cacheDir / StringFromFormat("%016llx.vdiscindex", (unsigned long long)XXH3_64bits(base.data(), base.size()));
+}
+
+bool VirtualDiscFileSystem::LoadCachedFileListIndex(const Path &cacheFilename, const File::FileInfo &indexInfo) {
+	std::string data;
+	if (!File::Exists(cacheFilename) || !File::ReadBinaryFileToString(cacheFilename, &data))
+		return false;
+
+	CachedFileListIndexHeader header;
+	if (data.size() < sizeof(header))
+		return false;
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.magic, CACHED_INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version != CACHED_INDEX_VERSION)
+		return false;
+	// Any change to the index file, or to whether handlers are used, means starting over.
+	if (header.indexSize != indexInfo.size || header.indexMTime != indexInfo.mtime || header.indexMTimeUs != indexInfo.mtimeUs)
+		return false;
+	if (header.handlersEnabled != (EnableFileHandlerPlugins() ? 1 : 0))
+		return false;
+
+	const size_t entriesSize = (size_t)header.count * sizeof(CachedFileListIndexEntry);
+	if ((data.size() - sizeof(header)) / sizeof(CachedFileListIndexEntry) < header.count)
+		return false;
+	const char *strings = data.data() + sizeof(header) + entriesSize;
+	const size_t stringsSize = data.size() - sizeof(header) - entriesSize;
+	const std::string &base = basePath.ToString();
+	if (header.basePathLength != base.size() || header.basePathLength > stringsSize || memcmp(strings, base.data(), base.size()) != 0)
+		return false;
+
+	std::vector<FileListEntry> cached;
+	cached.reserve(header.count);
+	for (u32 i = 0; i < header.count; ++i) {
+		CachedFileListIndexEntry cachedEntry;
+		memcpy(&cachedEntry, data.data() + sizeof(header) + i * sizeof(cachedEntry), sizeof(cachedEntry));
+		if ((u64)cachedEntry.nameOffset + cachedEntry.nameLength + cachedEntry.handlerLength > stringsSize)
+			return false;
+
+		FileListEntry entry = {""};
+		entry.fileName.assign(strings + cachedEntry.nameOffset, cachedEntry.nameLength);
+		entry.firstBlock = cachedEntry.firstBlock;
+		entry.totalSize = cachedEntry.totalSize;
+		if (cachedEntry.handlerLength != 0)
+			SetEntryHandler(entry, std::string(strings + cachedEntry.nameOffset + cachedEntry.nameLength, cachedEntry.handlerLength));
+		cached.push_back(entry);
+	}
+
+	fileList = std::move(cached);
+	currentBlockIndex = header.currentBlockIndex;
+	INFO_LOG(Log::FileSystem, "Loaded cached virtual disc index with %d files", (int)fileList.size());
+	return true;
+}
+
+void VirtualDiscFileSystem::SaveCachedFileListIndex(const Path &cacheFilename, const File::FileInfo &indexInfo, const std::vector<std::string> &handlerNames) {
+	std::string strings = basePath.ToString();
+	std::vector<CachedFileListIndexEntry> cachedEntries;
+	cachedEntries.reserve(fileList.size());
+	for (size_t i = 0; i < fileList.size(); ++i) {
+		const FileListEntry &entry = fileList[i];
+		const std::string &handler = handlerNames[i];
+		if (entry.fileName.size() > 0xFFFF || handler.size() > 0xFFFF)
+			return;
+
+		CachedFileListIndexEntry cachedEntry{};
+		cachedEntry.firstBlock = entry.firstBlock;
+		cachedEntry.totalSize = entry.totalSize;
+		cachedEntry.nameOffset = (u32)strings.size();
+		cachedEntry.nameLength = (u16)entry.fileName.size();
+		cachedEntry.handlerLength = (u16)handler.size();
+		strings += entry.fileName;
+		strings += handler;
+		cachedEntries.push_back(cachedEntry);
+	}
+
+	CachedFileListIndexHeader header{};
+	memcpy(header.magic, CACHED_INDEX_MAGIC, sizeof(header.magic));
+	header.version = CACHED_INDEX_VERSION;
+	header.indexSize = indexInfo.size;
+	header.indexMTime = indexInfo.mtime;
+	header.indexMTimeUs = indexInfo.mtimeUs;
+	header.handlersEnabled = EnableFileHandlerPlugins() ? 1 : 0;
+	header.count = (u32)cachedEntries.size();
+	header.currentBlockIndex = currentBlockIndex;
+	header.basePathLength = (u32)basePath.ToString().size();
+
+	std::string data;
+	data.reserve(sizeof(header) + cachedEntries.size() * sizeof(CachedFileListIndexEntry) + strings.size());
+	data.append((const char *)&header, sizeof(header));
+	if (!cachedEntries.empty())
+		data.append((const char *)&cachedEntries[0], cachedEntries.size() * sizeof(CachedFileListIndexEntry));
+	data += strings;
+
+	File::CreateFullPath(cacheFilename.NavigateUp());
+	if (!File::WriteDataToFile(false, data.data(), data.size(), cacheFilename)) {
+		WARN_LOG(Log::FileSystem, "Failed to write cached virtual disc index to %s", cacheFilename.c_str());
+	}
+}
+
+void VirtualDiscFileSystem::AddFileListEntry(const FileListEntry &entry) {
+	fileList.push_back(entry);
+	const int index = (int)fileList.size() - 1;
+	fileListNames_.emplace(entry.fileName, index);
+
+	// New files go after everything else, so this is usually just an append.
+	if (!fileListBlocks_.empty() && entry.firstBlock < fileListBlocks_.back().firstBlock) {
+		RebuildFileListLookups();
+		return;
+	}
+	u64 reach = (u64)entry.firstBlock + (entry.totalSize + 2047) / 2048;
+	if (!fileListBlocks_.empty())
+		reach = std::max(reach, fileListBlocks_.back().reach);
+	fileListBlocks_.push_back(FileListBlock{ entry.firstBlock, index, reach });
+}
+
+void VirtualDiscFileSystem::RebuildFileListLookups() {
+	fileListNames_.clear();
+	fileListBlocks_.clear();
+	fileListBlocks_.reserve(fileList.size());
+	for (size_t i = 0; i < fileList.size(); ++i) {
+		fileListNames_.emplace(fileList[i].fileName, (int)i);
+		fileListBlocks_.push_back(FileListBlock{ fileList[i].firstBlock, (int)i, 0 });
+	}
+
+	std::stable_sort(fileListBlocks_.begin(), fileListBlocks_.end(), [](const FileListBlock &a, const FileListBlock &b) {
+		return a.firstBlock < b.firstBlock;
+	});
+	u64 reach = 0;
+	for (FileListBlock &block : fileListBlocks_) {
+		const FileListEntry &entry = fileList[block.index];
+		reach = std::max(reach, (u64)entry.firstBlock + (entry.totalSize + 2047) / 2048);
+		block.reach = reach;
+	}
+}
+
+// Returns true if the size was out of date (now fixed), which might change what's at which block.
+bool VirtualDiscFileSystem::CheckFileListEntrySize(int fileIndex) {
+	FileListEntry &entry = fileList[fileIndex];
+	if (entry.sizeChecked)
+		return false;
+	entry.sizeChecked = true;
+	// Handlers weren't asked again, the cache is only used if they're set up the same way.
+	if (entry.handler != nullptr)
+		return false;
+
+	u32 totalSize = (u32)File::GetFileSize(GetLocalPath(entry.fileName));
+	if (totalSize == entry.totalSize)
+		return false;
+
+	WARN_LOG(Log::FileSystem, "%s changed size since the virtual disc index was cached", entry.fileName.c_str());
+	entry.totalSize = totalSize;
+	u32 nextBlock = entry.firstBlock + (entry.totalSize + 2047) / 2048;
+	if (nextBlock > currentBlockIndex) {
+		currentBlockIndex = nextBlock;
+	}
+	RebuildFileListLookups();
+
+	// Start over from the index file next time.
+	File::Delete(CachedFileListIndexPath(), true);
+	return true;
+}
+
+VirtualDiscFileSystem::OpenFileEntry *VirtualDiscFileSystem::GetBlockReadFile(int fileIndex) {
+	for (size_t i = 0; i < blockReadFiles_.size(); ++i) {
+		if (blockReadFiles_[i].first == fileIndex) {
+			std::rotate(blockReadFiles_.begin(), blockReadFiles_.begin() + i, blockReadFiles_.begin() + i + 1);
+			return &blockReadFiles_[0].second;
+		}
+	}
+
+	OpenFileEntry file(Flags());
+	if (fileList[fileIndex].handler != NULL) {
+		file.handler = fileList[fileIndex].handler;
+	}
+	if (!file.Open(basePath, fileList[fileIndex].fileName, FILEACCESS_READ)) {
+		return nullptr;
+	}
+
+	if (blockReadFiles_.size() >= MAX_BLOCK_READ_FILES) {
+		blockReadFiles_.back().second.Close();
+		blockReadFiles_.pop_back();
+	}
+	blockReadFiles_.insert(blockReadFiles_.begin(), std::make_pair(fileIndex, file));
+	return &blockReadFiles_[0].second;
+}
+
+void VirtualDiscFileSystem::CloseBlockReadFiles() {
+	for (auto &file : blockReadFiles_) {
+		file.second.Close();
+	}
+	blockReadFiles_.clear();
 }
 
 void VirtualDiscFileSystem::DoState(PointerWrap &p)
@@ -206,6 +459,11 @@ void VirtualDiscFileSystem::DoState(PointerWrap &p)
 
 	if (p.mode == p.MODE_READ)
 	{
+		// Sizes are as the game last saw them.
+		for (FileListEntry &entry : fileList)
+			entry.sizeChecked = true;
+		RebuildFileListLookups();
+		CloseBlockReadFiles();
 		entries.clear();
 
 		for (int i = 0; i < entryCount; i++)
@@ -282,11 +540,9 @@ int VirtualDiscFileSystem::getFileListIndex(std::string &fileName)
 		normalized = fileName;
 	}
 
-	for (size_t i = 0; i < fileList.size(); i++)
-	{
-		if (fileList[i].fileName == normalized)
-			return (int)i;
-	}
+	auto known = fileListNames_.find(normalized);
+	if (known != fileListNames_.end())
+		return known->second;
 
 	// unknown file - add it
 	Path fullName = GetLocalPath(fileName);
@@ -310,27 +566,40 @@ int VirtualDiscFileSystem::getFileListIndex(std::string &fileName)
 	entry.fileName = normalized;
 	entry.totalSize = File::GetFileSize(fullName);
 	entry.firstBlock = currentBlockIndex;
+	entry.sizeChecked = true;
 	currentBlockIndex += (entry.totalSize+2047)/2048;
 
-	fileList.push_back(entry);
+	AddFileListEntry(entry);
 
 	return (int)fileList.size()-1;
 }
 
 int VirtualDiscFileSystem::getFileListIndex(u32 accessBlock, u32 accessSize, bool blockMode) const {
-	for (size_t i = 0; i < fileList.size(); i++) {
-		if (fileList[i].firstBlock <= accessBlock) {
-			u32 sectorOffset = (accessBlock-fileList[i].firstBlock)*2048;
-			u32 totalFileSize = blockMode ? (fileList[i].totalSize+2047) & ~2047 : fileList[i].totalSize;
-
-			u32 endOffset = sectorOffset+accessSize;
-			if (endOffset <= totalFileSize) {
-				return (int)i;
-			}
+	// Only files starting at or before the block and reaching it can contain it.
+	// If several do, the first one listed wins.
+	auto after = std::upper_bound(fileListBlocks_.begin(), fileListBlocks_.end(), accessBlock, [](u32 block, const FileListBlock &entry) {
+		return block < entry.firstBlock;
+	});
+
+	int found = -1;
+	for (auto it = after; it != fileListBlocks_.begin(); ) {
+		--it;
+		if (it->reach < accessBlock)
+			break;
+		if (found != -1 && it->index > found)
+			continue;
+
+		const FileListEntry &entry = fileList[it->index];
+		u32 sectorOffset = (accessBlock-entry.firstBlock)*2048;
+		u32 totalFileSize = blockMode ? (entry.totalSize+2047) & ~2047 : entry.totalSize;
+
+		u32 endOffset = sectorOffset+accessSize;
+		if (endOffset <= totalFileSize) {
+			found = it->index;
 		}
 	}
 
-	return -1;
+	return found;
 }
 
 int VirtualDiscFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename)
@@ -360,6 +629,8 @@ int VirtualDiscFileSystem::OpenFile(std::string filename, FileAccess access, con
 		entry.size = readSize;
 
 		int fileIndex = getFileListIndex(sectorStart,readSize);
+		if (fileIndex != -1 && CheckFileListEntrySize(fileIndex))
+			fileIndex = getFileListIndex(sectorStart,readSize);
 		if (fileIndex == -1)
 		{
 			ERROR_LOG(Log::FileSystem, "VirtualDiscFileSystem: sce_lbn used without calling fileinfo.");
@@ -477,24 +748,20 @@ size_t VirtualDiscFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &u
 		}
 
 		// it's the whole iso... it could reference any of the files on the disc.
-		// For now let's just open and close the files on demand. Can certainly be done
-		// better though
+		// The last few files read this way are kept open.
 		if (iter->second.type == VFILETYPE_ISO)
 		{
 			int fileIndex = getFileListIndex(iter->second.curOffset,size*2048,true);
+			if (fileIndex != -1 && CheckFileListEntrySize(fileIndex))
+				fileIndex = getFileListIndex(iter->second.curOffset,size*2048,true);
 			if (fileIndex == -1)
 			{
 				ERROR_LOG(Log::FileSystem,"VirtualDiscFileSystem: Reading from unknown address in %08x at %08llx", handle, iter->second.curOffset);
 				return 0;
 			}
 
-			OpenFileEntry temp(Flags());
-			if (fileList[fileIndex].handler != NULL) {
-				temp.handler = fileList[fileIndex].handler;
-			}
-			bool success = temp.Open(basePath, fileList[fileIndex].fileName, FILEACCESS_READ);
-
-			if (!success)
+			OpenFileEntry *file = GetBlockReadFile(fileIndex);
+			if (!file)
 			{
 				ERROR_LOG(Log::FileSystem,"VirtualDiscFileSystem: Error opening file %s", fileList[fileIndex].fileName.c_str());
 				return 0;
@@ -503,21 +770,19 @@ size_t VirtualDiscFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &u
 			u32 startOffset = (iter->second.curOffset-fileList[fileIndex].firstBlock)*2048;
 			size_t bytesRead;
 
-			temp.Seek(startOffset, FILEMOVE_BEGIN);
+			file->Seek(startOffset, FILEMOVE_BEGIN);
 
 			u32 remainingSize = fileList[fileIndex].totalSize-startOffset;
 			if (remainingSize < size * 2048)
 			{
 				// the file doesn't fill the whole last sector
 				// read what's there and zero fill the rest like on a real disc
-				bytesRead = temp.Read(pointer, remainingSize);
+				bytesRead = file->Read(pointer, remainingSize);
 				memset(&pointer[bytesRead], 0, size * 2048 - bytesRead);
 			} else {
-				bytesRead = temp.Read(pointer, size * 2048);
+				bytesRead = file->Read(pointer, size * 2048);
 			}
 
-			temp.Close();
-
 			iter->second.curOffset += size;
 			// TODO: This probably isn't enough...
 			if (abs((int)lastReadBlock_ - (int)iter->second.curOffset) > 100) {
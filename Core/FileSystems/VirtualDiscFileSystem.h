@@ -18,11 +18,13 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 
 #include "ppsspp_config.h"
 #include "Common/File/Path.h"
 #include "Core/FileSystems/FileSystem.h"
 #include "Core/FileSystems/DirectoryFileSystem.h"
+#include "Common/File/DirListing.h"
 
 extern const std::string INDEX_FILENAME;
 
@@ -65,10 +67,22 @@ class VirtualDiscFileSystem: public IFileSystem {
 	void Describe(char *buf, size_t size) const override { snprintf(buf, size, "VirtualDisc: %s", basePath.ToVisualString().c_str()); }  // TODO: Ask the fileLoader about the origins
 
 private:
+	struct FileListEntry;
+	struct OpenFileEntry;
+
 	void LoadFileListIndex();
+	bool LoadCachedFileListIndex(const Path &cacheFilename, const File::FileInfo &indexInfo);
+	void SaveCachedFileListIndex(const Path &cacheFilename, const File::FileInfo &indexInfo, const std::vector<std::string> &handlerNames);
+	Path CachedFileListIndexPath() const;
+	void SetEntryHandler(FileListEntry &entry, const std::string &handler);
 	// Warning: modifies input string.
 	int getFileListIndex(std::string &fileName);
 	int getFileListIndex(u32 accessBlock, u32 accessSize, bool blockMode = false) const;
+	void AddFileListEntry(const FileListEntry &entry);
+	void RebuildFileListLookups();
+	bool CheckFileListEntrySize(int fileIndex);
+	OpenFileEntry *GetBlockReadFile(int fileIndex);
+	void CloseBlockReadFiles();
 	Path GetLocalPath(std::string_view localpath) const;
 
 	typedef void *HandlerLibrary;
@@ -197,11 +211,27 @@ class VirtualDiscFileSystem: public IFileSystem {
 		u32 firstBlock;
 		u32 totalSize;
 		Handler *handler;
+		// Sizes from the cached index are checked against the file once it's used.
+		bool sizeChecked;
 	};
 
 	std::vector<FileListEntry> fileList;
 	u32 currentBlockIndex;
 	u32 lastReadBlock_;
 
+	// Lookups into fileList. Names map to the first entry with the name.
+	std::unordered_map<std::string, int> fileListNames_;
+	struct FileListBlock {
+		u32 firstBlock;
+		int index;
+		// Furthest any entry up to and including this one reaches, in blocks.
+		u64 reach;
+	};
+	// Sorted by firstBlock.
+	std::vector<FileListBlock> fileListBlocks_;
+
+	// Files recently read through the whole disc, kept open since games tend to read them in pieces.
+	std::vector<std::pair<int, OpenFileEntry>> blockReadFiles_;
+
 	std::map<std::string, Handler *> handlers;
 };
@@ -935,7 +935,8 @@ const HLEFunction *GetSyscallFunctionData(MIPSOpcode op, u32 pcForDiagnostics) {
 }
 
 void *GetQuickSyscallFunc(const HLEFunction *info, MIPSOpcode op) {
-	if (g_coreCollectDebugStats)
+	// Only CallSyscall times syscalls. Blocks compiled before the profiler was turned on keep the quick path.
+	if (g_coreCollectDebugStats || Profiler_IsEnabled())
 		return nullptr;
 	if (!info || !info->func)
 		return nullptr;
@@ -0,0 +1,156 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Buffering for runs of small sequential reads on an open file, used by sceIo.
+//
+// Once a file gets a few small reads in a row, they're copied out of a buffer while the next
+// one is read in the background. The file's real position is then ahead of where the game
+// thinks it is, so anything else that uses the file must Flush() first, which seeks it back.
+
+class IoReadaheadFile {
+public:
+	virtual ~IoReadaheadFile() {}
+
+	// Starts reading into buf from the current position. Only one is ever in flight.
+	virtual void StartRead(u8 *buf, size_t bytes) = 0;
+	// Waits for StartRead() to finish. Returns the bytes read, or a negative error code.
+	virtual s64 FinishRead() = 0;
+	virtual s64 Tell() = 0;
+	virtual void SeekBack(size_t bytes) = 0;
+};
+
+class IoReadahead {
+public:
+	enum {
+		AFTER_READS = 3,
+		MAX_READ = 16 * 1024,
+		BUFFER_SIZE = 64 * 1024,
+	};
+
+	// Returns false if the read should go to the file as usual. canStart is only checked before
+	// buffering starts, and is for things like another operation being pending on the file.
+	bool Read(IoReadaheadFile &file, u8 *data, u32 size, bool canStart, u32 *result) {
+		if (size > MAX_READ) {
+			Flush(file);
+			return false;
+		}
+
+		if (!Active()) {
+			if (++sequentialReads_ < AFTER_READS || !canStart)
+				return false;
+			pos_ = file.Tell();
+			Fill(file);
+		}
+
+		u32 done = 0;
+		while (done < size) {
+			size_t avail = cur_.size() - curPos_;
+			if (avail == 0) {
+				if (filling_)
+					Wait(file);
+				if (next_.empty()) {
+					// End of the file.
+					break;
+				}
+				cur_.swap(next_);
+				curPos_ = 0;
+				next_.clear();
+				if (!eof_)
+					Fill(file);
+				continue;
+			}
+
+			size_t copySize = std::min(avail, (size_t)(size - done));
+			memcpy(data + done, &cur_[curPos_], copySize);
+			curPos_ += copySize;
+			done += (u32)copySize;
+		}
+
+		pos_ += done;
+		*result = done;
+		return true;
+	}
+
+	// Drops anything buffered and puts the file position back where the game expects it.
+	// Also starts the count of small reads over.
+	void Flush(IoReadaheadFile &file) {
+		sequentialReads_ = 0;
+		if (!Active())
+			return;
+
+		if (filling_)
+			Wait(file);
+		size_t ahead = (cur_.size() - curPos_) + next_.size();
+		if (ahead != 0)
+			file.SeekBack(ahead);
+		cur_.clear();
+		curPos_ = 0;
+		next_.clear();
+		eof_ = false;
+		pos_ = -1;
+	}
+
+	bool Active() const {
+		return filling_ || curPos_ < cur_.size() || !next_.empty() || eof_;
+	}
+	bool Filling() const {
+		return filling_;
+	}
+	// Where the game thinks the file position is while buffering, otherwise -1.
+	// Unlike the rest, this can be called from any thread (e.g. the debugger.)
+	s64 Position() const {
+		return pos_;
+	}
+
+private:
+	void Fill(IoReadaheadFile &file) {
+		next_.resize(BUFFER_SIZE);
+		filling_ = true;
+		file.StartRead(&next_[0], next_.size());
+	}
+
+	void Wait(IoReadaheadFile &file) {
+		s64 result = file.FinishRead();
+		filling_ = false;
+		if (result < 0 || result > (s64)next_.size()) {
+			// Probably an error code, not much else we can do.
+			result = 0;
+		}
+		next_.resize((size_t)result);
+		if (result < (s64)BUFFER_SIZE)
+			eof_ = true;
+	}
+
+	int sequentialReads_ = 0;
+	std::atomic<s64> pos_{ -1 };
+	// What's being read from, and how much of it is used up.
+	std::vector<u8> cur_;
+	size_t curPos_ = 0;
+	// Filled in the background. Its size is what was read, once it's done.
+	std::vector<u8> next_;
+	bool filling_ = false;
+	bool eof_ = false;
+};
@@ -23,6 +23,7 @@
 
 #include "Common/CommonTypes.h"
 #include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/HLE/ErrorCodes.h"
 
@@ -312,4 +313,66 @@ inline void RemoveWaitingThread(std::vector<T> &waitingThreads, const SceUID thr
 	waitingThreads.erase(std::remove(waitingThreads.begin(), waitingThreads.end(), threadID), waitingThreads.end());
 }
 
+template <typename T>
+inline SceUID WaitingThreadID(const T &waitInfo) {
+	return waitInfo.threadID;
+}
+
+template <>
+inline SceUID WaitingThreadID(const SceUID &threadID) {
+	return threadID;
+}
+
+// Same order as std::stable_sort with __KernelThreadSortPriority, but looks up each thread's priority
+// once rather than on every comparison, and leaves the list alone if it's already in order.
+// getPrio takes a thread ID and returns its priority.
+template <typename T, class GetPrioFunc>
+inline void SortWaitingThreadsByPriority(std::vector<T> &waitingThreads, GetPrioFunc getPrio) {
+	if (waitingThreads.size() < 2)
+		return;
+
+	// Priority, then position in the list.
+	std::vector<std::pair<u32, u32>> order;
+	order.reserve(waitingThreads.size());
+	bool sorted = true;
+	for (size_t i = 0; i < waitingThreads.size(); ++i) {
+		u32 prio = getPrio(WaitingThreadID(waitingThreads[i]));
+		if (!order.empty() && prio < order.back().first)
+			sorted = false;
+		order.emplace_back(prio, (u32)i);
+	}
+	if (sorted)
+		return;
+
+	std::sort(order.begin(), order.end());
+	std::vector<T> result;
+	result.reserve(waitingThreads.size());
+	for (const auto &entry : order)
+		result.push_back(waitingThreads[entry.second]);
+	waitingThreads.swap(result);
+}
+
+template <typename T>
+inline void SortWaitingThreadsByPriority(std::vector<T> &waitingThreads) {
+	SortWaitingThreadsByPriority(waitingThreads, [](SceUID threadID) {
+		return __KernelGetThreadPrio(threadID);
+	});
+}
+
+// Tries to wake each waiting thread in order, and removes those tryUnlock returns true for.
+// Unlike erasing each one as it goes, this stays linear when a lot of threads wake at once.
+// tryUnlock must not change waitingThreads itself.
+template <typename T, class TryUnlockFunc>
+inline void UnlockWaitingThreads(std::vector<T> &waitingThreads, TryUnlockFunc tryUnlock) {
+	size_t kept = 0;
+	for (size_t i = 0; i < waitingThreads.size(); ++i) {
+		if (tryUnlock(waitingThreads[i]))
+			continue;
+		if (kept != i)
+			waitingThreads[kept] = waitingThreads[i];
+		++kept;
+	}
+	waitingThreads.erase(waitingThreads.begin() + kept, waitingThreads.end());
+}
+
 };
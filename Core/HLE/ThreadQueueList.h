@@ -18,6 +18,7 @@
 #pragma once
 
 #include "Core/HLE/sceKernel.h"
+#include "Common/BitScan.h"
 #include "Common/Serialize/Serializer.h"
 
 struct ThreadQueueList {
@@ -51,6 +52,7 @@ struct ThreadQueueList {
 
 	ThreadQueueList() {
 		memset(queues, 0, sizeof(queues));
+		memset(nonEmpty, 0, sizeof(nonEmpty));
 		first = invalid();
 	}
 
@@ -75,37 +77,27 @@ struct ThreadQueueList {
 	}
 
 	inline SceUID pop_first() {
-		Queue *cur = first;
-		while (cur != invalid()) {
-			if (cur->size() > 0)
-				return cur->data[cur->first++];
-			cur = cur->next;
-		}
+		int priority = first_nonempty(NUM_QUEUES);
+		if (priority >= 0)
+			return pop(priority);
 
 		_dbg_assert_msg_(false, "ThreadQueueList should not be empty.");
 		return 0;
 	}
 
 	inline SceUID pop_first_better(u32 priority) {
-		Queue *cur = first;
 		// Don't bother looking past (worse than) this priority.
-		Queue *stop = &queues[priority];
-		while (cur < stop) {
-			if (cur->size() > 0)
-				return cur->data[cur->first++];
-			cur = cur->next;
-		}
+		int better = first_nonempty(priority);
+		if (better >= 0)
+			return pop(better);
 
 		return 0;
 	}
 
 	inline SceUID peek_first() {
-		Queue *cur = first;
-		while (cur != invalid()) {
-			if (cur->size() > 0)
-				return cur->data[cur->first];
-			cur = cur->next;
-		}
+		int priority = first_nonempty(NUM_QUEUES);
+		if (priority >= 0)
+			return queues[priority].data[queues[priority].first];
 
 		return 0;
 	}
@@ -113,6 +105,7 @@ struct ThreadQueueList {
 	inline void push_front(u32 priority, const SceUID threadID) {
 		Queue *cur = &queues[priority];
 		cur->data[--cur->first] = threadID;
+		nonEmpty[priority / 32] |= 1U << (priority & 31);
 		// If we ran out of room toward the front, add more room for next time.
 		if (cur->first == 0)
 			rebalance(priority);
@@ -121,6 +114,7 @@ struct ThreadQueueList {
 	inline void push_back(u32 priority, const SceUID threadID) {
 		Queue *cur = &queues[priority];
 		cur->data[cur->end++] = threadID;
+		nonEmpty[priority / 32] |= 1U << (priority & 31);
 		if (cur->full())
 			rebalance(priority);
 	}
@@ -139,6 +133,8 @@ struct ThreadQueueList {
 
 				// Now we're one shorter.
 				--cur->end;
+				if (cur->empty())
+					nonEmpty[priority / 32] &= ~(1U << (priority & 31));
 				return;
 			}
 		}
@@ -163,6 +159,7 @@ struct ThreadQueueList {
 			free(queues[i].data);
 		}
 		memset(queues, 0, sizeof(queues));
+		memset(nonEmpty, 0, sizeof(nonEmpty));
 		first = invalid();
 	}
 
@@ -207,6 +204,8 @@ struct ThreadQueueList {
 				link(i, capacity);
 				cur->first = (cur->capacity - size) / 2;
 				cur->end = cur->first + size;
+				if (size != 0)
+					nonEmpty[i / 32] |= 1U << (i & 31);
 			}
 
 			if (size != 0)
@@ -219,6 +218,26 @@ struct ThreadQueueList {
 		return (Queue *)-1;
 	}
 
+	// Best (lowest) priority level with any threads, if better than limit, otherwise -1.
+	int first_nonempty(u32 limit) const {
+		for (u32 i = 0; i < (u32)NUM_WORDS && i * 32 < limit; ++i) {
+			u32 bits = nonEmpty[i];
+			if (bits == 0)
+				continue;
+			u32 priority = i * 32 + 31 - clz32_nonzero(bits & (0 - bits));
+			return priority < limit ? (int)priority : -1;
+		}
+		return -1;
+	}
+
+	inline SceUID pop(u32 priority) {
+		Queue *cur = &queues[priority];
+		SceUID threadID = cur->data[cur->first++];
+		if (cur->empty())
+			nonEmpty[priority / 32] &= ~(1U << (priority & 31));
+		return threadID;
+	}
+
 	// Initialize a priority level and link to other queues.
 	void link(u32 priority, int size) {
 		_dbg_assert_msg_(queues[priority].data == nullptr, "ThreadQueueList::Queue should only be initialized once.");
@@ -281,8 +300,12 @@ struct ThreadQueueList {
 		}
 	}
 
+	static const int NUM_WORDS = NUM_QUEUES / 32;
+
 	// The first queue that's ever been used.
 	Queue *first;
 	// The priority level queues of thread ids.
 	Queue queues[NUM_QUEUES];
+	// One bit per priority level that has any threads, so finding the best one doesn't walk the levels.
+	u32 nonEmpty[NUM_WORDS];
 };
@@ -30,6 +30,7 @@
 #include "Common/Serialize/SerializeMap.h"
 #include "Common/Serialize/SerializeSet.h"
 #include "Common/StringUtils.h"
+#include "Common/Data/Text/StringWriter.h"
 #include "Common/System/Request.h"
 #include "Core/Core.h"
 #include "Core/Config.h"
@@ -42,6 +43,7 @@
 #include "Core/SaveState.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HLE/HLEHelperThread.h"
+#include "Core/HLE/IoReadahead.h"
 #include "Core/HLE/FunctionWrappers.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/HLE/sceUmd.h"
@@ -147,6 +149,16 @@ static std::thread ioManagerThread;
 // Let's try. (was 256)
 const int IO_THREAD_MIN_DATA_SIZE = 0;
 
+struct IoReadStats {
+	u64 reads;
+	u64 readBytes;
+	u64 hostReads;
+	u64 hostReadBytes;
+	u64 readaheadReads;
+};
+
+static IoReadStats ioReadStats;
+
 #define SCE_STM_FDIR 0x1000
 #define SCE_STM_FREG 0x2000
 #define SCE_STM_FLNK 0x4000
@@ -217,6 +229,8 @@ class FileNode : public KernelObject {
 public:
 	FileNode() {}
 	~FileNode() {
+		if (readahead.Filling())
+			ioManager.WaitReadahead(handle);
 		if (handle != -1)
 			pspFileSystem.CloseFile(handle);
 		pgd_close(pgdInfo);
@@ -225,7 +239,9 @@ class FileNode : public KernelObject {
 	const char *GetTypeName() override { return GetStaticTypeName(); }
 	static const char *GetStaticTypeName() { return "OpenFile"; }
 	void GetQuickInfo(char *buf, int bufSize) override {
-		snprintf(buf, bufSize, "Seekpos: %08x", (u32)pspFileSystem.GetSeekPos(handle));
+		// Called from the debugger. While reading ahead, the real position is further on and may be changing.
+		s64 pos = readahead.Position();
+		snprintf(buf, bufSize, "Seekpos: %08x", (u32)(pos >= 0 ? pos : pspFileSystem.GetSeekPos(handle)));
 	}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_BADF; }
 	static int GetStaticIDType() { return PPSSPP_KERNEL_TMID_File; }
@@ -320,6 +336,9 @@ class FileNode : public KernelObject {
 	std::map<SceUID, u64> pausedWaits;
 
 	bool isTTY = false;
+
+	// Not saved, __IoDoState flushes it first.
+	IoReadahead readahead;
 };
 
 /******************************************************************************/
@@ -361,6 +380,69 @@ static FileNode *__IoGetFd(int fd, u32 &error) {
 	return kernelObjects.Get<FileNode>(fds[fd], error);
 }
 
+// The io thread does the reading ahead.
+class FileNodeReadaheadFile : public IoReadaheadFile {
+public:
+	explicit FileNodeReadaheadFile(u32 handle) : handle_(handle) {}
+
+	void StartRead(u8 *buf, size_t bytes) override {
+		ioManager.ScheduleReadahead(handle_, buf, bytes);
+		ioReadStats.hostReads++;
+		ioReadStats.hostReadBytes += bytes;
+	}
+	s64 FinishRead() override {
+		return ioManager.WaitReadahead(handle_);
+	}
+	s64 Tell() override {
+		return pspFileSystem.GetSeekPos(handle_);
+	}
+	void SeekBack(size_t bytes) override {
+		pspFileSystem.SeekFile(handle_, -(s32)bytes, FILEMOVE_CURRENT);
+	}
+
+private:
+	u32 handle_;
+};
+
+// Anything that uses the file's position, other than a small read, must call this first.
+static void __IoReadaheadFlush(FileNode *f) {
+	FileNodeReadaheadFile file(f->handle);
+	f->readahead.Flush(file);
+}
+
+// Other handles to the same file may have read ahead of what's about to be written.
+static void __IoReadaheadFlushPath(const FileNode *writer) {
+	for (int i = 0; i < PSP_COUNT_FDS; ++i) {
+		u32 error;
+		FileNode *f = fds[i] != 0 ? kernelObjects.Get<FileNode>(fds[i], error) : nullptr;
+		if (f && f != writer && f->readahead.Active() && f->fullpath == writer->fullpath)
+			__IoReadaheadFlush(f);
+	}
+}
+
+// Small sequential reads are copied out of a buffer, while the io thread reads the next one.
+// The caller still applies the usual delay, so emulated timing is the same as reading directly.
+// Returns false if the read should go to the file system as usual.
+static bool __IoReadahead(FileNode *f, u8 *data, u32 size, int &result) {
+	// Realistic timing charges by what's actually read, and host timing waits for the host read.
+	bool allowed = g_Config.bIOReadahead && GetIOTimingMethod() == IOTIMING_FAST;
+	if (!allowed || (f->openMode & FILEACCESS_WRITE) != 0) {
+		__IoReadaheadFlush(f);
+		return false;
+	}
+
+	// Block device reads are counted in sectors.
+	bool canStart = !ioManager.HasOperation(f->handle) && (pspFileSystem.DevType(f->handle) & PSPDevType::BLOCK) == 0;
+	FileNodeReadaheadFile file(f->handle);
+	u32 done;
+	if (!f->readahead.Read(file, data, size, canStart, &done))
+		return false;
+
+	ioReadStats.readaheadReads++;
+	result = (int)done;
+	return true;
+}
+
 static int __IoAllocFd(FileNode *f) {
 	// The PSP takes the lowest available id after stderr/etc.
 	for (int possible = PSP_MIN_FD; possible < PSP_COUNT_FDS; ++possible) {
@@ -654,6 +736,7 @@ void __IoInit() {
 	__KernelListenThreadEnd(&TellFsThreadEnded);
 
 	memset(fds, 0, sizeof(fds));
+	ioReadStats = {};
 
 	ioManagerThreadEnabled = true;
 	ioManager.SetThreadEnabled(true);
@@ -668,6 +751,12 @@ void __IoInit() {
 }
 
 void __IoShutdown() {
+	if (ioReadStats.reads != 0) {
+		INFO_LOG(Log::sceIo, "%d reads (%d from readahead) took %d host reads, %0.2f per read, %0.2f bytes read per byte requested",
+			(int)ioReadStats.reads, (int)ioReadStats.readaheadReads, (int)ioReadStats.hostReads, (double)ioReadStats.hostReads / ioReadStats.reads,
+			ioReadStats.readBytes ? (double)ioReadStats.hostReadBytes / ioReadStats.readBytes : 0.0);
+	}
+
 	ioManagerThreadEnabled = false;
 	ioManager.SyncThread();
 	ioManager.FinishEventLoop();
@@ -691,11 +780,25 @@ void __IoShutdown() {
 	memStickFatCallbacks.clear();
 }
 
+static void __IoReadaheadFlushAll() {
+	for (int i = 0; i < PSP_COUNT_FDS; ++i) {
+		u32 error;
+		FileNode *f = fds[i] != 0 ? kernelObjects.Get<FileNode>(fds[i], error) : nullptr;
+		if (f)
+			__IoReadaheadFlush(f);
+	}
+}
+
 void __IoDoState(PointerWrap &p) {
 	auto s = p.Section("sceIo", 1, 5);
 	if (!s)
 		return;
 
+	// The file system saves file positions, so they must be where the game expects.
+	// When loading, the old files are already gone (and waited for their readahead.)
+	if (p.mode != p.MODE_READ)
+		__IoReadaheadFlushAll();
+
 	ioManager.DoState(p);
 	DoArray(p, fds, ARRAY_SIZE(fds));
 	Do(p, asyncNotifyEvent);
@@ -759,8 +862,16 @@ void __IoDoState(PointerWrap &p) {
 	}
 }
 
+void __IoGetDebugStats(StringWriter &w) {
+	const IoReadStats &stats = ioReadStats;
+	w.F("IO reads: %d (%d from readahead), %d KB\n", (int)stats.reads, (int)stats.readaheadReads, (int)(stats.readBytes / 1024));
+	w.F("Host reads: %d (%0.2f per read), %d KB\n", (int)stats.hostReads, stats.reads ? (double)stats.hostReads / stats.reads : 0.0, (int)(stats.hostReadBytes / 1024));
+}
+
 static std::string IODetermineFilename(const FileNode *f) {
-	uint64_t offset = pspFileSystem.GetSeekPos(f->handle);
+	// The real position is further ahead (and may be changing) while buffering.
+	s64 readaheadPos = f->readahead.Position();
+	uint64_t offset = readaheadPos >= 0 ? readaheadPos : pspFileSystem.GetSeekPos(f->handle);
 	if ((pspFileSystem.DevType(f->handle) & PSPDevType::BLOCK) != 0) {
 		return StringFromFormat("%s offset 0x%08llx", f->fullpath.c_str(), offset * 2048);
 	}
@@ -773,6 +884,8 @@ u32 __IoGetFileHandleFromId(u32 id, u32 &outError)
 	if (!f) {
 		return (u32)-1;
 	}
+	// Whoever asked will read from the current position.
+	__IoReadaheadFlush(f);
 	return f->handle;
 }
 
@@ -1035,16 +1148,30 @@ static bool __IoRead(int &result, int id, u32 data_addr, int size, int &us) {
 			result = SCE_KERNEL_ERROR_ILLEGAL_ADDR;
 			return true;
 		} else if (Memory::IsValidAddress(data_addr)) {
-			const std::string tag = "IoRead/" + IODetermineFilename(f);
-			NotifyMemInfo(MemBlockFlags::WRITE, data_addr, size, tag.c_str(), tag.size());
-			u8 *data = (u8 *)Memory::GetPointerUnchecked(data_addr);
+			// Validated once here, everything below writes straight into guest memory.
 			u32 validSize = Memory::ClampValidSizeAt(data_addr, size);
+			u8 *data = Memory::GetPointerWriteUnchecked(data_addr);
+			if (MemBlockInfoDetailed(validSize)) {
+				const std::string tag = "IoRead/" + IODetermineFilename(f);
+				NotifyMemInfo(MemBlockFlags::WRITE, data_addr, validSize, tag.c_str(), tag.size());
+			} else {
+				NotifyMemInfo(MemBlockFlags::WRITE, data_addr, validSize, "IoRead");
+			}
+			ioReadStats.reads++;
+			ioReadStats.readBytes += validSize;
 			if (f->npdrm) {
 				result = npdrmRead(f, data, validSize);
 				currentMIPS->InvalidateICacheRangeDeferred(data_addr, validSize);
 				return true;
 			}
 
+			if (__IoReadahead(f, data, validSize, result)) {
+				currentMIPS->InvalidateICacheRangeDeferred(data_addr, validSize);
+				return true;
+			}
+
+			ioReadStats.hostReads++;
+			ioReadStats.hostReadBytes += validSize;
 			bool useThread = __KernelIsDispatchEnabled() && ioManagerThreadEnabled && size > IO_THREAD_MIN_DATA_SIZE;
 			if (useThread) {
 				// If there's a pending operation on this file, wait for it to finish and don't overwrite it.
@@ -1195,6 +1322,8 @@ static bool __IoWrite(int &result, int id, u32 data_addr, int size, int &us) {
 			return true;
 		}
 
+		__IoReadaheadFlushPath(f);
+
 		bool useThread = __KernelIsDispatchEnabled() && ioManagerThreadEnabled && size > IO_THREAD_MIN_DATA_SIZE;
 		if (useThread) {
 			// If there's a pending operation on this file, wait for it to finish and don't overwrite it.
@@ -1354,6 +1483,7 @@ static s64 __IoLseekDest(FileNode *f, s64 offset, int whence, FileMove &seek) {
 	if (ioManager.HasOperation(f->handle)) {
 		ioManager.SyncThread();
 	}
+	__IoReadaheadFlush(f);
 
 	s64 newPos = 0;
 	switch (whence) {
@@ -2550,6 +2680,9 @@ int __IoIoctl(u32 id, u32 cmd, u32 indataPtr, u32 inlen, u32 outdataPtr, u32 out
 		return SCE_KERNEL_ERROR_ASYNC_BUSY;
 	}
 
+	// Several of these read or seek the file.
+	__IoReadaheadFlush(f);
+
 	// TODO: Move this into each command, probably?
 	usec += 100;
 
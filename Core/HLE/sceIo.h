@@ -19,11 +19,14 @@
 
 class PointerWrap;
 class KernelObject;
+class StringWriter;
 
 void __IoInit();
 void __IoDoState(PointerWrap &p);
 void __IoShutdown();
 void __IoVblank();
+// Emulated reads against the host reads they took.
+void __IoGetDebugStats(StringWriter &w);
 
 struct ScePspDateTime;
 struct tm;
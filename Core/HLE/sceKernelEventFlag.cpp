@@ -255,14 +255,9 @@ u32 sceKernelSetEventFlag(SceUID id, u32 bitsToSet) {
 
 		e->nef.currentPattern |= bitsToSet;
 
-		for (size_t i = 0; i < e->waitingThreads.size(); ++i) {
-			EventFlagTh *t = &e->waitingThreads[i];
-			if (__KernelUnlockEventFlagForThread(e, *t, error, 0, wokeThreads)) {
-				e->waitingThreads.erase(e->waitingThreads.begin() + i);
-				// Try the one that used to be in this place next.
-				--i;
-			}
-		}
+		HLEKernel::UnlockWaitingThreads(e->waitingThreads, [&](EventFlagTh &th) {
+			return __KernelUnlockEventFlagForThread(e, th, error, 0, wokeThreads);
+		});
 
 		if (wokeThreads)
 			hleReSchedule("event flag set");
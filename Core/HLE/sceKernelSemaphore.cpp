@@ -257,16 +257,13 @@ int sceKernelSignalSema(SceUID id, int signal) {
 		s->ns.currentCount += signal;
 
 		if ((s->ns.attr & PSP_SEMA_ATTR_PRIORITY) != 0)
-			std::stable_sort(s->waitingThreads.begin(), s->waitingThreads.end(), __KernelThreadSortPriority);
+			HLEKernel::SortWaitingThreadsByPriority(s->waitingThreads);
 
+		// Waking a thread only lowers the count, so one pass wakes everything that can be woken.
 		bool wokeThreads = false;
-retry:
-		for (auto iter = s->waitingThreads.begin(), end = s->waitingThreads.end(); iter != end; ++iter) {
-			if (__KernelUnlockSemaForThread(s, *iter, error, 0, wokeThreads)) {
-				s->waitingThreads.erase(iter);
-				goto retry;
-			}
-		}
+		HLEKernel::UnlockWaitingThreads(s->waitingThreads, [&](SceUID threadID) {
+			return __KernelUnlockSemaForThread(s, threadID, error, 0, wokeThreads);
+		});
 
 		if (wokeThreads)
 			hleReSchedule("semaphore signaled");
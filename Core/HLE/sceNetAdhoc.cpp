@@ -751,6 +751,7 @@ static int pdp_recv_postoffice(int idx, SceNetEtherAddr *saddr, uint16_t *sport,
 	SceNetEtherAddr saddr_copy = {0};
 	int len_copy = *len;
 
+	Memory::DirtyPages_PrepareHostWrite(data, std::max(len_copy, 0));
 	int pdp_recv_status = pdp_recv(pdp_sock, (char *)&saddr_copy, &sport_copy, (char *)data, &len_copy, true);
 	if (pdp_recv_status == AEMU_POSTOFFICE_CLIENT_SESSION_DEAD) {
 		handle_relay_connect_failure();
@@ -854,6 +855,7 @@ int DoBlockingPdpRecv(AdhocSocketRequest& req, s64& result) {
 	if (ret >= 0 && ret <= *req.length) {
 		sinlen = sizeof(sin);
         memset(&sin, 0, sinlen);
+		Memory::DirtyPages_PrepareHostWrite(req.buffer, std::max(0, *req.length));
 		ret = recvfrom(pdpsocket.id, (char*)req.buffer, std::max(0, *req.length), MSG_NOSIGNAL, (struct sockaddr*)&sin, &sinlen);
 		// UDP can also receives 0 data, while on TCP receiving 0 data = connection gracefully closed, but not sure whether PDP can send/recv 0 data or not tho
 		*req.length = 0;
@@ -1145,6 +1147,7 @@ static int ptp_recv_postoffice(int idx, void *data, int *len) {
 
 	int len_copy = *len;
 
+	Memory::DirtyPages_PrepareHostWrite(data, std::max(len_copy, 0));
 	int ptp_recv_status = ptp_recv(internal->postofficeHandle, (char *)data, &len_copy, true);
 	if (ptp_recv_status == AEMU_POSTOFFICE_CLIENT_SESSION_DEAD) {
 		// the session is dead, need to be reflected to the other side
@@ -1194,6 +1197,7 @@ int DoBlockingPtpRecv(AdhocSocketRequest& req, s64& result) {
 		ret = SOCKET_ERROR;
 		sockerr = EAGAIN;
 	} else {
+		Memory::DirtyPages_PrepareHostWrite(req.buffer, std::max(0, *req.length));
 		ret = recv(ptpsocket.id, (char*)req.buffer, std::max(0, *req.length), MSG_NOSIGNAL);
 		sockerr = socket_errno;
 	}
@@ -2684,6 +2688,7 @@ int sceNetAdhocPdpRecv(int id, void *addr, void * port, void *buf, void *dataLen
 					sinlen = sizeof(sin);
 					memset(&sin, 0, sinlen);
 					// On Windows: Socket Error 10014 may happen when buffer size is less than the minimum allowed/required (ie. negative number on Vulcanus Seek and Destroy), the address is not a valid part of the user address space (ie. on the stack or when buffer overflow occurred), or the address is not properly aligned (ie. multiple of 4 on 32bit and multiple of 8 on 64bit) https://stackoverflow.com/questions/861154/winsock-error-code-10014
+					Memory::DirtyPages_PrepareHostWrite(buf, std::max(0, *len));
 					received = recvfrom(pdpsocket.id, (char*)buf, std::max(0, *len), MSG_NOSIGNAL, (struct sockaddr*)&sin, &sinlen);
 					error = socket_errno;
 				}
@@ -5384,6 +5389,7 @@ static int sceNetAdhocPtpRecv(int id, u32 dataAddr, u32 dataSizeAddr, int timeou
 						error = EAGAIN;
 					} else {
 						// Receive Data. POSIX: May received 0 bytes when the remote peer already closed the connection.
+						Memory::DirtyPages_PrepareHostWrite(buf, std::max(0, *len));
 						received = recv(ptpsocket.id, (char*)buf, std::max(0, *len), MSG_NOSIGNAL);
 						error = socket_errno;
 					}
@@ -419,6 +419,8 @@ static int sceNetInetRecv(int socket, u32 bufPtr, u32 bufLen, u32 flags) {
 
 	int flgs = flags & ~PSP_NET_INET_MSG_DONTWAIT; // removing non-POSIX flag, which is an alternative way to use non-blocking mode
 	flgs = convertMSGFlagsPSP2Host(flgs);
+	// The OS writes straight into RAM, which the dirty page tracking can't catch.
+	Memory::DirtyPages_PrepareHostWrite(Memory::GetPointerOrException(bufPtr), bufLen);
 	int retval = recv(inetSock->sock, (char*)Memory::GetPointerOrException(bufPtr), bufLen, flgs | MSG_NOSIGNAL);
 	if (retval < 0) {
 		if (UpdateErrnoFromHost(__KernelGetCurThread(), socket_errno, __FUNCTION__) == ERROR_INET_EAGAIN) {
@@ -608,6 +610,8 @@ static int sceNetInetGetsockopt(int socket, int level, int optname, u32 optvalPt
 			memcpy(optval, &val, std::min(static_cast<socklen_t>(sizeof(val)), std::min(static_cast<socklen_t>(sizeof(*optval)), *optlen)));
 		}
 	} else {
+		Memory::DirtyPages_PrepareHostWrite(optlen, optlen ? sizeof(socklen_t) : 0);
+		Memory::DirtyPages_PrepareHostWrite(optval, optval && optlen ? (size_t)*optlen : 0);
 		retval = getsockopt(inetSock->sock, convertSockoptLevelPSP2Host(level), convertSockoptNamePSP2Host(optname, level), (char*)optval, optlen);
 	}
 	if (retval < 0) {
@@ -757,6 +761,7 @@ static int sceNetInetAccept(int socket, u32 addrPtr, u32 addrLenPtr) {
 	if (srclen)
 		*srclen = std::min((*srclen) > 0 ? *srclen : 0, static_cast<socklen_t>(sizeof(saddr)));
 
+	Memory::DirtyPages_PrepareHostWrite(srclen, srclen ? sizeof(socklen_t) : 0);
 	int newHostSocket = accept(inetSock->sock, (struct sockaddr*)&saddr.addr, srclen);
 	if (newHostSocket < 0) {
 		if (UpdateErrnoFromHost(__KernelGetCurThread(), socket_errno, __FUNCTION__) == ERROR_INET_EAGAIN) {
@@ -852,6 +857,9 @@ static int sceNetInetRecvfrom(int socket, u32 bufferPtr, int len, int flags, u32
 		*srclen = std::min((*srclen) > 0 ? *srclen : 0, static_cast<socklen_t>(sizeof(saddr)));
 	int flgs = flags & ~PSP_NET_INET_MSG_DONTWAIT; // removing non-POSIX flag, which is an alternative way to use non-blocking mode
 	flgs = convertMSGFlagsPSP2Host(flgs);
+	// The OS writes straight into RAM, which the dirty page tracking can't catch.
+	Memory::DirtyPages_PrepareHostWrite(Memory::GetPointerOrException(bufferPtr), std::max(len, 0));
+	Memory::DirtyPages_PrepareHostWrite(srclen, srclen ? sizeof(socklen_t) : 0);
 	int retval = recvfrom(inetSock->sock, (char*)Memory::GetPointerOrException(bufferPtr), len, flgs | MSG_NOSIGNAL, (struct sockaddr*)&saddr.addr, srclen);
 	if (retval < 0) {
 		if (UpdateErrnoFromHost(__KernelGetCurThread(), socket_errno, __FUNCTION__) == ERROR_INET_EAGAIN) {
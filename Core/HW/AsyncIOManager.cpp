@@ -52,6 +52,8 @@ void AsyncIOManager::Shutdown() {
 	std::lock_guard<std::mutex> guard(resultsLock_);
 	resultsPending_.clear();
 	results_.clear();
+	readaheadPending_.clear();
+	readaheadResults_.clear();
 }
 
 bool AsyncIOManager::HasResult(u32 handle) {
@@ -115,6 +117,41 @@ u64 AsyncIOManager::ResultFinishTicks(u32 handle) {
 	return 0;
 }
 
+void AsyncIOManager::ScheduleReadahead(u32 handle, u8 *buf, size_t bytes) {
+	{
+		std::lock_guard<std::mutex> guard(resultsLock_);
+		if (!readaheadPending_.insert(handle).second) {
+			ERROR_LOG_REPORT(Log::sceIo, "Scheduling readahead for file %d while one is pending", handle);
+		}
+	}
+
+	AsyncIOEvent ev = IO_EVENT_READAHEAD;
+	ev.handle = handle;
+	ev.buf = buf;
+	ev.bytes = bytes;
+	ev.invalidateAddr = 0;
+	ScheduleEvent(ev);
+}
+
+s64 AsyncIOManager::WaitReadahead(u32 handle) {
+	std::unique_lock<std::mutex> guard(resultsLock_);
+	ScheduleEvent(IO_EVENT_SYNC);
+	while (HasEvents() && ThreadEnabled() && readaheadResults_.find(handle) == readaheadResults_.end()) {
+		resultsWait_.wait_for(guard, std::chrono::milliseconds(16));
+	}
+
+	auto it = readaheadResults_.find(handle);
+	if (it == readaheadResults_.end()) {
+		ERROR_LOG(Log::sceIo, "Readahead for file %d never finished", handle);
+		readaheadPending_.erase(handle);
+		return 0;
+	}
+	s64 result = it->second;
+	readaheadResults_.erase(it);
+	readaheadPending_.erase(handle);
+	return result;
+}
+
 void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	switch (ev.type) {
 	case IO_EVENT_READ:
@@ -125,6 +162,10 @@ void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 		Write(ev.handle, ev.buf, ev.bytes);
 		break;
 
+	case IO_EVENT_READAHEAD:
+		Readahead(ev.handle, ev.buf, ev.bytes);
+		break;
+
 	default:
 		ERROR_LOG_REPORT(Log::sceIo, "Unsupported IO event type");
 	}
@@ -142,6 +183,13 @@ void AsyncIOManager::Write(u32 handle, const u8 *buf, size_t bytes) {
 	EventResult(handle, AsyncIOResult(result, usec));
 }
 
+void AsyncIOManager::Readahead(u32 handle, u8 *buf, size_t bytes) {
+	s64 result = pspFileSystem.ReadFile(handle, buf, bytes);
+	std::lock_guard<std::mutex> guard(resultsLock_);
+	readaheadResults_[handle] = result;
+	resultsWait_.notify_all();
+}
+
 void AsyncIOManager::EventResult(u32 handle, const AsyncIOResult &result) {
 	std::lock_guard<std::mutex> guard(resultsLock_);
 	if (results_.find(handle) != results_.end()) {
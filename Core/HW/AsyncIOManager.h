@@ -34,6 +34,7 @@ enum AsyncIOEventType {
 	IO_EVENT_FINISH,
 	IO_EVENT_READ,
 	IO_EVENT_WRITE,
+	IO_EVENT_READAHEAD,
 };
 
 struct AsyncIOEvent {
@@ -89,6 +90,13 @@ class AsyncIOManager {
 	bool WaitResult(u32 handle, AsyncIOResult &result);
 	u64 ResultFinishTicks(u32 handle);
 
+	// Reads into buf from the file's current position, leaving the position after what was read.
+	// Unlike other operations, these aren't visible to HasOperation() and aren't saved - the caller
+	// must wait for them before touching the file again.
+	void ScheduleReadahead(u32 handle, u8 *buf, size_t bytes);
+	// Returns the bytes read.
+	s64 WaitReadahead(u32 handle);
+
 	void SetThreadEnabled(bool threadEnabled) {
 		threadEnabled_ = threadEnabled;
 	}
@@ -260,6 +268,7 @@ class AsyncIOManager {
 	bool ReadResult(u32 handle, AsyncIOResult &result);
 	void Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr);
 	void Write(u32 handle, const u8 *buf, size_t bytes);
+	void Readahead(u32 handle, u8 *buf, size_t bytes);
 
 	void EventResult(u32 handle, const AsyncIOResult &result);
 
@@ -275,4 +284,6 @@ class AsyncIOManager {
 	std::condition_variable resultsWait_;
 	std::set<u32> resultsPending_;
 	std::map<u32, AsyncIOResult> results_;
+	std::set<u32> readaheadPending_;
+	std::map<u32, s64> readaheadResults_;
 };
@@ -32,6 +32,15 @@
 #define CONTROL_FACTOR  0.2f // in freq_shift per fifo size offset
 #define CONTROL_AVG     32.0f
 
+// Latency mode (iAudioLatencyMs > 0.) The controller works on the fill error relative to the target,
+// and adjusts the playback ratio by at most LATENCY_MAX_ADJUST (1% is about the limit of being inaudible.)
+#define LATENCY_MIN_FRAMES 256
+#define LATENCY_HEADROOM 2048  // the emulator pushes a whole frame or more at once
+#define LATENCY_KP 0.02f
+#define LATENCY_KI 0.004f  // per second
+#define LATENCY_MAX_ADJUST 0.01f
+#define LATENCY_FILTER_SECONDS 0.25f
+
 #include "ppsspp_config.h"
 #include <algorithm>
 #include <cstring>
@@ -75,6 +84,17 @@ StereoResampler::~StereoResampler() {
 }
 
 void StereoResampler::UpdateBufferSize() {
+	targetLatencyMs_ = std::max(0, g_Config.iAudioLatencyMs);
+	if (targetLatencyMs_ > 0) {
+		int frames = targetLatencyMs_ * inputSampleRateHz_ / 1000;
+		// Can't go below what the backend pulls in one go without underrunning constantly.
+		int systemBufsize = System_GetPropertyInt(SYSPROP_AUDIO_FRAMES_PER_BUFFER);
+		frames = std::max(frames, std::max(LATENCY_MIN_FRAMES, systemBufsize));
+		targetBufsize_ = std::min(frames, MAX_BUFSIZE_EXTRA - LATENCY_HEADROOM);
+		maxBufsize_ = targetBufsize_ + LATENCY_HEADROOM > MAX_BUFSIZE_DEFAULT ? MAX_BUFSIZE_EXTRA : MAX_BUFSIZE_DEFAULT;
+		return;
+	}
+
 	if (g_Config.bExtraAudioBuffering) {
 		maxBufsize_ = MAX_BUFSIZE_EXTRA;
 		targetBufsize_ = TARGET_BUFSIZE_EXTRA;
@@ -159,32 +179,58 @@ inline int16_t MixSingleSample(int16_t s1, int16_t s2, uint16_t frac) {
 		return (int16_t)value;
 }
 
-// Executed from sound stream thread, pulling sound out of the buffer.
-void StereoResampler::Mix(s16 *samples, unsigned int numSamples, bool consider_framelimit, int sample_rate) {
-	if (!samples)
-		return;
-
-	if (!buffer_) {
-		return;
-	}
+// Catmull-Rom between s1 and s2. Costs a bit more than linear, but has much less high-frequency loss.
+inline int16_t MixCubicSample(int16_t s0, int16_t s1, int16_t s2, int16_t s3, uint16_t frac) {
+	float t = (float)frac * (1.0f / 65536.0f);
+	float a = -0.5f * s0 + 1.5f * s1 - 1.5f * s2 + 0.5f * s3;
+	float b = s0 - 2.5f * s1 + 2.0f * s2 - 0.5f * s3;
+	float c = -0.5f * s0 + 0.5f * s2;
+	int32_t value = (int32_t)(((a * t + b) * t + c) * t + (float)s1);
+	if (value < -32767)
+		return -32767;
+	else if (value > 32767)
+		return 32767;
+	else
+		return (int16_t)value;
+}
 
+// Returns the number of stereo frames written. Stops early if the buffer runs out.
+template <bool cubic>
+static unsigned int ResampleFrames(s16 *samples, unsigned int numSamples, const int16_t *buffer, u32 indexMask, u32 indexW, u32 &indexR, u32 &frac, u32 ratio) {
+	// Cubic looks one frame back and two ahead.
+	const u32 needed = cubic ? 6 : 2;
 	unsigned int currentSample;
+	for (currentSample = 0; currentSample < numSamples * 2; currentSample += 2) {
+		if (((indexW - indexR) & indexMask) <= needed) {
+			// Ran out!
+			break;
+		}
+		u32 indexR2 = indexR + 2; //next sample
+		s16 l1 = buffer[indexR & indexMask]; //current
+		s16 r1 = buffer[(indexR + 1) & indexMask]; //current
+		s16 l2 = buffer[indexR2 & indexMask]; //next
+		s16 r2 = buffer[(indexR2 + 1) & indexMask]; //next
+		if (cubic) {
+			s16 l0 = buffer[(indexR - 2) & indexMask];
+			s16 r0 = buffer[(indexR - 1) & indexMask];
+			s16 l3 = buffer[(indexR + 4) & indexMask];
+			s16 r3 = buffer[(indexR + 5) & indexMask];
+			samples[currentSample] = MixCubicSample(l0, l1, l2, l3, (u16)frac);
+			samples[currentSample + 1] = MixCubicSample(r0, r1, r2, r3, (u16)frac);
+		} else {
+			samples[currentSample] = MixSingleSample(l1, l2, (u16)frac);
+			samples[currentSample + 1] = MixSingleSample(r1, r2, (u16)frac);
+		}
+		frac += ratio;
+		indexR += 2 * (frac >> 16);
+		frac &= 0xffff;
+	}
+	return currentSample / 2;
+}
 
-	// Cache access in non-volatile variable
-	// This is the only function changing the read value, so it's safe to
-	// cache it locally although it's written here.
-	// The writing pointer will be modified outside, but it will only increase,
-	// so we will just ignore new written data while interpolating (until it wraps...).
-	// Without this cache, the compiler wouldn't be allowed to optimize the
-	// interpolation loop.
-	u32 indexR = indexR_.load();
-	u32 indexW = indexW_.load();
-
+u32 StereoResampler::ClassicRatio(u32 indexW, u32 indexR, int sample_rate) {
 	const int INDEX_MASK = (maxBufsize_ * 2 - 1);
 
-	// This is only for debug visualization, not used for anything.
-	lastBufSize_ = ((indexW - indexR) & INDEX_MASK) / 2;
-
 	// Drift prevention mechanism.
 	float numLeft = (float)(((indexW - indexR) & INDEX_MASK) / 2);
 	// If we had to discard samples the last frame due to underrun,
@@ -206,46 +252,109 @@ void StereoResampler::Mix(s16 *samples, unsigned int numSamples, bool consider_f
 	if (offset < -MAX_FREQ_SHIFT) offset = -MAX_FREQ_SHIFT;
 
 	outputSampleRateHz_ = (float)(inputSampleRateHz_ + offset);
-	const u32 ratio = (u32)(65536.0 * outputSampleRateHz_ / (double)sample_rate);
-	ratio_ = ratio;
-	// TODO: consider a higher-quality resampling algorithm.
-	// TODO: Add a fast path for 1:1.
-	u32 frac = frac_;
-	for (currentSample = 0; currentSample < numSamples * 2; currentSample += 2) {
-		if (((indexW - indexR) & INDEX_MASK) <= 2) {
-			// Ran out!
-			// int missing = numSamples * 2 - currentSample;
-			// ILOG("Resampler underrun: %d (numSamples: %d, currentSample: %d)", missing, numSamples, currentSample / 2);
-			underrunCount_++;
-			break;
+	return (u32)(65536.0 * outputSampleRateHz_ / (double)sample_rate);
+}
+
+u32 StereoResampler::LatencyRatio(u32 indexW, u32 indexR, unsigned int numSamples, int sample_rate) {
+	const int INDEX_MASK = (maxBufsize_ * 2 - 1);
+	float fill = (float)(((indexW - indexR) & INDEX_MASK) / 2);
+
+	// Unlike the classic filter, this is based on time, so the callback size doesn't change how fast we react.
+	float dt = (float)numSamples / (float)sample_rate;
+	float alpha = dt / (LATENCY_FILTER_SECONDS + dt);
+	filteredFill_ += (fill - filteredFill_) * alpha;
+	numLeftI_ = filteredFill_;
+
+	float error = (filteredFill_ - (float)targetBufsize_) / (float)targetBufsize_;
+	// Clamping the integral avoids windup while we're pinned at the limit (like when fast-forwarding.)
+	const float maxIntegral = LATENCY_MAX_ADJUST / LATENCY_KI;
+	integral_ = std::clamp(integral_ + error * dt, -maxIntegral, maxIntegral);
+	float adjust = std::clamp(LATENCY_KP * error + LATENCY_KI * integral_, -LATENCY_MAX_ADJUST, LATENCY_MAX_ADJUST);
+
+	outputSampleRateHz_ = (float)inputSampleRateHz_ * (1.0f + adjust);
+	return (u32)(65536.0 * outputSampleRateHz_ / (double)sample_rate);
+}
+
+void StereoResampler::RecordUnderrun(int missingFrames) {
+	underrunCount_++;
+	int bucket = 0;
+	while (bucket < StereoResamplerStats::UNDERRUN_BUCKETS - 1 && missingFrames >= (16 << (bucket * 2)))
+		bucket++;
+	underrunHistogram_[bucket]++;
+}
+
+// Executed from sound stream thread, pulling sound out of the buffer.
+void StereoResampler::Mix(s16 *samples, unsigned int numSamples, bool consider_framelimit, int sample_rate) {
+	if (!samples)
+		return;
+
+	if (!buffer_) {
+		return;
+	}
+
+	// Cache access in non-volatile variable
+	// This is the only function changing the read value, so it's safe to
+	// cache it locally although it's written here.
+	// The writing pointer will be modified outside, but it will only increase,
+	// so we will just ignore new written data while interpolating (until it wraps...).
+	// Without this cache, the compiler wouldn't be allowed to optimize the
+	// interpolation loop.
+	// Acquire pairs with the release in PushSamples, so the samples before indexW are visible.
+	u32 indexR = indexR_.load(std::memory_order_relaxed);
+	u32 indexW = indexW_.load(std::memory_order_acquire);
+
+	const int INDEX_MASK = (maxBufsize_ * 2 - 1);
+
+	// This is only for debug visualization, not used for anything.
+	lastBufSize_ = ((indexW - indexR) & INDEX_MASK) / 2;
+	int latencyBucket = lastBufSize_ * 100 / inputSampleRateHz_;
+	latencyHistogram_[std::min(latencyBucket, StereoResamplerStats::LATENCY_BUCKETS - 1)]++;
+
+	const bool latencyMode = targetLatencyMs_ > 0;
+	unsigned int produced = 0;
+	if (latencyMode) {
+		if (priming_ && lastBufSize_ >= targetBufsize_) {
+			priming_ = false;
+			filteredFill_ = (float)lastBufSize_;
+		}
+		if (!priming_) {
+			const u32 ratio = LatencyRatio(indexW, indexR, numSamples, sample_rate);
+			ratio_ = ratio;
+			u32 frac = frac_;
+			produced = ResampleFrames<true>(samples, numSamples, buffer_, INDEX_MASK, indexW, indexR, frac, ratio);
+			frac_ = frac;
+			if (produced < numSamples) {
+				RecordUnderrun(numSamples - produced);
+				// Wait until we're back at the target, rather than stuttering along at the edge.
+				priming_ = true;
+			}
+		}
+	} else {
+		const u32 ratio = ClassicRatio(indexW, indexR, sample_rate);
+		ratio_ = ratio;
+		// TODO: Add a fast path for 1:1.
+		u32 frac = frac_;
+		produced = ResampleFrames<false>(samples, numSamples, buffer_, INDEX_MASK, indexW, indexR, frac, ratio);
+		frac_ = frac;
+		if (produced < numSamples) {
+			RecordUnderrun(numSamples - produced);
 		}
-		u32 indexR2 = indexR + 2; //next sample
-		s16 l1 = buffer_[indexR & INDEX_MASK]; //current
-		s16 r1 = buffer_[(indexR + 1) & INDEX_MASK]; //current
-		s16 l2 = buffer_[indexR2 & INDEX_MASK]; //next
-		s16 r2 = buffer_[(indexR2 + 1) & INDEX_MASK]; //next
-		samples[currentSample] = MixSingleSample(l1, l2, (u16)frac);
-		samples[currentSample + 1] = MixSingleSample(r1, r2, (u16)frac);
-		frac += ratio;
-		indexR += 2 * (frac >> 16);
-		frac &= 0xffff;
 	}
-	frac_ = frac;
 
 	// Let's not count the underrun padding here.
-	outputSampleCount_ += currentSample / 2;
+	outputSampleCount_ += produced;
 
 	// Padding with the last value to reduce clicking
 	short s[2];
 	s[0] = clamp_s16(buffer_[(indexR - 1) & INDEX_MASK]);
 	s[1] = clamp_s16(buffer_[(indexR - 2) & INDEX_MASK]);
-	for (; currentSample < numSamples * 2; currentSample += 2) {
+	for (unsigned int currentSample = produced * 2; currentSample < numSamples * 2; currentSample += 2) {
 		samples[currentSample] = s[0];
 		samples[currentSample + 1] = s[1];
 	}
 
 	// Flush cached variable
-	indexR_.store(indexR);
+	indexR_.store(indexR, std::memory_order_release);
 }
 
 // Executes on the emulator thread, pushing sound into the buffer.
@@ -257,17 +366,24 @@ void StereoResampler::PushSamples(const s32 *samples, unsigned int numSamples, f
 	// Cache access in non-volatile variable
 	// indexR isn't allowed to cache in the audio throttling loop as it
 	// needs to get updates to not deadlock.
-	u32 indexW = indexW_.load();
+	u32 indexW = indexW_.load(std::memory_order_relaxed);
 
-	u32 cap = maxBufsize_ * 2;
+	// Keep one frame behind the reader intact, cubic interpolation reads it.
+	u32 cap = maxBufsize_ * 2 - 2;
 	// If fast-forwarding, no need to fill up the entire buffer, just screws up timing after releasing the fast-forward button.
 	if (PSP_CoreParameter().fastForward) {
-		cap = targetBufsize_ * 2;
+		if (targetLatencyMs_ > 0) {
+			// Mix() waits for the fill to reach the target before playing, so leave room for one more push.
+			cap = std::min(cap, (targetBufsize_ + numSamples) * 2 + 2);
+		} else {
+			cap = targetBufsize_ * 2;
+		}
 	}
 
 	// Check if we have enough free space
 	// indexW == indexR_ results in empty buffer, so indexR must always be smaller than indexW
-	if (numSamples * 2 + ((indexW - indexR_.load()) & INDEX_MASK) >= cap) {
+	// Acquire so we don't overwrite samples the reader is still using.
+	if (numSamples * 2 + ((indexW - indexR_.load(std::memory_order_acquire)) & INDEX_MASK) >= cap) {
 		if (!PSP_CoreParameter().fastForward) {
 			overrunCount_++;
 		}
@@ -287,7 +403,8 @@ void StereoResampler::PushSamples(const s32 *samples, unsigned int numSamples, f
 		ClampBufferToS16WithVolume(&buffer_[indexW & INDEX_MASK], samples, numSamples * 2, volume);
 	}
 
-	indexW_ += numSamples * 2;
+	// Only this thread writes indexW_, so no need for an atomic add. Release publishes the samples.
+	indexW_.store(indexW + numSamples * 2, std::memory_order_release);
 	lastPushSize_ = numSamples;
 }
 
@@ -298,7 +415,8 @@ void StereoResampler::GetAudioDebugStats(char *buf, size_t bufSize) {
 	double effective_output_sample_rate = (double)outputSampleCount_ / elapsed;
 
 	double bufferLatencyMs = 1000.0 * (double)lastBufSize_ / (double)inputSampleRateHz_;
-	snprintf(buf, bufSize,
+	int len = snprintf(buf, bufSize,
+		"Mode: %s (target latency: %dms)\n"
 		"Audio buffer: %d/%d (%0.1fms, target: %d)\n"
 		"Filtered: %0.2f\n"
 		"Underruns: %d\n"
@@ -308,6 +426,8 @@ void StereoResampler::GetAudioDebugStats(char *buf, size_t bufSize) {
 		"Effective output sample rate: %0.2f\n"
 		"Push size: %d\n"
 		"Ratio: %0.6f\n",
+		targetLatencyMs_ > 0 ? "latency" : "classic",
+		targetLatencyMs_ > 0 ? targetLatencyMs_ : targetBufsize_ * 1000 / inputSampleRateHz_,
 		lastBufSize_,
 		maxBufsize_,
 		bufferLatencyMs,
@@ -321,6 +441,19 @@ void StereoResampler::GetAudioDebugStats(char *buf, size_t bufSize) {
 		effective_output_sample_rate,
 		lastPushSize_,
 		(float)ratio_ / 65536.0f);
+
+	auto appendHistogram = [&](const char *title, const int *counts, int n) {
+		if (len < 0 || (size_t)len >= bufSize)
+			return;
+		len += snprintf(buf + len, bufSize - len, "%s:", title);
+		for (int i = 0; i < n && len >= 0 && (size_t)len < bufSize; i++)
+			len += snprintf(buf + len, bufSize - len, " %d", counts[i]);
+		if (len >= 0 && (size_t)len < bufSize)
+			len += snprintf(buf + len, bufSize - len, "\n");
+	};
+	appendHistogram("Latency (10ms buckets)", latencyHistogram_, StereoResamplerStats::LATENCY_BUCKETS);
+	appendHistogram("Underrun sizes (<16,<64,<256,<1k,<4k,more)", underrunHistogram_, StereoResamplerStats::UNDERRUN_BUCKETS);
+
 	underrunCountTotal_ += underrunCount_;
 	overrunCountTotal_ += overrunCount_;
 	underrunCount_ = 0;
@@ -332,7 +465,20 @@ void StereoResampler::GetAudioDebugStats(char *buf, size_t bufSize) {
 	// }
 }
 
+void StereoResampler::GetStats(StereoResamplerStats *stats) {
+	stats->bufferedFrames = lastBufSize_;
+	stats->filteredFrames = numLeftI_;
+	stats->targetFrames = targetBufsize_;
+	stats->ratio = (float)ratio_ / 65536.0f;
+	stats->underruns = underrunCountTotal_ + underrunCount_;
+	stats->overruns = overrunCountTotal_ + overrunCount_;
+	memcpy(stats->latencyHistogram, latencyHistogram_, sizeof(latencyHistogram_));
+	memcpy(stats->underrunHistogram, underrunHistogram_, sizeof(underrunHistogram_));
+}
+
 void StereoResampler::ResetStatCounters() {
+	memset(latencyHistogram_, 0, sizeof(latencyHistogram_));
+	memset(underrunHistogram_, 0, sizeof(underrunHistogram_));
 	underrunCount_ = 0;
 	overrunCount_ = 0;
 	underrunCountTotal_ = 0;
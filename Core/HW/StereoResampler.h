@@ -26,6 +26,29 @@
 
 struct AudioDebugStats;
 
+struct StereoResamplerStats {
+	enum {
+		// 10ms per bucket, the last one is everything above.
+		LATENCY_BUCKETS = 16,
+		// Missing frames per underrun: <16, <64, <256, <1024, <4096, more.
+		UNDERRUN_BUCKETS = 6,
+	};
+
+	int bufferedFrames;
+	float filteredFrames;
+	int targetFrames;
+	float ratio;
+	int underruns;
+	int overruns;
+	int latencyHistogram[LATENCY_BUCKETS];
+	int underrunHistogram[UNDERRUN_BUCKETS];
+};
+
+// Ring buffer between the emulator thread (single producer) and the audio thread (single consumer.)
+//
+// By default the playback speed is nudged towards a fixed buffer size. If a target latency is
+// configured (iAudioLatencyMs), a PI controller keeps the filtered buffer fill at that latency
+// instead, and cubic interpolation is used for the rate conversion.
 class StereoResampler {
 public:
 	StereoResampler() noexcept;
@@ -42,13 +65,19 @@ class StereoResampler {
 	void Clear();
 
 	void GetAudioDebugStats(char *buf, size_t bufSize);
+	void GetStats(StereoResamplerStats *stats);
 	void ResetStatCounters();
 
 private:
 	void UpdateBufferSize();
+	u32 ClassicRatio(u32 indexW, u32 indexR, int sampleRate);
+	u32 LatencyRatio(u32 indexW, u32 indexR, unsigned int numSamples, int sampleRate);
+	void RecordUnderrun(int missingFrames);
 
 	int maxBufsize_;
 	int targetBufsize_;
+	// 0 if using the classic rate control.
+	int targetLatencyMs_ = 0;
 
 	// This can be adjusted, for the case of non-60hz output (a few hz off).
 	int inputSampleRateHz_ = 44100;
@@ -64,6 +93,12 @@ class StereoResampler {
 	int lastPushSize_ = 0;
 	u32 ratio_ = 0;
 
+	// Latency mode controller state, only touched by the audio thread.
+	float filteredFill_ = 0.0f;
+	float integral_ = 0.0f;
+	// Waiting for the buffer to fill up to the target before playing, after start or an underrun.
+	bool priming_ = true;
+
 	int underrunCount_ = 0;
 	int overrunCount_ = 0;
 	int underrunCountTotal_ = 0;
@@ -71,6 +106,9 @@ class StereoResampler {
 
 	int droppedSamples_ = 0;
 
+	int latencyHistogram_[StereoResamplerStats::LATENCY_BUCKETS]{};
+	int underrunHistogram_[StereoResamplerStats::UNDERRUN_BUCKETS]{};
+
 	int64_t inputSampleCount_ = 0;
 	int64_t outputSampleCount_ = 0;
 
@@ -614,11 +614,6 @@ void ArmJit::Comp_Syscall(MIPSOpcode op)
 	FlushAll();
 
 	SaveDowncount();
-#ifdef USE_PROFILER
-	// When profiling, we can't skip CallSyscall, since it times syscalls.
-	gpr.SetRegImm(R0, op.encoding);
-	QuickCallFunction(R1, (void *)&CallSyscall);
-#else
 	// Skip the CallSyscall where possible.
 	const HLEFunction *func = GetSyscallFunctionData(op, js.compilerPC);
 	if (func) {
@@ -635,7 +630,6 @@ void ArmJit::Comp_Syscall(MIPSOpcode op)
 		gpr.SetRegImm(R0, js.compilerPC);
 		QuickCallFunction(R1, (void *)&CallSyscallUnresolvedAtPC);
 	}
-#endif
 	ApplyRoundingMode();
 	RestoreDowncount();
 
@@ -629,11 +629,6 @@ void Arm64Jit::Comp_Syscall(MIPSOpcode op)
 	FlushAll();
 
 	SaveStaticRegisters();
-#ifdef USE_PROFILER
-	// When profiling, we can't skip CallSyscall, since it times syscalls.
-	MOVI2R(W0, op.encoding);
-	QuickCallFunction(X1, (void *)&CallSyscall);
-#else
 	// Skip the CallSyscall where possible.
 	const HLEFunction *func = GetSyscallFunctionData(op, js.compilerPC);
 	if (func) {
@@ -650,7 +645,6 @@ void Arm64Jit::Comp_Syscall(MIPSOpcode op)
 		MOVI2R(W0, js.compilerPC);
 		QuickCallFunction(X1, (void *)&CallSyscallUnresolvedAtPC);
 	}
-#endif
 	LoadStaticRegisters();
 	ApplyRoundingMode();
 
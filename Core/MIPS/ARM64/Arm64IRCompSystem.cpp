@@ -211,11 +211,6 @@ void Arm64JitBackend::CompIR_System(IRInst inst) {
 		SaveStaticRegisters();
 
 		WriteDebugProfilerStatus(IRProfilerStatus::SYSCALL);
-#ifdef USE_PROFILER
-		// When profiling, we can't skip CallSyscall, since it times syscalls.
-		MOVI2R(W0, inst.constant);
-		QuickCallFunction(SCRATCH2_64, &CallSyscall);
-#else
 		// Skip the CallSyscall where possible.
 		{
 			MIPSOpcode op(inst.constant);
@@ -235,7 +230,6 @@ void Arm64JitBackend::CompIR_System(IRInst inst) {
 				QuickCallFunction(SCRATCH2_64, &CallSyscallUnresolvedAtPC);
 			}
 		}
-#endif
 
 		WriteDebugProfilerStatus(IRProfilerStatus::IN_JIT);
 		LoadStaticRegisters();
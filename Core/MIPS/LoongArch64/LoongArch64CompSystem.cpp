@@ -177,11 +177,6 @@ void LoongArch64JitBackend::CompIR_System(IRInst inst) {
 		SaveStaticRegisters();
 
 		WriteDebugProfilerStatus(IRProfilerStatus::SYSCALL);
-#ifdef USE_PROFILER
-		// When profiling, we can't skip CallSyscall, since it times syscalls.
-		LI(R4, (int32_t)inst.constant);
-		QuickCallFunction(&CallSyscall, SCRATCH2);
-#else
 		// Skip the CallSyscall where possible.
 		{
 			MIPSOpcode op(inst.constant);
@@ -201,7 +196,6 @@ void LoongArch64JitBackend::CompIR_System(IRInst inst) {
 				QuickCallFunction(&CallSyscallUnresolvedAtPC, SCRATCH2);
 			}
 		}
-#endif
 		WriteDebugProfilerStatus(IRProfilerStatus::IN_JIT);
 		LoadStaticRegisters();
 		// This is always followed by an ExitToPC, where we check coreState.
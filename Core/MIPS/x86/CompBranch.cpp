@@ -676,10 +676,6 @@ void Jit::Comp_Syscall(MIPSOpcode op)
 		MOV(32, MIPSSTATE_VAR(pc), Imm32(GetCompilerPC() + 4));
 	}
 
-#ifdef USE_PROFILER
-	// When profiling, we can't skip CallSyscall, since it times syscalls.
-	ABI_CallFunctionC(&CallSyscall, op.encoding);
-#else
 	// Skip the CallSyscall where possible.
 	const HLEFunction *func = GetSyscallFunctionData(op, js.compilerPC);
 	if (func) {
@@ -692,7 +688,6 @@ void Jit::Comp_Syscall(MIPSOpcode op)
 	} else {
 		ABI_CallFunctionC(&CallSyscallUnresolvedAtPC, js.compilerPC);
 	}
-#endif
 
 	ApplyRoundingMode();
 	WriteSyscallExit();
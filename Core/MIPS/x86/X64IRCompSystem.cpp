@@ -204,10 +204,6 @@ void X64JitBackend::CompIR_System(IRInst inst) {
 		SaveStaticRegisters();
 
 		WriteDebugProfilerStatus(IRProfilerStatus::SYSCALL);
-#ifdef USE_PROFILER
-		// When profiling, we can't skip CallSyscall, since it times syscalls.
-		ABI_CallFunctionC((const u8 *)&CallSyscall, inst.constant);
-#else
 		// Skip the CallSyscall where possible.
 		{
 			MIPSOpcode op(inst.constant);
@@ -225,7 +221,6 @@ void X64JitBackend::CompIR_System(IRInst inst) {
 				ABI_CallFunctionC((const u8 *)&CallSyscallUnresolvedAtPC, 0);
 			}
 		}
-#endif
 
 		WriteDebugProfilerStatus(IRProfilerStatus::IN_JIT);
 		LoadStaticRegisters();
@@ -44,6 +44,7 @@
 #include "Core/MemMap.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/Debugger/LineInfo.h"
+#include "Core/Debugger/MemAccessStats.h"
 #include "Core/Debugger/SymbolMap.h"
 
 // Stack walking stuff
@@ -114,6 +115,10 @@ static bool DisassembleNativeAt(const uint8_t *codePtr, int instructionSize, std
 }
 
 bool HandleFault(uintptr_t hostAddress, void *ctx) {
+	// Not a crash, just the first write to a page since rewind started tracking writes.  Can happen on any thread.
+	if (DirtyPages_HandleFault(hostAddress))
+		return true;
+
 	if (inCrashHandler)
 		return false;
 	inCrashHandler = true;
@@ -154,6 +159,8 @@ bool HandleFault(uintptr_t hostAddress, void *ctx) {
 	// OK, a guest executable did a bad access. Let's handle it.
 
 	uint32_t guestAddress = invalidHostAddress ? 0xFFFFFFFFUL : (uint32_t)(hostAddress - baseAddress);
+	if (MemAccessStats::g_active)
+		MemAccessStats::Record(MemAccessStats::Kind::FAULT, currentMIPS->pc, guestAddress);
 
 	// TODO: Share the struct between the various analyzers, that will allow us to share most of
 	// the implementations here.
@@ -22,10 +22,13 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 
 #include "Common/CommonTypes.h"
+#include "Common/MachineContext.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
 
@@ -87,6 +90,16 @@ u32 g_PSPModel;
 
 static MemMapSetupFlags g_setupFlags;
 
+// Enough pages for the largest RAM Init() allows.
+static constexpr u32 DIRTY_MAX_PAGES = 0x06000000 / 4096;
+static std::atomic<bool> g_dirtyTracking;
+static std::atomic<u32> g_dirtyGeneration;
+static u32 g_dirtyPageShift = 12;
+// Set from the fault handler, so it's only ever touched with atomics.
+static std::atomic<u32> g_dirtyBits[DIRTY_MAX_PAGES / 32];
+static const std::vector<u32> *g_stateDirtyFilter;
+static size_t g_lastStateRAMOffset;
+
 
 // We don't declare the IO region in here since its handled by other means.
 static MemoryView views[] = {
@@ -286,6 +299,9 @@ bool MemoryMap_Setup(MemMapSetupFlags flags) {
 }
 
 void MemoryMap_Shutdown() {
+	// The views are going away, and new ones start out writable.
+	DirtyPages_Stop();
+
 	size_t position = 0;
 	size_t last_position = 0;
 	const MemMapSetupFlags flags = g_setupFlags;
@@ -351,6 +367,174 @@ void Reinit() {
 	Core_NotifyLifecycle(CoreLifecycle::MEMORY_REINITED);
 }
 
+// Calls func(hostPtr, offset, size) for each view of RAM, mirrors included.  Offsets are from the start of RAM.
+template <typename F>
+static void ForEachRAMView(F func) {
+	for (const MemoryView &view : views) {
+		if (!(view.flags & (MV_IS_PRIMARY_RAM | MV_IS_EXTRA1_RAM | MV_IS_EXTRA2_RAM)) || view.size == 0 || !*view.out_ptr)
+			continue;
+		func(*view.out_ptr, (view.virtual_address & 0x3FFFFFFF) - PSP_GetKernelMemoryBase(), view.size);
+	}
+}
+
+static bool ProtectRAM(u32 offset, u32 size, bool writable) {
+	bool success = true;
+	ForEachRAMView([&](u8 *ptr, u32 viewOffset, u32 viewSize) {
+		u32 start = std::max(offset, viewOffset);
+		u32 end = std::min(offset + size, viewOffset + viewSize);
+		if (start < end)
+			success = ProtectMemoryPages(ptr + (start - viewOffset), end - start, writable ? MEM_PROT_READ | MEM_PROT_WRITE : MEM_PROT_READ) && success;
+	});
+	return success;
+}
+
+static void MarkDirty(u32 offset, u32 size) {
+	u32 first = offset >> g_dirtyPageShift;
+	u32 last = std::min((offset + size - 1) >> g_dirtyPageShift, DIRTY_MAX_PAGES - 1);
+	for (u32 page = first; page <= last; ++page)
+		g_dirtyBits[page >> 5].fetch_or(1U << (page & 31));
+}
+
+bool DirtyPages_Start() {
+	// On Apple, the Mach exception port only covers the thread that installed it, and the GPU
+	// and file threads write RAM too.
+#if defined(MACHINE_CONTEXT_SUPPORTED) && !defined(__APPLE__)
+	if (!base)
+		return false;
+
+	u32 pageSize = std::max(GetMemoryProtectPageSize(), 4096);
+	g_dirtyPageShift = 0;
+	while ((1U << g_dirtyPageShift) < pageSize)
+		g_dirtyPageShift++;
+
+	// Clear before protecting.  A page written in between isn't marked, but that's before the caller saves.
+	for (auto &bits : g_dirtyBits)
+		bits.store(0);
+	g_dirtyTracking = true;
+	g_dirtyGeneration++;
+	if (!ProtectRAM(0, g_MemorySize, false)) {
+		WARN_LOG(Log::MemMap, "Couldn't write protect RAM, dirty pages won't be tracked");
+		DirtyPages_Stop();
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void DirtyPages_Stop() {
+	if (!g_dirtyTracking)
+		return;
+	// Unprotect first, the fault handler still needs to deal with writes until then.
+	ProtectRAM(0, g_MemorySize, true);
+	g_dirtyTracking = false;
+	g_dirtyGeneration++;
+}
+
+void DirtyPages_MarkAll() {
+	if (!g_dirtyTracking)
+		return;
+	MarkDirty(0, g_MemorySize);
+	ProtectRAM(0, g_MemorySize, true);
+}
+
+u32 DirtyPages_Generation() {
+	return g_dirtyGeneration;
+}
+
+bool DirtyPages_IsTracking(u32 generation) {
+	return g_dirtyTracking && g_dirtyGeneration == generation;
+}
+
+bool DirtyPages_HandleFault(uintptr_t hostAddress) {
+	if (!g_dirtyTracking.load())
+		return false;
+
+	u32 offset = 0;
+	bool found = false;
+	ForEachRAMView([&](u8 *ptr, u32 viewOffset, u32 viewSize) {
+		if (!found && hostAddress >= (uintptr_t)ptr && hostAddress < (uintptr_t)ptr + viewSize) {
+			offset = viewOffset + (u32)(hostAddress - (uintptr_t)ptr);
+			found = true;
+		}
+	});
+	if (!found)
+		return false;
+
+	// Mark before unprotecting, so a snapshot can't see the write without the mark.
+	const u32 pageSize = 1U << g_dirtyPageShift;
+	offset &= ~(pageSize - 1);
+	MarkDirty(offset, pageSize);
+	return ProtectRAM(offset, pageSize, true);
+}
+
+void DirtyPages_PrepareHostWrite(const void *ptr, size_t size) {
+	if (!g_dirtyTracking || size == 0)
+		return;
+
+	const uintptr_t start = (uintptr_t)ptr;
+	const uintptr_t end = start + size;
+	const u32 pageMask = (1U << g_dirtyPageShift) - 1;
+	ForEachRAMView([&](u8 *viewPtr, u32 viewOffset, u32 viewSize) {
+		uintptr_t clipStart = std::max(start, (uintptr_t)viewPtr);
+		uintptr_t clipEnd = std::min(end, (uintptr_t)viewPtr + viewSize);
+		if (clipStart >= clipEnd)
+			return;
+		u32 first = (viewOffset + (u32)(clipStart - (uintptr_t)viewPtr)) & ~pageMask;
+		u32 last = (viewOffset + (u32)(clipEnd - (uintptr_t)viewPtr) + pageMask) & ~pageMask;
+		MarkDirty(first, last - first);
+		ProtectRAM(first, last - first, true);
+	});
+}
+
+void DirtyPages_Snapshot(std::vector<u32> &dirty) {
+	const u32 pages = std::min((g_MemorySize + (1U << g_dirtyPageShift) - 1) >> g_dirtyPageShift, DIRTY_MAX_PAGES);
+	dirty.resize((pages + 31) / 32);
+	for (size_t i = 0; i < dirty.size(); ++i)
+		dirty[i] = g_dirtyBits[i].load();
+}
+
+u32 DirtyPages_PageSize() {
+	return 1U << g_dirtyPageShift;
+}
+
+bool DirtyPages_IsRangeDirty(const std::vector<u32> &dirty, u32 offset, u32 size) {
+	if (size == 0)
+		return false;
+	u32 first = offset >> g_dirtyPageShift;
+	u32 last = (offset + size - 1) >> g_dirtyPageShift;
+	for (u32 page = first; page <= last; ++page) {
+		// Past the snapshot counts as dirty, to be safe.
+		if ((page >> 5) >= dirty.size() || (dirty[page >> 5] & (1U << (page & 31))) != 0)
+			return true;
+	}
+	return false;
+}
+
+void SetStateDirtyFilter(const std::vector<u32> *dirty) {
+	g_stateDirtyFilter = dirty;
+}
+
+size_t LastStateRAMOffset() {
+	return g_lastStateRAMOffset;
+}
+
+// Saves the pages marked dirty, and skips over the rest, see SetStateDirtyFilter().
+static void DoDirtyMemoryVoid(PointerWrap &p, uint32_t start, uint32_t size, const std::vector<u32> &dirty) {
+	const uint8_t *d = GetPointerUnchecked(start);
+	p.EnsureWrite(size);
+	uint8_t *&storage = *p.ptr;
+
+	const u32 pageSize = DirtyPages_PageSize();
+	for (u32 offset = 0; offset < size; offset += pageSize) {
+		u32 runSize = std::min(pageSize, size - offset);
+		if (DirtyPages_IsRangeDirty(dirty, offset, runSize))
+			memcpy(storage + offset, d + offset, runSize);
+	}
+	storage += size;
+}
+
 static void DoMemoryVoid(PointerWrap &p, uint32_t start, uint32_t size) {
 	uint8_t *d = GetPointerWriteOrException(start);
 	uint8_t *&storage = *p.ptr;
@@ -364,6 +548,8 @@ static void DoMemoryVoid(PointerWrap &p, uint32_t start, uint32_t size) {
 		ParallelMemcpy(&g_threadManager, d, storage, size);
 		break;
 	case PointerWrap::MODE_WRITE:
+		// May move storage, but it's a reference so it stays current.
+		p.EnsureWrite(size);
 		ParallelMemcpy(&g_threadManager, storage, d, size);
 		break;
 	case PointerWrap::MODE_MEASURE:
@@ -413,7 +599,15 @@ void DoState(PointerWrap &p) {
 		}
 	}
 
-	DoMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize);
+	g_lastStateRAMOffset = p.Offset();
+	if (p.mode == PointerWrap::MODE_WRITE && g_stateDirtyFilter) {
+		DoDirtyMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize, *g_stateDirtyFilter);
+	} else {
+		// Loading writes every page, so don't take a fault for each one.
+		if (p.mode == PointerWrap::MODE_READ)
+			DirtyPages_MarkAll();
+		DoMemoryVoid(p, PSP_GetKernelMemoryBase(), g_MemorySize);
+	}
 	p.DoMarker("RAM");
 
 	DoMemoryVoid(p, PSP_GetVidMemBase(), VRAM_SIZE);
@@ -21,6 +21,7 @@
 
 #include <cstring>
 #include <cstdint>
+#include <vector>
 #ifndef offsetof
 #include <stddef.h>
 #endif
@@ -136,6 +137,31 @@ void DoState(PointerWrap &p);
 // False when shutdown has already been called.
 bool IsActive();
 
+// Tracks which RAM pages get written, by write protecting RAM and marking pages as the fault
+// handler sees writes to them. Rewind uses this to only save and compare what changed since
+// its base state. Returns false if unsupported, then nothing is tracked.
+bool DirtyPages_Start();
+void DirtyPages_Stop();
+// Marks everything dirty, e.g. before loading a state, so it doesn't fault page by page.
+void DirtyPages_MarkAll();
+// Changes on every start and stop, so a caller can tell tracking wasn't interrupted.
+u32 DirtyPages_Generation();
+bool DirtyPages_IsTracking(u32 generation);
+// Called by the fault handler.  Returns true if it was a write to a tracked page, which may retry.
+bool DirtyPages_HandleFault(uintptr_t hostAddress);
+// For writes the fault handler can't see, like the OS reading a file or socket into RAM.
+void DirtyPages_PrepareHostWrite(const void *ptr, size_t size);
+// One bit per page, pages are DirtyPages_PageSize() bytes from the start of RAM.
+void DirtyPages_Snapshot(std::vector<u32> &dirty);
+u32 DirtyPages_PageSize();
+bool DirtyPages_IsRangeDirty(const std::vector<u32> &dirty, u32 offset, u32 size);
+
+// While set, DoState() only saves the RAM pages marked in dirty, and skips over the rest,
+// leaving whatever the buffer held there.  Only for savers that take those pages from elsewhere.
+void SetStateDirtyFilter(const std::vector<u32> *dirty);
+// Where RAM started in the last state saved or loaded.
+size_t LastStateRAMOffset();
+
 // used by JIT to read instructions. Does not resolve replacements.
 Opcode Read_Opcode_JIT(const u32 _Address);
 // used by JIT. Reads in the "Locked cache" mode
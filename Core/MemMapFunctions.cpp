@@ -19,6 +19,7 @@
 #include "Common/LogReporting.h"
 
 #include "Core/Core.h"
+#include "Core/Debugger/MemAccessStats.h"
 #include "Core/MemMap.h"
 #include "Core/Config.h"
 #include "Core/ConfigValues.h"
@@ -28,6 +29,8 @@
 namespace Memory {
 
 u8 *GetPointerWriteOrException(const u32 address) {
+	if (MemAccessStats::g_active)
+		MemAccessStats::Record(MemAccessStats::Kind::SLOW_WRITE, currentMIPS->pc, address);
 	if ((address & 0x3E000000) == 0x08000000 || // RAM
 		(address & 0xBF800000) == 0x04000000 || // VRAM
 		(address & 0x3FFFC000) == 0x00010000 || // Scratchpad
@@ -41,6 +44,8 @@ u8 *GetPointerWriteOrException(const u32 address) {
 }
 
 const u8 *GetPointerOrException(const u32 address) {
+	if (MemAccessStats::g_active)
+		MemAccessStats::Record(MemAccessStats::Kind::SLOW_READ, currentMIPS->pc, address);
 	if ((address & 0x3E000000) == 0x08000000 || // RAM
 		(address & 0xBF800000) == 0x04000000 || // VRAM
 		(address & 0x3FFFC000) == 0x00010000 || // Scratchpad
@@ -87,6 +92,8 @@ const u8 *GetPointerRangeOrException(const u32 address, const u32 size) {
 
 template <typename T>
 inline void ReadMemoryOrException(T &var, const u32 address) {
+	if (MemAccessStats::g_active)
+		MemAccessStats::Record(MemAccessStats::Kind::SLOW_READ, currentMIPS->pc, address);
 	if ((address & 0x3E000000) == 0x08000000 || // RAM
 		(address & 0xBF800000) == 0x04000000 || // VRAM
 		(address & 0x3FFFC000) == 0x00010000 || // Scratchpad
@@ -100,6 +107,8 @@ inline void ReadMemoryOrException(T &var, const u32 address) {
 
 template <typename T>
 inline void WriteMemoryOrException(u32 address, const T data) {
+	if (MemAccessStats::g_active)
+		MemAccessStats::Record(MemAccessStats::Kind::SLOW_WRITE, currentMIPS->pc, address);
 	if ((address & 0x3E000000) == 0x08000000 || // RAM
 		(address & 0xBF800000) == 0x04000000 || // VRAM
 		(address & 0x3FFFC000) == 0x00010000 || // Scratchpad
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cstring>
+
+#include <zstd.h>
+
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Text/I18n.h"
 #include "Common/StringUtils.h"
@@ -5,9 +10,23 @@
 #include "Core/SaveStateRewind.h"
 #include "Core/Core.h"
 #include "Core/Config.h"
+#include "Core/MemMap.h"
 
 namespace SaveState {
 
+// Same as a guest page, most writes between snapshots are to a few of these.
+static const size_t DELTA_PAGE_SIZE = 4096;
+// Fast, the point is mostly to squeeze the zero and repeated bytes out.
+static const int DELTA_COMPRESSION_LEVEL = 1;
+
+// Followed by a bitmap with a bit set for each page that differs from the base, then those pages.
+struct DeltaHeader {
+	u32 stateSize;
+	u32 changedPages;
+	// 0 if the pages are stored uncompressed.
+	u32 compressedSize;
+};
+
 CChunkFileReader::Error StateRingbuffer::Save() {
 	rewindLastTime_ = time_now_d();
 
@@ -23,20 +42,28 @@ CChunkFileReader::Error StateRingbuffer::Save() {
 		++first_;
 
 	std::vector<u8> *compressBuffer = &buffer_;
+	const std::vector<u8> *cleanPages = nullptr;
 	CChunkFileReader::Error err;
 
 	if (base_ == -1 || ++baseUsage_ > BASE_USAGE_INTERVAL)
 	{
 		base_ = (base_ + 1) % ARRAY_SIZE(bases_);
 		baseUsage_ = 0;
+		// Restarting clears the marks, so from here on only pages written after this save count.
+		baseTracked_ = Memory::DirtyPages_Start();
+		baseTrackingGeneration_ = Memory::DirtyPages_Generation();
 		err = SaveToRam(bases_[base_]);
+		baseRAMOffset_ = Memory::LastStateRAMOffset();
 		// Let's not bother savestating twice.
 		compressBuffer = &bases_[base_];
-	} else
-		err = SaveToRam(buffer_);
+	} else {
+		err = SaveTracked(buffer_);
+		if (!cleanPages_.empty())
+			cleanPages = &cleanPages_;
+	}
 
 	if (err == CChunkFileReader::ERROR_NONE) {
-		ScheduleCompress(&states_[n].stateBuffer, compressBuffer, &bases_[base_]);
+		ScheduleCompress(&states_[n].stateBuffer, compressBuffer, &bases_[base_], cleanPages);
 		states_[n].savedTime = time_now_d();
 	} else {
 		states_[n].clear();
@@ -46,6 +73,29 @@ CChunkFileReader::Error StateRingbuffer::Save() {
 	return err;
 }
 
+// Saves only the RAM pages written since the base was saved, and fills in cleanPages_ for the rest.
+CChunkFileReader::Error StateRingbuffer::SaveTracked(StateBuffer &buffer) {
+	cleanPages_.clear();
+	if (!baseTracked_ || !Memory::DirtyPages_IsTracking(baseTrackingGeneration_))
+		return SaveToRam(buffer);
+
+	Memory::DirtyPages_Snapshot(dirtyPages_);
+	Memory::SetStateDirtyFilter(&dirtyPages_);
+	CChunkFileReader::Error err = SaveToRam(buffer);
+	Memory::SetStateDirtyFilter(nullptr);
+	if (err != CChunkFileReader::ERROR_NONE)
+		return err;
+
+	const size_t ramOffset = Memory::LastStateRAMOffset();
+	if (ramOffset != baseRAMOffset_) {
+		// Something before RAM changed size, so the skipped pages don't line up with the base.
+		return SaveToRam(buffer);
+	}
+
+	MarkCleanPages(cleanPages_, buffer, ramOffset, dirtyPages_);
+	return err;
+}
+
 CChunkFileReader::Error StateRingbuffer::Restore(std::string *errorString, std::string *metadata) {
 	std::lock_guard<std::mutex> guard(lock_);
 
@@ -60,7 +110,8 @@ CChunkFileReader::Error StateRingbuffer::Restore(std::string *errorString, std::
 	auto pa = GetI18NCategory(I18NCat::PAUSE);
 
 	static std::vector<u8> buffer;
-	LockedDecompress(buffer, states_[n].stateBuffer, bases_[baseMapping_[n]]);
+	if (!DecompressDelta(buffer, states_[n].stateBuffer, bases_[baseMapping_[n]]))
+		return CChunkFileReader::ERROR_BAD_FILE;
 	CChunkFileReader::Error error = LoadFromRam(buffer, errorString);
 	*metadata = pa->T("Rewind");
 
@@ -75,63 +126,140 @@ CChunkFileReader::Error StateRingbuffer::Restore(std::string *errorString, std::
 	return error;
 }
 
-void StateRingbuffer::ScheduleCompress(std::vector<u8> *result, const std::vector<u8> *state, const std::vector<u8> *base) {
+void StateRingbuffer::ScheduleCompress(std::vector<u8> *result, const std::vector<u8> *state, const std::vector<u8> *base, const std::vector<u8> *cleanPages) {
 	if (compressThread_.joinable())
 		compressThread_.join();
 	compressThread_ = std::thread([=] {
 		SetCurrentThreadName("SaveStateCompress");
 
 		// Should do no I/O, so no JNI thread context needed.
-		Compress(*result, *state, *base);
+		Compress(*result, *state, *base, cleanPages);
 	});
 }
 
-void StateRingbuffer::Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base) {
+void StateRingbuffer::Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base, const std::vector<u8> *cleanPages) {
 	std::lock_guard<std::mutex> guard(lock_);
 	// Bail if we were cleared before locking.
 	if (first_ == 0 && next_ == 0)
 		return;
 
 	double start_time = time_now_d();
-	result.clear();
-	result.reserve(512 * 1024);
-	for (size_t i = 0; i < state.size(); i += BLOCK_SIZE)
-	{
-		int blockSize = std::min(BLOCK_SIZE, (int)(state.size() - i));
-		if (i + blockSize > base.size() || memcmp(&state[i], &base[i], blockSize) != 0) {
-			result.push_back(1);
-			result.insert(result.end(), state.begin() + i, state.begin() + i + blockSize);
+	CompressDelta(result, state, base, cleanPages);
+
+	double taken_s = time_now_d() - start_time;
+	DEBUG_LOG(Log::SaveState, "Rewind: Compressed save from %d bytes to %d in %0.2f ms.", (int)state.size(), (int)result.size(), taken_s * 1000.0);
+}
+
+void StateRingbuffer::CompressDelta(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base, const std::vector<u8> *cleanPages) {
+	const size_t pages = (state.size() + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE;
+	const size_t bitmapSize = (pages + 7) / 8;
+
+	DeltaHeader header{};
+	header.stateSize = (u32)state.size();
+
+	std::vector<u8> bitmap(bitmapSize);
+	std::vector<u8> changed;
+	for (size_t i = 0; i < pages; ++i) {
+		const size_t offset = i * DELTA_PAGE_SIZE;
+		const size_t size = std::min(DELTA_PAGE_SIZE, state.size() - offset);
+		const bool inBase = offset + size <= base.size();
+		// The base itself is the first state against it, and pages tracked as unwritten don't need comparing.
+		if (inBase && (&state == &base || (cleanPages && i < cleanPages->size() && (*cleanPages)[i])))
+			continue;
+		if (!inBase || memcmp(&state[offset], &base[offset], size) != 0) {
+			bitmap[i >> 3] |= 1 << (i & 7);
+			changed.insert(changed.end(), state.begin() + offset, state.begin() + offset + size);
+			header.changedPages++;
+		}
+	}
+
+	// Build a new buffer, so the ring buffer doesn't hold onto the capacity of a large delta.
+	std::vector<u8> out;
+	out.resize(sizeof(header) + bitmapSize + ZSTD_compressBound(changed.size()));
+	memcpy(&out[sizeof(header)], bitmap.data(), bitmapSize);
+	u8 *data = &out[sizeof(header) + bitmapSize];
+
+	size_t dataSize = 0;
+	if (!changed.empty()) {
+		size_t compressedSize = ZSTD_compress(data, out.size() - sizeof(header) - bitmapSize, changed.data(), changed.size(), DELTA_COMPRESSION_LEVEL);
+		if (!ZSTD_isError(compressedSize) && compressedSize < changed.size()) {
+			header.compressedSize = (u32)compressedSize;
+			dataSize = compressedSize;
 		} else {
-			result.push_back(0);
+			memcpy(data, changed.data(), changed.size());
+			dataSize = changed.size();
 		}
 	}
 
-	double taken_s = time_now_d() - start_time;
-	DEBUG_LOG(Log::SaveState, "Rewind: Compressed save from %d bytes to %d in %0.2f ms.", (int)state.size(), (int)result.size(), taken_s * 1000.0);
+	memcpy(&out[0], &header, sizeof(header));
+	out.resize(sizeof(header) + bitmapSize + dataSize);
+	out.shrink_to_fit();
+	result.swap(out);
 }
 
-void StateRingbuffer::LockedDecompress(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base) {
-	result.clear();
-	result.reserve(base.size());
-	auto basePos = base.begin();
-	for (size_t i = 0; i < compressed.size(); ) {
-		if (compressed[i] == 0) {
-			++i;
-			int blockSize = std::min(BLOCK_SIZE, (int)(base.size() - result.size()));
-			result.insert(result.end(), basePos, basePos + blockSize);
-			basePos += blockSize;
+void StateRingbuffer::MarkCleanPages(std::vector<u8> &cleanPages, std::vector<u8> &state, size_t ramOffset, const std::vector<u32> &dirty) {
+	const size_t ramEnd = ramOffset + Memory::g_MemorySize;
+	const u8 *ram = Memory::GetPointerUnchecked(PSP_GetKernelMemoryBase());
+	const size_t pages = (state.size() + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE;
+	cleanPages.clear();
+	cleanPages.resize(pages);
+	for (size_t i = 0; i < pages; ++i) {
+		const size_t offset = i * DELTA_PAGE_SIZE;
+		const size_t start = std::max(offset, ramOffset);
+		const size_t end = std::min(offset + DELTA_PAGE_SIZE, ramEnd);
+		if (start >= end)
+			continue;
+		if (offset >= ramOffset && offset + DELTA_PAGE_SIZE <= ramEnd && !Memory::DirtyPages_IsRangeDirty(dirty, (u32)(offset - ramOffset), (u32)DELTA_PAGE_SIZE)) {
+			cleanPages[i] = 1;
+		} else {
+			// RAM isn't at a page boundary in the state, so this page may also cover a skipped RAM page,
+			// holding whatever the buffer had before.  Those are few, just copy them again.
+			memcpy(&state[start], ram + (start - ramOffset), end - start);
+		}
+	}
+}
+
+bool StateRingbuffer::DecompressDelta(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base) {
+	DeltaHeader header;
+	if (compressed.size() < sizeof(header))
+		return false;
+	memcpy(&header, compressed.data(), sizeof(header));
+
+	const size_t pages = (header.stateSize + DELTA_PAGE_SIZE - 1) / DELTA_PAGE_SIZE;
+	const size_t bitmapSize = (pages + 7) / 8;
+	if (compressed.size() < sizeof(header) + bitmapSize)
+		return false;
+	const u8 *bitmap = compressed.data() + sizeof(header);
+	const u8 *data = bitmap + bitmapSize;
+	size_t dataSize = compressed.size() - sizeof(header) - bitmapSize;
+
+	std::vector<u8> changed;
+	if (header.compressedSize != 0) {
+		changed.resize((size_t)header.changedPages * DELTA_PAGE_SIZE);
+		size_t size = ZSTD_decompress(changed.data(), changed.size(), data, dataSize);
+		if (ZSTD_isError(size))
+			return false;
+		data = changed.data();
+		dataSize = size;
+	}
+
+	result.resize(header.stateSize);
+	size_t dataPos = 0;
+	for (size_t i = 0; i < pages; ++i) {
+		const size_t offset = i * DELTA_PAGE_SIZE;
+		const size_t size = std::min(DELTA_PAGE_SIZE, (size_t)header.stateSize - offset);
+		if (bitmap[i >> 3] & (1 << (i & 7))) {
+			if (dataPos + size > dataSize)
+				return false;
+			memcpy(&result[offset], data + dataPos, size);
+			dataPos += size;
 		} else {
-			++i;
-			int blockSize = std::min(BLOCK_SIZE, (int)(compressed.size() - i));
-			result.insert(result.end(), compressed.begin() + i, compressed.begin() + i + blockSize);
-			i += blockSize;
-			// This check is to avoid advancing basePos out of range, which MSVC catches.
-			// When this happens, we're at the end of decoding anyway.
-			if (base.end() - basePos >= blockSize) {
-				basePos += blockSize;
-			}
+			if (offset + size > base.size())
+				return false;
+			memcpy(&result[offset], &base[offset], size);
 		}
 	}
+	return true;
 }
 
 void StateRingbuffer::Clear() {
@@ -151,6 +279,10 @@ void StateRingbuffer::Clear() {
 		s.clear();
 	}
 	buffer_.clear();
+	cleanPages_.clear();
+	if (baseTracked_)
+		Memory::DirtyPages_Stop();
+	baseTracked_ = false;
 	base_ = -1;
 	baseUsage_ = 0;
 	rewindLastTime_ = time_now_d();
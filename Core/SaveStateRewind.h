@@ -11,8 +11,10 @@ namespace SaveState {
 // This ring buffer of states is for rewind save states, which are kept in RAM.
 // Save states are compressed against one of two reference saves (bases_), and the reference
 // is switched to a fresh save every N saves, where N is BASE_USAGE_INTERVAL.
-// The compression is a simple block based scheme where 0 means to copy a block from the base,
-// and 1 means that the following bytes are the next block. See Compress/LockedDecompress.
+// Only the pages that differ from the base are kept, zstd compressed, along with a bitmap of which
+// pages those are. See CompressDelta/DecompressDelta.
+// Where Memory can track written pages, RAM the game hasn't written since the base was saved
+// isn't even copied out or compared, see Memory::DirtyPages_Start().
 class StateRingbuffer {
 public:
 	StateRingbuffer() {
@@ -29,11 +31,19 @@ class StateRingbuffer {
 
 	CChunkFileReader::Error Save();
 	CChunkFileReader::Error Restore(std::string *errorString, std::string *metadata);
-	void ScheduleCompress(std::vector<u8> *result, const std::vector<u8> *state, const std::vector<u8> *base);
-	void Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base);
-	void LockedDecompress(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base);
+	void ScheduleCompress(std::vector<u8> *result, const std::vector<u8> *state, const std::vector<u8> *base, const std::vector<u8> *cleanPages);
+	void Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base, const std::vector<u8> *cleanPages);
 	void Clear();
 
+	// These don't touch the ring buffer, so they can be tested and timed on their own.
+	// cleanPages, if set, has a byte per DELTA_PAGE_SIZE page of state.  Non-zero means the page is known
+	// to match base, and state may hold anything there.
+	static void CompressDelta(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base, const std::vector<u8> *cleanPages = nullptr);
+	static bool DecompressDelta(std::vector<u8> &result, const std::vector<u8> &compressed, const std::vector<u8> &base);
+	// For a state saved with Memory::SetStateDirtyFilter(&dirty), flags the pages CompressDelta() can take
+	// from the base, and fills in the skipped RAM in the rest.  ramOffset is Memory::LastStateRAMOffset().
+	static void MarkCleanPages(std::vector<u8> &cleanPages, std::vector<u8> &state, size_t ramOffset, const std::vector<u32> &dirty);
+
 	bool Empty() const {
 		return next_ == first_;
 	}
@@ -44,13 +54,14 @@ class StateRingbuffer {
 	double NextStateTimestamp() const;
 
 private:
-	const int BLOCK_SIZE = 8192;
 	const int REWIND_NUM_STATES = 20;
 	// TODO: Instead, based on size of compressed state?
 	const int BASE_USAGE_INTERVAL = 15;
 
 	typedef std::vector<u8> StateBuffer;
 
+	CChunkFileReader::Error SaveTracked(StateBuffer &buffer);
+
 	struct RewindState {
 		StateBuffer stateBuffer;
 		double savedTime;
@@ -73,6 +84,14 @@ class StateRingbuffer {
 	int base_ = -1;
 	int baseUsage_ = 0;
 
+	// Set while Memory is tracking RAM writes since bases_[base_] was saved.
+	bool baseTracked_ = false;
+	u32 baseTrackingGeneration_ = 0;
+	size_t baseRAMOffset_ = 0;
+	std::vector<u32> dirtyPages_;
+	// See CompressDelta(), for buffer_.
+	std::vector<u8> cleanPages_;
+
 	double rewindLastTime_ = 0.0f;
 };
 
@@ -42,6 +42,8 @@
 #include "Common/File/DirListing.h"
 #include "Common/File/AndroidContentURI.h"
 #include "Common/Log/LogManager.h"
+#include "Common/Profiler/FrameTrace.h"
+#include "Common/Profiler/Profiler.h"
 #include "Common/TimeUtil.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/GPU/GraphicsContext.h"
@@ -50,6 +52,8 @@
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "Core/Debugger/FunctionProfiler.h"
+#include "Core/Debugger/MemAccessStats.h"
 #include "Core/Debugger/LineInfo.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/System.h"
@@ -595,6 +599,8 @@ void CPU_Shutdown(bool success) {
 	// Core_LockAgainstShutdown(); it's recursive, so the nested acquire in Memory::Shutdown() is fine.
 	CoreShutdownLock coreLock = Core_LockAgainstShutdown();
 
+	// Nothing would handle the faults anymore.
+	Memory::DirtyPages_Stop();
 	UninstallExceptionHandler();
 
 	GPURecord::Replay_Unload();
@@ -836,6 +842,12 @@ void PSP_Shutdown(bool success) {
 	if (g_Config.bFuncHashMap) {
 		MIPSAnalyst::StoreHashMap();
 	}
+	// Needs the analyzed functions, so before the CPU shuts down.
+	FunctionProfiler::WriteReportIfRequested();
+	// Also before the CPU shuts down, for the symbol names.
+	MemAccessStats::WriteReportIfRequested();
+	FrameTrace::WriteReportIfRequested();
+	Profiler_WriteTraceIfRequested();
 
 	if (g_bootState == BootState::Booting) {
 		// This should only happen during failures.
@@ -15,8 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cstring>
 
+#include "Common/BitScan.h"
 #include "Common/Log.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
@@ -25,7 +27,26 @@
 #include "Core/Util/BlockAllocator.h"
 #include "Core/Reporting.h"
 
-// Slow freaking thing but works (eventually) :)
+// The blocks live in a linked list in address order, indexed by address and by free size class.
+
+// Four classes per power of two, so a class doesn't fill up with leftovers too small for most requests in it.
+static int FreeSizeClass(u32 size) {
+	if (size < 4)
+		return size;
+	int log2 = 31 - (int)clz32_nonzero(size);
+	return log2 * 4 + ((size >> (log2 - 2)) & 3);
+}
+
+// How far into a free block an allocation from the bottom has to start to be aligned.
+static u32 BottomOffset(u32 start, u32 grain) {
+	u32 offset = start % grain;
+	return offset != 0 ? grain - offset : 0;
+}
+
+// How much of a free block an allocation from the top has to leave above itself to be aligned.
+static u32 TopOffset(u32 start, u32 blockSize, u32 size, u32 grain) {
+	return (start + blockSize - size) % grain;
+}
 
 BlockAllocator::~BlockAllocator()
 {
@@ -39,6 +60,7 @@ void BlockAllocator::Init(u32 rangeStart, u32 rangeSize, bool suballoc) {
 	//Initial block, covering everything
 	top_ = new Block(rangeStart_, rangeSize_, false, NULL, NULL);
 	bottom_ = top_;
+	IndexBlock(top_);
 	suballoc_ = suballoc;
 }
 
@@ -51,6 +73,66 @@ void BlockAllocator::Shutdown()
 		bottom_ = next;
 	}
 	top_ = NULL;
+
+	blocks_.clear();
+	for (auto &freeBlocks : freeBlocks_)
+		freeBlocks.clear();
+	freeBytes_ = 0;
+}
+
+void BlockAllocator::IndexBlock(Block *b) {
+	// Only bad save states have these, and they can't be found or allocated anyway.
+	if (b->size == 0)
+		return;
+	blocks_[b->start] = b;
+	if (!b->taken) {
+		freeBlocks_[FreeSizeClass(b->size)][b->start] = b;
+		freeBytes_ += b->size;
+	}
+}
+
+void BlockAllocator::UnindexBlock(Block *b) {
+	if (b->size == 0)
+		return;
+	blocks_.erase(b->start);
+	if (!b->taken) {
+		freeBlocks_[FreeSizeClass(b->size)].erase(b->start);
+		freeBytes_ -= b->size;
+	}
+}
+
+// Same as walking up the list for the first free block that fits, but only looks at big enough size classes.
+BlockAllocator::Block *BlockAllocator::FindFreeFromBottom(u32 size, u32 grain) {
+	Block *best = nullptr;
+	for (int c = FreeSizeClass(size); c < FREE_SIZE_CLASSES; ++c) {
+		for (const auto &iter : freeBlocks_[c]) {
+			Block *b = iter.second;
+			if (best && b->start >= best->start)
+				break;
+			if (b->size >= BottomOffset(b->start, grain) + size) {
+				best = b;
+				break;
+			}
+		}
+	}
+	return best;
+}
+
+// Same as walking down the list for the last free block that fits.
+BlockAllocator::Block *BlockAllocator::FindFreeFromTop(u32 size, u32 grain) {
+	Block *best = nullptr;
+	for (int c = FreeSizeClass(size); c < FREE_SIZE_CLASSES; ++c) {
+		for (auto iter = freeBlocks_[c].rbegin(); iter != freeBlocks_[c].rend(); ++iter) {
+			Block *b = iter->second;
+			if (best && b->start <= best->start)
+				break;
+			if (b->size >= TopOffset(b->start, b->size, size, grain) + size) {
+				best = b;
+				break;
+			}
+		}
+	}
+	return best;
 }
 
 u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop, const char *tag)
@@ -70,67 +152,31 @@ u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromT
 	// upalign size to grain
 	size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
 
-	if (!fromTop)
-	{
-		//Allocate from bottom of mem
-		for (Block *bp = bottom_; bp != NULL; bp = bp->next)
-		{
-			Block &b = *bp;
-			u32 offset = b.start % grain;
-			if (offset != 0)
-				offset = grain - offset;
+	Block *bp = fromTop ? FindFreeFromTop(size, grain) : FindFreeFromBottom(size, grain);
+	if (bp) {
+		Block &b = *bp;
+		UnindexBlock(&b);
+		if (!fromTop) {
+			// Allocate from bottom of mem.
+			u32 offset = BottomOffset(b.start, grain);
 			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeAfter(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-			}
-		}
-	}
-	else
-	{
-		// Allocate from top of mem.
-		for (Block *bp = top_; bp != NULL; bp = bp->prev)
-		{
-			Block &b = *bp;
-			u32 offset = (b.start + b.size - size) % grain;
+			if (b.size != needed)
+				InsertFreeAfter(&b, b.size - needed);
+			if (offset >= grain_)
+				InsertFreeBefore(&b, offset);
+		} else {
+			// Allocate from top of mem.
+			u32 offset = TopOffset(b.start, b.size, size, grain);
 			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeBefore(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-			}
+			if (b.size != needed)
+				InsertFreeBefore(&b, b.size - needed);
+			if (offset >= grain_)
+				InsertFreeAfter(&b, offset);
 		}
+		b.taken = true;
+		IndexBlock(&b);
+		b.SetAllocated(tag, suballoc_);
+		return b.start;
 	}
 
 	//Out of memory :(
@@ -147,7 +193,6 @@ u32 BlockAllocator::Alloc(u32 &size, bool fromTop, const char *tag)
 
 u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 {
-	CheckBlocks();
 	if (size > rangeSize_) {
 		ERROR_LOG(Log::sceKernel, "Clearly bogus size: %08x - failing allocation", size);
 		return -1;
@@ -189,21 +234,25 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 			//good to go
 			else if (b.start == alignedPosition)
 			{
+				UnindexBlock(&b);
 				if (b.size != alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
 				b.taken = true;
+				IndexBlock(&b);
 				b.SetAllocated(tag, suballoc_);
-				CheckBlocks();
+				CheckBlock(b.start, b.size);
 				return position;
 			}
 			else
 			{
+				UnindexBlock(&b);
 				InsertFreeBefore(&b, alignedPosition - b.start);
 				if (b.size > alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
 				b.taken = true;
+				IndexBlock(&b);
 				b.SetAllocated(tag, suballoc_);
-
+				CheckBlock(b.start, b.size);
 				return position;
 			}
 		}
@@ -220,6 +269,7 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 	return -1;
 }
 
+// fromBlock must be free, and not indexed.
 void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 {
 	VERBOSE_LOG(Log::sceKernel, "Merging Blocks");
@@ -228,6 +278,7 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 	while (prev != NULL && prev->taken == false)
 	{
 		VERBOSE_LOG(Log::sceKernel, "Block Alloc found adjacent free blocks - merging");
+		UnindexBlock(prev);
 		prev->size += fromBlock->size;
 		if (fromBlock->next == NULL)
 			top_ = prev;
@@ -248,6 +299,7 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 	while (next != NULL && next->taken == false)
 	{
 		VERBOSE_LOG(Log::sceKernel, "Block Alloc found adjacent free blocks - merging");
+		UnindexBlock(next);
 		fromBlock->size += next->size;
 		fromBlock->next = next->next;
 		delete next;
@@ -258,6 +310,8 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 		top_ = fromBlock;
 	else
 		next->prev = fromBlock;
+
+	IndexBlock(fromBlock);
 }
 
 bool BlockAllocator::Free(u32 position)
@@ -266,6 +320,7 @@ bool BlockAllocator::Free(u32 position)
 	if (b && b->taken)
 	{
 		NotifyMemInfo(suballoc_ ? MemBlockFlags::SUB_FREE : MemBlockFlags::FREE, b->start, b->size, "");
+		UnindexBlock(b);
 		b->taken = false;
 		MergeFreeBlocks(b);
 		return true;
@@ -283,6 +338,7 @@ bool BlockAllocator::FreeExact(u32 position)
 	if (b && b->taken && b->start == position)
 	{
 		NotifyMemInfo(suballoc_ ? MemBlockFlags::SUB_FREE : MemBlockFlags::FREE, b->start, b->size, "");
+		UnindexBlock(b);
 		b->taken = false;
 		MergeFreeBlocks(b);
 		return true;
@@ -294,6 +350,7 @@ bool BlockAllocator::FreeExact(u32 position)
 	}
 }
 
+// b must not be indexed, since it shrinks. The new block is.
 BlockAllocator::Block *BlockAllocator::InsertFreeBefore(Block *b, u32 size)
 {
 	Block *inserted = new Block(b->start, size, false, b->prev, b);
@@ -305,9 +362,11 @@ BlockAllocator::Block *BlockAllocator::InsertFreeBefore(Block *b, u32 size)
 
 	b->start += size;
 	b->size -= size;
+	IndexBlock(inserted);
 	return inserted;
 }
 
+// Same as InsertFreeBefore().
 BlockAllocator::Block *BlockAllocator::InsertFreeAfter(Block *b, u32 size)
 {
 	Block *inserted = new Block(b->start + b->size - size, size, false, b, b->next);
@@ -318,21 +377,24 @@ BlockAllocator::Block *BlockAllocator::InsertFreeAfter(Block *b, u32 size)
 		inserted->next->prev = inserted;
 
 	b->size -= size;
+	IndexBlock(inserted);
 	return inserted;
 }
 
 void BlockAllocator::CheckBlocks() const
 {
 	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		const Block &b = *bp;
-		if (b.start > 0xc0000000) {  // probably free'd debug values
-			ERROR_LOG_REPORT(Log::HLE, "Bogus block in allocator");
-		}
-		// Outside the valid range, probably logic bug in allocation.
-		if (b.start + b.size > rangeStart_ + rangeSize_ || b.start < rangeStart_) {
-			ERROR_LOG_REPORT(Log::HLE, "Bogus block in allocator");
-		}
+		CheckBlock(bp->start, bp->size);
+}
+
+void BlockAllocator::CheckBlock(u32 start, u32 size) const
+{
+	if (start > 0xc0000000) {  // probably free'd debug values
+		ERROR_LOG_REPORT(Log::HLE, "Bogus block in allocator");
+	}
+	// Outside the valid range, probably logic bug in allocation.
+	if (start + size > rangeStart_ + rangeSize_ || start < rangeStart_) {
+		ERROR_LOG_REPORT(Log::HLE, "Bogus block in allocator");
 	}
 }
 
@@ -352,28 +414,22 @@ const char *BlockAllocator::GetBlockTag(u32 addr) const {
 // linkable COMDAT anyway, but clang follows the standard and the Android unittest link fails.)
 BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr)
 {
-	for (Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
-	}
-	return NULL;
+	const BlockAllocator *self = this;
+	return const_cast<Block *>(self->GetBlockFromAddress(addr));
 }
 
 const BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr) const
 {
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	// The last block starting at or below addr.
+	auto iter = blocks_.upper_bound(addr);
+	if (iter == blocks_.begin())
+		return NULL;
+	--iter;
+	const Block *bp = iter->second;
+	if (bp->start + bp->size > addr)
 	{
-		const Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
+		// Got one!
+		return bp;
 	}
 	return NULL;
 }
@@ -409,14 +465,14 @@ void BlockAllocator::ListBlocks(LogLevel level) const {
 u32 BlockAllocator::GetLargestFreeBlockSize() const
 {
 	u32 maxFreeBlock = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	for (int c = FREE_SIZE_CLASSES - 1; c >= 0; --c)
 	{
-		const Block &b = *bp;
-		if (!b.taken)
-		{
-			if (b.size > maxFreeBlock)
-				maxFreeBlock = b.size;
-		}
+		if (freeBlocks_[c].empty())
+			continue;
+		// Only the largest class matters.
+		for (const auto &iter : freeBlocks_[c])
+			maxFreeBlock = std::max(maxFreeBlock, iter.second->size);
+		break;
 	}
 	if (maxFreeBlock & (grain_ - 1))
 		WARN_LOG_REPORT(Log::HLE, "GetLargestFreeBlockSize: free size %08x does not align to grain %08x.", maxFreeBlock, grain_);
@@ -425,15 +481,7 @@ u32 BlockAllocator::GetLargestFreeBlockSize() const
 
 u32 BlockAllocator::GetTotalFreeBytes() const
 {
-	u32 sum = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		const Block &b = *bp;
-		if (!b.taken)
-		{
-			sum += b.size;
-		}
-	}
+	u32 sum = freeBytes_;
 	if (sum & (grain_ - 1))
 		WARN_LOG_REPORT(Log::HLE, "GetTotalFreeBytes: free size %08x does not align to grain %08x.", sum, grain_);
 	return sum;
@@ -479,6 +527,9 @@ void BlockAllocator::DoState(PointerWrap &p)
 			top_->next->DoState(p, compact);
 			top_ = top_->next;
 		}
+
+		for (Block *bp = bottom_; bp != NULL; bp = bp->next)
+			IndexBlock(bp);
 	}
 	else
 	{
@@ -501,6 +552,9 @@ void BlockAllocator::DoState(PointerWrap &p)
 	Do(p, rangeStart_);
 	Do(p, rangeSize_);
 	Do(p, grain_);
+
+	if (p.mode == p.MODE_READ)
+		CheckBlocks();
 }
 
 BlockAllocator::Block::Block(u32 _start, u32 _size, bool _taken, Block *_prev, Block *_next)
@@ -19,6 +19,8 @@
 
 class PointerWrap;
 
+#include <map>
+
 #include "Common/CommonTypes.h"
 
 #include "Common/Log.h"
@@ -60,6 +62,7 @@ class BlockAllocator
 
 private:
 	void CheckBlocks() const;
+	void CheckBlock(u32 start, u32 size) const;
 
 	struct Block {
 		Block(u32 _start, u32 _size, bool _taken, Block *_prev, Block *_next);
@@ -75,14 +78,29 @@ class BlockAllocator
 		Block *next;
 	};
 
+	// The blocks tile the range, in address order. This list is what's saved in states.
 	Block *bottom_ = nullptr;
 	Block *top_ = nullptr;
+
+	// Indexes over the list, so lookups and allocations don't have to walk it.
+	// A block must be unindexed while its start, size or taken flag changes.
+	std::map<u32, Block *> blocks_;
+	// Free blocks by address, split into size classes of a quarter of a power of two each.
+	enum { FREE_SIZE_CLASSES = 128 };
+	std::map<u32, Block *> freeBlocks_[FREE_SIZE_CLASSES];
+	u32 freeBytes_ = 0;
+
 	u32 rangeStart_ = 0;
 	u32 rangeSize_ = 0;
 
 	u32 grain_;
 	bool suballoc_ = false;
 
+	void IndexBlock(Block *b);
+	void UnindexBlock(Block *b);
+	Block *FindFreeFromBottom(u32 size, u32 grain);
+	Block *FindFreeFromTop(u32 size, u32 grain);
+
 	void MergeFreeBlocks(Block *fromBlock);
 	Block *GetBlockFromAddress(u32 addr);
 	const Block *GetBlockFromAddress(u32 addr) const;
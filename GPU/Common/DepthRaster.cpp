@@ -1,33 +1,53 @@
+#include "ppsspp_config.h"
+
 #include <algorithm>
+#include <cstdio>
 #include <cstring>
 #include <cstdint>
-
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "Common/CPUDetect.h"
+#include "Common/File/FileUtil.h"
+#include "Common/File/Path.h"
+#include "Common/Log.h"
+#include "Common/MemoryUtil.h"
 #include "Common/Math/CrossSIMD.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/TimeUtil.h"
+#include "Core/MemMap.h"
 #include "GPU/Common/DepthRaster.h"
 #include "GPU/Math3D.h"
 #include "Common/Math/math_util.h"
 #include "GPU/Common/VertexDecoderCommon.h"
 
-DepthScissor DepthScissor::Tile(int tile, int numTiles) const {
-	if (numTiles == 1) {
-		return *this;
-	}
-	// First tiling algorithm: Split into vertical slices.
-	int w = x2 - x1;
-	int tileW = (w / numTiles) & ~3;  // Round to four pixels.
-
-	// TODO: Should round x1 to four pixels as well! except the first one
+// The 8-wide path uses AVX2 through a function attribute, so the rest of the file doesn't require it.
+#if PPSSPP_ARCH(SSE2) && (PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)) && !TEST_FALLBACK
+#define DEPTH_RASTER_WIDE 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define DEPTH_RASTER_WIDE_TARGET __attribute__((target("avx2")))
+#else
+#define DEPTH_RASTER_WIDE_TARGET
+#endif
+#else
+#define DEPTH_RASTER_WIDE 0
+#endif
 
-	DepthScissor scissor;
-	scissor.x1 = x1 + tileW * tile;
-	scissor.x2 = (tile == numTiles - 1) ? x2 : (x1 + tileW * (tile + 1));
-	scissor.y1 = y1;
-	scissor.y2 = y2;
-	return scissor;
+void DepthRasterStats::Add(const DepthRasterStats &other) {
+	prims += other.prims;
+	noPixels += other.noPixels;
+	tooSmall += other.tooSmall;
+	earlySize += other.earlySize;
+	zCulled += other.zCulled;
+	boxCulled += other.boxCulled;
+	cullTime += other.cullTime;
+	rasterTime += other.rasterTime;
 }
 
 // x1/x2 etc are the scissor rect.
-static void DepthRasterRect(uint16_t *dest, int stride, const DepthScissor scissor, int v1x, int v1y, int v2x, int v2y, short depthValue, ZCompareMode compareMode) {
+static void DepthRasterRect(uint16_t *dest, int stride, const DepthScissor scissor, const DepthSlice &slice, int v1x, int v1y, int v2x, int v2y, short depthValue, ZCompareMode compareMode, DepthRasterStats *stats) {
 	// Swap coordinates if needed, we don't back-face-cull rects.
 	// We also ignore the UV rotation here.
 	if (v1x > v2x) {
@@ -37,12 +57,18 @@ static void DepthRasterRect(uint16_t *dest, int stride, const DepthScissor sciss
 		std::swap(v1y, v2y);
 	}
 
+	if (slice.Owns(std::clamp(v1x, (int)scissor.x1, (int)scissor.x2))) {
+		stats->prims++;
+	}
+
 	if (v1x < scissor.x1) {
 		v1x = scissor.x1;
 	}
 	if (v2x > scissor.x2) {
 		v2x = scissor.x2 + 1;  // PSP scissors are inclusive
 	}
+	v1x = std::max(v1x, slice.x1);
+	v2x = std::min(v2x, slice.x2);
 	if (v1x >= v2x) {
 		return;
 	}
@@ -95,9 +121,108 @@ enum class TriangleStat {
 
 constexpr int MIN_TWICE_TRI_AREA = 10;
 
-// A mix of ideas from Intel's sample and ryg's rasterizer blog series.
+#if DEPTH_RASTER_WIDE
+
+template<ZCompareMode compareMode>
+DEPTH_RASTER_WIDE_TARGET static inline __m128i DepthCombineWide(__m128i bufferValues, __m128i shortMaskInv, __m128i shortZ) {
+	switch (compareMode) {
+	case ZCompareMode::Greater:
+		return _mm_max_epu16(_mm_andnot_si128(shortMaskInv, shortZ), bufferValues);
+	case ZCompareMode::Less:
+		return _mm_min_epu16(_mm_or_si128(shortZ, shortMaskInv), bufferValues);
+	case ZCompareMode::Always:
+	default:
+		return _mm_or_si128(_mm_and_si128(bufferValues, shortMaskInv), _mm_andnot_si128(shortMaskInv, shortZ));
+	}
+}
+
+// Two 4x1 tiles at a time, otherwise the same as the inner loops of DepthRaster4Triangles.
+// Z is still stepped one tile at a time, so the output is bit-identical.
 template<ZCompareMode compareMode, bool lowQ>
-void DepthRaster4Triangles(int stats[3], uint16_t *depthBuf, int stride, DepthScissor scissor, const int *tx, const int *ty, const float *tz) {
+DEPTH_RASTER_WIDE_TARGET static void DepthRasterRowsWide(uint16_t *depthBuf, int stride, int minYT, int maxYT, int xStart, int xEnd, int skipTiles,
+		Vec4S32 w0_row, Vec4S32 w1_row, Vec4S32 w2_row, int stepX12, int stepX20, int stepX01,
+		Vec4S32 oneStepY12, Vec4S32 oneStepY20, Vec4S32 oneStepY01, Vec4F32 zrow, Vec4F32 zdeltaX, Vec4F32 zdeltaY) {
+	constexpr int stepYSize = lowQ ? 2 : 1;
+
+	const __m128i stepX12x4 = _mm_set1_epi32(stepX12);
+	const __m128i stepX20x4 = _mm_set1_epi32(stepX20);
+	const __m128i stepX01x4 = _mm_set1_epi32(stepX01);
+	const __m256i stepX12x8 = _mm256_set1_epi32(stepX12 * 2);
+	const __m256i stepX20x8 = _mm256_set1_epi32(stepX20 * 2);
+	const __m256i stepX01x8 = _mm256_set1_epi32(stepX01 * 2);
+	const __m256i lowBits = _mm256_set1_epi32(0xFFFF);
+
+
+	for (int y = minYT; y <= maxYT; y += stepYSize, w0_row += oneStepY12, w1_row += oneStepY20, w2_row += oneStepY01, zrow += zdeltaY) {
+		// Lanes 4-7 are one tile to the right.
+		__m256i w0 = _mm256_inserti128_si256(_mm256_castsi128_si256(w0_row.v), _mm_add_epi32(w0_row.v, stepX12x4), 1);
+		__m256i w1 = _mm256_inserti128_si256(_mm256_castsi128_si256(w1_row.v), _mm_add_epi32(w1_row.v, stepX20x4), 1);
+		__m256i w2 = _mm256_inserti128_si256(_mm256_castsi128_si256(w2_row.v), _mm_add_epi32(w2_row.v, stepX01x4), 1);
+		__m128 zs = zrow.v;
+		for (int i = 0; i < skipTiles; i++) {
+			zs = _mm_add_ps(zs, zdeltaX.v);
+		}
+
+		uint16_t *rowPtr = depthBuf + stride * y;
+
+		int x = xStart;
+		for (; x + 4 <= xEnd; x += 8) {
+			__m128 zsRight = _mm_add_ps(zs, zdeltaX.v);
+			__m256i signCalc = _mm256_or_si256(_mm256_or_si256(w0, w1), w2);
+			int signMask = _mm256_movemask_ps(_mm256_castsi256_ps(signCalc));
+			if (signMask != 0xFF) {
+				__m256i z32 = _mm256_and_si256(_mm256_cvtps_epi32(_mm256_insertf128_ps(_mm256_castps128_ps256(zs), zsRight, 1)), lowBits);
+				__m128i shortZ = _mm_packus_epi32(_mm256_castsi256_si128(z32), _mm256_extracti128_si256(z32, 1));
+				__m256i sign = _mm256_srai_epi32(signCalc, 31);
+				__m128i shortMaskInv = _mm_packs_epi32(_mm256_castsi256_si128(sign), _mm256_extracti128_si256(sign, 1));
+				__m128i writeVal = DepthCombineWide<compareMode>(_mm_loadu_si128((const __m128i *)(rowPtr + x)), shortMaskInv, shortZ);
+				// Like the 4-wide loop, don't touch tiles without coverage, the lowQ row copy would change them.
+				if ((signMask & 0xF) != 0xF && (signMask >> 4) != 0xF) {
+					_mm_storeu_si128((__m128i *)(rowPtr + x), writeVal);
+					if (lowQ) {
+						_mm_storeu_si128((__m128i *)(rowPtr + stride + x), writeVal);
+					}
+				} else if ((signMask & 0xF) != 0xF) {
+					_mm_storel_epi64((__m128i *)(rowPtr + x), writeVal);
+					if (lowQ) {
+						_mm_storel_epi64((__m128i *)(rowPtr + stride + x), writeVal);
+					}
+				} else {
+					_mm_storel_epi64((__m128i *)(rowPtr + x + 4), _mm_srli_si128(writeVal, 8));
+					if (lowQ) {
+						_mm_storel_epi64((__m128i *)(rowPtr + stride + x + 4), _mm_srli_si128(writeVal, 8));
+					}
+				}
+			}
+			w0 = _mm256_add_epi32(w0, stepX12x8);
+			w1 = _mm256_add_epi32(w1, stepX20x8);
+			w2 = _mm256_add_epi32(w2, stepX01x8);
+			zs = _mm_add_ps(zsRight, zdeltaX.v);
+		}
+
+		if (x <= xEnd) {
+			// One 4x1 tile left over.
+			__m128i signCalc = _mm_or_si128(_mm_or_si128(_mm256_castsi256_si128(w0), _mm256_castsi256_si128(w1)), _mm256_castsi256_si128(w2));
+			if (_mm_movemask_ps(_mm_castsi128_ps(signCalc)) != 0xF) {
+				__m128i z32 = _mm_and_si128(_mm_cvtps_epi32(zs), _mm256_castsi256_si128(lowBits));
+				__m128i shortZ = _mm_packus_epi32(z32, z32);
+				__m128i sign = _mm_srai_epi32(signCalc, 31);
+				__m128i shortMaskInv = _mm_packs_epi32(sign, sign);
+				__m128i writeVal = DepthCombineWide<compareMode>(_mm_loadl_epi64((const __m128i *)(rowPtr + x)), shortMaskInv, shortZ);
+				_mm_storel_epi64((__m128i *)(rowPtr + x), writeVal);
+				if (lowQ) {
+					_mm_storel_epi64((__m128i *)(rowPtr + stride + x), writeVal);
+				}
+			}
+		}
+	}
+}
+
+#endif
+
+// A mix of ideas from Intel's sample and ryg's rasterizer blog series.
+template<ZCompareMode compareMode, bool lowQ, bool wide>
+void DepthRaster4Triangles(int stats[3], uint16_t *depthBuf, int stride, DepthScissor scissor, const DepthSlice &slice, const int *tx, const int *ty, const float *tz) {
 	// Triangle setup. This is done using SIMD, four triangles at a time.
 	// 16x16->32 multiplications are doable on SSE2, which should be all we need.
 
@@ -162,24 +287,41 @@ void DepthRaster4Triangles(int stats[3], uint16_t *depthBuf, int stride, DepthSc
 
 	// Shared setup is done, now loop per-triangle in the group of four.
 	for (int t = 0; t < 4; t++) {
+		// When split into slices, the triangle is counted by the slice that has its leftmost pixel.
+		const bool owned = slice.Owns(std::min((int)minX[t], (int)scissor.x2));
+
 		// Check for bad triangle.
 		// Using operator[] on the vectors actually seems to result in pretty good code.
 		if (maxX[t] <= minX[t] || maxY[t] <= minY[t]) {
 			// No pixels, or outside screen.
 			// Most of these are now gone in the initial pass, but not all since we cull
 			// in 4-groups there.
-			stats[(int)TriangleStat::NoPixels]++;
+			if (owned)
+				stats[(int)TriangleStat::NoPixels]++;
 			continue;
 		}
 
 		if (triArea[t] < MIN_TWICE_TRI_AREA) {
-			stats[(int)TriangleStat::SmallOrBackface]++;  // Or zero area.
+			if (owned)
+				stats[(int)TriangleStat::SmallOrBackface]++;  // Or zero area.
 			continue;
 		}
 
+		if (owned)
+			stats[(int)TriangleStat::OK]++;
+
 		const int minXT = minX[t] & ~3;
 		const int maxXT = maxX[t] & ~3;
 
+		// Only visit the 4x1 tiles inside the slice. Z still has to be stepped through the ones before it,
+		// to get exactly the same values as without slices.
+		const int xStart = std::max(minXT, slice.x1);
+		const int xEnd = std::min(maxXT, slice.x2 - 4);
+		if (xStart > xEnd) {
+			continue;
+		}
+		const int skipTiles = (xStart - minXT) >> 2;
+
 		const int minYT = minY[t];
 		const int maxYT = maxY[t];
 
@@ -208,6 +350,22 @@ void DepthRaster4Triangles(int stats[3], uint16_t *depthBuf, int stride, DepthSc
 		Vec4S32 oneStepY20 = Vec4S32::Splat(stepY20[t]);
 		Vec4S32 oneStepX01 = Vec4S32::Splat(stepX01[t]);
 		Vec4S32 oneStepY01 = Vec4S32::Splat(stepY01[t]);
+
+		if (skipTiles) {
+			// The edge functions are exact, so these can jump ahead directly.
+			w0_row += Vec4S32::Splat(stepX12[t] * skipTiles);
+			w1_row += Vec4S32::Splat(stepX20[t] * skipTiles);
+			w2_row += Vec4S32::Splat(stepX01[t] * skipTiles);
+		}
+
+#if DEPTH_RASTER_WIDE
+		if (wide) {
+			DepthRasterRowsWide<compareMode, lowQ>(depthBuf, stride, minYT, maxYT, xStart, xEnd, skipTiles,
+				w0_row, w1_row, w2_row, stepX12[t], stepX20[t], stepX01[t], oneStepY12, oneStepY20, oneStepY01, zrow, zdeltaX, zdeltaY);
+			continue;
+		}
+#endif
+
 		// Rasterize
 		for (int y = minYT; y <= maxYT; y += stepYSize, w0_row += oneStepY12, w1_row += oneStepY20, w2_row += oneStepY01, zrow += zdeltaY) {
 			// Barycentric coordinates at start of row
@@ -215,10 +373,13 @@ void DepthRaster4Triangles(int stats[3], uint16_t *depthBuf, int stride, DepthSc
 			Vec4S32 w1 = w1_row;
 			Vec4S32 w2 = w2_row;
 			Vec4F32 zs = zrow;
+			for (int i = 0; i < skipTiles; i++) {
+				zs += zdeltaX;
+			}
 
 			uint16_t *rowPtr = depthBuf + stride * y;
 
-			for (int x = minXT; x <= maxXT; x += stepXSize, w0 += oneStepX12, w1 += oneStepX20, w2 += oneStepX01, zs += zdeltaX) {
+			for (int x = xStart; x <= xEnd; x += stepXSize, w0 += oneStepX12, w1 += oneStepX20, w2 += oneStepX01, zs += zdeltaX) {
 				// If p is on or inside all edges for any pixels,
 				// render those pixels.
 				Vec4S32 signCalc = w0 | w1 | w2;
@@ -258,8 +419,6 @@ void DepthRaster4Triangles(int stats[3], uint16_t *depthBuf, int stride, DepthSc
 				}
 			}
 		}
-
-		stats[(int)TriangleStat::OK]++;
 	}
 }
 
@@ -370,7 +529,7 @@ int DepthRasterClipIndexedRectangles(int *tx, int *ty, float *tz, const float *t
 	return outCount;
 }
 
-int DepthRasterClipIndexedTriangles(int *tx, int *ty, float *tz, const float *transformed, const uint16_t *indexBuffer, const DepthDraw &draw, const DepthScissor scissor) {
+int DepthRasterClipIndexedTriangles(int *tx, int *ty, float *tz, const float *transformed, const uint16_t *indexBuffer, const DepthDraw &draw, const DepthScissor scissor, DepthRasterStats *stats) {
 	int outCount = 0;
 
 	int flipCull = 0;
@@ -518,7 +677,7 @@ int DepthRasterClipIndexedTriangles(int *tx, int *ty, float *tz, const float *tr
 		// Still good for backface culling early and pretty cheap to compute.
 		Vec4F32 doubleTriArea = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0) - Vec4F32::Splat((float)(MIN_TWICE_TRI_AREA));
 		if (!AnyZeroSignBit(doubleTriArea)) {
-			gpuStats.perFrame.numDepthRasterEarlySize += 4;
+			stats->earlySize += 4;
 			continue;
 		}
 
@@ -560,13 +719,35 @@ int DepthRasterClipIndexedTriangles(int *tx, int *ty, float *tz, const float *tr
 		}
 	}
 
-	gpuStats.perFrame.numDepthRasterZCulled += planeCulled;
-	gpuStats.perFrame.numDepthEarlyBoxCulled += boxCulled;
+	stats->zCulled += planeCulled;
+	stats->boxCulled += boxCulled;
 	return outCount;
 }
 
+template<ZCompareMode compareMode, bool lowQ, bool wide>
+static void DepthRasterTriangleGroups(int stats[3], uint16_t *depth, int depthStride, const DepthScissor scissor, const DepthSlice &slice, const int *tx, const int *ty, const float *tz, int count) {
+	for (int i = 0; i < count; i += 12) {
+		DepthRaster4Triangles<compareMode, lowQ, wide>(stats, depth, depthStride, scissor, slice, &tx[i], &ty[i], &tz[i]);
+	}
+}
+
+template<bool lowQ, bool wide>
+static void DepthRasterTriangleGroups(int stats[3], uint16_t *depth, int depthStride, const DepthScissor scissor, const DepthSlice &slice, const int *tx, const int *ty, const float *tz, int count, ZCompareMode compareMode) {
+	switch (compareMode) {
+	case ZCompareMode::Greater:
+		DepthRasterTriangleGroups<ZCompareMode::Greater, lowQ, wide>(stats, depth, depthStride, scissor, slice, tx, ty, tz, count);
+		break;
+	case ZCompareMode::Less:
+		DepthRasterTriangleGroups<ZCompareMode::Less, lowQ, wide>(stats, depth, depthStride, scissor, slice, tx, ty, tz, count);
+		break;
+	case ZCompareMode::Always:
+		DepthRasterTriangleGroups<ZCompareMode::Always, lowQ, wide>(stats, depth, depthStride, scissor, slice, tx, ty, tz, count);
+		break;
+	}
+}
+
 // Rasterizes screen-space vertices.
-void DepthRasterScreenVerts(uint16_t *depth, int depthStride, const int *tx, const int *ty, const float *tz, int count, const DepthDraw &draw, const DepthScissor scissor, bool lowQ) {
+void DepthRasterScreenVerts(uint16_t *depth, int depthStride, const int *tx, const int *ty, const float *tz, int count, const DepthDraw &draw, const DepthScissor scissor, const DepthSlice &slice, bool lowQ, bool wide, DepthRasterStats *stats) {
 	// Prim should now be either TRIANGLES or RECTs.
 	_dbg_assert_(draw.prim == GE_PRIM_RECTANGLES || draw.prim == GE_PRIM_TRIANGLES);
 
@@ -576,69 +757,388 @@ void DepthRasterScreenVerts(uint16_t *depth, int depthStride, const int *tx, con
 			uint16_t z = (uint16_t)tz[i + 1];  // depth from second vertex
 			// TODO: Should clip coordinates to the scissor rectangle.
 			// We remove the subpixel information here.
-			DepthRasterRect(depth, depthStride, scissor, tx[i], ty[i], tx[i + 1], ty[i + 1], z, draw.compareMode);
+			DepthRasterRect(depth, depthStride, scissor, slice, tx[i], ty[i], tx[i + 1], ty[i + 1], z, draw.compareMode, stats);
 		}
-		gpuStats.perFrame.numDepthRasterPrims += count / 2;
 		break;
 	case GE_PRIM_TRIANGLES:
 	{
-		int stats[3]{};
+		int triStats[3]{};
 		// Batches of 4 triangles, as output by the clip function.
+#if DEPTH_RASTER_WIDE
+		if (wide) {
+			if (lowQ) {
+				DepthRasterTriangleGroups<true, true>(triStats, depth, depthStride, scissor, slice, tx, ty, tz, count, draw.compareMode);
+			} else {
+				DepthRasterTriangleGroups<false, true>(triStats, depth, depthStride, scissor, slice, tx, ty, tz, count, draw.compareMode);
+			}
+		} else
+#endif
 		if (lowQ) {
-			switch (draw.compareMode) {
-			case ZCompareMode::Greater:
-			{
-				for (int i = 0; i < count; i += 12) {
-					DepthRaster4Triangles<ZCompareMode::Greater, true>(stats, depth, depthStride, scissor, &tx[i], &ty[i], &tz[i]);
-				}
-				break;
+			DepthRasterTriangleGroups<true, false>(triStats, depth, depthStride, scissor, slice, tx, ty, tz, count, draw.compareMode);
+		} else {
+			DepthRasterTriangleGroups<false, false>(triStats, depth, depthStride, scissor, slice, tx, ty, tz, count, draw.compareMode);
+		}
+		stats->noPixels += triStats[(int)TriangleStat::NoPixels];
+		stats->tooSmall += triStats[(int)TriangleStat::SmallOrBackface];
+		stats->prims += triStats[(int)TriangleStat::OK];
+		break;
+	}
+	default:
+		_dbg_assert_(false);
+	}
+}
+
+enum {
+	DEPTH_SCREENVERTS_COMPONENT_COUNT = 65536,
+	DEPTH_SCREENVERTS_COMPONENT_BYTES = DEPTH_SCREENVERTS_COMPONENT_COUNT * sizeof(int) + 384,
+	DEPTH_SCREENVERTS_TOTAL_BYTES = DEPTH_SCREENVERTS_COMPONENT_BYTES * 3,
+	// Below these, splitting into slices costs more than it saves.
+	DEPTH_SLICE_MIN_WIDTH = 64,
+	DEPTH_SLICE_MIN_VERTS = 96,
+};
+
+// Slices are claimed one at a time, by whoever gets there first. Once they're all claimed, helper
+// tasks that run late find nothing left to do, so nobody ever waits for a task to be scheduled.
+class DepthSliceJob {
+public:
+	DepthSliceJob(int count, std::function<void(int)> func) : count_(count), done_(count), func_(std::move(func)) {}
+
+	void RunSlices() {
+		int s;
+		while ((s = next_++) < count_) {
+			func_(s);
+			done_.Count();
+		}
+	}
+
+	void Wait() {
+		done_.Wait();
+	}
+
+private:
+	const int count_;
+	std::atomic<int> next_{};
+	WaitableCounter done_;
+	// Only called for claimed slices, so the captures are alive until Wait() returns.
+	std::function<void(int)> func_;
+};
+
+class DepthSliceTask : public Task {
+public:
+	explicit DepthSliceTask(std::shared_ptr<DepthSliceJob> job) : job_(std::move(job)) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	TaskPriority Priority() const override {
+		return TaskPriority::HIGH;
+	}
+
+	void Run() override {
+		job_->RunSlices();
+	}
+
+	// The thread that queued us does any slices left over, nothing to do.
+	bool Cancellable() const override {
+		return true;
+	}
+
+private:
+	std::shared_ptr<DepthSliceJob> job_;
+};
+
+DepthRasterizer::DepthRasterizer() {
+	screenVerts_ = (int *)AllocateMemoryPages(DEPTH_SCREENVERTS_TOTAL_BYTES, MEM_PROT_READ | MEM_PROT_WRITE);
+}
+
+DepthRasterizer::~DepthRasterizer() {
+	FreeMemoryPages(screenVerts_, DEPTH_SCREENVERTS_TOTAL_BYTES);
+}
+
+void DepthRasterizer::SetOptions(int maxSlices, bool allowWide) {
+	maxSlices_ = std::max(1, maxSlices);
+#if DEPTH_RASTER_WIDE
+	wide_ = allowWide && cpu_info.bAVX2;
+#else
+	wide_ = false;
+#endif
+}
+
+void DepthRasterizer::Rasterize(const DepthDraw *draws, size_t count, const float *transformed, const uint16_t *indices, const DepthPtrFunc &getDepthPtr, bool lowQ, bool collectTimes, DepthRasterStats *stats) {
+	segment_.clear();
+	segmentVerts_ = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		const DepthDraw &draw = draws[i];
+		// With culling off, every triangle can be output four times, and the last group is padded to four.
+		const int maxOutCount = draw.prim == GE_PRIM_RECTANGLES ? draw.vertexCount : draw.vertexCount * 4 + 24;
+		if (!segment_.empty()) {
+			const DepthDraw &first = *segment_[0].draw;
+			if (first.depthAddr != draw.depthAddr || first.depthStride != draw.depthStride || segmentVerts_ + maxOutCount > DEPTH_SCREENVERTS_COMPONENT_COUNT) {
+				FlushSegment(lowQ, collectTimes, stats);
 			}
-			case ZCompareMode::Less:
-			{
-				for (int i = 0; i < count; i += 12) {
-					DepthRaster4Triangles<ZCompareMode::Less, true>(stats, depth, depthStride, scissor, &tx[i], &ty[i], &tz[i]);
-				}
+		}
+
+		int *tx = screenVerts_ + segmentVerts_;
+		int *ty = tx + DEPTH_SCREENVERTS_COMPONENT_COUNT;
+		float *tz = (float *)(tx + DEPTH_SCREENVERTS_COMPONENT_COUNT * 2);
+
+		const float *vertices = transformed + 4 * draw.vertexOffset;
+		const uint16_t *drawIndices = indices + draw.indexOffset;
+
+		int outVertCount = 0;
+		{
+			TimeCollector collectStat(&stats->cullTime, collectTimes);
+			switch (draw.prim) {
+			case GE_PRIM_RECTANGLES:
+				outVertCount = DepthRasterClipIndexedRectangles(tx, ty, tz, vertices, drawIndices, draw, draw.scissor);
 				break;
-			}
-			case ZCompareMode::Always:
-			{
-				for (int i = 0; i < count; i += 12) {
-					DepthRaster4Triangles<ZCompareMode::Always, true>(stats, depth, depthStride, scissor, &tx[i], &ty[i], &tz[i]);
-				}
+			case GE_PRIM_TRIANGLES:
+				outVertCount = DepthRasterClipIndexedTriangles(tx, ty, tz, vertices, drawIndices, draw, draw.scissor, stats);
 				break;
-			}
-			}
-		} else {
-			switch (draw.compareMode) {
-			case ZCompareMode::Greater:
-			{
-				for (int i = 0; i < count; i += 12) {
-					DepthRaster4Triangles<ZCompareMode::Greater, false>(stats, depth, depthStride, scissor, &tx[i], &ty[i], &tz[i]);
-				}
+			default:
+				_dbg_assert_(false);
 				break;
 			}
-			case ZCompareMode::Less:
-			{
-				for (int i = 0; i < count; i += 12) {
-					DepthRaster4Triangles<ZCompareMode::Less, false>(stats, depth, depthStride, scissor, &tx[i], &ty[i], &tz[i]);
-				}
-				break;
+		}
+
+		uint16_t *depth = outVertCount > 0 ? getDepthPtr(draw.depthAddr) : nullptr;
+		if (depth) {
+			segment_.push_back(SegmentDraw{ &draw, depth, segmentVerts_, outVertCount });
+			// Keep the next draw's groups 16-byte aligned.
+			segmentVerts_ += (outVertCount + 3) & ~3;
+		}
+	}
+
+	FlushSegment(lowQ, collectTimes, stats);
+}
+
+void DepthRasterizer::FlushSegment(bool lowQ, bool collectTimes, DepthRasterStats *stats) {
+	if (segment_.empty()) {
+		return;
+	}
+
+	TimeCollector collectStat(&stats->rasterTime, collectTimes);
+
+	const int *tx = screenVerts_;
+	const int *ty = tx + DEPTH_SCREENVERTS_COMPONENT_COUNT;
+	const float *tz = (const float *)(tx + DEPTH_SCREENVERTS_COMPONENT_COUNT * 2);
+	const int stride = segment_[0].draw->depthStride;
+
+	int numSlices = std::min(maxSlices_, stride / DEPTH_SLICE_MIN_WIDTH);
+	if (segmentVerts_ < DEPTH_SLICE_MIN_VERTS) {
+		numSlices = 1;
+	}
+
+	if (numSlices <= 1) {
+		for (const SegmentDraw &sd : segment_) {
+			DepthRasterScreenVerts(sd.depth, stride, tx + sd.offset, ty + sd.offset, tz + sd.offset, sd.count, *sd.draw, sd.draw->scissor, DepthSlice::Full(), lowQ, wide_, stats);
+		}
+	} else {
+		// Slices are whole 4x1 tiles, so no two slices ever write to the same pixels.
+		const int sliceWidth = ((stride + numSlices - 1) / numSlices + 3) & ~3;
+		BinSegment(sliceWidth, numSlices);
+
+		sliceStats_.assign(numSlices, DepthRasterStats{});
+		auto job = std::make_shared<DepthSliceJob>(numSlices, [&](int s) {
+			DepthSlice slice = DepthSlice::Full();
+			if (s != 0)
+				slice.x1 = s * sliceWidth;
+			if (s != numSlices - 1)
+				slice.x2 = (s + 1) * sliceWidth;
+			for (const BinRun &run : bins_[s]) {
+				const SegmentDraw &sd = segment_[run.draw];
+				DepthRasterScreenVerts(sd.depth, stride, tx + run.offset, ty + run.offset, tz + run.offset, run.count, *sd.draw, sd.draw->scissor, slice, lowQ, wide_, &sliceStats_[s]);
 			}
-			case ZCompareMode::Always:
-			{
-				for (int i = 0; i < count; i += 12) {
-					DepthRaster4Triangles<ZCompareMode::Always, false>(stats, depth, depthStride, scissor, &tx[i], &ty[i], &tz[i]);
-				}
-				break;
+		});
+
+		// We're normally on a compute worker ourselves, so we can't wait for tasks that may never
+		// get a thread. Instead, helpers take slices while they last, and we take the rest.
+		const int numHelpers = std::min(numSlices - 1, g_threadManager.GetNumLooperThreads() - 1);
+		for (int i = 0; i < numHelpers; i++) {
+			g_threadManager.EnqueueTask(new DepthSliceTask(job));
+		}
+		job->RunSlices();
+		// Only waits for slices that a helper already started.
+		job->Wait();
+
+		for (const DepthRasterStats &sliceStats : sliceStats_) {
+			stats->Add(sliceStats);
+		}
+	}
+
+	segment_.clear();
+	segmentVerts_ = 0;
+}
+
+// Assigns each group of four triangles (or each rectangle) to the slices its bounding box touches, keeping the order.
+void DepthRasterizer::BinSegment(int sliceWidth, int numSlices) {
+	bins_.resize(numSlices);
+	for (auto &bin : bins_) {
+		bin.clear();
+	}
+
+	const int *tx = screenVerts_;
+	for (int d = 0; d < (int)segment_.size(); d++) {
+		const SegmentDraw &sd = segment_[d];
+		const DepthScissor &scissor = sd.draw->scissor;
+		const int groupSize = sd.draw->prim == GE_PRIM_RECTANGLES ? 2 : 12;
+		for (int i = 0; i < sd.count; i += groupSize) {
+			const int *groupX = tx + sd.offset + i;
+			int minX = groupX[0];
+			int maxX = groupX[0];
+			for (int j = 1; j < groupSize; j++) {
+				minX = std::min(minX, groupX[j]);
+				maxX = std::max(maxX, groupX[j]);
 			}
+			// The rasterizer clamps to the scissor the same way, so this covers every tile it can touch.
+			const int firstSlice = std::min(std::clamp(minX, (int)scissor.x1, (int)scissor.x2) / sliceWidth, numSlices - 1);
+			const int lastSlice = std::min(std::clamp(maxX, (int)scissor.x1, (int)scissor.x2) / sliceWidth, numSlices - 1);
+			for (int s = firstSlice; s <= lastSlice; s++) {
+				std::vector<BinRun> &bin = bins_[s];
+				if (!bin.empty() && bin.back().draw == d && bin.back().offset + bin.back().count == sd.offset + i) {
+					bin.back().count += groupSize;
+				} else {
+					bin.push_back(BinRun{ d, sd.offset + i, groupSize });
+				}
 			}
 		}
-		gpuStats.perFrame.numDepthRasterNoPixels += stats[(int)TriangleStat::NoPixels];
-		gpuStats.perFrame.numDepthRasterTooSmall += stats[(int)TriangleStat::SmallOrBackface];
-		gpuStats.perFrame.numDepthRasterPrims += stats[(int)TriangleStat::OK];
-		break;
 	}
-	default:
-		_dbg_assert_(false);
+}
+
+// Recording format: a sequence of batches, each a DepthRasterRecordHeader followed by the draws,
+// transformed vertices, indices, and then the buffers (address, pixel count, pixels).
+struct DepthRasterRecordHeader {
+	char magic[4];
+	u32 lowQ;
+	u32 drawCount;
+	u32 vertexCount;
+	u32 indexCount;
+	u32 bufferCount;
+};
+
+static const char DEPTH_RASTER_RECORD_MAGIC[4] = { 'Z', 'R', 'S', '1' };
+
+static std::mutex g_recordLock;
+static Path g_recordFile;
+static std::atomic<bool> g_recording;
+
+void DepthRasterSetRecordFile(const Path &filename) {
+	std::lock_guard<std::mutex> guard(g_recordLock);
+	g_recordFile = filename;
+	g_recording = !filename.empty();
+	if (g_recording) {
+		// Start from scratch, batches are appended.
+		File::Delete(filename, true);
+	}
+}
+
+bool DepthRasterIsRecording() {
+	return g_recording;
+}
+
+void DepthRasterRecordBatch(const DepthDraw *draws, size_t count, const float *transformed, int vertexCount, const uint16_t *indices, int indexCount, bool lowQ) {
+	std::lock_guard<std::mutex> guard(g_recordLock);
+	if (!g_recording) {
+		return;
+	}
+
+	// Save every depth buffer the batch can touch, before it does.
+	std::vector<u32> addrs;
+	std::vector<u32> sizes;
+	for (size_t i = 0; i < count; i++) {
+		// Rows below the scissor can be touched in lowQ, and 4x1 tiles can poke out a little to the right.
+		u32 pixels = draws[i].depthStride * (draws[i].scissor.y2 + 2) + 8;
+		auto it = std::find(addrs.begin(), addrs.end(), draws[i].depthAddr);
+		if (it == addrs.end()) {
+			addrs.push_back(draws[i].depthAddr);
+			sizes.push_back(pixels);
+		} else {
+			u32 &size = sizes[it - addrs.begin()];
+			size = std::max(size, pixels);
+		}
+	}
+
+	FILE *f = File::OpenCFile(g_recordFile, "ab");
+	if (!f) {
+		ERROR_LOG(Log::G3D, "Failed to open %s for depth raster recording", g_recordFile.c_str());
+		g_recording = false;
+		return;
+	}
+
+	DepthRasterRecordHeader header{};
+	memcpy(header.magic, DEPTH_RASTER_RECORD_MAGIC, sizeof(header.magic));
+	header.lowQ = lowQ ? 1 : 0;
+	header.drawCount = (u32)count;
+	header.vertexCount = (u32)vertexCount;
+	header.indexCount = (u32)indexCount;
+	header.bufferCount = 0;
+	for (size_t i = 0; i < addrs.size(); i++) {
+		if (Memory::IsValidRange(addrs[i], sizes[i] * 2))
+			header.bufferCount++;
+	}
+
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(draws, sizeof(DepthDraw), count, f);
+	fwrite(transformed, sizeof(float) * 4, vertexCount, f);
+	fwrite(indices, sizeof(uint16_t), indexCount, f);
+	for (size_t i = 0; i < addrs.size(); i++) {
+		if (!Memory::IsValidRange(addrs[i], sizes[i] * 2))
+			continue;
+		fwrite(&addrs[i], sizeof(u32), 1, f);
+		fwrite(&sizes[i], sizeof(u32), 1, f);
+		fwrite(Memory::GetPointerUnchecked(addrs[i]), sizeof(uint16_t), sizes[i], f);
+	}
+	fclose(f);
+}
+
+bool DepthRasterLoadRecording(const Path &filename, std::vector<DepthRasterRecordedBatch> *batches) {
+	std::string data;
+	if (!File::ReadBinaryFileToString(filename, &data)) {
+		return false;
+	}
+
+	size_t pos = 0;
+	auto read = [&](void *dest, size_t bytes) -> bool {
+		if (data.size() - pos < bytes) {
+			return false;
+		}
+		memcpy(dest, data.data() + pos, bytes);
+		pos += bytes;
+		return true;
+	};
+
+	while (pos < data.size()) {
+		DepthRasterRecordHeader header;
+		if (!read(&header, sizeof(header)) || memcmp(header.magic, DEPTH_RASTER_RECORD_MAGIC, sizeof(header.magic)) != 0) {
+			ERROR_LOG(Log::G3D, "Bad depth raster recording %s", filename.c_str());
+			return false;
+		}
+
+		DepthRasterRecordedBatch batch;
+		batch.lowQ = header.lowQ != 0;
+		batch.draws.resize(header.drawCount);
+		batch.transformed.resize((size_t)header.vertexCount * 4);
+		batch.indices.resize(header.indexCount);
+		bool success = read(batch.draws.data(), sizeof(DepthDraw) * batch.draws.size());
+		success = success && read(batch.transformed.data(), sizeof(float) * batch.transformed.size());
+		success = success && read(batch.indices.data(), sizeof(uint16_t) * batch.indices.size());
+		for (u32 i = 0; success && i < header.bufferCount; i++) {
+			DepthRasterRecordedBatch::Buffer buffer;
+			u32 pixels = 0;
+			success = read(&buffer.addr, sizeof(u32)) && read(&pixels, sizeof(u32));
+			if (success) {
+				buffer.data.resize(pixels);
+				success = read(buffer.data.data(), sizeof(uint16_t) * pixels);
+			}
+			batch.buffers.push_back(std::move(buffer));
+		}
+		if (!success) {
+			ERROR_LOG(Log::G3D, "Truncated depth raster recording %s", filename.c_str());
+			return false;
+		}
+		batches->push_back(std::move(batch));
 	}
+	return true;
 }
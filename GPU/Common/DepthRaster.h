@@ -1,8 +1,13 @@
 #pragma once
 
+#include <functional>
+#include <vector>
+
 #include "Common/CommonTypes.h"
 #include "GPU/ge_constants.h"
 
+class Path;
+
 struct DepthScreenVertex {
 	int x;
 	int y;
@@ -26,8 +31,34 @@ struct DepthScissor {
 	u16 y1;
 	u16 x2;
 	u16 y2;
+};
+
+// A vertical slice of the depth buffer, [x1, x2), in whole 4-pixel columns.
+// Rasterizing the same primitives into each slice of a set gives exactly the same result as rasterizing them
+// all into Full(), so slices can be done in parallel. Each primitive is counted in stats by one slice only.
+struct DepthSlice {
+	int x1;
+	int x2;
+
+	static DepthSlice Full() {
+		return DepthSlice{ -0x40000000, 0x40000000 };
+	}
+	bool Owns(int x) const {
+		return x >= x1 && x < x2;
+	}
+};
+
+struct DepthRasterStats {
+	int prims;
+	int noPixels;
+	int tooSmall;
+	int earlySize;
+	int zCulled;
+	int boxCulled;
+	double cullTime;
+	double rasterTime;
 
-	DepthScissor Tile(int tile, int numTiles) const;
+	void Add(const DepthRasterStats &other);
 };
 
 struct DepthDraw {
@@ -51,9 +82,71 @@ struct DepthDraw {
 class VertexDecoder;
 struct TransformedVertex;
 
-int DepthRasterClipIndexedTriangles(int *tx, int *ty, float *tz, const float *transformed, const uint16_t *indexBuffer, const DepthDraw &draw, const DepthScissor scissor);
+int DepthRasterClipIndexedTriangles(int *tx, int *ty, float *tz, const float *transformed, const uint16_t *indexBuffer, const DepthDraw &draw, const DepthScissor scissor, DepthRasterStats *stats);
 int DepthRasterClipIndexedRectangles(int *tx, int *ty, float *tz, const float *transformed, const uint16_t *indexBuffer, const DepthDraw &draw, const DepthScissor scissor);
 void DecodeAndTransformForDepthRaster(float *dest, const float *worldviewproj, const void *vertexData, int indexLowerBound, int indexUpperBound, const VertexDecoder *dec, u32 vertTypeID);
 void TransformPredecodedForDepthRaster(float *dest, const float *worldviewproj, const void *decodedVertexData, const VertexDecoder *dec, int count);
 void ConvertPredecodedThroughForDepthRaster(float *dest, const void *decodedVertexData, const VertexDecoder *dec, int count);
-void DepthRasterScreenVerts(uint16_t *depth, int depthStride, const int *tx, const int *ty, const float *tz, int count, const DepthDraw &draw, const DepthScissor scissor, bool lowQ);
+void DepthRasterScreenVerts(uint16_t *depth, int depthStride, const int *tx, const int *ty, const float *tz, int count, const DepthDraw &draw, const DepthScissor scissor, const DepthSlice &slice, bool lowQ, bool wide, DepthRasterStats *stats);
+
+// Returns nullptr if the address isn't valid.
+typedef std::function<uint16_t *(u32 depthAddr)> DepthPtrFunc;
+
+// Culls and rasterizes a batch of draws, in order. Consecutive draws into the same depth buffer are culled first,
+// then binned into vertical slices which are rasterized in parallel on g_threadManager.
+// Not thread safe, but can be used from any one thread at a time.
+class DepthRasterizer {
+public:
+	DepthRasterizer();
+	~DepthRasterizer();
+
+	// maxSlices = 1 keeps everything on the calling thread. The 8-wide path is only used if the CPU supports it.
+	void SetOptions(int maxSlices, bool allowWide);
+	void Rasterize(const DepthDraw *draws, size_t count, const float *transformed, const uint16_t *indices, const DepthPtrFunc &getDepthPtr, bool lowQ, bool collectTimes, DepthRasterStats *stats);
+
+private:
+	struct SegmentDraw {
+		const DepthDraw *draw;
+		uint16_t *depth;
+		int offset;
+		int count;
+	};
+	struct BinRun {
+		int draw;
+		int offset;
+		int count;
+	};
+
+	void FlushSegment(bool lowQ, bool collectTimes, DepthRasterStats *stats);
+	void BinSegment(int sliceWidth, int numSlices);
+
+	int *screenVerts_ = nullptr;
+	int maxSlices_ = 1;
+	bool wide_ = false;
+
+	std::vector<SegmentDraw> segment_;
+	int segmentVerts_ = 0;
+	std::vector<std::vector<BinRun>> bins_;
+	std::vector<DepthRasterStats> sliceStats_;
+};
+
+// Recording of the depth raster input, for benchmarking and checking the rasterizer outside the emulator
+// (see TestDepthRaster). Each batch also stores the affected depth buffers as they were before it ran.
+struct DepthRasterRecordedBatch {
+	struct Buffer {
+		u32 addr;
+		std::vector<uint16_t> data;
+	};
+
+	bool lowQ;
+	std::vector<DepthDraw> draws;
+	std::vector<float> transformed;
+	std::vector<uint16_t> indices;
+	std::vector<Buffer> buffers;
+};
+
+// Where DrawEngineCommon should append its batches. Empty to stop.
+void DepthRasterSetRecordFile(const Path &filename);
+bool DepthRasterIsRecording();
+void DepthRasterRecordBatch(const DepthDraw *draws, size_t count, const float *transformed, int vertexCount, const uint16_t *indices, int indexCount, bool lowQ);
+bool DepthRasterLoadRecording(const Path &filename, std::vector<DepthRasterRecordedBatch> *batches);
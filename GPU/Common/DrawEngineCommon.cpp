@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <functional>
 
 #include "Common/Data/Convert/ColorConv.h"
 #include "Common/Profiler/Profiler.h"
@@ -25,6 +26,8 @@
 #include "Common/Math/SIMDHeaders.h"
 #include "Common/Math/CrossSIMD.h"
 #include "Common/Math/lin/matrix4x4.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/Thread/Waitable.h"
 #include "Common/TimeUtil.h"
 #include "Core/System.h"
 #include "Core/Config.h"
@@ -1007,18 +1010,17 @@ bool DrawEngineCommon::DescribeCodePtr(const u8 *ptr, std::string &name) const {
 enum {
 	DEPTH_TRANSFORMED_MAX_VERTS = VERTEX_BUFFER_MAX,
 	DEPTH_TRANSFORMED_BYTES = DEPTH_TRANSFORMED_MAX_VERTS * 4 * sizeof(float),
-	DEPTH_SCREENVERTS_COMPONENT_COUNT = VERTEX_BUFFER_MAX,
-	DEPTH_SCREENVERTS_COMPONENT_BYTES = DEPTH_SCREENVERTS_COMPONENT_COUNT * sizeof(int) + 384,
-	DEPTH_SCREENVERTS_TOTAL_BYTES = DEPTH_SCREENVERTS_COMPONENT_BYTES * 3,
 	DEPTH_INDEXBUFFER_BYTES = DEPTH_TRANSFORMED_MAX_VERTS * 3 * sizeof(uint16_t),  // hmmm
 };
 
 // We process vertices for depth rendering in several stages:
-// First, we transform and collect vertices into depthTransformed_ (4-vectors, xyzw).
-// Then, we group and cull the vertices into four-triangle groups, which are placed in
-// depthScreenVerts_, with x, y and z separated into different part of the array.
+// First, we transform and collect vertices into the current batch's transformed array (4-vectors, xyzw).
+// When the batch is flushed, it's handed to a worker thread, which does the rest while we keep
+// collecting into the other batch:
+// We group and cull the vertices into four-triangle groups, which are placed in
+// DepthRasterizer's screen vertex array, with x, y and z separated into different part of the array.
 // (Alternatively, if drawing rectangles, they're just added linearly).
-// After that, we send these groups out for SIMD setup and rasterization.
+// After that, we send these groups out for SIMD setup and rasterization, split into slices of the screen.
 void DrawEngineCommon::InitDepthRaster() {
 	switch ((DepthRasterMode)g_Config.iDepthRasterMode) {
 	case DepthRasterMode::DEFAULT:
@@ -1033,23 +1035,30 @@ void DrawEngineCommon::InitDepthRaster() {
 	}
 
 	if (useDepthRaster_) {
-		depthDraws_.reserve(256);
-		depthTransformed_ = (float *)AllocateMemoryPages(DEPTH_TRANSFORMED_BYTES, MEM_PROT_READ | MEM_PROT_WRITE);
-		depthScreenVerts_ = (int *)AllocateMemoryPages(DEPTH_SCREENVERTS_TOTAL_BYTES, MEM_PROT_READ | MEM_PROT_WRITE);
-		depthIndices_ = (uint16_t *)AllocateMemoryPages(DEPTH_INDEXBUFFER_BYTES, MEM_PROT_READ | MEM_PROT_WRITE);
+		for (auto &batch : depthBatches_) {
+			batch.draws.reserve(256);
+			batch.transformed = (float *)AllocateMemoryPages(DEPTH_TRANSFORMED_BYTES, MEM_PROT_READ | MEM_PROT_WRITE);
+			batch.indices = (uint16_t *)AllocateMemoryPages(DEPTH_INDEXBUFFER_BYTES, MEM_PROT_READ | MEM_PROT_WRITE);
+		}
+		depthRasterizer_ = new DepthRasterizer();
+		// The worker running the batch takes slices too, and finishes them alone if no other compute thread
+		// is free, so this can use every compute thread without waiting on tasks that never get scheduled.
+		depthRasterizer_->SetOptions(g_threadManager.GetNumLooperThreads(), true);
 	}
 }
 
 void DrawEngineCommon::ShutdownDepthRaster() {
-	if (depthTransformed_) {
-		FreeMemoryPages(depthTransformed_, DEPTH_TRANSFORMED_BYTES);
-	}
-	if (depthScreenVerts_) {
-		FreeMemoryPages(depthScreenVerts_, DEPTH_SCREENVERTS_TOTAL_BYTES);
-	}
-	if (depthIndices_) {
-		FreeMemoryPages(depthIndices_, DEPTH_INDEXBUFFER_BYTES);
+	FinishDepthBatch();
+	for (auto &batch : depthBatches_) {
+		if (batch.transformed) {
+			FreeMemoryPages(batch.transformed, DEPTH_TRANSFORMED_BYTES);
+		}
+		if (batch.indices) {
+			FreeMemoryPages(batch.indices, DEPTH_INDEXBUFFER_BYTES);
+		}
 	}
+	delete depthRasterizer_;
+	depthRasterizer_ = nullptr;
 }
 
 Mat4F32 ComputeFinalProjMatrix() {
@@ -1116,15 +1125,16 @@ bool DrawEngineCommon::CalculateDepthDraw(DepthDraw *draw, GEPrimitiveType prim,
 		_dbg_assert_(gstate.isDepthWriteEnabled());
 	}
 
-	if (depthVertexCount_ + vertexCount >= DEPTH_TRANSFORMED_MAX_VERTS) {
+	const DepthRasterBatch &batch = depthBatches_[curDepthBatch_];
+	if (batch.vertexCount + vertexCount >= DEPTH_TRANSFORMED_MAX_VERTS) {
 		// Can't add more. We need to flush.
 		return false;
 	}
 
 	draw->depthAddr = gstate.getDepthBufRawAddress() | 0x04000000;
 	draw->depthStride = gstate.DepthBufStride();
-	draw->vertexOffset = depthVertexCount_;
-	draw->indexOffset = depthIndexCount_;
+	draw->vertexOffset = batch.vertexCount;
+	draw->indexOffset = batch.indexCount;
 	draw->vertexCount = vertexCount;
 	draw->cullEnabled = gstate.isCullEnabled();
 	draw->cullMode = gstate.getCullMode();
@@ -1156,6 +1166,7 @@ void DrawEngineCommon::DepthRasterSubmitRaw(GEPrimitiveType prim, const VertexDe
 	}
 
 	TimeCollector collectStat(&gpuStats.perFrame.msPrepareDepth, g_coreCollectDebugStats);
+	DepthRasterBatch &batch = depthBatches_[curDepthBatch_];
 
 	// Decode.
 	int numDecoded = 0;
@@ -1167,22 +1178,22 @@ void DrawEngineCommon::DepthRasterSubmitRaw(GEPrimitiveType prim, const VertexDe
 			break;
 		}
 		// Decode the verts (and at the same time apply morphing/skinning). Simple.
-		DecodeAndTransformForDepthRaster(depthTransformed_ + (draw.vertexOffset + numDecoded) * 4, worldviewproj, dv.verts, dv.indexLowerBound, dv.indexUpperBound, dec, vertTypeID);
+		DecodeAndTransformForDepthRaster(batch.transformed + (draw.vertexOffset + numDecoded) * 4, worldviewproj, dv.verts, dv.indexLowerBound, dv.indexUpperBound, dec, vertTypeID);
 		numDecoded += dv.indexUpperBound - dv.indexLowerBound + 1;
 	}
 
 	// Copy indices.
-	memcpy(depthIndices_ + draw.indexOffset, decIndex_, sizeof(uint16_t) * vertexCount);
+	memcpy(batch.indices + draw.indexOffset, decIndex_, sizeof(uint16_t) * vertexCount);
 
 	// Commit
-	depthIndexCount_ += vertexCount;
-	depthVertexCount_ += numDecoded;
+	batch.indexCount += vertexCount;
+	batch.vertexCount += numDecoded;
 
-	if (depthDraws_.empty()) {
+	if (batch.draws.empty()) {
 		rasterTimeStart_ = time_now_d();
 	}
 
-	depthDraws_.push_back(draw);
+	batch.draws.push_back(draw);
 
 	// FlushQueuedDepth();
 }
@@ -1198,82 +1209,120 @@ void DrawEngineCommon::DepthRasterPredecoded(GEPrimitiveType prim, const void *i
 	}
 
 	TimeCollector collectStat(&gpuStats.perFrame.msPrepareDepth, g_coreCollectDebugStats);
+	DepthRasterBatch &batch = depthBatches_[curDepthBatch_];
 
 	// Make sure these have already been indexed away.
 	_dbg_assert_(prim != GE_PRIM_TRIANGLE_STRIP && prim != GE_PRIM_TRIANGLE_FAN);
 
 	if (dec->throughmode) {
-		ConvertPredecodedThroughForDepthRaster(depthTransformed_ + 4 * draw.vertexOffset, decoded_, dec, numDecoded);
+		ConvertPredecodedThroughForDepthRaster(batch.transformed + 4 * draw.vertexOffset, decoded_, dec, numDecoded);
 	} else {
 		if (dec->VertexType() & (GE_VTYPE_WEIGHT_MASK | GE_VTYPE_MORPHCOUNT_MASK)) {
 			return;
 		}
 		float worldviewproj[16];
 		ComputeFinalProjMatrix().Store(worldviewproj);
-		TransformPredecodedForDepthRaster(depthTransformed_ + 4 * draw.vertexOffset, worldviewproj, decoded_, dec, numDecoded);
+		TransformPredecodedForDepthRaster(batch.transformed + 4 * draw.vertexOffset, worldviewproj, decoded_, dec, numDecoded);
 	}
 
 	// Copy indices.
-	memcpy(depthIndices_ + draw.indexOffset, decIndex_, sizeof(uint16_t) * vertexCount);
+	memcpy(batch.indices + draw.indexOffset, decIndex_, sizeof(uint16_t) * vertexCount);
 
 	// Commit
-	depthIndexCount_ += vertexCount;
-	depthVertexCount_ += numDecoded;
+	batch.indexCount += vertexCount;
+	batch.vertexCount += numDecoded;
 
-	depthDraws_.push_back(draw);
-
-	if (depthDraws_.empty()) {
+	if (batch.draws.empty()) {
 		rasterTimeStart_ = time_now_d();
 	}
+
+	batch.draws.push_back(draw);
 	// FlushQueuedDepth();
 }
 
+class DepthRasterTask : public Task {
+public:
+	DepthRasterTask(std::function<void()> func, LimitedWaitable *waitable) : func_(std::move(func)), waitable_(waitable) {}
+
+	TaskType Type() const override { return TaskType::CPU_COMPUTE; }
+	TaskPriority Priority() const override { return TaskPriority::HIGH; }
+
+	void Run() override {
+		func_();
+		waitable_->Notify();
+	}
+
+private:
+	std::function<void()> func_;
+	LimitedWaitable *waitable_;
+};
+
 void DrawEngineCommon::FlushQueuedDepth() {
+	DepthRasterBatch &batch = depthBatches_[curDepthBatch_];
+	if (batch.draws.empty()) {
+		return;
+	}
+
 	if (rasterTimeStart_ != 0.0) {
 		gpuStats.perFrame.msRasterTimeAvailable += time_now_d() - rasterTimeStart_;
 		rasterTimeStart_ = 0.0;
 	}
 
-	const bool collectStats = g_coreCollectDebugStats;
-	const bool lowQ = g_Config.iDepthRasterMode == (int)DepthRasterMode::LOW_QUALITY;
-	for (const auto &draw : depthDraws_) {
-		int *tx = depthScreenVerts_;
-		int *ty = depthScreenVerts_ + DEPTH_SCREENVERTS_COMPONENT_COUNT;
-		float *tz = (float *)(depthScreenVerts_ + DEPTH_SCREENVERTS_COMPONENT_COUNT * 2);
+	// Only one batch is rasterized at a time, draws have to land in order and they share depthRasterizer_.
+	// Usually, the previous one finished long ago.
+	FinishDepthBatch();
 
-		int outVertCount = 0;
+	depthRasterWaitable_ = new LimitedWaitable();
+	g_threadManager.EnqueueTask(new DepthRasterTask([this, &batch]() {
+		RasterizeDepthBatch(batch);
+	}, depthRasterWaitable_));
+	curDepthBatch_ ^= 1;
+}
 
-		const float *vertices = depthTransformed_ + 4 * draw.vertexOffset;
-		const uint16_t *indices = depthIndices_ + draw.indexOffset;
+void DrawEngineCommon::WaitForQueuedDepth() {
+	FlushQueuedDepth();
+	FinishDepthBatch();
+}
 
-		DepthScissor tileScissor = draw.scissor.Tile(0, 1);
+void DrawEngineCommon::FinishDepthBatch() {
+	if (!depthRasterWaitable_) {
+		return;
+	}
 
-		{
-			TimeCollector collectStat(&gpuStats.perFrame.msCullDepth, collectStats);
-			switch (draw.prim) {
-			case GE_PRIM_RECTANGLES:
-				outVertCount = DepthRasterClipIndexedRectangles(tx, ty, tz, vertices, indices, draw, tileScissor);
-				break;
-			case GE_PRIM_TRIANGLES:
-				outVertCount = DepthRasterClipIndexedTriangles(tx, ty, tz, vertices, indices, draw, tileScissor);
-				break;
-			default:
-				_dbg_assert_(false);
-				break;
-			}
-		}
-		if (outVertCount > 0) {
-			TimeCollector collectStat(&gpuStats.perFrame.msRasterizeDepth, collectStats);
-			if (!Memory::IsValid4AlignedAddress(draw.depthAddr)) {
-				continue;
-			}
-			u16 *depthPtr = (uint16_t *)Memory::GetPointerWriteUnchecked(draw.depthAddr);
-			DepthRasterScreenVerts(depthPtr, draw.depthStride, tx, ty, tz, outVertCount, draw, tileScissor, lowQ);
-		}
+	{
+		TimeCollector collectStat(&gpuStats.perFrame.msWaitDepth, g_coreCollectDebugStats);
+		depthRasterWaitable_->WaitAndRelease();
+		depthRasterWaitable_ = nullptr;
+	}
+
+	// The batch that was rasterized is the one we're not currently filling.
+	DepthRasterBatch &batch = depthBatches_[curDepthBatch_ ^ 1];
+	const DepthRasterStats &stats = batch.stats;
+	gpuStats.perFrame.numDepthRasterPrims += stats.prims;
+	gpuStats.perFrame.numDepthRasterNoPixels += stats.noPixels;
+	gpuStats.perFrame.numDepthRasterTooSmall += stats.tooSmall;
+	gpuStats.perFrame.numDepthRasterEarlySize += stats.earlySize;
+	gpuStats.perFrame.numDepthRasterZCulled += stats.zCulled;
+	gpuStats.perFrame.numDepthEarlyBoxCulled += stats.boxCulled;
+	gpuStats.perFrame.msCullDepth += stats.cullTime;
+	gpuStats.perFrame.msRasterizeDepth += stats.rasterTime;
+	batch.stats = DepthRasterStats{};
+	batch.indexCount = 0;
+	batch.vertexCount = 0;
+	batch.draws.clear();
+}
+
+// Runs on a worker thread.
+void DrawEngineCommon::RasterizeDepthBatch(DepthRasterBatch &batch) {
+	const bool lowQ = g_Config.iDepthRasterMode == (int)DepthRasterMode::LOW_QUALITY;
+	if (DepthRasterIsRecording()) {
+		DepthRasterRecordBatch(batch.draws.data(), batch.draws.size(), batch.transformed, batch.vertexCount, batch.indices, batch.indexCount, lowQ);
 	}
 
-	// Reset queue
-	depthIndexCount_ = 0;
-	depthVertexCount_ = 0;
-	depthDraws_.clear();
+	depthRasterizer_->Rasterize(batch.draws.data(), batch.draws.size(), batch.transformed, batch.indices, [](u32 depthAddr) -> uint16_t * {
+		if (!Memory::IsValid4AlignedAddress(depthAddr)) {
+			return nullptr;
+		}
+		return (uint16_t *)Memory::GetPointerWriteUnchecked(depthAddr);
+	}, lowQ, g_coreCollectDebugStats, &batch.stats);
 }
@@ -27,12 +27,13 @@
 #include "GPU/Math3D.h"
 #include "GPU/GPUState.h"
 #include "GPU/GPUDefinitions.h"
+#include "GPU/Common/DepthRaster.h"
 #include "GPU/Common/GPUStateUtils.h"
 #include "GPU/Common/IndexGenerator.h"
 #include "GPU/Common/VertexDecoderCommon.h"
 
 class VertexDecoder;
-struct DepthDraw;
+class LimitedWaitable;
 
 enum {
 	VERTEX_BUFFER_MAX = 65536,
@@ -118,7 +119,7 @@ class DrawEngineCommon {
 	void SkipPrim(GEPrimitiveType prim, int vertexCount, const VertexDecoder *dec, int *bytesRead);
 
 	template<class Surface>
-	void SubmitCurve(const void *control_points, const void *indices, Surface &surface, u32 vertType, int *bytesRead, const char *scope);
+	void SubmitCurve(const void *control_points, const void *indices, Surface &surface, u32 vertType, int *bytesRead);
 	static void ClearSplineBezierWeights();
 
 	bool CanUseHardwareTransform(int prim) const;
@@ -153,7 +154,11 @@ class DrawEngineCommon {
 		return decoded_ + 12 * 65536;
 	}
 
+	// Hands the queued depth draws to a worker thread for rasterization. Returns immediately.
 	void FlushQueuedDepth();
+	// Flushes, and then waits until all depth draws have been rasterized into PSP memory.
+	// Call before anything that can read the depth buffer (CPU syncs, block transfers, copies.)
+	void WaitForQueuedDepth();
 
 protected:
 	bool CheckClipFlags(bool useHwTransform) const;
@@ -165,8 +170,22 @@ class DrawEngineCommon {
 
 	void ApplyFramebufferRead(FBOTexState *fboTexState);
 
+	// Queued depth draws with their own vertex and index storage. There are two, so one can be filled
+	// while the other one is rasterized.
+	struct DepthRasterBatch {
+		float *transformed = nullptr;
+		uint16_t *indices = nullptr;
+		int vertexCount = 0;
+		int indexCount = 0;
+		std::vector<DepthDraw> draws;
+		// Filled in by the worker, and added to gpuStats once the batch has been waited for.
+		DepthRasterStats stats{};
+	};
+
 	void InitDepthRaster();
 	void ShutdownDepthRaster();
+	void RasterizeDepthBatch(DepthRasterBatch &batch);
+	void FinishDepthBatch();
 	void DepthRasterSubmitRaw(GEPrimitiveType prim, const VertexDecoder *dec, uint32_t vertTypeID, int vertexCount);
 	void DepthRasterPredecoded(GEPrimitiveType prim, const void *inVerts, int numDecoded, const VertexDecoder *dec, int vertexCount);
 	bool CalculateDepthDraw(DepthDraw *draw, GEPrimitiveType prim, int vertexCount);
@@ -338,18 +357,18 @@ class DrawEngineCommon {
 	// Software depth raster
 	bool useDepthRaster_ = false;
 
-	float *depthTransformed_ = nullptr;
-	int *depthScreenVerts_ = nullptr;
-	uint16_t *depthIndices_ = nullptr;
+	// Only used by the worker.
+	DepthRasterizer *depthRasterizer_ = nullptr;
 
 	// Depth tracking
 	ClipInfoFlags clipInfoFlags_{};
 	ClipInfoFlags lastClipInfoFlags_{};  // Flags at the last flush. For dirtying.
 
 	// Queue
-	int depthVertexCount_ = 0;
-	int depthIndexCount_ = 0;
-	std::vector<DepthDraw> depthDraws_;
+	DepthRasterBatch depthBatches_[2];
+	int curDepthBatch_ = 0;
+	// Set while the other batch is being rasterized.
+	LimitedWaitable *depthRasterWaitable_ = nullptr;
 
 	double rasterTimeStart_ = 0.0;
 
@@ -3309,7 +3309,7 @@ void FramebufferManagerCommon::ReadFramebufferToMemory(VirtualFramebuffer *vfb,
 }
 
 void FramebufferManagerCommon::FlushBeforeCopy() {
-	drawEngine_->FlushQueuedDepth();
+	drawEngine_->WaitForQueuedDepth();
 	// Flush anything not yet drawn before blitting, downloading, or uploading.
 	// This might be a stalled list, or unflushed before a block transfer, etc.
 	// Only bother if any draws are pending.
@@ -24,7 +24,10 @@
 #include "ext/basis_universal/basisu_transcoder.h"
 #include "ext/basis_universal/basisu_file_headers.h"
 
+#include "ext/xxhash.h"
+
 #include "GPU/Common/ReplacedTexture.h"
+#include "GPU/Common/ReplacedTextureCache.h"
 #include "GPU/Common/TextureReplacer.h"
 #include "Core/Util/PathUtil.h"
 
@@ -675,7 +678,7 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 			}
 			free(image[0]);
 
-			const TextureAlpha res = CheckAlpha32Rect((u32 *)&out[0], level.w, w[0], h[0], 0xFF000000);
+			const TextureAlpha res = ParallelCheckAlpha32Rect((u32 *)&out[0], level.w, w[0], h[0], 0xFF000000);
 			if (res == TextureAlpha::Any || mipLevel == 0) {
 				alphaStatus_ = res;
 			}
@@ -694,6 +697,21 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 		pngdata.resize(fileSize);
 		pngdata.resize(vfs_->Read(openFile, &pngdata[0], fileSize));
 		vfs_->CloseFile(openFile);
+
+		// PNG decoding can't be split across threads, but the cache format can, and is much faster anyway.
+		uint64_t sourceHash = 0;
+		if (!desc_.decodeCachePath.empty()) {
+			sourceHash = XXH3_64bits(pngdata.data(), pngdata.size());
+			TextureAlpha cachedAlpha;
+			if (LoadCachedReplacementImage(desc_.decodeCachePath, sourceHash, level.w, level.h, &data_[mipLevel], &cachedAlpha)) {
+				if (cachedAlpha == TextureAlpha::Any || mipLevel == 0) {
+					alphaStatus_ = cachedAlpha;
+				}
+				levels_.push_back(level);
+				return LoadLevelResult::CONTINUE;
+			}
+		}
+
 		if (!png_image_begin_read_from_memory(&png, &pngdata[0], pngdata.size())) {
 			ERROR_LOG(Log::TexReplacement, "Could not load texture replacement info: %s - %s (zip)", filename.c_str(), png.message);
 			return LoadLevelResult::LOAD_ERROR;
@@ -723,14 +741,19 @@ ReplacedTexture::LoadLevelResult ReplacedTexture::LoadLevelData(VFSFileReference
 		}
 		png_image_free(&png);
 
+		TextureAlpha levelAlpha = TextureAlpha::Solid;
 		if (!checkedAlpha) {
 			// This will only check the hashed bits.
-			const TextureAlpha res = CheckAlpha32Rect((u32 *)&out[0], level.w, png.width, png.height, 0xFF000000);
-			if (res == TextureAlpha::Any || mipLevel == 0) {
-				alphaStatus_ = res;
+			levelAlpha = ParallelCheckAlpha32Rect((u32 *)&out[0], level.w, png.width, png.height, 0xFF000000);
+			if (levelAlpha == TextureAlpha::Any || mipLevel == 0) {
+				alphaStatus_ = levelAlpha;
 			}
 		}
 
+		if (!desc_.decodeCachePath.empty()) {
+			SaveCachedReplacementImage(desc_.decodeCachePath, sourceHash, level.w, level.h, out.data(), levelAlpha);
+		}
+
 		levels_.push_back(level);
 		return LoadLevelResult::CONTINUE;
 	} else {
@@ -108,6 +108,8 @@ struct ReplacementDesc {
 	TextureFiltering forceFiltering;
 	std::string hashfiles;
 	Path basePath;
+	// If set, decoded PNG levels are cached here (see ReplacedTextureCache.h.)
+	Path decodeCachePath;
 	std::vector<std::string> filenames;
 	std::string logId;
 	GPUFormatSupport formatSupport;
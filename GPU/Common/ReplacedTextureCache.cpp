@@ -0,0 +1,274 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include <zstd.h>
+
+#include "ext/xxhash.h"
+
+#include "Common/File/DirListing.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "GPU/Common/ReplacedTextureCache.h"
+#include "GPU/Common/TextureDecoder.h"
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'P', 'R', 'T', 'C' };
+const uint32_t CACHE_VERSION = 1;
+// Rows are grouped so each strip is about this many bytes uncompressed.
+const int STRIP_TARGET_BYTES = 256 * 1024;
+// Fast to compress (we do it during gameplay), and decompression speed barely depends on the level.
+const int CACHE_ZSTD_LEVEL = 1;
+
+struct CachedImageHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t w;
+	uint32_t h;
+	uint64_t sourceHash;
+	uint32_t alpha;
+	uint32_t rowsPerStrip;
+	uint32_t stripCount;
+	uint32_t reserved;
+	// Followed by stripCount StripInfo, then the strips back to back.
+};
+
+struct StripInfo {
+	uint32_t compressedSize;
+	// Of the uncompressed rows. zstd frames don't have one by default, so corruption could go unnoticed.
+	uint32_t checksum;
+};
+
+Path CacheFilename(const Path &cacheDir, uint64_t sourceHash) {
+	return cacheDir / StringFromFormat("%016llx.rtc", (unsigned long long)sourceHash);
+}
+
+// Bytes saved since the size was last checked. Listing the directory on every save would be slow.
+std::atomic<uint64_t> g_bytesSinceTrim;
+std::mutex g_trimLock;
+
+void ListCacheEntries(const Path &dir, std::vector<File::FileInfo> *entries) {
+	std::vector<File::FileInfo> files;
+	File::GetFilesInDir(dir, &files, "rtc");
+	for (const File::FileInfo &file : files) {
+		if (file.isDirectory) {
+			ListCacheEntries(file.fullName, entries);
+		} else {
+			entries->push_back(file);
+		}
+	}
+}
+
+}  // namespace
+
+bool LoadCachedReplacementImage(const Path &cacheDir, uint64_t sourceHash, int w, int h, std::vector<uint8_t> *out, TextureAlpha *alpha) {
+	std::string data;
+	if (!File::ReadBinaryFileToString(CacheFilename(cacheDir, sourceHash), &data)) {
+		return false;
+	}
+
+	CachedImageHeader header;
+	if (data.size() < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != CACHE_VERSION || header.sourceHash != sourceHash) {
+		return false;
+	}
+	if (header.w != (uint32_t)w || header.h != (uint32_t)h || header.rowsPerStrip == 0) {
+		WARN_LOG(Log::TexReplacement, "Cached replacement image has the wrong size (%dx%d, expected %dx%d), ignoring", header.w, header.h, w, h);
+		return false;
+	}
+	const uint32_t stripCount = (header.h + header.rowsPerStrip - 1) / header.rowsPerStrip;
+	if (header.stripCount != stripCount || data.size() < sizeof(header) + stripCount * sizeof(StripInfo)) {
+		return false;
+	}
+
+	// Compute where each strip starts, and check they're all within the file.
+	std::vector<StripInfo> strips(stripCount);
+	memcpy(strips.data(), data.data() + sizeof(header), stripCount * sizeof(StripInfo));
+	std::vector<size_t> offsets(stripCount + 1);
+	offsets[0] = sizeof(header) + stripCount * sizeof(StripInfo);
+	for (uint32_t i = 0; i < stripCount; i++) {
+		offsets[i + 1] = offsets[i] + strips[i].compressedSize;
+	}
+	if (offsets[stripCount] > data.size()) {
+		return false;
+	}
+
+	const size_t rowBytes = (size_t)w * 4;
+	out->resize(rowBytes * h);
+	std::atomic<bool> failed{};
+	ParallelRangeLoop(&g_threadManager, [&](int l, int u) {
+		for (int i = l; i < u; i++) {
+			int y = i * header.rowsPerStrip;
+			int rows = std::min((int)header.rowsPerStrip, h - y);
+			size_t expected = rowBytes * rows;
+			uint8_t *dest = out->data() + rowBytes * y;
+			size_t result = ZSTD_decompress(dest, expected, data.data() + offsets[i], offsets[i + 1] - offsets[i]);
+			if (ZSTD_isError(result) || result != expected || (uint32_t)XXH3_64bits(dest, expected) != strips[i].checksum) {
+				failed = true;
+			}
+		}
+	}, 0, (int)stripCount, 1);
+
+	if (failed) {
+		WARN_LOG(Log::TexReplacement, "Cached replacement image %016llx is corrupt, ignoring", (unsigned long long)sourceHash);
+		out->clear();
+		return false;
+	}
+
+	// The modification time doubles as the last use, for trimming.
+	File::ChangeMTime(CacheFilename(cacheDir, sourceHash), (time_t)time_now_unix_utc());
+	*alpha = (TextureAlpha)header.alpha;
+	return true;
+}
+
+bool SaveCachedReplacementImage(const Path &cacheDir, uint64_t sourceHash, int w, int h, const uint8_t *rgba, TextureAlpha alpha) {
+	const size_t rowBytes = (size_t)w * 4;
+	const int rowsPerStrip = std::max(1, STRIP_TARGET_BYTES / (int)rowBytes);
+	const int stripCount = (h + rowsPerStrip - 1) / rowsPerStrip;
+
+	std::vector<std::vector<uint8_t>> strips(stripCount);
+	std::vector<StripInfo> stripInfo(stripCount);
+	std::atomic<bool> failed{};
+	ParallelRangeLoop(&g_threadManager, [&](int l, int u) {
+		for (int i = l; i < u; i++) {
+			int y = i * rowsPerStrip;
+			int rows = std::min(rowsPerStrip, h - y);
+			size_t srcSize = rowBytes * rows;
+			strips[i].resize(ZSTD_compressBound(srcSize));
+			size_t result = ZSTD_compress(strips[i].data(), strips[i].size(), rgba + rowBytes * y, srcSize, CACHE_ZSTD_LEVEL);
+			if (ZSTD_isError(result)) {
+				failed = true;
+				continue;
+			}
+			strips[i].resize(result);
+			stripInfo[i].compressedSize = (uint32_t)result;
+			stripInfo[i].checksum = (uint32_t)XXH3_64bits(rgba + rowBytes * y, srcSize);
+		}
+	}, 0, stripCount, 1);
+
+	if (failed) {
+		ERROR_LOG(Log::TexReplacement, "Failed to compress replacement image for the cache");
+		return false;
+	}
+
+	CachedImageHeader header{};
+	memcpy(header.magic, CACHE_MAGIC, 4);
+	header.version = CACHE_VERSION;
+	header.w = w;
+	header.h = h;
+	header.sourceHash = sourceHash;
+	header.alpha = (uint32_t)alpha;
+	header.rowsPerStrip = rowsPerStrip;
+	header.stripCount = stripCount;
+
+	std::string data;
+	data.append((const char *)&header, sizeof(header));
+	data.append((const char *)stripInfo.data(), stripInfo.size() * sizeof(StripInfo));
+	for (const auto &strip : strips) {
+		data.append((const char *)strip.data(), strip.size());
+	}
+
+	if (!File::Exists(cacheDir) && !File::CreateFullPath(cacheDir)) {
+		ERROR_LOG(Log::TexReplacement, "Failed to create replacement cache directory %s", cacheDir.c_str());
+		return false;
+	}
+
+	// Write under a temporary name, so a crash (or another texture task) never sees a partial file.
+	const Path filename = CacheFilename(cacheDir, sourceHash);
+	const Path tempFilename = filename.WithExtraExtension(".tmp");
+	if (!File::WriteDataToFile(false, data.data(), data.size(), tempFilename)) {
+		ERROR_LOG(Log::TexReplacement, "Failed to write replacement cache file %s", tempFilename.c_str());
+		return false;
+	}
+	if (!File::Rename(tempFilename, filename)) {
+		File::Delete(tempFilename, true);
+		return false;
+	}
+
+	if ((g_bytesSinceTrim += data.size()) >= REPLACEMENT_IMAGE_CACHE_MAX_BYTES / 8) {
+		g_bytesSinceTrim = 0;
+		TrimReplacementImageCache(cacheDir, REPLACEMENT_IMAGE_CACHE_MAX_BYTES);
+	}
+	return true;
+}
+
+void TrimReplacementImageCache(const Path &cacheDir, uint64_t maxBytes) {
+	// If another thread is already trimming, that's good enough.
+	std::unique_lock<std::mutex> guard(g_trimLock, std::try_to_lock);
+	if (!guard.owns_lock()) {
+		return;
+	}
+
+	std::vector<File::FileInfo> entries;
+	ListCacheEntries(cacheDir, &entries);
+	uint64_t total = 0;
+	for (const File::FileInfo &entry : entries) {
+		total += entry.size;
+	}
+	if (total <= maxBytes) {
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const File::FileInfo &a, const File::FileInfo &b) {
+		if (a.mtime != b.mtime)
+			return a.mtime < b.mtime;
+		return a.mtimeUs < b.mtimeUs;
+	});
+
+	// Go a bit below the limit, so the next few saves don't immediately trim again.
+	const uint64_t target = maxBytes - maxBytes / 8;
+	int deleted = 0;
+	for (const File::FileInfo &entry : entries) {
+		if (total <= target) {
+			break;
+		}
+		if (File::Delete(entry.fullName, true)) {
+			total -= entry.size;
+			deleted++;
+		}
+	}
+	INFO_LOG(Log::TexReplacement, "Trimmed %d old entries from the replacement cache in %s", deleted, cacheDir.c_str());
+}
+
+TextureAlpha ParallelCheckAlpha32Rect(const uint32_t *pixelData, int stride, int width, int height, uint32_t fullAlphaMask) {
+	// Not worth splitting small images.
+	const int MIN_LINES_PER_THREAD = std::max(4, 65536 / std::max(width, 1));
+	if (height <= MIN_LINES_PER_THREAD) {
+		return CheckAlpha32Rect(pixelData, stride, width, height, fullAlphaMask);
+	}
+
+	std::atomic<bool> anyAlpha{};
+	ParallelRangeLoop(&g_threadManager, [&](int l, int u) {
+		if (anyAlpha)
+			return;
+		if (CheckAlpha32Rect(pixelData + stride * l, stride, width, u - l, fullAlphaMask) == TextureAlpha::Any)
+			anyAlpha = true;
+	}, 0, height, MIN_LINES_PER_THREAD);
+	return anyAlpha ? TextureAlpha::Any : TextureAlpha::Solid;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2016- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Common/File/Path.h"
+#include "GPU/Common/ImageCommon.h"
+
+// On-disk cache of decoded (RGBA8888) replacement images, so PNG packs only pay for the PNG decode once.
+//
+// The pixels are zstd-compressed in independent strips of rows, which unlike a PNG stream can be
+// decompressed on all cores at once. Entries are named by a hash of the source file, so an edited
+// pack never picks up stale data.
+
+// The cache is kept under this size, dropping the least recently used entries first.
+const uint64_t REPLACEMENT_IMAGE_CACHE_MAX_BYTES = 2048ULL * 1024 * 1024;
+
+// Returns false if there's no valid entry (or it doesn't match the expected size.)
+// A successful load marks the entry as recently used.
+bool LoadCachedReplacementImage(const Path &cacheDir, uint64_t sourceHash, int w, int h, std::vector<uint8_t> *out, TextureAlpha *alpha);
+bool SaveCachedReplacementImage(const Path &cacheDir, uint64_t sourceHash, int w, int h, const uint8_t *rgba, TextureAlpha alpha);
+
+// Deletes entries in cacheDir (and its subdirectories) by oldest modification time until the total is
+// comfortably below maxBytes. Entries for PNGs that were edited or removed are never loaded again, so they go first.
+void TrimReplacementImageCache(const Path &cacheDir, uint64_t maxBytes);
+
+// CheckAlpha32Rect, split across threads for large images.
+TextureAlpha ParallelCheckAlpha32Rect(const uint32_t *pixelData, int stride, int width, int height, uint32_t fullAlphaMask);
@@ -40,6 +40,7 @@
 #include "Core/Config.h"
 #include "Core/System.h"
 #include "Core/ELF/ParamSFO.h"
+#include "GPU/Common/ReplacedTextureCache.h"
 #include "GPU/Common/TextureReplacer.h"
 #include "GPU/Common/TextureDecoder.h"
 
@@ -79,8 +80,9 @@ TextureReplacer::~TextureReplacer() {
 	delete vfs_;
 }
 
-bool TextureReplacer::LoadPackForTesting(const Path &basePath, std::string *error) {
+bool TextureReplacer::LoadPackForTesting(const Path &basePath, std::string *error, const Path &decodeCachePath) {
 	basePath_ = basePath;
+	decodeCachePath_ = decodeCachePath;
 	gameID_ = "";
 	replaceEnabled_ = true;
 	saveEnabled_ = false;
@@ -98,6 +100,13 @@ void TextureReplacer::NotifyConfigChanged() {
 		basePath_ = GetSysDirectory(DIRECTORY_TEXTURES) / gameID_;
 		replaceEnabled_ = replaceEnabled_ && File::IsDirectory(basePath_);
 		newTextureDir_ = basePath_ / NEW_TEXTURE_DIR;
+		decodeCachePath_.clear();
+		if (g_Config.bReplaceTexturesDecodeCache) {
+			const Path decodeCacheRoot = GetSysDirectory(DIRECTORY_CACHE) / "ReplacedTextures";
+			decodeCachePath_ = decodeCacheRoot / gameID_;
+			// Over all games, so entries of removed packs and games don't pile up.
+			TrimReplacementImageCache(decodeCacheRoot, REPLACEMENT_IMAGE_CACHE_MAX_BYTES);
+		}
 
 		// If we're saving, auto-create the directory.
 		if (saveEnabled_ && !File::Exists(newTextureDir_)) {
@@ -689,6 +698,7 @@ ReplacedTexture *TextureReplacer::FindReplacement(ReplacementCacheKey replacemen
 
 	// Final path - we actually need a new replacement texture, because we haven't seen "hashfiles" before.
 	desc.basePath = basePath_;
+	desc.decodeCachePath = decodeCachePath_;
 	desc.formatSupport = formatSupport_;
 
 	ReplacedTexture *texture = new ReplacedTexture(vfs_, desc);
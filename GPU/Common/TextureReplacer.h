@@ -95,7 +95,8 @@ class TextureReplacer {
 
 	// For testing: point the replacer at a texture pack directory and load its
 	// ini, without touching the global config. Returns true on success.
-	bool LoadPackForTesting(const Path &basePath, std::string *error);
+	// If decodeCachePath is set, decoded PNGs are cached there.
+	bool LoadPackForTesting(const Path &basePath, std::string *error, const Path &decodeCachePath = Path());
 
 	// Check if a NotifyTextureDecoded for this texture is desired (used to avoid reads from write-combined memory.)
 	bool WillSave(const ReplacedTextureDecodeInfo &replacedInfo) const;
@@ -141,6 +142,7 @@ class TextureReplacer {
 	std::string gameID_;
 	Path basePath_;
 	Path newTextureDir_;
+	Path decodeCachePath_;
 	ReplacedTextureHash textureHash_ = ReplacedTextureHash::QUICK;
 
 	VFSBackend *vfs_ = nullptr;
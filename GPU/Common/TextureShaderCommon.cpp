@@ -158,6 +158,155 @@ std::string TextureShaderCache::DebugGetShaderString(const std::string &idstr, D
 	}
 }
 
+static const char *const textureDecodeShader = R"(
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+#define TEX_FORMAT %d
+#define CLUT_FORMAT %d
+#define SWIZZLED %d
+
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform layout(set = 0, binding = 0, rgba8) writeonly image2D img;
+
+layout(std430, set = 0, binding = 1) readonly buffer Tex {
+	uint data[];
+} tex;
+
+layout(std430, set = 0, binding = 2) readonly buffer Clut {
+	uint data[];
+} clut;
+
+layout(push_constant) uniform Params {
+	int width;
+	int height;
+	int bufw;
+	uint clutParams;
+} params;
+
+// Same numbering as GETextureFormat.
+#define TFMT_5650 0
+#define TFMT_5551 1
+#define TFMT_4444 2
+#define TFMT_8888 3
+#define TFMT_CLUT4 4
+#define TFMT_CLUT8 5
+#define TFMT_CLUT16 6
+#define TFMT_CLUT32 7
+
+#if TEX_FORMAT == TFMT_CLUT4
+#define BITS_PER_TEXEL 4
+#elif TEX_FORMAT == TFMT_CLUT8
+#define BITS_PER_TEXEL 8
+#elif TEX_FORMAT == TFMT_8888 || TEX_FORMAT == TFMT_CLUT32
+#define BITS_PER_TEXEL 32
+#else
+#define BITS_PER_TEXEL 16
+#endif
+
+// The texel's byte (or for 4-bit, the byte holding it) in the raw data.
+uint texelOffset(uint x, uint y) {
+	uint rowBytes = uint(params.bufw) * BITS_PER_TEXEL / 8;
+#if BITS_PER_TEXEL == 4
+	uint byteX = x >> 1;
+#else
+	uint byteX = x * (BITS_PER_TEXEL / 8);
+#endif
+#if SWIZZLED
+	// Blocks of 16 bytes by 8 rows, stored one after another.
+	uint block = (y >> 3) * (rowBytes >> 4) + (byteX >> 4);
+	return block * 128 + (y & 7) * 16 + (byteX & 15);
+#else
+	return y * rowBytes + byteX;
+#endif
+}
+
+uint readTexel(uint x, uint y) {
+	uint offset = texelOffset(x, y);
+	uint word = tex.data[offset >> 2];
+#if BITS_PER_TEXEL == 4
+	return (word >> ((offset & 3) * 8 + (x & 1) * 4)) & 0xF;
+#elif BITS_PER_TEXEL == 8
+	return (word >> ((offset & 3) * 8)) & 0xFF;
+#elif BITS_PER_TEXEL == 16
+	return (word >> ((offset & 2) * 8)) & 0xFFFF;
+#else
+	return word;
+#endif
+}
+
+// Bit replication, same as Convert5To8() and friends.
+vec4 toColor(uint r, uint g, uint b, uint a) {
+	return vec4(uvec4(r, g, b, a)) * (1.0 / 255.0);
+}
+
+// 0 = 5650, 1 = 5551, 2 = 4444, 3 = 8888, both for the CLUT and direct formats.
+vec4 convertColor(uint c, int format) {
+	if (format == 0) {
+		uint r = c & 0x1F, g = (c >> 5) & 0x3F, b = (c >> 11) & 0x1F;
+		return toColor((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255);
+	} else if (format == 1) {
+		uint r = c & 0x1F, g = (c >> 5) & 0x1F, b = (c >> 10) & 0x1F;
+		return toColor((r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), (c & 0x8000) != 0 ? 255 : 0);
+	} else if (format == 2) {
+		uint r = c & 0xF, g = (c >> 4) & 0xF, b = (c >> 8) & 0xF, a = (c >> 12) & 0xF;
+		return toColor(r * 17, g * 17, b * 17, a * 17);
+	}
+	return unpackUnorm4x8(c);
+}
+
+#if TEX_FORMAT >= TFMT_CLUT4
+vec4 lookupClut(uint index) {
+	uint shift = params.clutParams & 0x1F;
+	uint mask = (params.clutParams >> 5) & 0xFF;
+	uint start = (params.clutParams >> 13) & 0x1FF;
+	uint offset = params.clutParams >> 22;
+	uint i = offset + (((index >> shift) & mask) | start);
+#if CLUT_FORMAT == 3
+	uint c = clut.data[i & 511];
+#else
+	uint c = (clut.data[(i >> 1) & 511] >> ((i & 1) * 16)) & 0xFFFF;
+#endif
+	return convertColor(c, CLUT_FORMAT);
+}
+#endif
+
+void main() {
+	uvec2 xy = gl_GlobalInvocationID.xy;
+	if (xy.x >= params.width || xy.y >= params.height)
+		return;
+	uint texel = readTexel(xy.x, xy.y);
+#if TEX_FORMAT >= TFMT_CLUT4
+	vec4 color = lookupClut(texel);
+#else
+	vec4 color = convertColor(texel, TEX_FORMAT);
+#endif
+	imageStore(img, ivec2(xy), color);
+}
+)";
+
+u32 TextureDecodeShaderKey::ToU32() const {
+	// The CLUT format doesn't matter for the direct formats, so don't let it make separate shaders.
+	u32 clut = texFormat >= GE_TFMT_CLUT4 ? (u32)clutFormat : 0;
+	return (u32)texFormat | (clut << 4) | ((swizzled ? 1 : 0) << 6);
+}
+
+bool TextureDecodeShaderSupported(GETextureFormat format) {
+	return format <= GE_TFMT_CLUT32;
+}
+
+std::string GenerateTextureDecodeShader(const TextureDecodeShaderKey &key) {
+	_dbg_assert_(TextureDecodeShaderSupported(key.texFormat));
+	int clutFormat = key.texFormat >= GE_TFMT_CLUT4 ? (int)key.clutFormat : 0;
+	return StringFromFormat(textureDecodeShader, (int)key.texFormat, clutFormat, key.swizzled ? 1 : 0);
+}
+
+u32 PackTextureDecodeClutParams(int shift, int mask, int start, int offset) {
+	_dbg_assert_(shift < 32 && mask < 256 && start < 512 && offset < 1024);
+	return (u32)shift | ((u32)mask << 5) | ((u32)start << 13) | ((u32)offset << 22);
+}
+
 void ClutTextureCache::DeviceRestore(Draw::DrawContext *draw) {
 	draw_ = draw;
 }
@@ -52,6 +52,37 @@ class ClutTextureCache {
 	std::unordered_map<u32, ClutTexture *> texCache_;
 };
 
+// Compute shaders that decode raw PSP texture data straight into an RGBA8 storage image, reading through
+// the CLUT and undoing the swizzle as needed. These are GLSL for Vulkan, see TextureCacheVulkan.
+//
+// The shader reads the raw texture bytes from binding 1 and the raw CLUT (all 2048 bytes of it) from binding 2,
+// both as storage buffers, and writes to the storage image at binding 0. Output matches the CPU decoder
+// expanding to 32-bit.
+struct TextureDecodeShaderKey {
+	GETextureFormat texFormat;
+	// Ignored unless texFormat is a CLUT format.
+	GEPaletteFormat clutFormat;
+	bool swizzled;
+
+	u32 ToU32() const;
+};
+
+// Push constants for the decode shaders.
+struct TextureDecodeShaderParams {
+	int width;
+	int height;
+	// In texels.
+	int bufw;
+	// See PackTextureDecodeClutParams().
+	u32 clutParams;
+};
+
+// The DXT formats are still decoded on the CPU.
+bool TextureDecodeShaderSupported(GETextureFormat format);
+std::string GenerateTextureDecodeShader(const TextureDecodeShaderKey &key);
+// start should already be masked the way transformClutIndex() does, and offset is in CLUT entries (for mipmaps with their own CLUTs.)
+u32 PackTextureDecodeClutParams(int shift, int mask, int start, int offset);
+
 // For CLUT depal shaders, and other pre-bind texture shaders.
 // Caches both shaders and palette textures.
 class TextureShaderCache {
@@ -18,6 +18,7 @@
 #include <wrl/client.h>
 
 #include "Common/Log.h"
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/Profiler/Profiler.h"
 
 #include "Core/Config.h"
@@ -269,6 +270,7 @@ void DrawEngineD3D11::Flush() {
 	if (!numDrawVerts_) {
 		return;
 	}
+	FrameTraceScope traceScope(FrameTraceStage::DRAW_SUBMIT);
 
 	// This is not done on every drawcall, we collect vertex data
 	// until critical state changes. That's when we draw (flush).
@@ -20,6 +20,7 @@
 #include "Common/LogReporting.h"
 
 #include "Common/GPU/OpenGL/GLDebugLog.h"
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/Profiler/Profiler.h"
 
 #include "GPU/GPUState.h"
@@ -217,6 +218,7 @@ void DrawEngineGLES::Flush() {
 		return;
 	}
 	PROFILE_THIS_SCOPE("flush");
+	FrameTraceScope traceScope(FrameTraceStage::DRAW_SUBMIT);
 	FrameData &frameData = frameData_[render_->GetCurFrame()];
 	VShaderID vsid;
 
@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/Profiler/Profiler.h"
 #include "Common/Data/Text/I18n.h"
 
@@ -91,6 +92,7 @@ GPU_GLES::GPU_GLES(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 		if (g_Config.bShaderCache) {
 			File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
 			shaderCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".glshadercache");
+			programBinaryCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".glprogrambinary");
 			// Actually precompiled by IsReady() since we're single-threaded.
 			File::IOFile f(shaderCachePath_, "rb");
 			if (f.IsOpen()) {
@@ -99,6 +101,7 @@ GPU_GLES::GPU_GLES(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 					// We're compiling now, clear if they changed.
 					gstate_c.useFlagsChanged = false;
 
+					shaderManagerGL_->LoadProgramBinaryCache(programBinaryCachePath_);
 					if (shaderManagerGL_->LoadCache(f))
 						NOTICE_LOG(Log::G3D, "Precompiling the shader cache from '%s'", shaderCachePath_.c_str());
 				}
@@ -116,6 +119,7 @@ GPU_GLES::~GPU_GLES() {
 	if (shaderCachePath_.Valid() && draw_) {
 		if (g_Config.bShaderCache) {
 			shaderManagerGL_->SaveCache(shaderCachePath_, &drawEngine_);
+			shaderManagerGL_->SaveProgramBinaryCache(programBinaryCachePath_);
 		} else {
 			INFO_LOG(Log::G3D, "Shader cache disabled. Not saving.");
 		}
@@ -220,6 +224,7 @@ void GPU_GLES::BeginHostFrame(const DisplayLayoutConfig &config) {
 	constexpr int saveShaderCacheFrameInterval = 32767;  // power of 2 - 1. About every 10 minutes at 60fps.
 	if (shaderCachePath_.Valid() && !(gpuStats.totals.numFlips & saveShaderCacheFrameInterval) && coreState == CORE_RUNNING_CPU) {
 		shaderManagerGL_->SaveCache(shaderCachePath_, &drawEngine_);
+		shaderManagerGL_->SaveProgramBinaryCache(programBinaryCachePath_);
 	}
 
 	gstate_c.Dirty(DIRTY_ALL_UNIFORMS | DIRTY_FRAGMENTSHADER_STATE | DIRTY_VERTEXSHADER_STATE);
@@ -239,6 +244,8 @@ void GPU_GLES::BeginHostFrame(const DisplayLayoutConfig &config) {
 
 void GPU_GLES::EndHostFrame() {
 	drawEngine_.EndFrame();
+	// Doesn't call GPUCommonHW::EndHostFrame(), but the frame still has to end.
+	FrameTrace::EndFrame();
 }
 
 void GPU_GLES::FinishDeferred() {
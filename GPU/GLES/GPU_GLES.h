@@ -60,4 +60,5 @@ class GPU_GLES : public GPUCommonHW {
 	ShaderManagerGLES *shaderManagerGL_;
 
 	Path shaderCachePath_;
+	Path programBinaryCachePath_;
 };
@@ -41,6 +41,7 @@
 #include "Common/Log.h"
 #include "Common/File/FileUtil.h"
 #include "Common/TimeUtil.h"
+#include "ext/xxhash.h"
 #include "Core/Config.h"
 #include "GPU/Math3D.h"
 #include "GPU/GPUState.h"
@@ -202,7 +203,18 @@ LinkedShader::LinkedShader(GLRenderManager *render, VShaderID VSID, Shader *vs,
 		flags.useClipDistance0 = true;
 	}
 
-	program = render->CreateProgram(shaders, semantics, queries, initialize, nullptr, flags);
+	// Everything that affects the linked program: the generated sources (not just the IDs, the generators
+	// change), the attribute semantics and the flags.
+	XXH3_state_t *hashState = XXH3_createState();
+	XXH3_64bits_reset(hashState);
+	XXH3_64bits_update(hashState, vs->source().data(), vs->source().size());
+	XXH3_64bits_update(hashState, fs->source().data(), fs->source().size());
+	XXH3_64bits_update(hashState, &useHWTransform_, sizeof(useHWTransform_));
+	XXH3_64bits_update(hashState, &flags, sizeof(flags));
+	uint64_t binaryKey = XXH3_64bits_digest(hashState);
+	XXH3_freeState(hashState);
+
+	program = render->CreateProgram(shaders, semantics, queries, initialize, nullptr, flags, binaryKey ? binaryKey : 1);
 
 	// The rest, use the "dirty" mechanism.
 	dirtyUniforms = DIRTY_ALL_UNIFORMS;
@@ -863,13 +875,29 @@ std::string ShaderManagerGLES::DebugGetShaderString(std::string id, DebugShaderT
 	}
 }
 
+bool ShaderManagerGLES::LoadProgramBinaryCache(const Path &filename) {
+	if (!render_ || !GLProgramBinaryCache::IsSupported()) {
+		return false;
+	}
+	return render_->GetProgramBinaryCache().Load(filename);
+}
+
+void ShaderManagerGLES::SaveProgramBinaryCache(const Path &filename) {
+	if (!render_ || !GLProgramBinaryCache::IsSupported()) {
+		return;
+	}
+	GLProgramBinaryCache &cache = render_->GetProgramBinaryCache();
+	INFO_LOG(Log::G3D, "Program binaries: %d used from cache, %d rejected by the driver", cache.Hits(), cache.Rejected());
+	cache.Save(filename);
+}
+
 // Shader pseudo-cache.
 //
 // We simply store the IDs of the shaders used during gameplay. On next startup of
 // the same game, we simply compile all the shaders from the start, so we don't have to
-// compile them on the fly later. Ideally we would store the actual compiled shaders
-// rather than just their IDs, but OpenGL does not support this, except for a few obscure
-// vendor-specific extensions.
+// compile them on the fly later. Where GL_ARB_get_program_binary is available, the linked
+// programs are also stored separately (see LoadProgramBinaryCache), which skips most of the
+// compile time.
 //
 // If things like GPU supported features have changed since the last time, we discard the cache
 // as sometimes these features might have an effect on the ID bits.
@@ -144,6 +144,7 @@ class Shader {
 	GLRShader *shader;
 
 	bool UseHWTransform() const { return useHWTransform_; }  // only relevant for vtx shaders
+	const std::string &source() const { return source_; }
 
 	std::string GetShaderString(DebugShaderStringType type, ShaderID id) const;
 
@@ -189,6 +190,10 @@ class ShaderManagerGLES : public ShaderManagerCommon {
 	bool LoadCache(File::IOFile &f);
 	void SaveCache(const Path &filename, DrawEngineGLES *drawEngine);
 
+	// Linked program binaries, if the driver supports them. Lets LoadCache() skip linking from source.
+	bool LoadProgramBinaryCache(const Path &filename);
+	void SaveProgramBinaryCache(const Path &filename);
+
 private:
 	void Clear();
 	Shader *CompileFragmentShader(FShaderID id);
@@ -134,6 +134,7 @@ struct GPUStatsPerFrame {
 	double msCullDepth;
 	double msRasterizeDepth;
 	double msRasterTimeAvailable;
+	double msWaitDepth;
 	int vertexGPUCycles;
 	int otherGPUCycles;
 	int numDepthRasterPrims;
@@ -2,6 +2,7 @@
 
 #include <algorithm>  // std::remove
 
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/Profiler/Profiler.h"
 
 #include "Common/GPU/GraphicsContext.h"
@@ -63,6 +64,7 @@ GPUCommon::GPUCommon(GraphicsContext *gfxCtx, Draw::DrawContext *draw) :
 }
 
 void GPUCommon::BeginHostFrame(const DisplayLayoutConfig &config) {
+	FrameTrace::BeginFrame();
 	ReapplyGfxState();
 
 	// TODO: Assume config may have changed - maybe move to resize.
@@ -81,6 +83,7 @@ void GPUCommon::EndHostFrame() {
 	if (draw_) {
 		draw_->Invalidate(InvalidationFlags::CACHED_RENDER_STATE);
 	}
+	FrameTrace::EndFrame();
 }
 
 void GPUCommon::Reinitialize() {
@@ -746,6 +749,7 @@ DLResult GPUCommon::ProcessDLQueue() {
 	}
 
 	TimeCollector collectStat(&gpuStats.perFrame.msProcessingDisplayLists, g_coreCollectDebugStats);
+	FrameTraceScope traceScope(FrameTraceStage::GE_LIST);
 
 	auto GetNextListIndex = [&]() -> int {
 		if (dlQueue.empty())
@@ -509,7 +509,8 @@ void GPUCommonHW::PreExecuteOp(u32 op, u32 diff) {
 }
 
 void GPUCommonHW::PrepareCopyDisplayToOutput(const DisplayLayoutConfig &config) {
-	drawEngineCommon_->FlushQueuedDepth();
+	// Also keeps the depth raster from touching memory while a save state is taken.
+	drawEngineCommon_->WaitForQueuedDepth();
 	// Flush anything left over.
 	drawEngineCommon_->Flush();
 
@@ -527,6 +528,7 @@ bool GPUCommonHW::PresentedThisFrame() const {
 }
 
 void GPUCommonHW::DoState(PointerWrap &p) {
+	drawEngineCommon_->WaitForQueuedDepth();
 	GPUCommon::DoState(p);
 
 	// TODO: Some of these things may not be necessary.
@@ -1310,7 +1312,7 @@ void GPUCommonHW::Execute_Bezier(u32 op, u32 diff) {
 	gstate_c.submitType = SubmitType::BEZIER;
 
 	int bytesRead = 0;
-	drawEngineCommon_->SubmitCurve(control_points, indices, surface, gstate.vertType, &bytesRead, "bezier");
+	drawEngineCommon_->SubmitCurve(control_points, indices, surface, gstate.vertType, &bytesRead);
 
 	gstate_c.Dirty(DIRTY_RASTER_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_UVSCALEOFFSET);
 	gstate_c.submitType = SubmitType::DRAW;
@@ -1382,7 +1384,7 @@ void GPUCommonHW::Execute_Spline(u32 op, u32 diff) {
 	gstate_c.submitType = SubmitType::SPLINE;
 
 	int bytesRead = 0;
-	drawEngineCommon_->SubmitCurve(control_points, indices, surface, gstate.vertType, &bytesRead, "spline");
+	drawEngineCommon_->SubmitCurve(control_points, indices, surface, gstate.vertType, &bytesRead);
 
 	gstate_c.Dirty(DIRTY_RASTER_STATE | DIRTY_VERTEXSHADER_STATE | DIRTY_UVSCALEOFFSET);
 	gstate_c.submitType = SubmitType::DRAW;
@@ -1393,7 +1395,7 @@ void GPUCommonHW::Execute_Spline(u32 op, u32 diff) {
 }
 
 void GPUCommonHW::Execute_BlockTransferStart(u32 op, u32 diff) {
-	drawEngineCommon_->FlushQueuedDepth();
+	drawEngineCommon_->WaitForQueuedDepth();
 	Flush();
 
 	PROFILE_THIS_SCOPE("block");  // don't include the flush in the profile, would be misleading.
@@ -1712,12 +1714,12 @@ void GPUCommonHW::Execute_TexFlush(u32 op, u32 diff) {
 }
 
 u32 GPUCommonHW::DrawSync(int mode) {
-	drawEngineCommon_->FlushQueuedDepth();
+	drawEngineCommon_->WaitForQueuedDepth();
 	return GPUCommon::DrawSync(mode);
 }
 
 int GPUCommonHW::ListSync(int listid, int mode) {
-	drawEngineCommon_->FlushQueuedDepth();
+	drawEngineCommon_->WaitForQueuedDepth();
 	return GPUCommon::ListSync(listid, mode);
 }
 
@@ -1781,13 +1783,14 @@ void GPUCommonHW::FormatGPUStatsCommon(StringWriter &w) {
 	}
 
 	if (PSP_CoreParameter().compat.flags().SoftwareRasterDepth) {
-		w.F("Z-rast: %0.2f+%0.2f+%0.2f (total %0.2f/%0.2f) ms\n"
+		w.F("Z-rast: %0.2f+%0.2f+%0.2f (total %0.2f/%0.2f) ms, waited %0.2f ms\n"
 			"Z-rast: %d prim, %d nopix, %d small, %d earlysize, %d zcull, %d box\n%s",
 			gpuStats.perFrame.msPrepareDepth * 1000.0,
 			gpuStats.perFrame.msCullDepth * 1000.0,
 			gpuStats.perFrame.msRasterizeDepth * 1000.0,
 			(gpuStats.perFrame.msPrepareDepth + gpuStats.perFrame.msCullDepth + gpuStats.perFrame.msRasterizeDepth) * 1000.0,
 			gpuStats.perFrame.msRasterTimeAvailable * 1000.0,
+			gpuStats.perFrame.msWaitDepth * 1000.0,
 			gpuStats.perFrame.numDepthRasterPrims,
 			gpuStats.perFrame.numDepthRasterNoPixels,
 			gpuStats.perFrame.numDepthRasterTooSmall,
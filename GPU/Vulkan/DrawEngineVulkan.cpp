@@ -18,6 +18,7 @@
 #include "ppsspp_config.h"
 #include <functional>
 
+#include "Common/Profiler/FrameTrace.h"
 #include "Common/Profiler/Profiler.h"
 #include "Common/GPU/Vulkan/VulkanRenderManager.h"
 
@@ -181,8 +182,10 @@ void DrawEngineVulkan::DirtyAllUBOs() {
 
 void DrawEngineVulkan::Invalidate(InvalidationCallbackFlags flags) {
 	if (flags & InvalidationCallbackFlags::COMMAND_BUFFER_STATE) {
-		// Nothing here anymore (removed the "frame descriptor set"
-		// If we add back "seldomly-changing" descriptors, we might use this again.
+		// About to submit, so the batched texture uploads have to go into the init command buffer now.
+		if (textureCache_) {
+			textureCache_->FlushPendingUploads();
+		}
 	}
 	if (flags & InvalidationCallbackFlags::RENDER_PASS_STATE) {
 		// If have a new render pass, dirty our dynamic state so it gets re-set.
@@ -198,6 +201,7 @@ void DrawEngineVulkan::Flush() {
 	if (!numDrawVerts_) {
 		return;
 	}
+	FrameTraceScope traceScope(FrameTraceStage::DRAW_SUBMIT);
 
 	VulkanRenderManager *renderManager = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
 
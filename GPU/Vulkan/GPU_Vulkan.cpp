@@ -90,6 +90,8 @@ GPU_Vulkan::GPU_Vulkan(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	if (discID.size()) {
 		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
 		shaderCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".vkshadercache");
+		driverCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".vkpipelinecache");
+		spirvCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".vkspirvcache");
 		LoadCache(shaderCachePath_);
 	}
 
@@ -123,12 +125,21 @@ void GPU_Vulkan::LoadCache(const Path &filename) {
 	if (result) {
 		// Reload use flags in case LoadCacheFlags() changed them.
 		gstate_c.SetUseFlags(CheckGPUFeatures());
+		if (spirvCachePath_.Valid()) {
+			shaderManagerVulkan_->LoadSpirvCache(spirvCachePath_);
+		}
 		result = shaderManagerVulkan_->LoadCache(f);
 		if (!result) {
 			WARN_LOG(Log::G3D, "ShaderManagerVulkan failed to load cache.");
 		}
 	}
+	double start = time_now_d();
 	if (result) {
+		// The driver's own cache lets it skip the backend compile when we recreate the pipelines below.
+		// It's in a separate file since it's only valid for this exact device and driver.
+		if (driverCachePath_.Valid() && !pipelineManager_->LoadDriverPipelineCache(driverCachePath_) && File::Exists(driverCachePath_)) {
+			File::Delete(driverCachePath_);
+		}
 		// WARNING: See comment in LoadPipelineCache if you are tempted to flip the second parameter to true.
 		result = pipelineManager_->LoadPipelineCache(f, false, shaderManagerVulkan_, draw_, drawEngine_.GetPipelineLayout(), msaaLevel_);
 	}
@@ -136,11 +147,13 @@ void GPU_Vulkan::LoadCache(const Path &filename) {
 
 	// Now, since we're on the loader thread, we can just block here until all pipelines are actually created.
 	// This makes it so that the on-screen spinner keeps spinning until we are done.
-	double start = time_now_d();
+	double waitStart = time_now_d();
 	VulkanRenderManager *rm = (VulkanRenderManager *)draw_->GetNativeObject(Draw::NativeObject::RENDER_MANAGER);
 	int maxTasksSeen = rm->WaitForPipelines();
-	double seconds = time_now_d() - start;
-	INFO_LOG(Log::G3D, "Waited %0.1fms for at least %d pipeline tasks to finish compiling.", seconds * 1000.0, maxTasksSeen);
+	double now = time_now_d();
+	INFO_LOG(Log::G3D, "Waited %0.1fms for at least %d pipeline tasks to finish compiling.", (now - waitStart) * 1000.0, maxTasksSeen);
+	startupPipelineTime_ = now - start;
+	INFO_LOG(Log::G3D, "Startup pipeline creation took %0.1fms (driver cache: %s).", startupPipelineTime_ * 1000.0, pipelineManager_->DriverPipelineCacheLoadedSize() ? "hit" : "miss");
 
 	if (!result) {
 		WARN_LOG(Log::G3D, "Incompatible Vulkan pipeline cache - rebuilding.");
@@ -171,6 +184,13 @@ void GPU_Vulkan::SaveCache(const Path &filename) {
 	pipelineManager_->SavePipelineCache(f, false, shaderManagerVulkan_, draw_);
 	INFO_LOG(Log::G3D, "Saved Vulkan pipeline cache");
 	fclose(f);
+
+	if (driverCachePath_.Valid()) {
+		pipelineManager_->SaveDriverPipelineCache(driverCachePath_);
+	}
+	if (spirvCachePath_.Valid()) {
+		shaderManagerVulkan_->SaveSpirvCache(spirvCachePath_);
+	}
 }
 
 GPU_Vulkan::~GPU_Vulkan() {
@@ -408,6 +428,9 @@ void GPU_Vulkan::GetStats(StringWriter &w) {
 		pipelineManager_->GetNumPipelines(),
 		drawStats.pushVertexSpaceUsed,
 		drawStats.pushIndexSpaceUsed);
+	if (startupPipelineTime_ > 0.0) {
+		w.F("Startup pipeline creation: %0.1f ms (driver cache: %d KB)\n", startupPipelineTime_ * 1000.0, (int)(pipelineManager_->DriverPipelineCacheLoadedSize() / 1024));
+	}
 	textureCacheVulkan_->GetStats(w);
 	FormatGPUStatsCommon(w);
 }
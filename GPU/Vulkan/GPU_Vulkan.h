@@ -83,4 +83,8 @@ class GPU_Vulkan : public GPUCommonHW {
 	PipelineManagerVulkan *pipelineManager_;
 
 	Path shaderCachePath_;
+	Path driverCachePath_;
+	Path spirvCachePath_;
+	// Time spent recreating pipelines from the disk cache, for GetStats.
+	double startupPipelineTime_ = 0.0;
 };
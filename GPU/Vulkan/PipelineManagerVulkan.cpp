@@ -1,6 +1,9 @@
 #include <cstring>
 #include <memory>
 #include <set>
+#include "ext/xxhash.h"
+
+#include "Common/File/FileUtil.h"
 #include "Common/Profiler/Profiler.h"
 
 #include "Common/Log.h"
@@ -65,6 +68,8 @@ void PipelineManagerVulkan::DeviceLost() {
 	Clear();
 	if (pipelineCache_ != VK_NULL_HANDLE)
 		vulkan_->Delete().QueueDeletePipelineCache(pipelineCache_);
+	// Must be recreated on restore, and may get reloaded from disk.
+	pipelineCache_ = VK_NULL_HANDLE;
 	vulkan_ = nullptr;
 }
 
@@ -778,3 +783,132 @@ bool PipelineManagerVulkan::LoadPipelineCache(FILE *file, bool loadRawPipelineCa
 	// The rest of the work is async, we can't know here if it'll succeed.
 	return true;
 }
+
+// Drivers generally only check the UUID in the blob's own header, if that, and some crash on corrupt data.
+// So we add our own header with everything that identifies the driver, plus a hash of the contents.
+// See https://zeux.io/2019/07/17/serializing-pipeline-cache/ .
+struct DriverPipelineCacheFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t uuid[VK_UUID_SIZE];
+	uint64_t dataSize;
+	uint64_t dataHash;
+};
+
+static const char DRIVER_CACHE_MAGIC[4] = { 'V', 'K', 'P', 'C' };
+static const uint32_t DRIVER_CACHE_VERSION = 1;
+// Anything bigger than this is surely garbage.
+static const uint64_t DRIVER_CACHE_MAX_SIZE = 256 * 1024 * 1024;
+
+static void FillDriverCacheHeader(const VkPhysicalDeviceProperties &props, DriverPipelineCacheFileHeader *header) {
+	memcpy(header->magic, DRIVER_CACHE_MAGIC, sizeof(header->magic));
+	header->version = DRIVER_CACHE_VERSION;
+	header->vendorID = props.vendorID;
+	header->deviceID = props.deviceID;
+	header->driverVersion = props.driverVersion;
+	memcpy(header->uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+bool PipelineManagerVulkan::LoadDriverPipelineCache(const Path &filename) {
+	driverCacheLoadedSize_ = 0;
+	std::string data;
+	if (!File::ReadBinaryFileToString(filename, &data)) {
+		return false;
+	}
+
+	const VkPhysicalDeviceProperties &props = vulkan_->GetPhysicalDeviceProperties().properties;
+	DriverPipelineCacheFileHeader expected{};
+	FillDriverCacheHeader(props, &expected);
+
+	DriverPipelineCacheFileHeader header;
+	if (data.size() < sizeof(header)) {
+		WARN_LOG(Log::G3D, "Truncated Vulkan driver pipeline cache - ignoring");
+		return false;
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version) {
+		WARN_LOG(Log::G3D, "Bad Vulkan driver pipeline cache header - ignoring");
+		return false;
+	}
+	if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID || header.driverVersion != expected.driverVersion ||
+		memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) != 0) {
+		INFO_LOG(Log::G3D, "Vulkan driver pipeline cache is from another device or driver version - ignoring");
+		return false;
+	}
+	const uint8_t *blob = (const uint8_t *)data.data() + sizeof(header);
+	if (header.dataSize > DRIVER_CACHE_MAX_SIZE || header.dataSize != data.size() - sizeof(header) || XXH3_64bits(blob, header.dataSize) != header.dataHash) {
+		WARN_LOG(Log::G3D, "Corrupt Vulkan driver pipeline cache - ignoring");
+		return false;
+	}
+
+	// And the header the driver wrote, for good measure.
+	VkPipelineCacheHeader driverHeader;
+	if (header.dataSize < sizeof(driverHeader)) {
+		return false;
+	}
+	memcpy(&driverHeader, blob, sizeof(driverHeader));
+	if (driverHeader.version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || memcmp(driverHeader.uuid, props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		WARN_LOG(Log::G3D, "Vulkan driver pipeline cache blob doesn't match the device - ignoring");
+		return false;
+	}
+
+	VkPipelineCacheCreateInfo pc{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+	pc.pInitialData = blob;
+	pc.initialDataSize = (size_t)header.dataSize;
+	VkPipelineCache cache;
+	VkResult res = vkCreatePipelineCache(vulkan_->GetDevice(), &pc, nullptr, &cache);
+	if (res != VK_SUCCESS) {
+		WARN_LOG(Log::G3D, "vkCreatePipelineCache with initial data failed (%08x)", (u32)res);
+		return false;
+	}
+	if (!pipelineCache_) {
+		pipelineCache_ = cache;
+	} else {
+		vkMergePipelineCaches(vulkan_->GetDevice(), pipelineCache_, 1, &cache);
+		vkDestroyPipelineCache(vulkan_->GetDevice(), cache, nullptr);
+	}
+
+	driverCacheLoadedSize_ = (size_t)header.dataSize;
+	INFO_LOG(Log::G3D, "Loaded Vulkan driver pipeline cache (%d bytes).", (int)header.dataSize);
+	return true;
+}
+
+void PipelineManagerVulkan::SaveDriverPipelineCache(const Path &filename) {
+	if (!pipelineCache_) {
+		return;
+	}
+
+	size_t dataSize = 0;
+	VkResult res = vkGetPipelineCacheData(vulkan_->GetDevice(), pipelineCache_, &dataSize, nullptr);
+	if (res != VK_SUCCESS || dataSize == 0 || dataSize > DRIVER_CACHE_MAX_SIZE) {
+		return;
+	}
+
+	DriverPipelineCacheFileHeader header{};
+	FillDriverCacheHeader(vulkan_->GetPhysicalDeviceProperties().properties, &header);
+
+	std::string data;
+	data.resize(sizeof(header) + dataSize);
+	uint8_t *blob = (uint8_t *)&data[sizeof(header)];
+	// VK_INCOMPLETE is possible if it grew in between, but then we just get a smaller, still valid, blob.
+	res = vkGetPipelineCacheData(vulkan_->GetDevice(), pipelineCache_, &dataSize, blob);
+	if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+		return;
+	}
+	data.resize(sizeof(header) + dataSize);
+	header.dataSize = dataSize;
+	header.dataHash = XXH3_64bits(blob, dataSize);
+	memcpy(&data[0], &header, sizeof(header));
+
+	// Write to a temporary file first, a half-written cache is worse than none.
+	Path tempFilename = filename.WithExtraExtension(".tmp");
+	if (!File::WriteDataToFile(false, data.data(), data.size(), tempFilename) || !File::Rename(tempFilename, filename)) {
+		WARN_LOG(Log::G3D, "Failed to save Vulkan driver pipeline cache to %s", filename.c_str());
+		File::Delete(tempFilename, true);
+		return;
+	}
+	INFO_LOG(Log::G3D, "Saved Vulkan driver pipeline cache (%d bytes).", (int)dataSize);
+}
@@ -104,11 +104,18 @@ class PipelineManagerVulkan {
 	void SavePipelineCache(FILE *file, bool saveRawPipelineCache, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext);
 	bool LoadPipelineCache(FILE *file, bool loadRawPipelineCache, ShaderManagerVulkan *shaderManager, Draw::DrawContext *drawContext, VKRPipelineLayout *layout, int multiSampleLevel);
 
+	// The driver's own VkPipelineCache contents, kept in a separate file with a header identifying the
+	// device and driver. Load before LoadPipelineCache() so the recreated pipelines can hit it.
+	bool LoadDriverPipelineCache(const Path &filename);
+	void SaveDriverPipelineCache(const Path &filename);
+	size_t DriverPipelineCacheLoadedSize() const { return driverCacheLoadedSize_; }
+
 	// For analysis only.
 	const DenseHashMap<VulkanPipelineKey, VulkanPipeline *> &GetPipelines() const { return pipelines_; }
 
 private:
 	DenseHashMap<VulkanPipelineKey, VulkanPipeline *> pipelines_;
 	VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+	size_t driverCacheLoadedSize_ = 0;
 	VulkanContext *vulkan_;
 };
@@ -37,17 +37,23 @@
 #include "GPU/Vulkan/DrawEngineVulkan.h"
 
 // Most drivers treat vkCreateShaderModule as pretty much a memcpy. What actually
-// takes time here, and makes this worthy of parallelization, is GLSLtoSPV.
+// takes time here, and makes this worthy of parallelization, is GLSLtoSPV - unless it's
+// already in the SPIR-V cache, if one is passed in.
 // Takes ownership over tag.
 // This always returns something, checking the return value for null is not meaningful.
-static Promise<VkShaderModule> *CompileShaderModuleAsync(VulkanContext *vulkan, VkShaderStageFlagBits stage, const char *code, std::string *tag) {
+static Promise<VkShaderModule> *CompileShaderModuleAsync(VulkanContext *vulkan, SpirvCache *spirvCache, VkShaderStageFlagBits stage, const char *code, std::string *tag) {
 	auto compile = [=] {
 		PROFILE_THIS_SCOPE("shadercomp");
 
 		std::string errorMessage;
 		std::vector<uint32_t> spirv;
 
-		bool success = GLSLtoSPV(stage, code, GLSLVariant::VULKAN, spirv, &errorMessage);
+		bool success;
+		if (spirvCache) {
+			success = spirvCache->Compile(stage, code, GLSLVariant::VULKAN, spirv, &errorMessage);
+		} else {
+			success = GLSLtoSPV(stage, code, GLSLVariant::VULKAN, spirv, &errorMessage);
+		}
 
 		if (!errorMessage.empty()) {
 			if (success) {
@@ -102,11 +108,11 @@ static Promise<VkShaderModule> *CompileShaderModuleAsync(VulkanContext *vulkan,
 	}
 }
 
-VulkanFragmentShader::VulkanFragmentShader(VulkanContext *vulkan, FShaderID id, FragmentShaderFlags flags, const char *code)
+VulkanFragmentShader::VulkanFragmentShader(VulkanContext *vulkan, SpirvCache *spirvCache, FShaderID id, FragmentShaderFlags flags, const char *code)
 	: vulkan_(vulkan), id_(id), flags_(flags) {
 	_assert_(!id.is_invalid());
 	source_ = code;
-	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_FRAGMENT_BIT, source_.c_str(), new std::string(id.Description()));
+	module_ = CompileShaderModuleAsync(vulkan, spirvCache, VK_SHADER_STAGE_FRAGMENT_BIT, source_.c_str(), new std::string(id.Description()));
 	VERBOSE_LOG(Log::G3D, "Compiled fragment shader:\n%s\n", (const char *)code);
 }
 
@@ -133,11 +139,11 @@ std::string VulkanFragmentShader::GetShaderString(DebugShaderStringType type) co
 	}
 }
 
-VulkanVertexShader::VulkanVertexShader(VulkanContext *vulkan, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform)
+VulkanVertexShader::VulkanVertexShader(VulkanContext *vulkan, SpirvCache *spirvCache, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform)
 	: vulkan_(vulkan), useHWTransform_(useHWTransform), flags_(flags), id_(id) {
 	_assert_(!id.is_invalid());
 	source_ = code;
-	module_ = CompileShaderModuleAsync(vulkan, VK_SHADER_STAGE_VERTEX_BIT, source_.c_str(), new std::string(id.Description()));
+	module_ = CompileShaderModuleAsync(vulkan, spirvCache, VK_SHADER_STAGE_VERTEX_BIT, source_.c_str(), new std::string(id.Description()));
 	VERBOSE_LOG(Log::G3D, "Compiled vertex shader:\n%s\n", (const char *)code);
 }
 
@@ -245,7 +251,7 @@ const VulkanVertexShader *ShaderManagerVulkan::GetVertexShaderFromID(VShaderID V
 	_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "VS length error: %d", (int)strlen(codeBuffer_));
 
 	const bool useHWTransform = VSID.Bit(VS_BIT_USE_HW_TRANSFORM);
-	vs = new VulkanVertexShader(vulkan, VSID, flags, codeBuffer_, useHWTransform);
+	vs = new VulkanVertexShader(vulkan, &spirvCache_, VSID, flags, codeBuffer_, useHWTransform);
 	vsCache_.Insert(VSID, vs);
 	return vs;
 }
@@ -264,7 +270,7 @@ const VulkanFragmentShader *ShaderManagerVulkan::GetFragmentShaderFromID(FShader
 	_assert_msg_(success, "FS gen error: %s", genErrorString.c_str());
 	_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "FS length error: %d", (int)strlen(codeBuffer_));
 
-	fs = new VulkanFragmentShader(vulkan, FSID, flags, codeBuffer_);
+	fs = new VulkanFragmentShader(vulkan, &spirvCache_, FSID, flags, codeBuffer_);
 	fsCache_.Insert(FSID, fs);
 	return fs;
 }
@@ -356,6 +362,15 @@ std::string ShaderManagerVulkan::DebugGetShaderString(std::string id, DebugShade
 	}
 }
 
+bool ShaderManagerVulkan::LoadSpirvCache(const Path &filename) {
+	return spirvCache_.Load(filename);
+}
+
+void ShaderManagerVulkan::SaveSpirvCache(const Path &filename) {
+	spirvCache_.Save(filename);
+	INFO_LOG(Log::G3D, "SPIR-V cache: %d hits, %d misses", (int)spirvCache_.Hits(), (int)spirvCache_.Misses());
+}
+
 // Shader cache.
 //
 // We simply store the IDs of the shaders used during gameplay. On next startup of
@@ -436,7 +451,7 @@ bool ShaderManagerVulkan::LoadCache(FILE *f) {
 		_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "VS length error: %d", (int)strlen(codeBuffer_));
 		// Don't add the new shader if already compiled - though this should no longer happen.
 		if (!vsCache_.ContainsKey(id)) {
-			VulkanVertexShader *vs = new VulkanVertexShader(vulkan, id, flags, codeBuffer_, useHWTransform);
+			VulkanVertexShader *vs = new VulkanVertexShader(vulkan, &spirvCache_, id, flags, codeBuffer_, useHWTransform);
 			vsCache_.Insert(id, vs);
 		}
 	}
@@ -459,7 +474,7 @@ bool ShaderManagerVulkan::LoadCache(FILE *f) {
 		}
 		_assert_msg_(strlen(codeBuffer_) < CODE_BUFFER_SIZE, "FS length error: %d", (int)strlen(codeBuffer_));
 		if (!fsCache_.ContainsKey(id)) {
-			VulkanFragmentShader *fs = new VulkanFragmentShader(vulkan, id, flags, codeBuffer_);
+			VulkanFragmentShader *fs = new VulkanFragmentShader(vulkan, &spirvCache_, id, flags, codeBuffer_);
 			fsCache_.Insert(id, fs);
 		}
 	}
@@ -24,6 +24,7 @@
 #include "Common/Thread/Promise.h"
 #include "Common/Data/Collections/Hashmaps.h"
 #include "Common/GPU/Vulkan/VulkanMemory.h"
+#include "Common/GPU/Vulkan/VulkanSpirvCache.h"
 #include "GPU/Common/ShaderCommon.h"
 #include "GPU/Common/ShaderId.h"
 #include "GPU/Common/VertexShaderGenerator.h"
@@ -40,7 +41,7 @@ class VulkanPushPool;
 
 class VulkanFragmentShader {
 public:
-	VulkanFragmentShader(VulkanContext *vulkan, FShaderID id, FragmentShaderFlags flags, const char *code);
+	VulkanFragmentShader(VulkanContext *vulkan, SpirvCache *spirvCache, FShaderID id, FragmentShaderFlags flags, const char *code);
 	~VulkanFragmentShader();
 
 	const std::string &source() const { return source_; }
@@ -63,7 +64,7 @@ class VulkanFragmentShader {
 
 class VulkanVertexShader {
 public:
-	VulkanVertexShader(VulkanContext *vulkan, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform);
+	VulkanVertexShader(VulkanContext *vulkan, SpirvCache *spirvCache, VShaderID id, VertexShaderFlags flags, const char *code, bool useHWTransform);
 	~VulkanVertexShader();
 
 	const std::string &source() const { return source_; }
@@ -132,10 +133,16 @@ class ShaderManagerVulkan : public ShaderManagerCommon {
 	bool LoadCache(FILE *f);
 	void SaveCache(FILE *f, DrawEngineVulkan *drawEngine);
 
+	// Compiled SPIR-V, so that recreating shaders from the cache above doesn't have to run glslang.
+	bool LoadSpirvCache(const Path &filename);
+	void SaveSpirvCache(const Path &filename);
+
 private:
 	void Clear();
 
 	ShaderLanguageDesc compat_;
+	// Must outlive the shaders, whose compile tasks use it.
+	SpirvCache spirvCache_;
 
 	typedef DenseHashMap<FShaderID, VulkanFragmentShader *> FSCache;
 	FSCache fsCache_;
@@ -21,6 +21,7 @@
 
 #include "Common/File/VFS/VFS.h"
 #include "Common/Data/Text/I18n.h"
+#include "Common/Data/Text/StringWriter.h"
 #include "Common/LogReporting.h"
 #include "Common/Math/math_util.h"
 #include "Common/Profiler/Profiler.h"
@@ -35,6 +36,8 @@
 #include "Common/GPU/Vulkan/VulkanMemory.h"
 
 #include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "Core/Debugger/MemBlockInfo.h"
 
 #include "GPU/ge_constants.h"
 #include "GPU/GPUState.h"
@@ -203,7 +206,8 @@ std::vector<std::string> SamplerCache::DebugGetSamplerIDs() const {
 TextureCacheVulkan::TextureCacheVulkan(Draw::DrawContext *draw, Draw2D *draw2D, VulkanContext *vulkan)
 	: TextureCacheCommon(draw, draw2D),
 		computeShaderManager_(vulkan),
-		samplerCache_(vulkan) {
+		samplerCache_(vulkan),
+		decodeShaders_(16) {
 	DeviceRestore(draw);
 }
 
@@ -225,7 +229,22 @@ void TextureCacheVulkan::DeviceLost() {
 		vulkan->Delete().QueueDeleteSampler(samplerNearest_);
 	}
 
+	// The frame these were meant for won't be submitted.
+	pendingCreateBarriers_.Clear();
+	pendingCopies_.clear();
+	pendingEndBarriers_.Clear();
+	if (pushTexture_) {
+		pushTexture_->Destroy();
+		delete pushTexture_;
+		pushTexture_ = nullptr;
+	}
+
 	ClearScalingShaders(vulkan);
+	decodeShaders_.Iterate([&](u32 key, VkShaderModule shader) {
+		if (shader != VK_NULL_HANDLE)
+			vulkan->Delete().QueueDeleteShaderModule(shader);
+	});
+	decodeShaders_.Clear();
 
 	computeShaderManager_.DeviceLost();
 
@@ -250,6 +269,10 @@ void TextureCacheVulkan::DeviceRestore(Draw::DrawContext *draw) {
 	VkResult res = vkCreateSampler(vulkan->GetDevice(), &samp, nullptr, &samplerNearest_);
 	_assert_(res == VK_SUCCESS);
 
+	pushTexture_ = new VulkanPushPool(vulkan, "pushTexture", 4 * 1024 * 1024, 0, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	// We may be restored in the middle of a frame.
+	pushTexture_->BeginFrame();
+
 	CompileScalingShader();
 
 	computeShaderManager_.DeviceRestore(draw);
@@ -582,6 +605,42 @@ void TextureCacheVulkan::StartFrame() {
 	// TODO: For low memory detection, maybe use some indication from VMA.
 	// Maybe see https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/staying_within_budget.html#staying_within_budget_querying_for_budget .
 	computeShaderManager_.BeginFrame();
+	pushTexture_->BeginFrame();
+
+	lastUploadStats_ = uploadStats_;
+	uploadStats_ = {};
+}
+
+void TextureCacheVulkan::FlushPendingUploads() {
+	if (pendingCopies_.empty() && pendingCreateBarriers_.empty() && pendingEndBarriers_.empty()) {
+		return;
+	}
+
+	VulkanContext *vulkan = (VulkanContext *)draw_->GetNativeObject(Draw::NativeObject::CONTEXT);
+	VkCommandBuffer cmdInit = (VkCommandBuffer)draw_->GetNativeObject(Draw::NativeObject::INIT_COMMANDBUFFER);
+
+	VK_PROFILE_BEGIN(vulkan, cmdInit, VK_PIPELINE_STAGE_TRANSFER_BIT, "Batched texture upload (%d levels)", (int)pendingCopies_.size());
+	pendingCreateBarriers_.Flush(cmdInit);
+
+	// Merge consecutive levels going from the same buffer to the same image into one copy.
+	FastVec<VkBufferImageCopy> regions;
+	size_t i = 0;
+	while (i < pendingCopies_.size()) {
+		const PendingTextureCopy &first = pendingCopies_[i];
+		regions.clear();
+		size_t end = i;
+		while (end < pendingCopies_.size() && pendingCopies_[end].image == first.image && pendingCopies_[end].buffer == first.buffer) {
+			regions.push_back(pendingCopies_[end].region);
+			end++;
+		}
+		vkCmdCopyBufferToImage(cmdInit, first.buffer, first.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+		uploadStats_.copies++;
+		i = end;
+	}
+	pendingCopies_.clear();
+
+	pendingEndBarriers_.Flush(cmdInit);
+	VK_PROFILE_END(vulkan, cmdInit, VK_PIPELINE_STAGE_TRANSFER_BIT);
 }
 
 void TextureCacheVulkan::BindTexture(TexCacheEntry *entry) {
@@ -698,11 +757,22 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		}
 	}
 
-	if (computeUpload) {
+	// Decoding on the GPU always produces 8888, like the CPU decoder does when expanding.
+	bool computeDecode = !computeUpload && g_Config.bTexComputeDecode && CanDecodeWithCompute(plan, entry);
+	if (computeDecode) {
+		dstFmt = VULKAN_8888_FORMAT;
+		actualFmt = VULKAN_8888_FORMAT;
+	}
+
+	if (computeUpload || computeDecode) {
 		usage |= VK_IMAGE_USAGE_STORAGE_BIT;
 		imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 	}
 
+	// Plain copies are left for FlushPendingUploads() to record together with the other textures built this frame.
+	// Compute scaling and mip generation depend on the copies, so those are recorded right away.
+	const bool deferUpload = !computeUpload && !computeDecode && plan.levelsToLoad >= plan.levelsToCreate;
+
 	if (plan.saveTexture) {
 		DEBUG_LOG(Log::G3D, "About to save texture (%dx%d) (might not, if it already exists)", plan.createW, plan.createH);
 		actualFmt = VULKAN_8888_FORMAT;
@@ -722,7 +792,8 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	VulkanTexture *image = entry->vkTex;
 
 	VulkanBarrierBatch barrier;
-	bool allocSuccess = image->CreateDirect(plan.createW, plan.createH, plan.depth, plan.levelsToCreate, actualFmt, imageLayout, usage, &barrier, mapping);
+	VulkanBarrierBatch *createBarrier = deferUpload ? &pendingCreateBarriers_ : &barrier;
+	bool allocSuccess = image->CreateDirect(plan.createW, plan.createH, plan.depth, plan.levelsToCreate, actualFmt, imageLayout, usage, createBarrier, mapping);
 	barrier.Flush(cmdInit);
 	if (!allocSuccess) {
 		WARN_LOG(Log::G3D, "Texture cache ran out of GPU memory; decimating");
@@ -747,8 +818,10 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		plan.createH /= plan.scaleFactor;
 		plan.scaleFactor = 1;
 		actualFmt = dstFmt;
+		// The retry doesn't ask for storage.
+		computeDecode = false;
 
-		allocSuccess = image->CreateDirect(plan.createW, plan.createH, plan.depth, plan.levelsToCreate, actualFmt, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, &barrier, mapping);
+		allocSuccess = image->CreateDirect(plan.createW, plan.createH, plan.depth, plan.levelsToCreate, actualFmt, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, createBarrier, mapping);
 		barrier.Flush(cmdInit);
 	}
 
@@ -773,12 +846,36 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		levels = plan.levelsToLoad;
 	}
 
-	VulkanPushPool *pushBuffer = drawEngine_->GetPushBufferForTextureData();
+	VulkanPushPool *pushBuffer = pushTexture_;
 
 	// Batch the copies.
 	TextureCopyBatch copyBatch;
 	copyBatch.reserve(levels);
 
+	// The decode shaders read the whole raw CLUT, the same for all levels.
+	VkBuffer clutBuf = VK_NULL_HANDLE;
+	uint32_t clutOffset = 0;
+	if (computeDecode && (GETextureFormat)entry->format >= GE_TFMT_CLUT4) {
+		int alignment = (int)vulkan->GetPhysicalDeviceProperties().properties.limits.minStorageBufferOffsetAlignment;
+		clutOffset = (uint32_t)pushBuffer->Push(clutBufRaw_, 2048, std::max(16, alignment), &clutBuf);
+	}
+
+	auto copyLevel = [&](int mip, int mipWidth, int mipHeight, int depthLayer, VkBuffer texBuf, uint32_t bufferOffset, size_t rowLength) {
+		if (deferUpload) {
+			PendingTextureCopy &copy = pendingCopies_.push_uninitialized();
+			copy.image = image->GetImage();
+			copy.buffer = texBuf;
+			copy.region = image->GetCopyRegion(mip, mipWidth, mipHeight, depthLayer, bufferOffset, rowLength);
+		} else {
+			if (!copyBatch.empty() && copyBatch.buffer != texBuf) {
+				// CopyBufferToMipLevel will record what it has so far.
+				uploadStats_.copies++;
+			}
+			image->CopyBufferToMipLevel(cmdInit, &copyBatch, mip, mipWidth, mipHeight, depthLayer, texBuf, bufferOffset, rowLength);
+		}
+		uploadStats_.levels++;
+	};
+
 	for (int i = 0; i < levels; i++) {
 		const int mipUnscaledWidth = gstate.getTextureWidth(i);
 		const int mipUnscaledHeight = gstate.getTextureHeight(i);
@@ -812,6 +909,7 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 			LoadVulkanTextureLevel(*entry, (uint8_t *)data, lstride, srcLevel, lfactor, actualFmt);
 			if (plan.saveTexture)
 				bufferOffset = pushBuffer->Push(&saveData[0], sz, pushAlignment, &texBuf);
+			uploadStats_.bytes += sz;
 		};
 
 		bool dataScaled = true;
@@ -831,12 +929,15 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 				// TODO: Fill with some pattern?
 			}
 			replacementTimeThisFrame_ += time_now_d() - replaceStart;
-			entry->vkTex->CopyBufferToMipLevel(cmdInit, &copyBatch, i, mipWidth, mipHeight, 0, texBuf, bufferOffset, rowLength);
+			uploadStats_.bytes += uploadSize;
+			copyLevel(i, mipWidth, mipHeight, 0, texBuf, bufferOffset, rowLength);
 		} else {
 			if (plan.depth != 1) {
 				// 3D texturing.
 				loadLevel(uploadSize, i, byteStride, plan.scaleFactor);
-				entry->vkTex->CopyBufferToMipLevel(cmdInit, &copyBatch, 0, mipWidth, mipHeight, i, texBuf, bufferOffset, pixelStride);
+				copyLevel(0, mipWidth, mipHeight, i, texBuf, bufferOffset, pixelStride);
+			} else if (computeDecode) {
+				DecodeLevelWithCompute(vulkan, cmdInit, *entry, i, i == 0 ? plan.baseLevelSrc : i, mipWidth, mipHeight, clutBuf, clutOffset);
 			} else if (computeUpload) {
 				int srcBpp = VkFormatBytesPerPixel(dstFmt);
 				srcStride = mipUnscaledWidth * srcBpp;
@@ -852,7 +953,7 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 				vulkan->Delete().QueueDeleteImageView(view);
 			} else {
 				loadLevel(uploadSize, i == 0 ? plan.baseLevelSrc : i, byteStride, plan.scaleFactor);
-				entry->vkTex->CopyBufferToMipLevel(cmdInit, &copyBatch, i, mipWidth, mipHeight, 0, texBuf, bufferOffset, pixelStride);
+				copyLevel(i, mipWidth, mipHeight, 0, texBuf, bufferOffset, pixelStride);
 			}
 			if (plan.saveTexture) {
 				// When hardware texture scaling is enabled, this saves the original.
@@ -876,23 +977,29 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 		VK_PROFILE_BEGIN(vulkan, cmdInit, VK_PIPELINE_STAGE_TRANSFER_BIT, "Copy Upload");
 		// Submit the whole batch of mip uploads.
 		entry->vkTex->FinishCopyBatch(cmdInit, &copyBatch);
+		uploadStats_.copies++;
 		VK_PROFILE_END(vulkan, cmdInit, VK_PIPELINE_STAGE_TRANSFER_BIT);
 	}
 
-	VkImageLayout layout = computeUpload ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	VkPipelineStageFlags prevStage = computeUpload ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+	VkImageLayout layout = computeUpload || computeDecode ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	VkPipelineStageFlags prevStage = computeUpload || computeDecode ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
 
 	// Generate any additional mipmap levels.
 	// This will transition the whole stack to GENERAL if it wasn't already.
 	if (plan.levelsToLoad < plan.levelsToCreate) {
 		VK_PROFILE_BEGIN(vulkan, cmdInit, VK_PIPELINE_STAGE_TRANSFER_BIT, "Mipgen up to level %d", plan.levelsToCreate);
-		entry->vkTex->GenerateMips(cmdInit, plan.levelsToLoad, computeUpload);
+		entry->vkTex->GenerateMips(cmdInit, plan.levelsToLoad, computeUpload || computeDecode);
 		layout = VK_IMAGE_LAYOUT_GENERAL;
 		prevStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		VK_PROFILE_END(vulkan, cmdInit, VK_PIPELINE_STAGE_TRANSFER_BIT);
 	}
 
-	entry->vkTex->EndCreate(cmdInit, false, prevStage, layout);
+	if (deferUpload) {
+		entry->vkTex->EndCreate(&pendingEndBarriers_, false, prevStage, layout);
+	} else {
+		entry->vkTex->EndCreate(cmdInit, false, prevStage, layout);
+	}
+	uploadStats_.textures++;
 	VK_PROFILE_END(vulkan, cmdInit, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
 
 	// Signal that we support depth textures so use it as one.
@@ -905,6 +1012,105 @@ void TextureCacheVulkan::BuildTexture(TexCacheEntry *const entry) {
 	}
 }
 
+VkShaderModule TextureCacheVulkan::GetDecodeShader(const TextureDecodeShaderKey &key) {
+	VkShaderModule shader;
+	if (decodeShaders_.Get(key.ToU32(), &shader)) {
+		return shader;
+	}
+
+	VulkanContext *vulkan = (VulkanContext *)draw_->GetNativeObject(Draw::NativeObject::CONTEXT);
+	std::string error;
+	std::string source = GenerateTextureDecodeShader(key);
+	shader = CompileShaderModule(vulkan, VK_SHADER_STAGE_COMPUTE_BIT, source.c_str(), &error);
+	if (shader == VK_NULL_HANDLE) {
+		ERROR_LOG(Log::G3D, "Failed to compile texture decode shader %08x, decoding on the CPU: %s", key.ToU32(), error.c_str());
+	}
+	// Also remember failures, so we don't retry them every time.
+	decodeShaders_.Insert(key.ToU32(), shader);
+	return shader;
+}
+
+// Whether all the levels can be read as-is from PSP memory by the decode shaders.
+bool TextureCacheVulkan::CanDecodeWithCompute(const BuildTexturePlan &plan, const TexCacheEntry *entry) {
+	const GETextureFormat format = (GETextureFormat)entry->format;
+	if (plan.doReplace || plan.saveTexture || plan.scaleFactor != 1 || plan.depth != 1 || plan.decodeToClut8 || !TextureDecodeShaderSupported(format)) {
+		return false;
+	}
+
+	const bool swizzled = gstate.isTextureSwizzled();
+	for (int i = 0; i < plan.levelsToLoad; i++) {
+		const int level = i == 0 ? plan.baseLevelSrc : i;
+		const u32 texaddr = gstate.getTextureAddress(level);
+		// The PPGe atlas isn't in PSP memory, and the VRAM mirrors may flip the swizzle. See DecodeTextureLevel().
+		if (IsPPGEAtlasFakeAddress(texaddr, nullptr) || ((texaddr & 0x00600000) != 0 && Memory::IsVRAMAddress(texaddr))) {
+			return false;
+		}
+		const u32 bufw = GetTextureBufw(level, texaddr, format);
+		const int h = gstate.getTextureHeight(level);
+		const u32 rows = swizzled ? ((h + 7) & ~7) : h;
+		if (!Memory::IsValidRange(texaddr, (textureBitsPerPixel[format] * bufw / 8) * rows)) {
+			return false;
+		}
+	}
+
+	TextureDecodeShaderKey key{ format, gstate.getClutPaletteFormat(), swizzled };
+	return GetDecodeShader(key) != VK_NULL_HANDLE;
+}
+
+void TextureCacheVulkan::DecodeLevelWithCompute(VulkanContext *vulkan, VkCommandBuffer cmdInit, TexCacheEntry &entry, int mip, int srcLevel, int mipWidth, int mipHeight, VkBuffer clutBuf, uint32_t clutOffset) {
+	const GETextureFormat format = (GETextureFormat)entry.format;
+	const GEPaletteFormat clutFormat = gstate.getClutPaletteFormat();
+	const bool swizzled = gstate.isTextureSwizzled();
+	const u32 texaddr = gstate.getTextureAddress(srcLevel);
+	const u32 bufw = GetTextureBufw(srcLevel, texaddr, format);
+	const int w = std::min(gstate.getTextureWidth(srcLevel), mipWidth);
+	const int h = std::min(gstate.getTextureHeight(srcLevel), mipHeight);
+	const u32 rows = swizzled ? ((gstate.getTextureHeight(srcLevel) + 7) & ~7) : gstate.getTextureHeight(srcLevel);
+	const u32 size = (textureBitsPerPixel[format] * bufw / 8) * rows;
+
+	char tag[128];
+	size_t len = snprintf(tag, sizeof(tag), "Tex_%08x_%dx%d_%s", texaddr, w, h, GeTextureFormatToString(format, clutFormat));
+	NotifyMemInfo(MemBlockFlags::TEXTURE, texaddr, size, tag, len);
+
+	// Validated by CanDecodeWithCompute().
+	const int alignment = std::max(16, (int)vulkan->GetPhysicalDeviceProperties().properties.limits.minStorageBufferOffsetAlignment);
+	VkBuffer texBuf;
+	uint32_t texOffset = (uint32_t)pushTexture_->Push(Memory::GetPointerUnchecked(texaddr), size, alignment, &texBuf);
+	uploadStats_.bytes += size;
+	uploadStats_.levels++;
+
+	TextureDecodeShaderParams params{ w, h, (int)bufw, 0 };
+	if (format >= GE_TFMT_CLUT4) {
+		int clutSharingOffset;
+		if (format == GE_TFMT_CLUT4) {
+			clutSharingOffset = gstate.isClutSharedForMipmaps() ? 0 : srcLevel * 16;
+		} else {
+			// Same hack as in ReadIndexedTex().
+			const bool mipmapShareClut = gstate.isClutSharedForMipmaps() || gstate.getClutLoadBlocks() != 0x40;
+			clutSharingOffset = mipmapShareClut ? 0 : (srcLevel & 1) * 256;
+		}
+		const int startMask = clutFormat == GE_CMODE_32BIT_ABGR8888 ? 0xFF : 0x1FF;
+		params.clutParams = PackTextureDecodeClutParams(gstate.getClutIndexShift(), gstate.getClutIndexMask(), gstate.getClutIndexStartPos() & startMask, clutSharingOffset);
+	}
+
+	// The alpha is only known on the GPU.
+	entry.SetAlphaStatus(TextureAlpha::Any, mip);
+
+	VkShaderModule shader = GetDecodeShader(TextureDecodeShaderKey{ format, clutFormat, swizzled });
+	VkImageView view = entry.vkTex->CreateViewForMip(mip);
+	VkDescriptorSet descSet = computeShaderManager_.GetDescriptorSet(view, texBuf, texOffset, size, clutBuf, clutOffset, clutBuf ? 2048 : 0, VK_NULL_HANDLE, VK_NULL_HANDLE, 0);
+	VkPipeline pipeline = computeShaderManager_.GetPipeline(shader, "Texture Decode Compute Shader");
+
+	VK_PROFILE_BEGIN(vulkan, cmdInit, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, "Compute Decode: %dx%d %s", w, h, GeTextureFormatToString(format, clutFormat));
+	vkCmdBindPipeline(cmdInit, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(cmdInit, VK_PIPELINE_BIND_POINT_COMPUTE, computeShaderManager_.GetPipelineLayout(), 0, 1, &descSet, 0, nullptr);
+	vkCmdPushConstants(cmdInit, computeShaderManager_.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+	vkCmdDispatch(cmdInit, (w + 7) / 8, (h + 7) / 8, 1);
+	VK_PROFILE_END(vulkan, cmdInit, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	vulkan->Delete().QueueDeleteImageView(view);
+}
+
 VkFormat TextureCacheVulkan::GetDestFormat(GETextureFormat format, GEPaletteFormat clutFormat) {
 	if (!gstate_c.Use(GPU_USE_16BIT_FORMATS)) {
 		return VK_FORMAT_R8G8B8A8_UNORM;
@@ -1068,7 +1274,13 @@ bool TextureCacheVulkan::GetCurrentTextureDebug(GPUDebugBuffer &buffer, int leve
 	return true;
 }
 
-void TextureCacheVulkan::GetStats(StringWriter &w) {}
+void TextureCacheVulkan::GetStats(StringWriter &w) {
+	w.F("Texture uploads: %d textures, %d KB, %d levels in %d copies\n",
+		lastUploadStats_.textures,
+		(int)(lastUploadStats_.bytes / 1024),
+		lastUploadStats_.levels,
+		lastUploadStats_.copies);
+}
 
 std::vector<std::string> TextureCacheVulkan::DebugGetSamplerIDs() const {
 	return samplerCache_.DebugGetSamplerIDs();
@@ -17,8 +17,10 @@
 
 #pragma once
 
+#include "Common/Data/Collections/FastVec.h"
 #include "Common/Data/Collections/Hashmaps.h"
 #include "GPU/GPUState.h"
+#include "Common/GPU/Vulkan/VulkanBarrier.h"
 #include "Common/GPU/Vulkan/VulkanContext.h"
 #include "GPU/Common/TextureCacheCommon.h"
 #include "GPU/Common/TextureShaderCommon.h"
@@ -32,6 +34,7 @@ class ShaderManagerVulkan;
 class DrawEngineVulkan;
 
 class VulkanContext;
+class VulkanPushPool;
 class VulkanTexture;
 class StringWriter;
 
@@ -77,6 +80,10 @@ class TextureCacheVulkan : public TextureCacheCommon {
 
 	bool GetCurrentTextureDebug(GPUDebugBuffer &buffer, int level, bool *isFramebuffer) override;
 
+	// Records the uploads of all textures built since the last call into the init command buffer, as one
+	// batch of copies between two batched barriers. Must happen before the init command buffer is submitted.
+	void FlushPendingUploads();
+
 	void GetStats(StringWriter &w);
 
 	std::vector<std::string> DebugGetSamplerIDs() const;
@@ -99,6 +106,19 @@ class TextureCacheVulkan : public TextureCacheCommon {
 		MULTIPASS,
 	};
 
+	struct PendingTextureCopy {
+		VkImage image;
+		VkBuffer buffer;
+		VkBufferImageCopy region;
+	};
+
+	struct TextureUploadStats {
+		size_t bytes;
+		int textures;
+		int levels;
+		int copies;
+	};
+
 	struct MultipassScratchDesc {
 		const char *tag;
 		uint8_t widthScale;
@@ -117,6 +137,9 @@ class TextureCacheVulkan : public TextureCacheCommon {
 	};
 
 	void LoadVulkanTextureLevel(TexCacheEntry &entry, uint8_t *writePtr, int rowPitch,  int level, int scaleFactor, VkFormat dstFmt);
+	VkShaderModule GetDecodeShader(const TextureDecodeShaderKey &key);
+	bool CanDecodeWithCompute(const BuildTexturePlan &plan, const TexCacheEntry *entry);
+	void DecodeLevelWithCompute(VulkanContext *vulkan, VkCommandBuffer cmdInit, TexCacheEntry &entry, int mip, int srcLevel, int mipWidth, int mipHeight, VkBuffer clutBuf, uint32_t clutOffset);
 	static VkFormat GetDestFormat(GETextureFormat format, GEPaletteFormat clutFormat) ;
 
 	void BuildTexture(TexCacheEntry *const entry) override;
@@ -136,9 +159,22 @@ class TextureCacheVulkan : public TextureCacheCommon {
 
 	DrawEngineVulkan *drawEngine_;
 
+	// Staging for decoded texture levels, so they don't churn the uniform push buffer.
+	VulkanPushPool *pushTexture_ = nullptr;
+
+	// Uploads waiting for FlushPendingUploads(). The images may have been deleted since, but that's deferred.
+	VulkanBarrierBatch pendingCreateBarriers_;
+	FastVec<PendingTextureCopy> pendingCopies_;
+	VulkanBarrierBatch pendingEndBarriers_;
+
+	TextureUploadStats uploadStats_{};
+	TextureUploadStats lastUploadStats_{};
+
 	std::string textureShader_;
 	TextureScalePipelineType textureScalePipeline_ = TextureScalePipelineType::NONE;
 	VkShaderModule singlePassCS_ = VK_NULL_HANDLE;
+	// Raw texture decode shaders by TextureDecodeShaderKey. VK_NULL_HANDLE if one failed to compile.
+	DenseHashMap<u32, VkShaderModule> decodeShaders_;
 	std::vector<VkShaderModule> multipassCS_;
 	std::vector<MultipassScratchDesc> multipassScratchDescs_;
 	std::vector<MultipassStageDesc> multipassStageDescs_;
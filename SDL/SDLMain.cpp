@@ -38,7 +38,6 @@ SDLJoystick *joystick = NULL;
 #include "NKCodeFromSDL.h"
 #include "Common/Math/math_util.h"
 #include "Common/GPU/OpenGL/GLRenderManager.h"
-#include "Common/Profiler/Profiler.h"
 #include "Common/Log/LogManager.h"
 
 #if defined(VK_USE_PLATFORM_XLIB_KHR)
@@ -1756,7 +1755,6 @@ int main(int argc, char *argv[]) {
 	}
 #endif // HAVE_LIBNX
 
-	PROFILE_INIT();
 	glslang::InitializeProcess();
 
 #if PPSSPP_PLATFORM(RPI)
@@ -9,6 +9,7 @@
 #include "Core/MIPS/MIPS.h"
 #include "Core/HW/Display.h"
 #include "Core/FrameTiming.h"
+#include "Core/HLE/sceIo.h"
 #include "Core/HLE/sceSas.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/HLE/scePower.h"
@@ -55,6 +56,7 @@ static void DrawDebugStats(UIContext *ctx, const Bounds &bounds) {
 		kernelStats.slowestSyscallTime * 1000.0f,
 		kernelStats.summedSlowestSyscallName ? kernelStats.summedSlowestSyscallName : "(none)",
 		kernelStats.summedSlowestSyscallTime * 1000.0f);
+	__IoGetDebugStats(w);
 
 	__DisplayGetDebugStats(w);
 
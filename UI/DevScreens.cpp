@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <ctime>
 
 #include "ppsspp_config.h"
 
@@ -96,9 +97,7 @@ static const char *g_debugOverlayList[] = {
 	"Debug stats",
 	"Draw Frametimes Graph",
 	"Frame timing",
-#ifdef USE_PROFILER
 	"Frame profile",
-#endif
 	"Control Debug",
 	"Audio Debug",
 	"GPU Profile",
@@ -130,6 +129,18 @@ void SaveFrameDump() {
 	});
 }
 
+static void SaveProfilerTrace() {
+	Path path = GetSysDirectory(DIRECTORY_DUMP) / StringFromFormat("profile_%lld.json", (long long)time(nullptr));
+	Profiler_SetEnabled(ProfilerUser::TRACE, false);
+	if (Profiler_WriteChromeTrace(path)) {
+		if (System_GetPropertyBool(SYSPROP_CAN_SHOW_FILE)) {
+			System_ShowFileInFolder(path);
+		} else {
+			g_OSD.Show(OSDType::MESSAGE_SUCCESS, GetFriendlyPath(path), 7.0f);
+		}
+	}
+}
+
 void DevMenuScreen::CreatePopupContents(UI::ViewGroup *parent) {
 	using namespace UI;
 	auto dev = GetI18NCategory(I18NCat::DEVELOPER);
@@ -208,6 +219,17 @@ void DevMenuScreen::CreatePopupContents(UI::ViewGroup *parent) {
 		});
 	}
 
+	// The trace covers whatever is still in the profiler's per-thread buffers when saved.
+	if (!Profiler_IsTracing()) {
+		items->Add(new Choice(dev->T("Start profiler trace")))->OnClick.Add([](UI::EventParams &e) {
+			Profiler_SetEnabled(ProfilerUser::TRACE, true);
+		});
+	} else {
+		items->Add(new Choice(dev->T("Save profiler trace")))->OnClick.Add([](UI::EventParams &e) {
+			SaveProfilerTrace();
+		});
+	}
+
 	// This one is not very useful these days, and only really on desktop. Hide it on other platforms.
 	if (System_GetPropertyInt(SYSPROP_DEVICE_TYPE) == DEVICE_TYPE_DESKTOP) {
 		items->Add(new Choice(dev->T("Dump next frame to log")))->OnClick.Add([](UI::EventParams &e) {
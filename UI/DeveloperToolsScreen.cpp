@@ -94,6 +94,7 @@ void DeveloperToolsScreen::CreateTextureReplacementTab(UI::LinearLayout *list) {
 	list->Add(new ItemHeader(dev->T("Texture Replacement")));
 	list->Add(new CheckBox(&g_Config.bSaveNewTextures, dev->T("Save new textures")));
 	list->Add(new CheckBox(&g_Config.bReplaceTextures, dev->T("Replace textures")));
+	list->Add(new CheckBox(&g_Config.bReplaceTexturesDecodeCache, dev->T("Cache decoded PNG replacements (faster loading, uses disk space)")));
 
 	Choice *createTextureIni = list->Add(new Choice(dev->T("Create/Open textures.ini file for current game")));
 	createTextureIni->OnClick.Handle(this, &DeveloperToolsScreen::OnOpenTexturesIniFile);
@@ -533,6 +534,12 @@ void DeveloperToolsScreen::CreateGraphicsTab(UI::LinearLayout *list) {
 			// TODO: Not translating yet. Will combine with other translations of settings that need restart.
 			g_OSD.Show(OSDType::MESSAGE_WARNING, "Restart required");
 		});
+		CheckBox *texComputeDecode = list->Add(new CheckBox(&g_Config.bTexComputeDecode, dev->T("Decode textures on the GPU")));
+		texComputeDecode->SetDisabledPtr(&g_Config.bSoftwareRendering);
+		texComputeDecode->OnClick.Add([](UI::EventParams &e) {
+			// Textures already decoded the other way stay cached otherwise.
+			System_PostUIMessage(UIMessage::GPU_CONFIG_CHANGED);
+		});
 	}
 
 	if (GetGPUBackend() == GPUBackend::VULKAN && SupportsCustomDriver()) {
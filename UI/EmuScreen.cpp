@@ -1699,6 +1699,7 @@ ScreenRenderFlags EmuScreen::RunEmulation(bool skipBufferEffects) {
 	const Draw::Viewport viewport{0.0f, 0.0f, (float)g_display.pixel_xres, (float)g_display.pixel_yres, 0.0f, 1.0f};
 
 	PSP_UpdateDebugStats((DebugOverlay)g_Config.iDebugOverlay == DebugOverlay::DEBUG_STATS || g_Config.bLogFrameDrops);
+	Profiler_SetEnabled(ProfilerUser::OVERLAY, (DebugOverlay)g_Config.iDebugOverlay == DebugOverlay::FRAME_PROFILE);
 	clearColor_ = 0;
 	bool blockedExecution = Achievements::IsBlockingExecution();
 	if (!blockedExecution) {
@@ -1846,11 +1847,9 @@ void EmuScreen::renderUI() {
 		}
 	}
 
-#ifdef USE_PROFILER
 	if ((DebugOverlay)g_Config.iDebugOverlay == DebugOverlay::FRAME_PROFILE && PSP_IsInited()) {
 		DrawProfile(*ctx);
 	}
-#endif
 
 	if (g_Config.bShowGPOLEDs) {
 		// Draw a vertical strip of LEDs at the right side of the screen.
@@ -638,6 +638,11 @@ void GameSettingsScreen::CreateAudioSettings(UI::ViewGroup *audioSettings) {
 	audioSettings->Add(new CheckBox(&g_Config.bFillAudioGaps, a->T("Fill audio gaps")))->SetEnabledFunc([]() {
 		return g_Config.iAudioPlaybackMode == (int)AudioSyncMode::GRANULAR;
 	});
+	PopupSliderChoice *audioLatency = audioSettings->Add(new PopupSliderChoice(&g_Config.iAudioLatencyMs, 0, 130, 0, a->T("Target latency"), 5, screenManager(), "ms"));
+	audioLatency->SetZeroLabel(a->T("Auto"));
+	audioLatency->SetEnabledFunc([]() {
+		return g_Config.iAudioPlaybackMode == (int)AudioSyncMode::CLASSIC_PITCH;
+	});
 
 	audioSettings->Add(new ItemHeader(a->T("Game volume")));
 
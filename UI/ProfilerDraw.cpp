@@ -23,7 +23,6 @@
 #include "Common/UI/View.h"
 #include "Common/Profiler/Profiler.h"
 
-#ifdef USE_PROFILER
 static const uint32_t nice_colors[] = {
 	0xFF8040,
 	0x80FF40,
@@ -45,7 +44,6 @@ static const uint32_t nice_colors[] = {
 	0xF8F8F8,
 	0x33FFFF,
 };
-#endif
 
 enum ProfileCatStatus {
 	PROFILE_CAT_VISIBLE = 0,
@@ -54,13 +52,11 @@ enum ProfileCatStatus {
 };
 
 void DrawProfile(UIContext &ui) {
-#ifdef USE_PROFILER
 	PROFILE_THIS_SCOPE("timing");
 	int numCategories = Profiler_GetNumCategories();
-	int numThreads = Profiler_GetNumThreads();
 	int historyLength = Profiler_GetHistoryLength();
 
-	ui.SetFontStyle(ui.theme->uiFont);
+	ui.SetFontStyle(ui.GetTheme().uiFont);
 
 	static float lastMaxVal = 1.0f / 60.0f;
 	float legendMinVal = lastMaxVal * (1.0f / 120.0f);
@@ -82,13 +78,19 @@ void DrawProfile(UIContext &ui) {
 		}
 
 		Profiler_GetSlowestHistory(i, &slowestThread[0], &history[0], historyLength);
-		catStatus[i] = PROFILE_CAT_NOLEGEND;
+		// All categories are always listed, leave out the ones that haven't been used at all.
+		catStatus[i] = PROFILE_CAT_IGNORE;
 		for (int j = 0; j < historyLength; ++j) {
 			if (history[j] > legendMinVal) {
 				catStatus[i] = PROFILE_CAT_VISIBLE;
 				break;
+			} else if (history[j] > 0.0f) {
+				catStatus[i] = PROFILE_CAT_NOLEGEND;
 			}
 		}
+		if (catStatus[i] == PROFILE_CAT_IGNORE) {
+			continue;
+		}
 
 		// So they don't move horizontally, we always measure.
 		float w = 0.0f, h = 0.0f;
@@ -201,5 +203,4 @@ void DrawProfile(UIContext &ui) {
 	}
 
 	lastMaxVal = lastMaxVal * 0.95f + maxVal * 0.05f;
-#endif
 }
@@ -2,8 +2,4 @@
 
 class UIContext;
 
-#ifdef USE_PROFILER
-
 void DrawProfile(UIContext &ui);
-
-#endif
\ No newline at end of file
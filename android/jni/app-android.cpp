@@ -81,7 +81,6 @@ struct JNIEnv {};
 #include "Common/File/AndroidStorage.h"
 #include "Common/Input/InputState.h"
 #include "Common/Input/KeyCodes.h"
-#include "Common/Profiler/Profiler.h"
 #include "Common/Math/math_util.h"
 #include "Common/Data/Text/Parsers.h"
 #include "Common/VR/PPSSPPVR.h"
@@ -666,7 +665,6 @@ extern "C" void Java_org_ppsspp_ppsspp_NativeApp_init
 	ProcessFrameCommands();
 
 	EARLY_LOG("NativeApp.init() -- begin");
-	PROFILE_INIT();
 
 	renderer_inited = false;
 	exitRenderLoop = false;
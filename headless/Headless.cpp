@@ -24,7 +24,6 @@
 
 #include <algorithm>
 
-#include "Common/Profiler/Profiler.h"
 #include "Common/System/Request.h"
 #include "Common/System/System.h"
 
@@ -61,6 +60,7 @@
 #include "Core/WebServer.h"
 #include "Core/HLE/sceUtility.h"
 #include "Core/SaveState.h"
+#include "Core/SaveStateRewind.h"
 #include "GPU/GPUCommon.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
 #include "Common/Log.h"
@@ -285,6 +285,7 @@ struct AutoTestOptions {
 	bool compare;
 	bool verbose;
 	bool bench;
+	bool benchRewind;
 	bool printEqualLines;
 };
 
@@ -336,6 +337,13 @@ static bool RunAutoTest(GraphicsContext *graphicsContext, CoreParameter &corePar
 
 	bool passed = true;
 	double deadline = time_now_d() + opt.timeout;
+
+	// Real states of whatever is running, to compare a full save against a rewind snapshot.
+	SaveState::StateRingbuffer benchRewindStates;
+	std::vector<u8> benchFullState;
+	double benchFullTime = 0.0;
+	double benchRewindTime = 0.0;
+	int benchSnapshots = 0;
 	coreState = coreParameter.startBreak ? CORE_STEPPING_CPU : CORE_RUNNING_CPU;
 	while (coreState == CORE_RUNNING_CPU || coreState == CORE_STEPPING_CPU) {
 		int blockTicks = (int)usToCycles(1000000 / 10);
@@ -349,6 +357,16 @@ static bool RunAutoTest(GraphicsContext *graphicsContext, CoreParameter &corePar
 		if (coreState == CORE_STEPPING_CPU && !coreParameter.startBreak) {
 			break;
 		}
+		if (opt.benchRewind && coreState == CORE_RUNNING_CPU) {
+			double start = time_now_d();
+			SaveState::SaveToRam(benchFullState);
+			benchFullTime += time_now_d() - start;
+
+			start = time_now_d();
+			benchRewindStates.Save();
+			benchRewindTime += time_now_d() - start;
+			benchSnapshots++;
+		}
 		bool debugger = false;
 #ifdef _WIN32
 		if (IsDebuggerPresent())
@@ -367,6 +385,12 @@ static bool RunAutoTest(GraphicsContext *graphicsContext, CoreParameter &corePar
 			Core_Stop();
 		}
 	}
+	if (benchSnapshots > 0) {
+		benchRewindStates.Clear();
+		printf("Rewind bench: %d snapshots of %d KB, full save %0.3f ms, rewind snapshot %0.3f ms\n", benchSnapshots, (int)(benchFullState.size() / 1024),
+			benchFullTime * 1000.0 / benchSnapshots, benchRewindTime * 1000.0 / benchSnapshots);
+	}
+
 	if (gpu) {
 		gpu->EndHostFrame();
 	}
@@ -523,7 +547,6 @@ class HeadlessApplication : public Application {
 };
 
 int main(int argc, const char* argv[]) {
-	PROFILE_INIT();
 	TimeInit();
 #if PPSSPP_PLATFORM(WINDOWS)
 	if (!IsDebuggerPresent()) {
@@ -564,6 +587,7 @@ int main(int argc, const char* argv[]) {
 	AutoTestOptions testOptions{};
 	testOptions.compare = cmdLineOptions.compare.value_or(false);
 	testOptions.bench = cmdLineOptions.bench.value_or(false);
+	testOptions.benchRewind = cmdLineOptions.benchRewind.value_or(false);
 	testOptions.timeout = cmdLineOptions.timeout.value_or(std::numeric_limits<double>::infinity());
 	testOptions.verbose = cmdLineOptions.verbose.value_or(false);
 	testOptions.printEqualLines = cmdLineOptions.printEqualLines.value_or(false);
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Common/Common.h"
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "GPU/Common/DepthRaster.h"
+#include "UnitTest.h"
+
+// Checks that the sliced and 8-wide depth rasterizer paths give exactly the same result as the plain one,
+// and prints how long each took. Set PPSSPP_DEPTH_RASTER_RECORDING to a file written with --depth-raster-record
+// to also run recorded batches from a game.
+
+static const u32 TEST_DEPTH_ADDR[2] = { 0x04088000, 0x04110000 };
+static const int TEST_DEPTH_STRIDE = 512;
+static const int TEST_DEPTH_PIXELS = TEST_DEPTH_STRIDE * (272 + 2) + 8;
+
+struct DepthRasterTestBatch {
+	bool lowQ;
+	std::vector<DepthDraw> draws;
+	std::vector<float> transformed;
+	std::vector<uint16_t> indices;
+	std::vector<DepthRasterRecordedBatch::Buffer> buffers;
+};
+
+struct DepthRasterTestConfig {
+	const char *name;
+	int maxSlices;
+	bool wide;
+};
+
+// Plain xorshift, so the stream is the same everywhere.
+class DepthTestRandom {
+public:
+	u32 Next() {
+		state_ ^= state_ << 13;
+		state_ ^= state_ >> 17;
+		state_ ^= state_ << 5;
+		return state_;
+	}
+	int Range(int lo, int hi) {
+		return lo + (int)(Next() % (u32)(hi - lo + 1));
+	}
+	float RangeF(float lo, float hi) {
+		return lo + (hi - lo) * (float)(Next() & 0xFFFFFF) / (float)0xFFFFFF;
+	}
+
+private:
+	u32 state_ = 0x12345678;
+};
+
+static void AddVertex(DepthRasterTestBatch &batch, float x, float y, float z, float w) {
+	batch.transformed.push_back(x * w);
+	batch.transformed.push_back(y * w);
+	batch.transformed.push_back(z * w);
+	batch.transformed.push_back(w);
+}
+
+static DepthRasterTestBatch GenerateBatch(DepthTestRandom &rng, bool lowQ, int drawCount) {
+	DepthRasterTestBatch batch;
+	batch.lowQ = lowQ;
+
+	for (int d = 0; d < drawCount; d++) {
+		DepthDraw draw{};
+		// Mostly one buffer, with the occasional switch to the other.
+		draw.depthAddr = TEST_DEPTH_ADDR[rng.Range(0, 7) == 0 ? 1 : 0];
+		draw.depthStride = TEST_DEPTH_STRIDE;
+		draw.compareMode = (ZCompareMode)rng.Range(0, 2);
+		draw.cullEnabled = rng.Range(0, 1) != 0;
+		draw.cullMode = (u8)rng.Range(0, 1);
+		draw.scissor.x1 = (u16)rng.Range(0, 120);
+		draw.scissor.y1 = (u16)rng.Range(0, 60);
+		draw.scissor.x2 = (u16)rng.Range(360, 479);
+		draw.scissor.y2 = (u16)rng.Range(200, 271);
+		draw.vertexOffset = (int)batch.transformed.size() / 4;
+		draw.indexOffset = (int)batch.indices.size();
+
+		if (rng.Range(0, 4) == 0) {
+			draw.prim = GE_PRIM_RECTANGLES;
+			int count = rng.Range(1, 16);
+			for (int i = 0; i < count * 2; i++) {
+				AddVertex(batch, (float)rng.Range(-40, 520), (float)rng.Range(-40, 310), rng.RangeF(0.0f, 65535.0f), 1.0f);
+				batch.indices.push_back((uint16_t)i);
+			}
+			draw.vertexCount = count * 2;
+		} else {
+			draw.prim = GE_PRIM_TRIANGLES;
+			int count = rng.Range(1, 300);
+			for (int i = 0; i < count * 3; i++) {
+				// Mostly small triangles around a center, some big ones crossing several slices.
+				if (i % 3 == 0) {
+					AddVertex(batch, rng.RangeF(-60.0f, 540.0f), rng.RangeF(-60.0f, 330.0f), rng.RangeF(100.0f, 65000.0f), rng.RangeF(0.5f, 2.0f));
+				} else {
+					const float *center = &batch.transformed[batch.transformed.size() - 4 * (i % 3)];
+					float size = rng.Range(0, 9) == 0 ? 400.0f : 40.0f;
+					float w = rng.Range(0, 50) == 0 ? -1.0f : rng.RangeF(0.5f, 2.0f);
+					AddVertex(batch, center[0] / center[3] + rng.RangeF(-size, size), center[1] / center[3] + rng.RangeF(-size, size), rng.RangeF(100.0f, 65000.0f), w);
+				}
+			}
+			for (int i = 0; i < count * 3; i++) {
+				batch.indices.push_back((uint16_t)i);
+			}
+			draw.vertexCount = count * 3;
+		}
+		batch.draws.push_back(draw);
+	}
+
+	for (u32 addr : TEST_DEPTH_ADDR) {
+		DepthRasterRecordedBatch::Buffer buffer;
+		buffer.addr = addr;
+		buffer.data.resize(TEST_DEPTH_PIXELS);
+		for (auto &pixel : buffer.data) {
+			pixel = (uint16_t)rng.Next();
+		}
+		batch.buffers.push_back(std::move(buffer));
+	}
+	return batch;
+}
+
+// Runs all the batches with one configuration, and returns the final buffers and stats.
+static double RunDepthRaster(const DepthRasterTestConfig &config, const std::vector<DepthRasterTestBatch> &batches, std::vector<std::vector<uint16_t>> *results, DepthRasterStats *stats) {
+	DepthRasterizer rasterizer;
+	rasterizer.SetOptions(config.maxSlices, config.wide);
+
+	double total = 0.0;
+	for (const auto &batch : batches) {
+		std::vector<DepthRasterRecordedBatch::Buffer> buffers = batch.buffers;
+		auto getDepthPtr = [&](u32 depthAddr) -> uint16_t * {
+			for (auto &buffer : buffers) {
+				if (buffer.addr == depthAddr)
+					return buffer.data.data();
+			}
+			return nullptr;
+		};
+
+		double start = time_now_d();
+		rasterizer.Rasterize(batch.draws.data(), batch.draws.size(), batch.transformed.data(), batch.indices.data(), getDepthPtr, batch.lowQ, false, stats);
+		total += time_now_d() - start;
+
+		for (auto &buffer : buffers) {
+			results->push_back(std::move(buffer.data));
+		}
+	}
+	return total;
+}
+
+static bool CompareDepthRaster(const char *name, const std::vector<DepthRasterTestBatch> &batches) {
+	static const DepthRasterTestConfig configs[] = {
+		{ "reference", 1, false },
+		{ "sliced", 8, false },
+		{ "wide", 1, true },
+		{ "sliced+wide", 8, true },
+	};
+
+	std::vector<std::vector<uint16_t>> reference;
+	DepthRasterStats referenceStats{};
+	double referenceTime = RunDepthRaster(configs[0], batches, &reference, &referenceStats);
+	printf("DepthRaster %s: %s %0.3f ms (%d prims)\n", name, configs[0].name, referenceTime * 1000.0, referenceStats.prims);
+
+	for (size_t c = 1; c < ARRAY_SIZE(configs); c++) {
+		std::vector<std::vector<uint16_t>> results;
+		DepthRasterStats stats{};
+		double time = RunDepthRaster(configs[c], batches, &results, &stats);
+		printf("DepthRaster %s: %s %0.3f ms\n", name, configs[c].name, time * 1000.0);
+
+		EXPECT_EQ_INT(results.size(), reference.size());
+		for (size_t i = 0; i < results.size(); i++) {
+			if (results[i] != reference[i]) {
+				printf("DepthRaster %s: %s differs from reference in buffer %d\n", name, configs[c].name, (int)i);
+				return false;
+			}
+		}
+		EXPECT_EQ_INT(stats.prims, referenceStats.prims);
+		EXPECT_EQ_INT(stats.noPixels, referenceStats.noPixels);
+		EXPECT_EQ_INT(stats.tooSmall, referenceStats.tooSmall);
+		EXPECT_EQ_INT(stats.earlySize, referenceStats.earlySize);
+		EXPECT_EQ_INT(stats.zCulled, referenceStats.zCulled);
+		EXPECT_EQ_INT(stats.boxCulled, referenceStats.boxCulled);
+	}
+	return true;
+}
+
+class DepthRasterTestTask : public Task {
+public:
+	explicit DepthRasterTestTask(std::function<void()> func) : func_(std::move(func)) {}
+	TaskType Type() const override { return TaskType::CPU_COMPUTE; }
+	TaskPriority Priority() const override { return TaskPriority::NORMAL; }
+	void Run() override { func_(); }
+
+private:
+	std::function<void()> func_;
+};
+
+// The depth raster batches run as compute tasks, and split into slices from there. Keep every compute
+// thread busy doing that at once, so slices can't count on another thread being free to take them.
+static bool TestDepthRasterInComputeTasks(const std::vector<DepthRasterTestBatch> &batches) {
+	std::vector<std::vector<uint16_t>> reference;
+	DepthRasterStats referenceStats{};
+	RunDepthRaster({ "reference", 1, false }, batches, &reference, &referenceStats);
+
+	// The tasks own this, since if they get stuck we return while they're still queued or running.
+	struct SharedState {
+		std::vector<DepthRasterTestBatch> batches;
+		std::vector<std::vector<std::vector<uint16_t>>> results;
+		std::atomic<int> finished{};
+	};
+	const int numTasks = g_threadManager.GetNumLooperThreads();
+	std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+	state->batches = batches;
+	state->results.resize(numTasks);
+	for (int i = 0; i < numTasks; i++) {
+		g_threadManager.EnqueueTask(new DepthRasterTestTask([state, i]() {
+			DepthRasterStats stats{};
+			RunDepthRaster({ "sliced in task", 8, false }, state->batches, &state->results[i], &stats);
+			state->finished++;
+		}));
+	}
+
+	// If slices wait on tasks that can't be scheduled, this never finishes, so don't wait forever.
+	double start = time_now_d();
+	while (state->finished < numTasks) {
+		if (time_now_d() - start > 60.0) {
+			printf("DepthRaster: sliced rasterization from %d compute tasks didn't finish\n", numTasks);
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	for (int i = 0; i < numTasks; i++) {
+		if (state->results[i] != reference) {
+			printf("DepthRaster: sliced rasterization from compute task %d differs from reference\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool TestDepthRaster() {
+	g_threadManager.Init(std::max(2, (int)std::thread::hardware_concurrency()), 1);
+
+	bool success = true;
+	DepthTestRandom rng;
+	for (int lowQ = 0; lowQ < 2 && success; lowQ++) {
+		std::vector<DepthRasterTestBatch> batches;
+		for (int i = 0; i < 16; i++) {
+			batches.push_back(GenerateBatch(rng, lowQ != 0, 64));
+		}
+		success = CompareDepthRaster(lowQ ? "synthetic lowQ" : "synthetic", batches);
+		if (success) {
+			batches.resize(4);
+			success = TestDepthRasterInComputeTasks(batches);
+		}
+	}
+
+	const char *recording = getenv("PPSSPP_DEPTH_RASTER_RECORDING");
+	if (success && recording) {
+		std::vector<DepthRasterRecordedBatch> recorded;
+		if (DepthRasterLoadRecording(Path(recording), &recorded)) {
+			std::vector<DepthRasterTestBatch> batches;
+			for (auto &rec : recorded) {
+				batches.push_back(DepthRasterTestBatch{ rec.lowQ, std::move(rec.draws), std::move(rec.transformed), std::move(rec.indices), std::move(rec.buffers) });
+			}
+			success = CompareDepthRaster("recording", batches);
+		} else {
+			printf("DepthRaster: Failed to load %s\n", recording);
+			success = false;
+		}
+	}
+
+	g_threadManager.Teardown();
+	return success;
+}
@@ -1,7 +1,12 @@
 #include "ppsspp_config.h"
 #include <algorithm>
+#include <set>
 
 #include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Data/Convert/ColorConv.h"
+#include "Common/GPU/Vulkan/VulkanSpirvCache.h"
 
 #include "GPU/Common/ShaderId.h"
 #include "GPU/Common/ShaderCommon.h"
@@ -15,6 +20,9 @@
 #include "GPU/Common/ReinterpretFramebuffer.h"
 #include "GPU/Common/StencilCommon.h"
 #include "GPU/Common/DepalettizeShaderCommon.h"
+#include "GPU/Common/TextureShaderCommon.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/Vulkan/VulkanUtil.h"
 
 #include "UnitTest.h"
 
@@ -343,6 +351,440 @@ bool TestDepalShaders() {
 	return true;
 }
 
+bool TestTextureDecodeShaders() {
+	std::string errorMessage;
+	for (int fmt = 0; fmt < 16; fmt++) {
+		if (!TextureDecodeShaderSupported((GETextureFormat)fmt)) {
+			continue;
+		}
+		// The CLUT format only matters for the indexed formats.
+		int clutFormats = fmt >= GE_TFMT_CLUT4 ? 4 : 1;
+		for (int clut = 0; clut < clutFormats; clut++) {
+			for (int swizzled = 0; swizzled < 2; swizzled++) {
+				TextureDecodeShaderKey key{ (GETextureFormat)fmt, (GEPaletteFormat)clut, swizzled != 0 };
+				std::string source = GenerateTextureDecodeShader(key);
+				if (!TestCompileShader(source.c_str(), ShaderLanguage::GLSL_VULKAN, ShaderStage::Compute, &errorMessage)) {
+					printf("Error compiling texture decode shader %08x:\n\n%s\n\n%s\n", key.ToU32(), LineNumberString(source).c_str(), errorMessage.c_str());
+					return false;
+				} else if (g_testLog) {
+					printf("===\n%s\n===\n", source.c_str());
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// The CPU side of the comparison, built from the same pieces TextureCacheCommon::DecodeTextureLevel() uses
+// when expanding to 32-bit. The CLUT mode is taken from gstate, like the CPU decoder does.
+static void DecodeTextureOnCPU(u32 *out, const u8 *raw, const u8 *rawClut, GETextureFormat format, bool swizzled, int w, int h, int bufw) {
+	const u32 rowBytes = bufw * TextureFormatBitsPerPixel(format) / 8;
+	const int rows = (h + 7) & ~7;
+	std::vector<u32> unswizzled;
+	const u8 *src = raw;
+	if (swizzled) {
+		unswizzled.resize(rowBytes * rows / 4);
+		DoUnswizzleTex16(raw, unswizzled.data(), rowBytes / 16, rows / 8, rowBytes);
+		src = (const u8 *)unswizzled.data();
+	}
+
+	u32 clut[512];
+	switch (gstate.getClutPaletteFormat()) {
+	case GE_CMODE_16BIT_BGR5650: ConvertRGB565ToRGBA8888(clut, (const u16 *)rawClut, 512); break;
+	case GE_CMODE_16BIT_ABGR5551: ConvertRGBA5551ToRGBA8888(clut, (const u16 *)rawClut, 512); break;
+	case GE_CMODE_16BIT_ABGR4444: ConvertRGBA4444ToRGBA8888(clut, (const u16 *)rawClut, 512); break;
+	case GE_CMODE_32BIT_ABGR8888: memcpy(clut, rawClut, sizeof(clut)); break;
+	}
+
+	u32 alphaSum = 0xFFFFFFFF;
+	for (int y = 0; y < h; y++) {
+		const u8 *row = src + y * rowBytes;
+		u32 *dst = out + y * w;
+		switch (format) {
+		case GE_TFMT_CLUT4: DeIndexTexture4(dst, row, w, clut, &alphaSum); break;
+		case GE_TFMT_CLUT8: DeIndexTexture(dst, row, w, clut, &alphaSum); break;
+		case GE_TFMT_5650: ConvertRGB565ToRGBA8888(dst, (const u16 *)row, w); break;
+		case GE_TFMT_5551: ConvertRGBA5551ToRGBA8888(dst, (const u16 *)row, w); break;
+		case GE_TFMT_4444: ConvertRGBA4444ToRGBA8888(dst, (const u16 *)row, w); break;
+		default: memcpy(dst, row, w * sizeof(u32)); break;
+		}
+	}
+}
+
+// Just enough Vulkan to run one decode shader at a time and read the result back.
+class TextureDecodeTestDevice {
+public:
+	bool Init(std::string *reason);
+	void Shutdown();
+	bool Decode(const TextureDecodeShaderKey &key, const TextureDecodeShaderParams &params, const std::vector<u8> &raw, const u8 *rawClut, std::vector<u32> *out);
+
+private:
+	struct HostBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void *data = nullptr;
+	};
+	bool CreateHostBuffer(VkDeviceSize size, VkBufferUsageFlags usage, HostBuffer *buf);
+	void DestroyHostBuffer(HostBuffer &buf);
+
+	VulkanContext *vulkan_ = nullptr;
+	VkDescriptorSetLayout descLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+	VkDescriptorPool descPool_ = VK_NULL_HANDLE;
+	VkCommandPool cmdPool_ = VK_NULL_HANDLE;
+	VkCommandBuffer cmd_ = VK_NULL_HANDLE;
+	VkFence fence_ = VK_NULL_HANDLE;
+};
+
+bool TextureDecodeTestDevice::Init(std::string *reason) {
+	if (!VulkanMayBeAvailable()) {
+		*reason = "no Vulkan driver";
+		return false;
+	}
+	if (!VulkanLoad(reason)) {
+		return false;
+	}
+
+	vulkan_ = new VulkanContext();
+	VulkanContext::CreateInfo info{};
+	info.app_name = "PPSSPPUnitTest";
+	info.app_ver = 1;
+	std::string deviceName;
+	if (!vulkan_->CreateInstanceAndDevice(info, &deviceName)) {
+		*reason = vulkan_->InitError();
+		delete vulkan_;
+		vulkan_ = nullptr;
+		VulkanFree();
+		return false;
+	}
+	VkDevice device = vulkan_->GetDevice();
+
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	for (int i = 0; i < 3; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo dsl{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	dsl.bindingCount = 3;
+	dsl.pBindings = bindings;
+	vkCreateDescriptorSetLayout(device, &dsl, nullptr, &descLayout_);
+
+	VkPushConstantRange push{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TextureDecodeShaderParams) };
+	VkPipelineLayoutCreateInfo pl{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	pl.setLayoutCount = 1;
+	pl.pSetLayouts = &descLayout_;
+	pl.pushConstantRangeCount = 1;
+	pl.pPushConstantRanges = &push;
+	vkCreatePipelineLayout(device, &pl, nullptr, &pipelineLayout_);
+
+	VkDescriptorPoolSize poolSizes[2]{ { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 } };
+	VkDescriptorPoolCreateInfo dp{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	dp.maxSets = 1;
+	dp.poolSizeCount = 2;
+	dp.pPoolSizes = poolSizes;
+	vkCreateDescriptorPool(device, &dp, nullptr, &descPool_);
+
+	VkCommandPoolCreateInfo cp{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	cp.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	cp.queueFamilyIndex = vulkan_->GetGraphicsQueueFamilyIndex();
+	vkCreateCommandPool(device, &cp, nullptr, &cmdPool_);
+	VkCommandBufferAllocateInfo cb{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	cb.commandPool = cmdPool_;
+	cb.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cb.commandBufferCount = 1;
+	vkAllocateCommandBuffers(device, &cb, &cmd_);
+
+	fence_ = vulkan_->CreateFence(false);
+	return true;
+}
+
+void TextureDecodeTestDevice::Shutdown() {
+	if (!vulkan_) {
+		return;
+	}
+	VkDevice device = vulkan_->GetDevice();
+	vkDestroyFence(device, fence_, nullptr);
+	vkDestroyCommandPool(device, cmdPool_, nullptr);
+	vkDestroyDescriptorPool(device, descPool_, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device, descLayout_, nullptr);
+
+	vulkan_->DestroyDevice();
+	vulkan_->DestroyInstance();
+	delete vulkan_;
+	vulkan_ = nullptr;
+	VulkanFree();
+}
+
+bool TextureDecodeTestDevice::CreateHostBuffer(VkDeviceSize size, VkBufferUsageFlags usage, HostBuffer *buf) {
+	VkDevice device = vulkan_->GetDevice();
+	VkBufferCreateInfo b{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	b.size = size;
+	b.usage = usage;
+	b.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(device, &b, nullptr, &buf->buffer) != VK_SUCCESS) {
+		return false;
+	}
+
+	VkMemoryRequirements reqs;
+	vkGetBufferMemoryRequirements(device, buf->buffer, &reqs);
+	VkMemoryAllocateInfo alloc{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	alloc.allocationSize = reqs.size;
+	if (!vulkan_->MemoryTypeFromProperties(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &alloc.memoryTypeIndex)) {
+		return false;
+	}
+	if (vkAllocateMemory(device, &alloc, nullptr, &buf->memory) != VK_SUCCESS) {
+		return false;
+	}
+	vkBindBufferMemory(device, buf->buffer, buf->memory, 0);
+	return vkMapMemory(device, buf->memory, 0, size, 0, &buf->data) == VK_SUCCESS;
+}
+
+void TextureDecodeTestDevice::DestroyHostBuffer(HostBuffer &buf) {
+	VkDevice device = vulkan_->GetDevice();
+	if (buf.data) {
+		vkUnmapMemory(device, buf.memory);
+	}
+	vkDestroyBuffer(device, buf.buffer, nullptr);
+	vkFreeMemory(device, buf.memory, nullptr);
+	buf = HostBuffer();
+}
+
+bool TextureDecodeTestDevice::Decode(const TextureDecodeShaderKey &key, const TextureDecodeShaderParams &params, const std::vector<u8> &raw, const u8 *rawClut, std::vector<u32> *out) {
+	VkDevice device = vulkan_->GetDevice();
+	std::string error;
+	std::string source = GenerateTextureDecodeShader(key);
+	VkShaderModule shader = CompileShaderModule(vulkan_, VK_SHADER_STAGE_COMPUTE_BIT, source.c_str(), &error);
+	if (shader == VK_NULL_HANDLE) {
+		printf("Failed to compile texture decode shader %08x: %s\n", key.ToU32(), error.c_str());
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pc{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	pc.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pc.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pc.stage.module = shader;
+	pc.stage.pName = "main";
+	pc.layout = pipelineLayout_;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pc, nullptr, &pipeline);
+
+	const VkDeviceSize outSize = params.width * params.height * sizeof(u32);
+	HostBuffer texBuf, clutBuf, readback;
+	bool success = CreateHostBuffer(raw.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &texBuf);
+	success = success && CreateHostBuffer(2048, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &clutBuf);
+	success = success && CreateHostBuffer(outSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, &readback);
+
+	VkImageCreateInfo ic{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	ic.imageType = VK_IMAGE_TYPE_2D;
+	ic.format = VK_FORMAT_R8G8B8A8_UNORM;
+	ic.extent = { (uint32_t)params.width, (uint32_t)params.height, 1 };
+	ic.mipLevels = 1;
+	ic.arrayLayers = 1;
+	ic.samples = VK_SAMPLE_COUNT_1_BIT;
+	ic.tiling = VK_IMAGE_TILING_OPTIMAL;
+	ic.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	ic.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	success = success && vkCreateImage(device, &ic, nullptr, &image) == VK_SUCCESS;
+	if (success) {
+		VkMemoryRequirements reqs;
+		vkGetImageMemoryRequirements(device, image, &reqs);
+		VkMemoryAllocateInfo alloc{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+		alloc.allocationSize = reqs.size;
+		if (!vulkan_->MemoryTypeFromProperties(reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &alloc.memoryTypeIndex)) {
+			vulkan_->MemoryTypeFromProperties(reqs.memoryTypeBits, 0, &alloc.memoryTypeIndex);
+		}
+		success = vkAllocateMemory(device, &alloc, nullptr, &imageMemory) == VK_SUCCESS;
+		success = success && vkBindImageMemory(device, image, imageMemory, 0) == VK_SUCCESS;
+
+		VkImageViewCreateInfo vc{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+		vc.image = image;
+		vc.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		vc.format = ic.format;
+		vc.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		success = success && vkCreateImageView(device, &vc, nullptr, &view) == VK_SUCCESS;
+	}
+
+	if (success && pipeline != VK_NULL_HANDLE) {
+		memcpy(texBuf.data, raw.data(), raw.size());
+		memcpy(clutBuf.data, rawClut, 2048);
+
+		vkResetDescriptorPool(device, descPool_, 0);
+		VkDescriptorSetAllocateInfo da{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+		da.descriptorPool = descPool_;
+		da.descriptorSetCount = 1;
+		da.pSetLayouts = &descLayout_;
+		VkDescriptorSet descSet;
+		vkAllocateDescriptorSets(device, &da, &descSet);
+
+		VkDescriptorImageInfo imageInfo{ VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL };
+		VkDescriptorBufferInfo bufferInfo[2]{ { texBuf.buffer, 0, VK_WHOLE_SIZE }, { clutBuf.buffer, 0, VK_WHOLE_SIZE } };
+		VkWriteDescriptorSet writes[3]{};
+		for (int i = 0; i < 3; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = descSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].pBufferInfo = &bufferInfo[0];
+		writes[2].pBufferInfo = &bufferInfo[1];
+		vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+
+		VkCommandBufferBeginInfo begin{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmd_, &begin);
+
+		VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		vkCmdBindPipeline(cmd_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(cmd_, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_, 0, 1, &descSet, 0, nullptr);
+		vkCmdPushConstants(cmd_, pipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+		vkCmdDispatch(cmd_, (params.width + 7) / 8, (params.height + 7) / 8, 1);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(cmd_, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy copy{};
+		copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		copy.imageExtent = ic.extent;
+		vkCmdCopyImageToBuffer(cmd_, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &copy);
+
+		VkBufferMemoryBarrier hostBarrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hostBarrier.buffer = readback.buffer;
+		hostBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(cmd_, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+		vkEndCommandBuffer(cmd_);
+
+		VkSubmitInfo submit{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		submit.commandBufferCount = 1;
+		submit.pCommandBuffers = &cmd_;
+		success = vkQueueSubmit(vulkan_->GetGraphicsQueue(), 1, &submit, fence_) == VK_SUCCESS;
+		success = success && vkWaitForFences(device, 1, &fence_, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+		vkResetFences(device, 1, &fence_);
+
+		if (success) {
+			out->resize(params.width * params.height);
+			memcpy(out->data(), readback.data, outSize);
+		}
+	} else {
+		printf("Failed to set up texture decode shader %08x\n", key.ToU32());
+		success = false;
+	}
+
+	vkDestroyImageView(device, view, nullptr);
+	vkDestroyImage(device, image, nullptr);
+	vkFreeMemory(device, imageMemory, nullptr);
+	DestroyHostBuffer(readback);
+	DestroyHostBuffer(clutBuf);
+	DestroyHostBuffer(texBuf);
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyShaderModule(device, shader, nullptr);
+	return success;
+}
+
+// Runs the decode shaders on an actual device (lavapipe or SwiftShader will do) and compares them byte for byte
+// with the CPU decoder. Skipped when there's no Vulkan driver.
+static bool TestTextureDecodeShadersOnDevice() {
+	TextureDecodeTestDevice device;
+	std::string reason;
+	if (!device.Init(&reason)) {
+		printf("Skipping texture decode shaders on device: %s\n", reason.c_str());
+		return true;
+	}
+
+	struct DecodeCase {
+		GETextureFormat format;
+		GEPaletteFormat clutFormat;
+		bool swizzled;
+		// Shift, mask and start pos, as in GE_CMD_CLUTFORMAT.
+		u32 clutMode;
+	};
+	static const u32 SIMPLE = 0x00FF00;
+	static const u32 SHIFTED = (4 << 2) | (0x3F << 8) | (0x11 << 16);
+	std::vector<DecodeCase> cases;
+	for (int clut = 0; clut < 4; clut++) {
+		for (int swizzled = 0; swizzled < 2; swizzled++) {
+			cases.push_back({ GE_TFMT_CLUT4, (GEPaletteFormat)clut, swizzled != 0, SIMPLE });
+			cases.push_back({ GE_TFMT_CLUT8, (GEPaletteFormat)clut, swizzled != 0, SIMPLE });
+			cases.push_back({ GE_TFMT_CLUT8, (GEPaletteFormat)clut, swizzled != 0, SHIFTED });
+		}
+	}
+	cases.push_back({ GE_TFMT_CLUT4, GE_CMODE_16BIT_ABGR4444, true, SHIFTED });
+	for (int fmt = GE_TFMT_5650; fmt <= GE_TFMT_8888; fmt++) {
+		cases.push_back({ (GETextureFormat)fmt, GE_CMODE_16BIT_BGR5650, true, SIMPLE });
+	}
+
+	// A height that isn't a multiple of 8 checks the swizzle block rounding, and bufw > width the row pitch.
+	const int w = 40, h = 20, bufw = 64;
+	GMRng rng;
+	u8 rawClut[2048];
+	for (int i = 0; i < 2048; i += 4) {
+		u32 v = rng.R32();
+		memcpy(rawClut + i, &v, 4);
+	}
+
+	const u32 oldClutFormat = gstate.clutformat;
+	bool failed = false;
+	for (const DecodeCase &c : cases) {
+		const u32 rowBytes = bufw * TextureFormatBitsPerPixel(c.format) / 8;
+		// Swizzled textures are read in whole blocks of 8 rows.
+		std::vector<u8> raw(rowBytes * ((h + 7) & ~7));
+		for (size_t i = 0; i < raw.size(); i++) {
+			raw[i] = (u8)rng.R32();
+		}
+
+		gstate.clutformat = (GE_CMD_CLUTFORMAT << 24) | c.clutMode | c.clutFormat;
+		std::vector<u32> expected(w * h);
+		DecodeTextureOnCPU(expected.data(), raw.data(), rawClut, c.format, c.swizzled, w, h, bufw);
+
+		const int startMask = c.clutFormat == GE_CMODE_32BIT_ABGR8888 ? 0xFF : 0x1FF;
+		TextureDecodeShaderParams params{ w, h, bufw, 0 };
+		params.clutParams = PackTextureDecodeClutParams(gstate.getClutIndexShift(), gstate.getClutIndexMask(), gstate.getClutIndexStartPos() & startMask, 0);
+		TextureDecodeShaderKey key{ c.format, c.clutFormat, c.swizzled };
+		std::vector<u32> actual;
+		if (!device.Decode(key, params, raw, rawClut, &actual)) {
+			failed = true;
+			break;
+		}
+
+		for (int i = 0; i < w * h; i++) {
+			if (actual[i] != expected[i]) {
+				printf("Texture decode shader %08x (CLUT mode %06x) mismatch at %d,%d: %08x, expected %08x\n", key.ToU32(), c.clutMode, i % w, i / w, actual[i], expected[i]);
+				failed = true;
+				break;
+			}
+		}
+	}
+	gstate.clutformat = oldClutFormat;
+
+	device.Shutdown();
+	return !failed;
+}
+
 const ShaderLanguage languages[] = {
 #if PPSSPP_PLATFORM(WINDOWS)
 	ShaderLanguage::HLSL_D3D11,
@@ -507,6 +949,87 @@ bool TestFragmentShaders() {
 	return true;
 }
 
+// Simulates a shader cache preload: generates a few thousand unique Vulkan shaders and compiles them through
+// the SPIR-V cache, first cold (all glslang) and then from the saved cache file. No GPU needed.
+static bool TestSpirvCache() {
+	const int SHADER_COUNT = 2000;
+	Path cacheFile("unittest_spirv.cache");
+	File::Delete(cacheFile, true);
+
+	struct Source {
+		VkShaderStageFlagBits stage;
+		std::string code;
+	};
+	std::vector<Source> sources;
+	std::set<uint64_t> seen;
+	char *buffer = new char[65536];
+	GMRng rng;
+	Draw::Bugs bugs;
+	for (int attempts = 0; (int)sources.size() < SHADER_COUNT && attempts < SHADER_COUNT * 20; attempts++) {
+		bool vertex = (attempts & 1) == 0;
+		std::string genErrorString;
+		bool success;
+		if (vertex) {
+			VShaderID id;
+			id.FromUint64(rng.R64());
+			if (id.Bit(VS_BIT_IS_THROUGH)) {
+				id.SetBit(VS_BIT_USE_HW_TRANSFORM, 0);
+			}
+			if (id.Bit(VS_BIT_VERTEX_RANGE_CULLING)) {
+				continue;
+			}
+			success = GenerateVShader(id, buffer, ShaderLanguage::GLSL_VULKAN, bugs, &genErrorString);
+		} else {
+			FShaderID id;
+			id.FromUint64(rng.R64());
+			success = GenerateFShader(id, buffer, ShaderLanguage::GLSL_VULKAN, bugs, &genErrorString);
+		}
+		VkShaderStageFlagBits stage = vertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+		if (success && seen.insert(SpirvCache::HashSource(stage, buffer, GLSLVariant::VULKAN)).second) {
+			sources.push_back(Source{ stage, buffer });
+		}
+	}
+	delete[] buffer;
+
+	std::vector<std::vector<uint32_t>> coldSpirv(sources.size());
+	double coldTime, warmTime;
+	{
+		SpirvCache cache;
+		double start = time_now_d();
+		for (size_t i = 0; i < sources.size(); i++) {
+			std::string errorMessage;
+			if (!cache.Compile(sources[i].stage, sources[i].code.c_str(), GLSLVariant::VULKAN, coldSpirv[i], &errorMessage)) {
+				printf("Failed to compile shader for SPIR-V cache test: %s\n", errorMessage.c_str());
+				return false;
+			}
+		}
+		coldTime = time_now_d() - start;
+		EXPECT_EQ_INT((int)cache.Misses(), (int)sources.size());
+		EXPECT_TRUE(cache.Save(cacheFile));
+	}
+
+	{
+		SpirvCache cache;
+		double start = time_now_d();
+		EXPECT_TRUE(cache.Load(cacheFile));
+		bool allEqual = true;
+		for (size_t i = 0; i < sources.size(); i++) {
+			std::vector<uint32_t> spirv;
+			if (!cache.Compile(sources[i].stage, sources[i].code.c_str(), GLSLVariant::VULKAN, spirv, nullptr) || spirv != coldSpirv[i]) {
+				allEqual = false;
+			}
+		}
+		warmTime = time_now_d() - start;
+		EXPECT_TRUE(allEqual);
+		EXPECT_EQ_INT((int)cache.Hits(), (int)sources.size());
+		EXPECT_EQ_INT((int)cache.Misses(), 0);
+	}
+	File::Delete(cacheFile, true);
+
+	printf("SPIR-V cache preload of %d shaders: %0.1f ms with glslang, %0.1f ms from cache\n", (int)sources.size(), coldTime * 1000.0, warmTime * 1000.0);
+	return true;
+}
+
 bool TestShaderGenerators() {
 #if PPSSPP_PLATFORM(WINDOWS)
 	LoadD3D11();
@@ -527,6 +1050,14 @@ bool TestShaderGenerators() {
 		return false;
 	}
 
+	if (!TestTextureDecodeShaders()) {
+		return false;
+	}
+
+	if (!TestTextureDecodeShadersOnDevice()) {
+		return false;
+	}
+
 	if (!TestFragmentShaders()) {
 		return false;
 	}
@@ -535,5 +1066,9 @@ bool TestShaderGenerators() {
 		return false;
 	}
 
+	if (!TestSpirvCache()) {
+		return false;
+	}
+
 	return true;
 } 
@@ -1,11 +1,18 @@
 #include <cstdio>
 #include <cstring>
+#include <thread>
 #include <vector>
 
+#include "ext/xxhash.h"
+
 #include "Common/Data/Format/PNGLoad.h"
+#include "Common/File/DirListing.h"
 #include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
+#include "Common/StringUtils.h"
 #include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "GPU/Common/ReplacedTextureCache.h"
 #include "GPU/Common/TextureReplacer.h"
 
 #include "UnitTest.h"
@@ -141,6 +148,167 @@ static bool TestLookups(TextureReplacer *replacer) {
 	return true;
 }
 
+static const int BENCH_TEXTURES = 8;
+static const int BENCH_SIZE = 1024;
+
+static bool CreateBenchmarkPack(const Path &packDir) {
+	File::DeleteDirRecursively(packDir);
+	if (!File::CreateDir(packDir)) {
+		return false;
+	}
+
+	std::string ini = "[options]\nhash = quick\nversion = 1\n\n[hashes]\n";
+	std::vector<u8> buf((size_t)BENCH_SIZE * BENCH_SIZE * 4);
+	for (int t = 0; t < BENCH_TEXTURES; t++) {
+		// Something that compresses about as badly as real artwork, so the PNG decode isn't trivial.
+		u32 seed = 1234 + t;
+		for (int i = 0; i < BENCH_SIZE * BENCH_SIZE; i++) {
+			seed = seed * 1103515245 + 12345;
+			int x = i % BENCH_SIZE, y = i / BENCH_SIZE;
+			buf[i * 4] = (u8)(x + ((seed >> 16) & 7));
+			buf[i * 4 + 1] = (u8)(y + ((seed >> 20) & 7));
+			buf[i * 4 + 2] = (u8)(x ^ y);
+			buf[i * 4 + 3] = (u8)(t & 1 ? 0xFF : (seed >> 24));
+		}
+		std::string filename = StringFromFormat("bench_%d.png", t);
+		if (!pngSave(packDir / filename, buf.data(), BENCH_SIZE, BENCH_SIZE, 4)) {
+			return false;
+		}
+		ini += StringFromFormat("B%07dC000000010000001 = %s\n", t, filename.c_str());
+	}
+
+	FILE *f = File::OpenCFile(packDir / "textures.ini", "w");
+	if (!f) {
+		return false;
+	}
+	fwrite(ini.data(), 1, ini.size(), f);
+	fclose(f);
+	return true;
+}
+
+// Loads the whole pack, returns textures per second, and a hash of all the pixel data.
+static double LoadBenchmarkPack(const Path &packDir, const Path &cacheDir, u64 *contentHash) {
+	TextureReplacer replacer(nullptr);
+	std::string error;
+	if (!replacer.LoadPackForTesting(packDir, &error, cacheDir)) {
+		return 0.0;
+	}
+
+	std::vector<ReplacedTexture *> textures;
+	for (int t = 0; t < BENCH_TEXTURES; t++) {
+		u64 key = ((u64)(0xB0000000 + t) << 32) | 0xC0000000ULL;
+		ReplacedTexture *tex = replacer.FindReplacement(ReplacementCacheKey(key, 0x10000001), BENCH_SIZE, BENCH_SIZE);
+		if (!tex) {
+			return 0.0;
+		}
+		textures.push_back(tex);
+	}
+
+	double start = time_now_d();
+	// Start them all at once, like a scene change would.
+	for (ReplacedTexture *tex : textures) {
+		tex->Poll(0.0);
+	}
+	for (ReplacedTexture *tex : textures) {
+		while (!tex->Poll(0.1)) {
+		}
+	}
+	double elapsed = time_now_d() - start;
+
+	XXH3_state_t *state = XXH3_createState();
+	XXH3_64bits_reset(state);
+	std::vector<u8> pixels((size_t)BENCH_SIZE * BENCH_SIZE * 4);
+	for (ReplacedTexture *tex : textures) {
+		if (tex->State() != ReplacementState::ACTIVE || !tex->CopyLevelTo(0, pixels.data(), pixels.size(), BENCH_SIZE * 4)) {
+			XXH3_freeState(state);
+			return 0.0;
+		}
+		XXH3_64bits_update(state, pixels.data(), pixels.size());
+		u8 alpha = (u8)tex->AlphaStatus();
+		XXH3_64bits_update(state, &alpha, 1);
+	}
+	*contentHash = XXH3_64bits_digest(state);
+	XXH3_freeState(state);
+	return BENCH_TEXTURES / elapsed;
+}
+
+// Entries are trimmed least recently used first, where loading counts as a use, across game directories.
+static bool TestDecodeCacheTrim(const Path &cacheDir) {
+	const int SIZE = 64;
+	std::vector<u8> pixels(SIZE * SIZE * 4);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = (u8)(i * 2654435761U >> 13);
+
+	// A, B and C are in one game's directory, D in another's. They're all the same size.
+	const Path game1 = cacheDir / "GAME00001";
+	const Path game2 = cacheDir / "GAME00002";
+	const u64 hashes[4] = { 0xA, 0xB, 0xC, 0xD };
+	for (int i = 0; i < 4; i++) {
+		EXPECT_TRUE(SaveCachedReplacementImage(i == 3 ? game2 : game1, hashes[i], SIZE, SIZE, pixels.data(), TextureAlpha::Any));
+	}
+	auto entryPath = [&](int i) {
+		return (i == 3 ? game2 : game1) / StringFromFormat("%016llx.rtc", (unsigned long long)hashes[i]);
+	};
+	File::FileInfo info;
+	EXPECT_TRUE(File::GetFileInfo(entryPath(0), &info));
+	const u64 entrySize = info.size;
+
+	// D is the oldest, then A, B, C. Loading A makes it the newest.
+	const time_t mtimes[4] = { 2000, 3000, 4000, 1000 };
+	for (int i = 0; i < 4; i++)
+		File::ChangeMTime(entryPath(i), mtimes[i]);
+	std::vector<u8> loaded;
+	TextureAlpha alpha;
+	EXPECT_TRUE(LoadCachedReplacementImage(game1, hashes[0], SIZE, SIZE, &loaded, &alpha));
+	EXPECT_TRUE(loaded == pixels);
+
+	// Under the limit, nothing goes.
+	TrimReplacementImageCache(cacheDir, entrySize * 4);
+	for (int i = 0; i < 4; i++)
+		EXPECT_TRUE(File::Exists(entryPath(i)));
+
+	// The trim goes to 7/8 of the limit, so two of four entries have to go.
+	TrimReplacementImageCache(cacheDir, entrySize * 3);
+	EXPECT_TRUE(File::Exists(entryPath(0)));
+	EXPECT_FALSE(File::Exists(entryPath(1)));
+	EXPECT_TRUE(File::Exists(entryPath(2)));
+	EXPECT_FALSE(File::Exists(entryPath(3)));
+	return true;
+}
+
+// Cold: PNG decode (and writing the decode cache.) Warm: reading back from the decode cache.
+static bool TestDecodeCache() {
+	Path packDir = Path("unittest_texture_bench");
+	Path cacheDir = Path("unittest_texture_decode_cache");
+	File::DeleteDirRecursively(cacheDir);
+	if (!CreateBenchmarkPack(packDir)) {
+		return false;
+	}
+
+	g_threadManager.Init(std::max(1, (int)std::thread::hardware_concurrency()), 1);
+
+	u64 uncachedHash = 0, coldHash = 0, warmHash = 0;
+	double uncached = LoadBenchmarkPack(packDir, Path(), &uncachedHash);
+	double cold = LoadBenchmarkPack(packDir, cacheDir, &coldHash);
+	double warm = LoadBenchmarkPack(packDir, cacheDir, &warmHash);
+	printf("Replacement textures (%dx%d): %0.1f/sec PNG, %0.1f/sec PNG + writing cache, %0.1f/sec from cache\n", BENCH_SIZE, BENCH_SIZE, uncached, cold, warm);
+
+	Path trimDir = Path("unittest_texture_decode_cache_trim");
+	File::DeleteDirRecursively(trimDir);
+	bool trimResult = TestDecodeCacheTrim(trimDir);
+
+	g_threadManager.Teardown();
+	File::DeleteDirRecursively(packDir);
+	File::DeleteDirRecursively(cacheDir);
+	File::DeleteDirRecursively(trimDir);
+
+	EXPECT_TRUE(uncached > 0.0 && cold > 0.0 && warm > 0.0);
+	EXPECT_TRUE(coldHash == uncachedHash);
+	EXPECT_TRUE(warmHash == uncachedHash);
+	EXPECT_TRUE(trimResult);
+	return true;
+}
+
 bool TestTextureReplacer() {
 	Path packDir = Path("unittest_texture_pack");
 	if (!CreateTestPack(packDir)) {
@@ -161,5 +329,5 @@ bool TestTextureReplacer() {
 	}
 
 	File::DeleteDirRecursively(packDir);
-	return true;
+	return TestDecodeCache();
 }
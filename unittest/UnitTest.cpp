@@ -42,6 +42,10 @@
 #include <cmath>
 #include <vector>
 #include <string>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 
@@ -49,6 +53,13 @@
 #include <jni.h>
 #endif
 
+#ifdef SDL
+#include "Common/GPU/OpenGL/GLCommon.h"
+#include "Common/GPU/OpenGL/GLFeatures.h"
+#include "Common/GPU/OpenGL/GLProgramBinaryCache.h"
+#include <SDL3/SDL.h>
+#endif
+
 #include "Common/Data/Collections/TinySet.h"
 #include "Common/Data/Collections/FastVec.h"
 #include "Common/Data/Collections/CharQueue.h"
@@ -57,7 +68,9 @@
 #include "Common/Data/Text/WrapText.h"
 #include "Common/Data/Encoding/Utf8.h"
 #include "Common/Buffer.h"
+#include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
+#include "Common/File/PathCaseCache.h"
 #include "Common/Log/LogManager.h"
 #include "Common/Math/SIMDHeaders.h"
 #include "Common/Math/CrossSIMD.h"
@@ -71,6 +84,7 @@
 #include "Common/Render/DrawBuffer.h"
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Format/IniFile.h"
 #include "Common/TimeUtil.h"
@@ -97,13 +111,26 @@
 #include "Core/CmdLine.h"
 #include "Common/Data/Collections/Hashmaps.h"
 #include "Core/Util/BlockAllocator.h"
+#include "Core/FileLoaders/BlockCache.h"
 #include "Core/Debugger/Breakpoints.h"
+#include "Core/Debugger/FunctionProfiler.h"
 #include "Core/Debugger/SymbolMap.h"
+#include "Core/HLE/IoReadahead.h"
+#include "Core/HLE/KernelWaitHelpers.h"
+#include "Core/HLE/ThreadQueueList.h"
 #include "Core/Debugger/MemBlockInfo.h"
+#include "Core/HW/StereoResampler.h"
+#include "Core/FileSystems/BlockDevices.h"
 #include "Core/FileSystems/ISOFileSystem.h"
+#include "Core/FileSystems/VirtualDiscFileSystem.h"
+#include "Core/Loaders.h"
+#include "Core/MemFault.h"
 #include "Core/MemMap.h"
+#include "Core/SaveStateRewind.h"
+#include "Core/System.h"
 #include "Core/KeyMap.h"
 #include "Core/Util/PathUtil.h"
+#include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/Common/GPUStateUtils.h"
@@ -915,6 +942,261 @@ bool TestSerializer() {
 	return true;
 }
 
+// Counts the map nodes allocated, to check that loading into an existing map reuses them.
+static int g_serializerAllocs;
+
+template <class T>
+struct SerializerCountingAllocator {
+	typedef T value_type;
+	SerializerCountingAllocator() = default;
+	template <class U>
+	SerializerCountingAllocator(const SerializerCountingAllocator<U> &) {}
+	T *allocate(size_t n) {
+		g_serializerAllocs++;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *ptr, size_t n) {
+		std::allocator<T>().deallocate(ptr, n);
+	}
+	template <class U>
+	bool operator ==(const SerializerCountingAllocator<U> &) const { return true; }
+	template <class U>
+	bool operator !=(const SerializerCountingAllocator<U> &) const { return false; }
+};
+
+typedef std::map<u32, u32, std::less<u32>, SerializerCountingAllocator<std::pair<const u32, u32>>> SerializerCountedMap;
+
+// Roughly what a state looks like: a big block of memory, then lots of small HLE objects.
+struct SerializerBenchState {
+	std::vector<u8> ram;
+	SerializerCountedMap objects;
+	std::vector<std::string> names;
+
+	void DoState(PointerWrap &p) {
+		auto s = p.Section("BenchState", 1);
+		if (!s)
+			return;
+		DoArray(p, ram.data(), (int)ram.size());
+		u32 dv = 0;
+		DoMap(p, objects, dv);
+		Do(p, names);
+	}
+};
+
+static bool TestSerializerArena() {
+	SerializerBenchState state;
+	state.ram.resize(32 * 1024 * 1024);
+	for (size_t i = 0; i < state.ram.size(); ++i)
+		state.ram[i] = (u8)(i * 13);
+	for (u32 i = 0; i < 4000; ++i)
+		state.objects[i * 7 + 3] = i ^ 0x5555;
+	for (int i = 0; i < 200; ++i)
+		state.names.push_back(StringFromFormat("object_name_%d", i));
+
+	// The two pass save, to compare against.
+	u8 *twoPass = nullptr;
+	size_t twoPassSize = 0;
+	double start = time_now_d();
+	EXPECT_EQ_INT((int)CChunkFileReader::MeasureAndSavePtr(state, &twoPass, &twoPassSize), (int)CChunkFileReader::ERROR_NONE);
+	double twoPassTime = time_now_d() - start;
+
+	// Starting from an empty vector, it has to grow.
+	std::vector<u8> arena;
+	start = time_now_d();
+	EXPECT_EQ_INT((int)CChunkFileReader::MeasureAndSavePtr(state, &arena), (int)CChunkFileReader::ERROR_NONE);
+	double firstTime = time_now_d() - start;
+	EXPECT_EQ_INT((int)arena.size(), (int)twoPassSize);
+	EXPECT_TRUE(memcmp(arena.data(), twoPass, twoPassSize) == 0);
+	free(twoPass);
+
+	// Saving again goes into the same storage.
+	const u8 *arenaData = arena.data();
+	state.names[10] = "a somewhat longer name than before";
+	start = time_now_d();
+	EXPECT_EQ_INT((int)CChunkFileReader::MeasureAndSavePtr(state, &arena), (int)CChunkFileReader::ERROR_NONE);
+	double againTime = time_now_d() - start;
+	EXPECT_TRUE(arena.data() == arenaData);
+
+	SerializerBenchState loaded;
+	loaded.ram.resize(state.ram.size());
+	std::string errorString;
+	EXPECT_EQ_INT((int)CChunkFileReader::LoadPtr(arena.data(), arena.size(), loaded, &errorString), (int)CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(loaded.ram == state.ram);
+	EXPECT_TRUE(loaded.objects == state.objects);
+	EXPECT_TRUE(loaded.names == state.names);
+
+	// Loading the same thing again shouldn't need to allocate any map nodes.
+	g_serializerAllocs = 0;
+	start = time_now_d();
+	EXPECT_EQ_INT((int)CChunkFileReader::LoadPtr(arena.data(), arena.size(), loaded, &errorString), (int)CChunkFileReader::ERROR_NONE);
+	double loadTime = time_now_d() - start;
+	int loadAllocs = g_serializerAllocs;
+	EXPECT_EQ_INT(loadAllocs, 0);
+	EXPECT_TRUE(loaded.objects == state.objects);
+
+	// When the keys don't line up, it still has to end up with exactly what was saved.
+	loaded.objects.clear();
+	loaded.objects[3] = 1;
+	loaded.objects[4] = 2;
+	loaded.objects[0xFFFFFFFF] = 3;
+	EXPECT_EQ_INT((int)CChunkFileReader::LoadPtr(arena.data(), arena.size(), loaded, &errorString), (int)CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(loaded.objects == state.objects);
+	loaded.objects.erase(loaded.objects.begin(), std::next(loaded.objects.begin(), 2000));
+	EXPECT_EQ_INT((int)CChunkFileReader::LoadPtr(arena.data(), arena.size(), loaded, &errorString), (int)CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(loaded.objects == state.objects);
+
+	printf("Savestate (%d KB): two pass save %0.2f ms, single pass %0.2f ms (first) %0.2f ms (reused), load %0.2f ms with %d node allocs\n",
+		(int)(arena.size() / 1024), twoPassTime * 1000.0, firstTime * 1000.0, againTime * 1000.0, loadTime * 1000.0, loadAllocs);
+	return true;
+}
+
+// Rewind states keep only the pages that changed since a base state. Check that round trips, and
+// roughly how long a delta takes compared to keeping a full copy, at both RAM sizes.
+static bool TestRewindDelta() {
+	using SaveState::StateRingbuffer;
+
+	std::vector<u8> decompressed;
+	std::vector<u8> delta;
+
+	// A state identical to its base is just the header and bitmap.
+	{
+		std::vector<u8> base(100 * 1024 + 123, 0x55);
+		StateRingbuffer::CompressDelta(delta, base, base);
+		EXPECT_TRUE(delta.size() < 64);
+		EXPECT_TRUE(StateRingbuffer::DecompressDelta(decompressed, delta, base));
+		EXPECT_TRUE(decompressed == base);
+
+		// Growing past the base, with a partial last page.
+		std::vector<u8> state = base;
+		state.resize(base.size() + 5000, 0xAA);
+		state[10] = 1;
+		StateRingbuffer::CompressDelta(delta, state, base);
+		EXPECT_TRUE(StateRingbuffer::DecompressDelta(decompressed, delta, base));
+		EXPECT_TRUE(decompressed == state);
+
+		// Truncated data shouldn't read out of bounds.
+		delta.resize(delta.size() / 2);
+		EXPECT_FALSE(StateRingbuffer::DecompressDelta(decompressed, delta, base));
+	}
+
+	// Pages flagged clean come from the base, whatever the state holds there.
+	{
+		std::vector<u8> base(16 * 4096 + 100, 0x11);
+		std::vector<u8> state = base;
+		std::vector<u8> cleanPages(17, 0);
+		memset(&state[3 * 4096], 0x22, 4096);
+		// Left stale by a tracked save.
+		memset(&state[5 * 4096], 0x33, 4096);
+		cleanPages[5] = 1;
+		// Past the end of the base, so it must be stored anyway.
+		state.resize(base.size() + 4096, 0x44);
+		cleanPages.push_back(1);
+
+		std::vector<u8> expected = state;
+		memset(&expected[5 * 4096], 0x11, 4096);
+
+		StateRingbuffer::CompressDelta(delta, state, base, &cleanPages);
+		EXPECT_TRUE(StateRingbuffer::DecompressDelta(decompressed, delta, base));
+		EXPECT_TRUE(decompressed == expected);
+	}
+
+	return true;
+}
+
+// Saves just Memory's part of a state, the RAM layout is the same as in a full one.
+struct RewindMemoryState {
+	void DoState(PointerWrap &p) {
+		Memory::DoState(p);
+	}
+};
+
+static bool TestRewindDirtyPages() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init(Memory::MemMapSetupFlags::Default);
+	InstallExceptionHandler(&Memory::HandleFault);
+
+	if (!Memory::DirtyPages_Start()) {
+		printf("Dirty page tracking not supported here, skipping\n");
+		UninstallExceptionHandler();
+		Memory::Shutdown();
+		return true;
+	}
+
+	const u32 pageSize = Memory::DirtyPages_PageSize();
+	const u32 ramBase = PSP_GetKernelMemoryBase();
+	// Not zero, so RAM a tracked save skipped can't match by accident.
+	Memory::DirtyPages_PrepareHostWrite(Memory::GetPointerWriteUnchecked(ramBase), Memory::g_MemorySize);
+	for (u32 i = 0; i < Memory::g_MemorySize; i += 4)
+		Memory::WriteUnchecked_U32(i * 0x9E3779B1, ramBase + i);
+	EXPECT_TRUE(Memory::DirtyPages_Start());
+
+	RewindMemoryState memoryState;
+	std::vector<u8> base;
+	EXPECT_EQ_INT((int)CChunkFileReader::MeasureAndSavePtr(memoryState, &base), (int)CChunkFileReader::ERROR_NONE);
+	const size_t ramOffset = Memory::LastStateRAMOffset();
+
+	std::vector<u32> dirty;
+	Memory::DirtyPages_Snapshot(dirty);
+	EXPECT_FALSE(Memory::DirtyPages_IsRangeDirty(dirty, 0, Memory::g_MemorySize));
+
+	// Plain stores fault once and get marked, like JIT and interpreter stores do.
+	Memory::WriteUnchecked_U32(0x12345678, ramBase + 3 * pageSize + 8);
+	Memory::WriteUnchecked_U32(0x87654321, ramBase + 3 * pageSize + 12);
+#ifndef MASKED_PSP_MEMORY
+	// Through the uncached mirror.
+	*(u32_le *)(Memory::base + ((ramBase + 10 * pageSize) | 0x40000000)) = 0x9ABCDEF0;
+#endif
+	// And what the OS would write, say a file read, has to be prepared for.
+	u8 *hostWrite = Memory::GetPointerWriteUnchecked(ramBase + 20 * pageSize + pageSize / 2);
+	Memory::DirtyPages_PrepareHostWrite(hostWrite, pageSize);
+	memset(hostWrite, 0xAB, pageSize);
+
+	Memory::DirtyPages_Snapshot(dirty);
+	EXPECT_TRUE(Memory::DirtyPages_IsRangeDirty(dirty, 3 * pageSize, 4));
+	EXPECT_FALSE(Memory::DirtyPages_IsRangeDirty(dirty, 4 * pageSize, pageSize));
+#ifndef MASKED_PSP_MEMORY
+	EXPECT_TRUE(Memory::DirtyPages_IsRangeDirty(dirty, 10 * pageSize, 4));
+#endif
+	EXPECT_TRUE(Memory::DirtyPages_IsRangeDirty(dirty, 20 * pageSize, 4));
+	EXPECT_TRUE(Memory::DirtyPages_IsRangeDirty(dirty, 21 * pageSize, 4));
+	EXPECT_FALSE(Memory::DirtyPages_IsRangeDirty(dirty, 22 * pageSize, pageSize));
+
+	// A save of just the dirty pages, with the rest from the base, has to match a full save.
+	std::vector<u8> full;
+	EXPECT_EQ_INT((int)CChunkFileReader::MeasureAndSavePtr(memoryState, &full), (int)CChunkFileReader::ERROR_NONE);
+	std::vector<u8> tracked;
+	Memory::SetStateDirtyFilter(&dirty);
+	EXPECT_EQ_INT((int)CChunkFileReader::MeasureAndSavePtr(memoryState, &tracked), (int)CChunkFileReader::ERROR_NONE);
+	Memory::SetStateDirtyFilter(nullptr);
+	EXPECT_EQ_INT((int)Memory::LastStateRAMOffset(), (int)ramOffset);
+	EXPECT_EQ_INT((int)tracked.size(), (int)full.size());
+
+	std::vector<u8> cleanPages;
+	SaveState::StateRingbuffer::MarkCleanPages(cleanPages, tracked, ramOffset, dirty);
+	std::vector<u8> delta, restored;
+	SaveState::StateRingbuffer::CompressDelta(delta, tracked, base, &cleanPages);
+	EXPECT_TRUE(SaveState::StateRingbuffer::DecompressDelta(restored, delta, base));
+	EXPECT_TRUE(restored == full);
+
+	// Loading marks everything, since it writes all of RAM.
+	RewindMemoryState loadState;
+	std::string errorString;
+	EXPECT_EQ_INT((int)CChunkFileReader::LoadPtr(&restored[0], restored.size(), loadState, &errorString), (int)CChunkFileReader::ERROR_NONE);
+	EXPECT_EQ_HEX(Memory::ReadUnchecked_U32(ramBase + 3 * pageSize + 8), 0x12345678U);
+	Memory::DirtyPages_Snapshot(dirty);
+	EXPECT_TRUE(Memory::DirtyPages_IsRangeDirty(dirty, 30 * pageSize, 4));
+
+	const u32 generation = Memory::DirtyPages_Generation();
+	EXPECT_TRUE(Memory::DirtyPages_IsTracking(generation));
+	Memory::DirtyPages_Stop();
+	EXPECT_FALSE(Memory::DirtyPages_IsTracking(generation));
+	// Writable again, without anything to catch the fault.
+	UninstallExceptionHandler();
+	Memory::WriteUnchecked_U32(1, ramBase + 40 * pageSize);
+	Memory::Shutdown();
+	return true;
+}
+
 bool TestMemBlockInfoSaveState() {
 	MemBlockInfoInit();
 	MemBlockOverrideDetailed();
@@ -955,6 +1237,189 @@ bool TestMemBlockInfoSaveState() {
 	return true;
 }
 
+bool TestMemBlockInfoTagLimit() {
+	MemBlockInfoInit();
+	MemBlockOverrideDetailed();
+
+	// Unique tags, like formatted copy tags, well past what the tag table can hold at once.
+	// Only the first keeps its own block, the rest replace each other and must get reclaimed.
+	const uint32_t base = 0x08800000;
+	const uint32_t count = 300000;
+	char tag[64];
+	for (uint32_t i = 0; i < count; ++i) {
+		size_t len = snprintf(tag, sizeof(tag), "UniqueTag_%08x", i);
+		NotifyMemInfo(MemBlockFlags::ALLOC, i == 0 ? base : base + 0x10, 0x10, tag, len);
+	}
+
+	auto first = FindMemInfoByFlag(MemBlockFlags::ALLOC, base, 0x10);
+	EXPECT_EQ_INT((int)first.size(), 1);
+	EXPECT_EQ_STR(first[0].tag, std::string("UniqueTag_00000000"));
+
+	auto last = FindMemInfoByFlag(MemBlockFlags::ALLOC, base + 0x10, 0x10);
+	EXPECT_EQ_INT((int)last.size(), 1);
+	EXPECT_EQ_STR(last[0].tag, std::string(tag));
+
+	// Copy tags are formatted from the source's tag, and should still work after all that.
+	NotifyMemInfo(MemBlockFlags::WRITE, base, 0x10, "CopySource");
+	NotifyMemInfoCopy(base + 0x100, base, 0x10, "Copy/");
+	auto copied = FindMemInfoByFlag(MemBlockFlags::WRITE, base + 0x100, 0x10);
+	EXPECT_EQ_INT((int)copied.size(), 1);
+	EXPECT_EQ_STR(copied[0].tag, std::string("Copy/CopySource"));
+
+	MemBlockReleaseDetailed();
+	MemBlockInfoShutdown();
+	return true;
+}
+
+// Simulates the emulator pushing a frame's worth of audio at a time, and a backend pulling
+// jittery callback sizes at a slightly different clock, in virtual time.
+bool TestStereoResampler() {
+	int savedLatency = g_Config.iAudioLatencyMs;
+	g_Config.iAudioLatencyMs = 50;
+
+	StereoResampler resampler;
+	std::vector<s32> input(2048 * 2);
+	std::vector<s16> output(1024 * 2);
+
+	// The emulator clock runs a bit fast compared to the output device, which the controller must absorb.
+	const double pushInterval = 1.0 / 60.0 / 1.002;
+	const double outputRate = 48000.0;
+	u32 seed = 1234;
+	auto nextRandom = [&](int range) {
+		seed = seed * 1103515245 + 12345;
+		return (int)((seed >> 16) % range);
+	};
+
+	double pushTime = 0.0;
+	double mixTime = 0.0;
+	int phase = 0;
+	int mixCount = 0;
+	double fillSum = 0.0;
+	int underrunsAtWarmup = 0;
+	const double warmup = 10.0;
+	while (mixTime < 40.0) {
+		if (pushTime <= mixTime) {
+			// A few ms of timing jitter, while keeping the average rate.
+			int frames = 735 + nextRandom(32) - 16;
+			for (int i = 0; i < frames; i++) {
+				s32 value = (s32)(8000.0 * sin((phase++) * 0.05));
+				input[i * 2] = value;
+				input[i * 2 + 1] = -value;
+			}
+			resampler.PushSamples(input.data(), frames, 1.0f);
+			pushTime += pushInterval * frames / 735.0;
+		} else {
+			int frames = 128 + nextRandom(4) * 128;
+			resampler.Mix(output.data(), frames, false, (int)outputRate);
+			mixTime += frames / outputRate;
+
+			StereoResamplerStats stats;
+			resampler.GetStats(&stats);
+			if (mixTime < warmup) {
+				underrunsAtWarmup = stats.underruns;
+			} else {
+				fillSum += stats.bufferedFrames;
+				mixCount++;
+			}
+		}
+	}
+
+	StereoResamplerStats stats;
+	resampler.GetStats(&stats);
+	g_Config.iAudioLatencyMs = savedLatency;
+
+	double avgLatencyMs = fillSum / mixCount * 1000.0 / 44100.0;
+	printf("StereoResampler: average latency %0.1f ms (target 50), ratio %0.5f, underruns %d (%d after warmup)\n", avgLatencyMs, stats.ratio, stats.underruns, stats.underruns - underrunsAtWarmup);
+	EXPECT_EQ_INT(stats.underruns - underrunsAtWarmup, 0);
+	EXPECT_TRUE(avgLatencyMs > 40.0 && avgLatencyMs < 60.0);
+	int histogramTotal = 0;
+	for (int i = 0; i < StereoResamplerStats::LATENCY_BUCKETS; i++)
+		histogramTotal += stats.latencyHistogram[i];
+	EXPECT_TRUE(histogramTotal > 0);
+	return true;
+}
+
+// When fast-forwarding, the buffer is capped near the target, which must still be enough to start playing.
+bool TestStereoResamplerFastForward() {
+	int savedLatency = g_Config.iAudioLatencyMs;
+	bool savedFastForward = PSP_CoreParameter().fastForward;
+	g_Config.iAudioLatencyMs = 50;
+	PSP_CoreParameter().fastForward = true;
+
+	StereoResampler resampler;
+	std::vector<s32> input(735 * 2);
+	std::vector<s16> output(256 * 2);
+	for (int i = 0; i < 735; i++) {
+		input[i * 2] = 8000;
+		input[i * 2 + 1] = -8000;
+	}
+
+	// The emulator runs far ahead, pushing several frames per mix.
+	int nonZero = 0;
+	for (int round = 0; round < 200; round++) {
+		for (int i = 0; i < 4; i++)
+			resampler.PushSamples(input.data(), 735, 1.0f);
+		std::fill(output.begin(), output.end(), 0);
+		resampler.Mix(output.data(), 256, false, 48000);
+		for (s16 sample : output) {
+			if (sample != 0)
+				nonZero++;
+		}
+	}
+
+	g_Config.iAudioLatencyMs = savedLatency;
+	PSP_CoreParameter().fastForward = savedFastForward;
+	EXPECT_TRUE(nonZero > 0);
+	return true;
+}
+
+// Tags are interned and notifications go through per-thread rings, so check that tags from
+// several threads all land, and that a copy picks up the source's tag on flush.
+bool TestMemBlockInfo() {
+	MemBlockInfoInit();
+	MemBlockOverrideDetailed();
+
+	std::thread threads[4];
+	for (int t = 0; t < 4; ++t) {
+		threads[t] = std::thread([t] {
+			char tag[32];
+			for (int i = 0; i < 2000; ++i) {
+				size_t len = snprintf(tag, sizeof(tag), "Thread%d_%d", t, i & 15);
+				NotifyMemInfo(MemBlockFlags::WRITE, 0x08900000 + t * 0x10000 + (i & 15) * 0x100, 0x100, tag, len);
+			}
+		});
+	}
+	for (auto &th : threads)
+		th.join();
+
+	for (int t = 0; t < 4; ++t) {
+		auto results = FindMemInfoByFlag(MemBlockFlags::WRITE, 0x08900000 + t * 0x10000 + 3 * 0x100, 4);
+		EXPECT_EQ_INT((int)results.size(), 1);
+		EXPECT_EQ_STR(results[0].tag, StringFromFormat("Thread%d_3", t));
+	}
+
+	NotifyMemInfoCopy(0x08980000, 0x08900000 + 0x500, 0x100, "Copy/");
+	auto copied = FindMemInfoByFlag(MemBlockFlags::WRITE, 0x08980000, 4);
+	EXPECT_EQ_INT((int)copied.size(), 1);
+	EXPECT_EQ_STR(copied[0].tag, std::string("Copy/Thread0_5"));
+
+	// Not a pass/fail check, just to keep an eye on the cost of the hot path.
+	int total = 0;
+	double st = time_now_d();
+	do {
+		for (int i = 0; i < 1000; ++i) {
+			NotifyMemInfo(MemBlockFlags::WRITE, 0x08A00000 + (i & 255) * 0x100, 0x100, "BenchTag");
+		}
+		total += 1000;
+	} while (time_now_d() - st < 0.5);
+	double elapsed = time_now_d() - st;
+	printf("NotifyMemInfo: %0.2f million calls/sec\n", total / elapsed / 1000000.0);
+
+	MemBlockReleaseDetailed();
+	MemBlockInfoShutdown();
+	return true;
+}
+
 // Covers BreakpointManager::ChangeBreakPointAddress(), which the ImDebugger uses to relocate a
 // breakpoint the user is editing. Only the pure bookkeeping is exercised here - there's no JIT in
 // this build, so the cache invalidation it also does is a no-op.
@@ -1072,6 +1537,77 @@ bool TestTempBreakpoints() {
 	return true;
 }
 
+// The profiler has to charge time to where the CPU actually was, not to wherever a slice ended.
+bool TestFunctionProfiler() {
+	const u32 kFuncA = 0x08804000;
+	const u32 kFuncB = 0x08804100;
+	const u32 kPeriod = 4 * FunctionProfiler::SAMPLE_INTERVAL_CYCLES;
+
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init(Memory::MemMapSetupFlags::Default);
+	SymbolMap symbolMap;
+	g_symbolMap = &symbolMap;
+	// li v0, n; jr ra; nop
+	for (u32 func : { kFuncA, kFuncB }) {
+		Memory::WriteUnchecked_U32(0x24020000 | (func & 0xFFFF), func);
+		Memory::WriteUnchecked_U32(0x03E00008, func + 4);
+		Memory::WriteUnchecked_U32(0, func + 8);
+	}
+	symbolMap.AddFunction("ProfileFuncA", kFuncA, 12);
+	symbolMap.AddFunction("ProfileFuncB", kFuncB, 12);
+	MIPSAnalyst::ScanForFunctions(kFuncA, kFuncB + 12, false);
+
+	// Like a frame: three quarters in A, then B, where an event ends every slice.  Charging whole
+	// slices to where they ended would put everything on B.
+	auto pcAt = [&](s64 ticks) {
+		return (ticks % kPeriod) < kPeriod * 3 / 4 ? kFuncA + 4 : kFuncB + 4;
+	};
+	FunctionProfiler::Clear();
+	FunctionProfiler::Start();
+	s64 ticks = 0;
+	s64 nextEvent = kPeriod * 3 / 4 + 1;
+	s64 nextSample = FunctionProfiler::Tick(pcAt(ticks), ticks);
+	EXPECT_EQ_INT((int)nextSample, FunctionProfiler::SAMPLE_INTERVAL_CYCLES);
+	while (ticks < 100 * kPeriod) {
+		// Like CoreTiming::Advance(), the slice ends at whichever comes first.
+		ticks = std::min(nextEvent, nextSample);
+		if (ticks == nextEvent)
+			nextEvent += kPeriod;
+		nextSample = FunctionProfiler::Tick(pcAt(ticks), ticks);
+		EXPECT_TRUE(nextSample > ticks);
+	}
+	// A slice that ran long (idle) counts every sample point it passed.
+	ticks = nextSample + 2 * FunctionProfiler::SAMPLE_INTERVAL_CYCLES;
+	nextSample = FunctionProfiler::Tick(kFuncB, ticks);
+	EXPECT_EQ_INT((int)nextSample, (int)(ticks + FunctionProfiler::SAMPLE_INTERVAL_CYCLES));
+	FunctionProfiler::Stop();
+
+	std::vector<FunctionProfiler::HotFunction> hot = FunctionProfiler::GetHotFunctions(10);
+	EXPECT_EQ_INT((int)hot.size(), 2);
+	EXPECT_EQ_HEX(hot[0].start, kFuncA);
+	EXPECT_EQ_INT(hot[0].size, 12);
+	EXPECT_EQ_STR(hot[0].name, std::string("ProfileFuncA"));
+	EXPECT_EQ_HEX(hot[1].start, kFuncB);
+	EXPECT_EQ_INT((int)hot[0].cycles, 300 * FunctionProfiler::SAMPLE_INTERVAL_CYCLES);
+	EXPECT_EQ_INT((int)hot[1].cycles, 103 * FunctionProfiler::SAMPLE_INTERVAL_CYCLES);
+	EXPECT_TRUE(hot[0].percent > 74.0 && hot[0].percent < 75.0);
+	EXPECT_TRUE(hot[0].replacement.empty());
+
+	// After a state load, time can go backwards.  That shouldn't charge anything.
+	FunctionProfiler::Clear();
+	FunctionProfiler::Start();
+	FunctionProfiler::Tick(kFuncA, 1000000);
+	EXPECT_EQ_INT((int)FunctionProfiler::Tick(kFuncA, 500), 500 + FunctionProfiler::SAMPLE_INTERVAL_CYCLES);
+	FunctionProfiler::Stop();
+	EXPECT_TRUE(FunctionProfiler::GetHotFunctions(10).empty());
+
+	FunctionProfiler::Clear();
+	MIPSAnalyst::Reset();
+	g_symbolMap = nullptr;
+	Memory::Shutdown();
+	return true;
+}
+
 // BlockAllocator backs sceKernelAllocPartitionMemory and friends. It's pure address bookkeeping -
 // no real memory involved - which makes it cheap to check hard: after any sequence of operations
 // the blocks must still tile the range exactly, and the free-space accessors must match reality.
@@ -1111,6 +1647,215 @@ static bool ValidateAllocator(BlockAllocator &a, u32 rangeStart, u32 rangeSize)
 	return true;
 }
 
+// The list-walking BlockAllocator as it was before it got indexes, kept as the reference the
+// indexed one has to match exactly: same addresses, same rounded sizes, same block layout.
+class ReferenceBlockAllocator {
+public:
+	ReferenceBlockAllocator(u32 grain) : grain_(grain) {}
+
+	void Init(u32 rangeStart, u32 rangeSize) {
+		rangeSize_ = rangeSize;
+		blocks_.assign(1, RefBlock{ rangeStart, rangeSize, false });
+	}
+
+	u32 AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop) {
+		if (size == 0 || size > rangeSize_)
+			return -1;
+		if (grain < grain_)
+			grain = grain_;
+		if (sizeGrain < grain_)
+			sizeGrain = grain_;
+		size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
+
+		for (size_t n = 0; n < blocks_.size(); ++n) {
+			size_t i = fromTop ? blocks_.size() - 1 - n : n;
+			const RefBlock b = blocks_[i];
+			u32 offset;
+			if (!fromTop) {
+				offset = b.start % grain;
+				if (offset != 0)
+					offset = grain - offset;
+			} else {
+				offset = (b.start + b.size - size) % grain;
+			}
+			const u32 needed = offset + size;
+			if (b.taken || b.size < needed)
+				continue;
+			if (!fromTop) {
+				if (b.size != needed)
+					InsertAfter(i, b.size - needed);
+				if (offset >= grain_)
+					i = InsertBefore(i, offset);
+			} else {
+				if (b.size != needed)
+					i = InsertBefore(i, b.size - needed);
+				if (offset >= grain_)
+					InsertAfter(i, offset);
+			}
+			blocks_[i].taken = true;
+			return blocks_[i].start;
+		}
+		return -1;
+	}
+
+	u32 AllocAt(u32 position, u32 size) {
+		if (size > rangeSize_)
+			return -1;
+		u32 alignedPosition = position & ~(grain_ - 1);
+		u32 alignedSize = size + (position - alignedPosition);
+		alignedSize = (alignedSize + grain_ - 1) & ~(grain_ - 1);
+
+		int i = Find(alignedPosition);
+		if (i < 0 || blocks_[i].taken || blocks_[i].start + blocks_[i].size < alignedPosition + alignedSize)
+			return -1;
+		if (blocks_[i].start != alignedPosition)
+			i = (int)InsertBefore(i, alignedPosition - blocks_[i].start);
+		if (blocks_[i].size > alignedSize)
+			InsertAfter(i, blocks_[i].size - alignedSize);
+		blocks_[i].taken = true;
+		return position;
+	}
+
+	bool Free(u32 position, bool exact) {
+		int i = Find(position);
+		if (i < 0 || !blocks_[i].taken || (exact && blocks_[i].start != position))
+			return false;
+		blocks_[i].taken = false;
+		size_t lo = i, hi = i;
+		while (lo > 0 && !blocks_[lo - 1].taken)
+			lo--;
+		while (hi + 1 < blocks_.size() && !blocks_[hi + 1].taken)
+			hi++;
+		for (size_t j = lo + 1; j <= hi; ++j)
+			blocks_[lo].size += blocks_[j].size;
+		blocks_.erase(blocks_.begin() + lo + 1, blocks_.begin() + hi + 1);
+		return true;
+	}
+
+	u32 GetTotalFreeBytes() const {
+		u32 sum = 0;
+		for (const RefBlock &b : blocks_)
+			sum += b.taken ? 0 : b.size;
+		return sum;
+	}
+
+	u32 GetLargestFreeBlockSize() const {
+		u32 largest = 0;
+		for (const RefBlock &b : blocks_)
+			largest = b.taken ? largest : std::max(largest, b.size);
+		return largest;
+	}
+
+	// Checks the real allocator has exactly the same blocks.
+	bool Matches(BlockAllocator &a) const {
+		for (const RefBlock &b : blocks_) {
+			if (a.GetBlockStartFromAddress(b.start) != b.start || a.GetBlockSizeFromAddress(b.start) != b.size || a.IsBlockFree(b.start) == b.taken)
+				return false;
+		}
+		return a.GetTotalFreeBytes() == GetTotalFreeBytes() && a.GetLargestFreeBlockSize() == GetLargestFreeBlockSize();
+	}
+
+private:
+	struct RefBlock {
+		u32 start;
+		u32 size;
+		bool taken;
+	};
+
+	int Find(u32 addr) const {
+		for (size_t i = 0; i < blocks_.size(); ++i) {
+			if (blocks_[i].start <= addr && blocks_[i].start + blocks_[i].size > addr)
+				return (int)i;
+		}
+		return -1;
+	}
+	// Splits a free block off the start of block i, returns where block i went.
+	size_t InsertBefore(size_t i, u32 size) {
+		blocks_.insert(blocks_.begin() + i, RefBlock{ blocks_[i].start, size, false });
+		blocks_[i + 1].start += size;
+		blocks_[i + 1].size -= size;
+		return i + 1;
+	}
+	void InsertAfter(size_t i, u32 size) {
+		blocks_[i].size -= size;
+		blocks_.insert(blocks_.begin() + i + 1, RefBlock{ blocks_[i].start + blocks_[i].size, size, false });
+	}
+
+	std::vector<RefBlock> blocks_;
+	u32 grain_;
+	u32 rangeSize_ = 0;
+};
+
+// Random operations against both, including a save state round trip halfway.
+static bool FuzzBlockAllocator(u32 rangeStart, u32 rangeSize, u32 grain, u32 seed, int iterations) {
+	BlockAllocator a(grain);
+	a.Init(rangeStart, rangeSize, false);
+	ReferenceBlockAllocator ref(grain);
+	ref.Init(rangeStart, rangeSize);
+
+	std::vector<u32> live;
+	u32 rng = seed;
+	auto next = [&rng]() { rng = rng * 1103515245u + 12345u; return (rng >> 16) & 0x7FFF; };
+
+	for (int i = 0; i < iterations; ++i) {
+		const int op = next() % 100;
+		if (op < 35 && !live.empty()) {
+			const size_t idx = next() % live.size();
+			// Sometimes somewhere inside the block rather than its start.
+			const u32 addr = live[idx] + ((next() % 4) == 0 ? grain : 0);
+			const bool exact = (next() % 2) != 0;
+			const bool got = exact ? a.FreeExact(addr) : a.Free(addr);
+			if (got != ref.Free(addr, exact)) {
+				printf("BlockAllocator fuzz: Free(%08x, %d) differs at iteration %d\n", addr, exact, i);
+				return false;
+			}
+			if (got)
+				live.erase(live.begin() + idx);
+		} else if (op < 85) {
+			// Mostly small, like FPL/VPL and homebrew malloc blocks, now and then something big.
+			u32 size = (next() % 8) == 0 ? (next() % 64 + 1) * 0x1000 : next() % 2048 + 1;
+			const u32 align = (next() % 3) == 0 ? 16u << ((next() % 5) * 2) : 0;
+			const bool fromTop = (next() % 3) == 0;
+			u32 refSize = size;
+			const u32 addr = align ? a.AllocAligned(size, align, align, fromTop, "fuzz") : a.Alloc(size, fromTop, "fuzz");
+			const u32 refAddr = ref.AllocAligned(refSize, align ? align : grain, align ? align : grain, fromTop);
+			if (addr != refAddr || size != refSize) {
+				printf("BlockAllocator fuzz: alloc gave %08x (%08x), reference %08x (%08x) at iteration %d\n", addr, size, refAddr, refSize, i);
+				return false;
+			}
+			if (addr != (u32)-1)
+				live.push_back(addr);
+		} else {
+			const u32 pos = rangeStart + (next() * 0x1000 + next() % 0x1000) % rangeSize;
+			u32 size = next() % 0x2000 + 1;
+			const u32 addr = a.AllocAt(pos, size, "fuzzat");
+			if (addr != ref.AllocAt(pos, size)) {
+				printf("BlockAllocator fuzz: AllocAt(%08x) differs at iteration %d\n", pos, i);
+				return false;
+			}
+			if (addr != (u32)-1)
+				live.push_back(addr);
+		}
+
+		if ((i % 64) == 0 && !ref.Matches(a)) {
+			printf("BlockAllocator fuzz: blocks differ from the reference at iteration %d\n", i);
+			return false;
+		}
+
+		if (i == iterations / 2) {
+			std::vector<u8> buf;
+			EXPECT_TRUE(SerializerWrite(&buf, [&](PointerWrap &p) { a.DoState(p); }));
+			BlockAllocator loaded(grain);
+			EXPECT_EQ_INT((int)SerializerRead(buf, [&](PointerWrap &p) { loaded.DoState(p); }), (int)PointerWrap::ERROR_NONE);
+			EXPECT_TRUE(ref.Matches(loaded));
+			// Carry on with the loaded one, so its indexes get exercised too.
+			a.Init(rangeStart, rangeSize, false);
+			EXPECT_EQ_INT((int)SerializerRead(buf, [&](PointerWrap &p) { a.DoState(p); }), (int)PointerWrap::ERROR_NONE);
+		}
+	}
+	return ref.Matches(a);
+}
+
 bool TestBlockAllocator() {
 	const u32 kStart = 0x08800000;
 	const u32 kSize = 0x00100000;  // 1MB
@@ -1422,6 +2167,31 @@ bool TestBlockAllocator() {
 		EXPECT_TRUE(ValidateAllocator(a, kStart, kSize));
 	}
 
+	// Compare against the old list walking allocator, including a range that's off the grain.
+	EXPECT_TRUE(FuzzBlockAllocator(kStart, 0x01800000, 256, 1, 20000));
+	EXPECT_TRUE(FuzzBlockAllocator(kStart + 0x40, 0x00400000, 16, 2, 20000));
+	EXPECT_TRUE(FuzzBlockAllocator(kStart + 8, 0x00100000 + 0x30, 16, 3, 20000));
+
+	// Lots of small blocks, like homebrew using the partition allocator as malloc.
+	{
+		BlockAllocator a(16);
+		a.Init(kStart, 0x01800000, false);
+		std::vector<u32> addrs;
+		double start = time_now_d();
+		for (int i = 0; i < 20000; ++i) {
+			u32 size = 64 + (i % 7) * 16;
+			addrs.push_back(a.Alloc(size, (i % 5) == 0, "small"));
+		}
+		for (size_t i = 0; i < addrs.size(); i += 2)
+			EXPECT_TRUE(a.Free(addrs[i]));
+		for (int i = 0; i < 20000; ++i) {
+			u32 size = 48;
+			a.Alloc(size, false, "refill");
+		}
+		printf("BlockAllocator: 40000 allocs and 10000 frees among ~30000 blocks: %0.2f ms\n", (time_now_d() - start) * 1000.0);
+		EXPECT_TRUE(ValidateAllocator(a, kStart, 0x01800000));
+	}
+
 	return true;
 }
 
@@ -1611,6 +2381,578 @@ bool TestSymbolMap() {
 		EXPECT_EQ_INT((int)map.GetFunctionStart(kModStart + 0x100), (int)SymbolMap::INVALID_ADDRESS);
 	}
 
+	// Label names are looked up ignoring case, and a name used twice resolves to the lower address
+	// until that one goes away.
+	{
+		SymbolMap map;
+		map.AddModule("TEST", kModStart, kModSize);
+		map.AddFunction("Twice", kModStart + 0x200, 0x40);
+		map.AddFunction("twice", kModStart + 0x100, 0x40);
+		u32 value = 0;
+		EXPECT_TRUE(map.GetLabelValue("TWICE", value));
+		EXPECT_EQ_INT((int)value, (int)(kModStart + 0x100));
+		EXPECT_TRUE(map.RemoveFunction(kModStart + 0x100, true));
+		EXPECT_TRUE(map.GetLabelValue("twice", value));
+		EXPECT_EQ_INT((int)value, (int)(kModStart + 0x200));
+		map.SetLabelName("renamed", kModStart + 0x200);
+		EXPECT_FALSE(map.GetLabelValue("twice", value));
+		EXPECT_TRUE(map.GetLabelValue("Renamed", value));
+	}
+
+	// Loading and unloading modules updates the active symbols in place. If two loaded modules have
+	// a symbol at the same address, the first module's wins, and the other one's shows up once the
+	// first is unloaded.
+	{
+		SymbolMap map;
+		map.AddModule("FIRST", kModStart, kModSize);
+		map.AddModule("SECOND", kModStart, kModSize + 0x1000);
+		const int first = map.GetModuleIndexByName("FIRST");
+		const int second = map.GetModuleIndexByName("SECOND");
+		map.AddFunction("first_func", kModStart + 0x100, 0x40, first);
+		map.AddFunction("second_func", kModStart + 0x100, 0x80, second);
+		map.AddFunction("second_only", kModStart + 0x400, 0x40, second);
+		EXPECT_EQ_STR(map.GetLabelString(kModStart + 0x100), std::string("first_func"));
+		EXPECT_EQ_INT((int)map.GetFunctionSize(kModStart + 0x100), 0x40);
+
+		map.UnloadModule(kModStart, kModSize);
+		EXPECT_EQ_STR(map.GetLabelString(kModStart + 0x100), std::string("second_func"));
+		EXPECT_EQ_INT((int)map.GetFunctionSize(kModStart + 0x100), 0x80);
+
+		map.UnloadModule(kModStart, kModSize + 0x1000);
+		EXPECT_EQ_INT((int)map.GetAllActiveSymbols(ST_FUNCTION).size(), 0);
+		EXPECT_TRUE(map.GetLabelString(kModStart + 0x400).empty());
+
+		map.AddModule("SECOND", kModStart + 0x100000, kModSize + 0x1000);
+		EXPECT_EQ_INT((int)map.GetFunctionStart(kModStart + 0x100420), (int)(kModStart + 0x100400));
+		u32 value = 0;
+		EXPECT_TRUE(map.GetLabelValue("second_only", value));
+		EXPECT_EQ_INT((int)value, (int)(kModStart + 0x100400));
+		EXPECT_FALSE(map.GetLabelValue("first_func", value));
+	}
+
+	// Module indexes don't follow load addresses, and a full rebuild collects symbols in module order.
+	// The active tables still have to come out sorted by address, or the lookups miss.
+	{
+		SymbolMap map;
+		const u32 highStart = 0x08900000;
+		const u32 lowStart = 0x08800000;
+		map.AddModule("HIGH", highStart, kModSize);
+		map.AddModule("LOW", lowStart, kModSize);
+		map.AddModule("SHADOW", lowStart, kModSize + 0x1000);
+		const int high = map.GetModuleIndexByName("HIGH");
+		const int low = map.GetModuleIndexByName("LOW");
+		const int shadow = map.GetModuleIndexByName("SHADOW");
+		map.AddFunction("high_func", highStart + 0x100, 0x40, high);
+		map.AddFunction("low_func", lowStart + 0x100, 0x40, low);
+		map.AddData(highStart + 0x800, 0x10, DATATYPE_WORD, high);
+		map.AddData(lowStart + 0x800, 0x10, DATATYPE_WORD, low);
+		// Hidden behind LOW's function, so unloading SHADOW has to rebuild everything.
+		map.AddFunction("shadow_func", lowStart + 0x100, 0x80, shadow);
+		map.UnloadModule(lowStart, kModSize + 0x1000);
+
+		EXPECT_EQ_INT((int)map.GetFunctionStart(lowStart + 0x100), (int)(lowStart + 0x100));
+		EXPECT_EQ_INT((int)map.GetFunctionStart(lowStart + 0x120), (int)(lowStart + 0x100));
+		EXPECT_EQ_INT((int)map.GetFunctionStart(highStart + 0x120), (int)(highStart + 0x100));
+		EXPECT_EQ_INT((int)map.GetFunctionSize(lowStart + 0x100), 0x40);
+		EXPECT_EQ_INT((int)map.GetDataStart(lowStart + 0x804), (int)(lowStart + 0x800));
+		EXPECT_EQ_INT((int)map.GetDataStart(highStart + 0x804), (int)(highStart + 0x800));
+		EXPECT_EQ_STR(map.GetLabelString(lowStart + 0x100), std::string("low_func"));
+		u32 prev = 0;
+		for (const auto &sym : map.GetAllActiveSymbols(ST_FUNCTION)) {
+			EXPECT_TRUE(sym.address >= prev);
+			prev = sym.address;
+		}
+	}
+
+	// A map file for a big game can have a hundred thousand symbols. Loading it and looking things
+	// up in it shouldn't make the debugger crawl.
+	{
+		const Path filename("unittest_symbols.sym");
+		const int SYMBOLS = 100000;
+		const u32 SPACING = 0x40;
+		Buffer buf;
+		buf.Printf(".text\n");
+		for (int i = 0; i < SYMBOLS; i++) {
+			const u32 addr = kModStart + i * SPACING;
+			buf.Printf("%08x %08x %08x %i func_%06d\n", addr, SPACING / 2, addr, ST_FUNCTION, i);
+		}
+		std::string text;
+		buf.TakeAll(&text);
+		EXPECT_TRUE(File::WriteStringToFile(true, text, filename));
+
+		SymbolMap map;
+		double start = time_now_d();
+		EXPECT_TRUE(map.LoadSymbolMap(filename));
+		EXPECT_EQ_INT((int)map.GetAllActiveSymbols(ST_FUNCTION).size(), SYMBOLS);
+		const double loadTime = time_now_d() - start;
+		File::Delete(filename);
+
+		start = time_now_d();
+		int wrong = 0;
+		for (u32 i = 0; i < 1000000; i++) {
+			const u32 offset = (i * 2654435761U) % (SYMBOLS * SPACING);
+			const u32 expected = (offset % SPACING) < SPACING / 2 ? kModStart + offset - offset % SPACING : SymbolMap::INVALID_ADDRESS;
+			if (map.GetFunctionStart(kModStart + offset) != expected)
+				wrong++;
+		}
+		const double lookupTime = time_now_d() - start;
+		EXPECT_EQ_INT(wrong, 0);
+
+		start = time_now_d();
+		for (int i = 0; i < SYMBOLS; i++) {
+			u32 value = 0;
+			if (!map.GetLabelValue(StringFromFormat("FUNC_%06d", (i * 7919) % SYMBOLS).c_str(), value) || value != kModStart + ((i * 7919) % SYMBOLS) * SPACING)
+				wrong++;
+		}
+		const double nameTime = time_now_d() - start;
+		EXPECT_EQ_INT(wrong, 0);
+
+		printf("SymbolMap: loading %d symbols: %0.1f ms, 1M address lookups: %0.1f ms, %d name lookups: %0.1f ms\n", SYMBOLS, loadTime * 1000.0, lookupTime * 1000.0, SYMBOLS, nameTime * 1000.0);
+	}
+
+	return true;
+}
+
+bool TestThreadQueueList() {
+	// Checked against a list per priority, through the kinds of sequences the scheduler does.
+	ThreadQueueList queue;
+	std::vector<std::vector<SceUID>> reference(ThreadQueueList::NUM_QUEUES);
+	std::vector<std::pair<u32, SceUID>> queued;
+	auto referenceFirst = [&](u32 limit) -> int {
+		for (u32 i = 0; i < limit; ++i) {
+			if (!reference[i].empty())
+				return (int)i;
+		}
+		return -1;
+	};
+	auto forget = [&](SceUID threadID) {
+		for (size_t i = 0; i < queued.size(); ++i) {
+			if (queued[i].second == threadID) {
+				queued.erase(queued.begin() + i);
+				break;
+			}
+		}
+	};
+
+	uint32_t seed = 0x12345678;
+	auto next = [&]() {
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	};
+
+	SceUID nextID = 1;
+	for (int i = 0; i < 200000; ++i) {
+		// Favor a few levels, like games do, but touch all of them.
+		u32 priority = (next() & 7) == 0 ? next() % ThreadQueueList::NUM_QUEUES : 16 + next() % 8;
+		switch (next() % 7) {
+		case 0:
+		case 1:
+			queue.prepare(priority);
+			if (next() & 1) {
+				queue.push_back(priority, nextID);
+				reference[priority].push_back(nextID);
+			} else {
+				queue.push_front(priority, nextID);
+				reference[priority].insert(reference[priority].begin(), nextID);
+			}
+			queued.emplace_back(priority, nextID++);
+			break;
+
+		case 2:
+			if (!queued.empty()) {
+				int best = referenceFirst(ThreadQueueList::NUM_QUEUES);
+				SceUID threadID = queue.pop_first();
+				EXPECT_EQ_INT(threadID, reference[best].front());
+				reference[best].erase(reference[best].begin());
+				forget(threadID);
+			}
+			break;
+
+		case 3:
+		{
+			int best = referenceFirst(priority);
+			SceUID threadID = queue.pop_first_better(priority);
+			if (best < 0) {
+				EXPECT_EQ_INT(threadID, 0);
+			} else {
+				EXPECT_EQ_INT(threadID, reference[best].front());
+				reference[best].erase(reference[best].begin());
+				forget(threadID);
+			}
+			break;
+		}
+
+		case 4:
+			if (!queued.empty()) {
+				auto entry = queued[next() % queued.size()];
+				queue.remove(entry.first, entry.second);
+				auto &level = reference[entry.first];
+				level.erase(std::find(level.begin(), level.end(), entry.second));
+				forget(entry.second);
+			}
+			break;
+
+		case 5:
+			if (!queued.empty()) {
+				u32 level = queued[next() % queued.size()].first;
+				queue.rotate(level);
+				if (reference[level].size() > 1)
+					std::rotate(reference[level].begin(), reference[level].begin() + 1, reference[level].end());
+			}
+			break;
+
+		case 6:
+		{
+			int best = referenceFirst(ThreadQueueList::NUM_QUEUES);
+			EXPECT_EQ_INT(queue.peek_first(), best < 0 ? 0 : reference[best].front());
+			EXPECT_EQ_INT(queue.empty(priority), reference[priority].empty());
+			break;
+		}
+		}
+	}
+
+	// Round trip through a save state, and make sure the order survives.
+	std::vector<u8> buf;
+	EXPECT_TRUE(SerializerWrite(&buf, [&](PointerWrap &p) {
+		queue.DoState(p);
+	}));
+	ThreadQueueList loaded;
+	EXPECT_EQ_INT((int)SerializerRead(buf, [&](PointerWrap &p) {
+		loaded.DoState(p);
+	}), (int)PointerWrap::ERROR_NONE);
+	for (size_t i = 0; i < queued.size(); ++i) {
+		int best = referenceFirst(ThreadQueueList::NUM_QUEUES);
+		EXPECT_EQ_INT(loaded.pop_first(), reference[best].front());
+		reference[best].erase(reference[best].begin());
+	}
+	EXPECT_EQ_INT(loaded.peek_first(), 0);
+
+	// Rough scheduling cost, with most levels used at some point but only a few threads left ready.
+	{
+		ThreadQueueList sched;
+		for (u32 p = 8; p < 112; ++p)
+			sched.prepare(p);
+		for (u32 p = 100; p < 112; ++p)
+			sched.push_back(p, (SceUID)(p + 1));
+		const int SWITCHES = 1000000;
+		double start = time_now_d();
+		SceUID current = sched.pop_first();
+		SceUID sum = 0;
+		for (int i = 0; i < SWITCHES; ++i) {
+			// Yield: nothing better to switch to, so rotate through the best level.
+			sum += sched.pop_first_better(100);
+			sched.push_back(100, current);
+			current = sched.pop_first();
+			sum += sched.peek_first();
+		}
+		double elapsed = time_now_d() - start;
+		printf("ThreadQueueList: %0.2f million scheduling ops/sec (%d)\n", SWITCHES * 4 / elapsed / 1000000.0, sum & 1);
+	}
+
+	return true;
+}
+
+// The wait list helpers, with priorities and the sema/event flag wake rules modeled here instead of real threads.
+bool TestKernelWaitHelpers() {
+	std::map<SceUID, u32> prios;
+	auto getPrio = [&](SceUID threadID) {
+		return prios[threadID];
+	};
+	auto stableSorted = [&](std::vector<SceUID> list) {
+		std::stable_sort(list.begin(), list.end(), [&](SceUID a, SceUID b) {
+			return prios[a] < prios[b];
+		});
+		return list;
+	};
+
+	// Priority order keeps FIFO order within a priority, like the stable_sort it replaced.
+	prios = { { 1, 30 }, { 2, 20 }, { 3, 30 }, { 4, 10 }, { 5, 20 }, { 6, 40 }, { 7, 10 }, { 8, 30 } };
+	std::vector<SceUID> waiting = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	HLEKernel::SortWaitingThreadsByPriority(waiting, getPrio);
+	EXPECT_TRUE(waiting == std::vector<SceUID>({ 4, 7, 2, 5, 1, 3, 8, 6 }));
+
+	uint32_t seed = 0x4A11C0DE;
+	auto next = [&]() {
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	};
+	for (int i = 0; i < 1000; ++i) {
+		prios.clear();
+		waiting.clear();
+		int count = next() % 40;
+		for (int j = 0; j < count; ++j) {
+			SceUID threadID = 100 + j;
+			// Few distinct priorities, so there are plenty of ties.
+			prios[threadID] = 16 + next() % 4;
+			waiting.push_back(threadID);
+		}
+		std::vector<SceUID> expected = stableSorted(waiting);
+		HLEKernel::SortWaitingThreadsByPriority(waiting, getPrio);
+		EXPECT_TRUE(waiting == expected);
+	}
+
+	// Struct wait lists (as used by FPL, VPL, message pipes) sort by their thread ID.
+	struct WaitInfo {
+		SceUID threadID;
+		u32 size;
+	};
+	prios = { { 1, 50 }, { 2, 20 }, { 3, 20 } };
+	std::vector<WaitInfo> waitInfos = { { 1, 100 }, { 2, 200 }, { 3, 300 } };
+	HLEKernel::SortWaitingThreadsByPriority(waitInfos, getPrio);
+	EXPECT_EQ_INT(waitInfos[0].threadID, 2);
+	EXPECT_EQ_INT(waitInfos[1].threadID, 3);
+	EXPECT_EQ_INT(waitInfos[2].size, 100);
+
+	// A semaphore: each waiter needs a count, and one pass wakes everything that fits, in list order.
+	struct SemaWaiter {
+		SceUID threadID;
+		int need;
+	};
+	std::vector<SceUID> woken;
+	auto signalSema = [&](std::vector<SemaWaiter> &waiters, int &semaCount) {
+		HLEKernel::UnlockWaitingThreads(waiters, [&](const SemaWaiter &w) {
+			if (w.need > semaCount)
+				return false;
+			semaCount -= w.need;
+			woken.push_back(w.threadID);
+			return true;
+		});
+	};
+
+	// FIFO: the first waiter needs too much, the ones after it that fit still wake.
+	prios = { { 1, 40 }, { 2, 30 }, { 3, 20 }, { 4, 10 } };
+	std::vector<SemaWaiter> semaWaiters = { { 1, 3 }, { 2, 1 }, { 3, 2 }, { 4, 1 } };
+	int semaCount = 2;
+	signalSema(semaWaiters, semaCount);
+	EXPECT_TRUE(woken == std::vector<SceUID>({ 2, 4 }));
+	EXPECT_EQ_INT(semaCount, 0);
+	EXPECT_EQ_INT((int)semaWaiters.size(), 2);
+	EXPECT_EQ_INT(semaWaiters[0].threadID, 1);
+	EXPECT_EQ_INT(semaWaiters[1].threadID, 3);
+
+	// Priority: same waiters, but the best priority gets the count first.
+	woken.clear();
+	semaWaiters = { { 1, 3 }, { 2, 1 }, { 3, 2 }, { 4, 1 } };
+	semaCount = 2;
+	HLEKernel::SortWaitingThreadsByPriority(semaWaiters, getPrio);
+	signalSema(semaWaiters, semaCount);
+	EXPECT_TRUE(woken == std::vector<SceUID>({ 4, 2 }));
+	EXPECT_EQ_INT((int)semaWaiters.size(), 2);
+	EXPECT_EQ_INT(semaWaiters[0].threadID, 3);
+	EXPECT_EQ_INT(semaWaiters[1].threadID, 1);
+
+	// An event flag: a waiter with a clear mode clears the bits, so the ones after it may stay asleep.
+	struct FlagWaiter {
+		SceUID threadID;
+		u32 bits;
+		bool andMode;
+		bool clear;
+	};
+	std::vector<FlagWaiter> flagWaiters = {
+		{ 1, 0x1, false, false },
+		{ 2, 0x3, true, true },
+		{ 3, 0x2, false, false },
+		{ 4, 0x4, false, false },
+	};
+	u32 pattern = 0;
+	auto setFlag = [&](std::vector<FlagWaiter> &waiters, u32 bits) {
+		pattern |= bits;
+		HLEKernel::UnlockWaitingThreads(waiters, [&](const FlagWaiter &w) {
+			bool match = w.andMode ? (pattern & w.bits) == w.bits : (pattern & w.bits) != 0;
+			if (!match)
+				return false;
+			if (w.clear)
+				pattern = 0;
+			woken.push_back(w.threadID);
+			return true;
+		});
+	};
+	woken.clear();
+	setFlag(flagWaiters, 0x3);
+	EXPECT_TRUE(woken == std::vector<SceUID>({ 1, 2 }));
+	EXPECT_EQ_HEX(pattern, 0);
+	EXPECT_EQ_INT((int)flagWaiters.size(), 2);
+	EXPECT_EQ_INT(flagWaiters[0].threadID, 3);
+	EXPECT_EQ_INT(flagWaiters[1].threadID, 4);
+	woken.clear();
+	setFlag(flagWaiters, 0x4);
+	EXPECT_TRUE(woken == std::vector<SceUID>({ 4 }));
+	EXPECT_EQ_INT(flagWaiters[0].threadID, 3);
+
+	// Many threads waiting on one priority semaphore and one event flag. Whoever wakes waits again at the end.
+	{
+		const int WAITERS = 2000;
+		const int SIGNALS = 5000;
+		prios.clear();
+		semaWaiters.clear();
+		flagWaiters.clear();
+		for (int i = 0; i < WAITERS; ++i) {
+			SceUID threadID = 1000 + i;
+			prios[threadID] = 16 + next() % 32;
+			semaWaiters.push_back({ threadID, 1 + (int)(next() % 4) });
+			flagWaiters.push_back({ threadID, 1u << (next() % 16), false, false });
+		}
+
+		int64_t wakes = 0;
+		int64_t signaled = 0;
+		semaCount = 0;
+		pattern = 0;
+		double start = time_now_d();
+		for (int i = 0; i < SIGNALS; ++i) {
+			woken.clear();
+			int signal = 1 + next() % 64;
+			semaCount += signal;
+			signaled += signal;
+			HLEKernel::SortWaitingThreadsByPriority(semaWaiters, getPrio);
+			signalSema(semaWaiters, semaCount);
+			for (SceUID threadID : woken)
+				semaWaiters.push_back({ threadID, 1 + (int)(next() % 4) });
+			wakes += woken.size();
+
+			woken.clear();
+			pattern = 0;
+			setFlag(flagWaiters, 1u << (next() % 16));
+			for (SceUID threadID : woken)
+				flagWaiters.push_back({ threadID, 1u << (next() % 16), false, false });
+			wakes += woken.size();
+		}
+		double elapsed = time_now_d() - start;
+		EXPECT_EQ_INT((int)semaWaiters.size(), WAITERS);
+		EXPECT_EQ_INT((int)flagWaiters.size(), WAITERS);
+		// Nothing is left over that a waiter could have taken.
+		for (const SemaWaiter &w : semaWaiters)
+			EXPECT_TRUE(w.need > semaCount);
+		EXPECT_TRUE(signaled > 0 && wakes > 0);
+		printf("Kernel wait lists: %0.2f million signal+wake ops/sec (%d waiters)\n", (SIGNALS * 2 + wakes) / elapsed / 1000000.0, WAITERS);
+	}
+
+	return true;
+}
+
+// A file in memory. Reads ahead don't happen until they're waited for, like with a busy io thread.
+class MemoryReadaheadFile : public IoReadaheadFile {
+public:
+	explicit MemoryReadaheadFile(const std::vector<u8> &contents) : data(contents) {}
+
+	void StartRead(u8 *buf, size_t bytes) override {
+		pendingBuf_ = buf;
+		pendingBytes_ = bytes;
+	}
+	s64 FinishRead() override {
+		return (s64)Read(pendingBuf_, pendingBytes_);
+	}
+	s64 Tell() override {
+		return pos;
+	}
+	void SeekBack(size_t bytes) override {
+		pos -= (s64)bytes;
+	}
+
+	size_t Read(u8 *dest, size_t bytes) {
+		size_t n = std::min(bytes, (size_t)(data.size() - pos));
+		memcpy(dest, &data[pos], n);
+		pos += n;
+		return n;
+	}
+
+	std::vector<u8> data;
+	s64 pos = 0;
+
+private:
+	u8 *pendingBuf_ = nullptr;
+	size_t pendingBytes_ = 0;
+};
+
+// Reads like sceIoRead: from the readahead buffer if it takes it, otherwise from the file.
+static u32 ReadWithReadahead(IoReadahead &ra, MemoryReadaheadFile &file, u8 *dest, u32 size, bool *buffered) {
+	u32 result;
+	*buffered = ra.Read(file, dest, size, true, &result);
+	if (!*buffered)
+		result = (u32)file.Read(dest, size);
+	return result;
+}
+
+bool TestIoReadahead() {
+	std::vector<u8> data(300 * 1024 + 123);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = (u8)(i * 2654435761U >> 11);
+	MemoryReadaheadFile file(data);
+	IoReadahead ra;
+	u8 buf[IoReadahead::MAX_READ + 1];
+	bool buffered;
+
+	// Buffering starts with the third small read in a row, and the file gets ahead of the game.
+	for (int i = 0; i < 3; i++) {
+		EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, 1000, &buffered), 1000);
+		EXPECT_TRUE(buffered == (i == 2));
+		EXPECT_TRUE(memcmp(buf, &data[i * 1000], 1000) == 0);
+	}
+	EXPECT_TRUE(ra.Active());
+	EXPECT_EQ_INT((int)ra.Position(), 3000);
+	EXPECT_TRUE(file.pos > 3000);
+
+	// Reads keep coming from the buffer, across its refills.
+	s64 pos = 3000;
+	while (pos < 200000) {
+		u32 size = 700 + (u32)(pos % 3000);
+		EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, size, &buffered), size);
+		EXPECT_TRUE(buffered);
+		EXPECT_TRUE(memcmp(buf, &data[pos], size) == 0);
+		pos += size;
+	}
+	EXPECT_EQ_INT((int)ra.Position(), (int)pos);
+
+	// A seek flushes first, which puts the file back where the game is. Then it takes a few reads to start again.
+	ra.Flush(file);
+	EXPECT_FALSE(ra.Active());
+	EXPECT_EQ_INT((int)ra.Position(), -1);
+	EXPECT_EQ_INT((int)file.pos, (int)pos);
+	file.pos = 5000;
+	for (int i = 0; i < 3; i++) {
+		EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, 1000, &buffered), 1000);
+		EXPECT_TRUE(buffered == (i == 2));
+		EXPECT_TRUE(memcmp(buf, &data[5000 + i * 1000], 1000) == 0);
+	}
+
+	// A write through another handle flushes too, so the next read sees the new data rather than the buffer.
+	for (size_t i = 8000; i < 12000; i++)
+		file.data[i] = ~data[i];
+	ra.Flush(file);
+	EXPECT_EQ_INT((int)file.pos, 8000);
+	EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, 4000, &buffered), 4000);
+	EXPECT_FALSE(buffered);
+	EXPECT_TRUE(memcmp(buf, &file.data[8000], 4000) == 0);
+	file.data = data;
+
+	// A large read also flushes, and goes to the file from where the game is.
+	for (int i = 0; i < 3; i++)
+		ReadWithReadahead(ra, file, buf, 1000, &buffered);
+	EXPECT_TRUE(buffered);
+	EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, sizeof(buf), &buffered), (int)sizeof(buf));
+	EXPECT_FALSE(buffered);
+	EXPECT_FALSE(ra.Active());
+	EXPECT_TRUE(memcmp(buf, &data[15000], sizeof(buf)) == 0);
+
+	// Reading to the end of the file, then past it.
+	ra.Flush(file);
+	file.pos = data.size() - 2500;
+	for (int i = 0; i < 3; i++)
+		EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, 1000, &buffered), i == 2 ? 500 : 1000);
+	EXPECT_TRUE(buffered);
+	EXPECT_TRUE(memcmp(buf, &data[data.size() - 500], 500) == 0);
+	EXPECT_EQ_INT(ReadWithReadahead(ra, file, buf, 1000, &buffered), 0);
+	EXPECT_TRUE(buffered);
+	ra.Flush(file);
+	EXPECT_EQ_INT((int)file.pos, (int)data.size());
+
+	// Nothing is buffered while the caller says it can't start.
+	file.pos = 0;
+	for (int i = 0; i < 5; i++) {
+		u32 result;
+		EXPECT_FALSE(ra.Read(file, buf, 1000, false, &result));
+		file.Read(buf, 1000);
+	}
+	EXPECT_FALSE(ra.Active());
 	return true;
 }
 
@@ -2038,6 +3380,414 @@ bool TestParseLBN() {
 	return true;
 }
 
+// A disc image held in memory, so block device reads can be checked and timed without the disk.
+class MemoryFileLoader : public FileLoader {
+public:
+	explicit MemoryFileLoader(const std::vector<u8> &data) : data_(data) {}
+	bool Exists() override { return true; }
+	bool IsDirectory() override { return false; }
+	s64 FileSize() override { return (s64)data_.size(); }
+	Path GetPath() const override { return Path("memory.iso"); }
+	size_t ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data, Flags flags = Flags::NONE) override {
+		readCalls++;
+		if (absolutePos < 0 || (u64)absolutePos >= data_.size() || bytes == 0)
+			return 0;
+		count = std::min(count, (size_t)((data_.size() - absolutePos) / bytes));
+		memcpy(data, &data_[absolutePos], bytes * count);
+		return count;
+	}
+
+	int readCalls = 0;
+
+private:
+	std::vector<u8> data_;
+};
+
+static void FillBlockDeviceImage(std::vector<u8> &image) {
+	for (size_t i = 0; i < image.size(); i += 4) {
+		u32 value = (u32)(i * 2654435761U);
+		memcpy(&image[i], &value, 4);
+	}
+}
+
+static void PutLE16(std::vector<u8> &image, size_t offset, u16 value) {
+	image[offset] = value & 0xFF;
+	image[offset + 1] = value >> 8;
+}
+
+static void PutLE32(std::vector<u8> &image, size_t offset, u32 value) {
+	for (int i = 0; i < 4; ++i)
+		image[offset + i] = (value >> (i * 8)) & 0xFF;
+}
+
+static void ClearSector(std::vector<u8> &image, u32 sector) {
+	memset(&image[sector * 2048], 0, 2048);
+}
+
+// Checks a device that maps USER_L0.IMG and USER_L1.IMG (both in the image at the given sectors) into one disc.
+static bool CheckLayeredBlockDevice(BlockDevice &device, const std::vector<u8> &image, u32 l0Start, u32 l0Blocks, u32 l1Start, u32 l1Blocks) {
+	EXPECT_TRUE(device.IsOK());
+	EXPECT_EQ_INT(device.GetNumBlocks(), l0Blocks + l1Blocks);
+
+	std::vector<u8> expected;
+	expected.insert(expected.end(), image.begin() + l0Start * 2048, image.begin() + (l0Start + l0Blocks) * 2048);
+	expected.insert(expected.end(), image.begin() + l1Start * 2048, image.begin() + (l1Start + l1Blocks) * 2048);
+
+	// Across the layer boundary.
+	const u32 first = l0Blocks - 3;
+	std::vector<u8> out(8 * 2048);
+	EXPECT_TRUE(device.ReadBlocks(first, 8, out.data()));
+	EXPECT_TRUE(memcmp(out.data(), &expected[first * 2048], out.size()) == 0);
+
+	u8 block[2048];
+	EXPECT_TRUE(device.ReadBlock(l0Blocks - 1, block));
+	EXPECT_TRUE(memcmp(block, &expected[(l0Blocks - 1) * 2048], sizeof(block)) == 0);
+	EXPECT_TRUE(device.ReadBlock(l0Blocks, block));
+	EXPECT_TRUE(memcmp(block, &expected[l0Blocks * 2048], sizeof(block)) == 0);
+
+	std::vector<u8> all(expected.size());
+	EXPECT_TRUE(device.ReadBlocks(0, l0Blocks + l1Blocks, all.data()));
+	EXPECT_TRUE(all == expected);
+
+	// Past the end of layer 1.
+	EXPECT_FALSE(device.ReadBlock(l0Blocks + l1Blocks, block));
+	EXPECT_FALSE(device.ReadBlocks(l0Blocks + l1Blocks - 2, 4, out.data()));
+	return true;
+}
+
+// A minimal UDF image, laid out the way PSP DVD-R dumps are: USER_L0.IMG and USER_L1.IMG in the root.
+static bool TestUDFBlockDeviceReads() {
+	const u32 PARTITION = 64;
+	const u32 L0_START = PARTITION + 10, L0_BLOCKS = 100;
+	// A gap between the layers, so reading them as one run would be noticed.
+	const u32 L1_START = L0_START + L0_BLOCKS + 20, L1_BLOCKS = 50;
+	std::vector<u8> image(300 * 2048);
+	FillBlockDeviceImage(image);
+
+	// Anchor volume descriptor pointer, pointing at a two sector main descriptor sequence.
+	ClearSector(image, 256);
+	PutLE16(image, 256 * 2048, 0x0002);
+	PutLE32(image, 256 * 2048 + 16, 2 * 2048);
+	PutLE32(image, 256 * 2048 + 20, 32);
+	// Partition descriptor, then logical volume descriptor with the file set descriptor at partition block 0.
+	ClearSector(image, 32);
+	PutLE16(image, 32 * 2048, 0x0005);
+	PutLE32(image, 32 * 2048 + 188, PARTITION);
+	ClearSector(image, 33);
+	PutLE16(image, 33 * 2048, 0x0006);
+	PutLE32(image, 33 * 2048 + 252, 0);
+	// File set descriptor, with the root file entry at partition block 1.
+	ClearSector(image, PARTITION);
+	PutLE16(image, PARTITION * 2048, 0x0100);
+	PutLE32(image, PARTITION * 2048 + 400, 2048);
+	PutLE32(image, PARTITION * 2048 + 404, 1);
+
+	auto putFileEntry = [&](u32 sector, u32 length, u32 position) {
+		ClearSector(image, sector);
+		PutLE16(image, sector * 2048, 0x0105);
+		PutLE32(image, sector * 2048 + 0xAC, 8);
+		PutLE32(image, sector * 2048 + 0xB0, length);
+		PutLE32(image, sector * 2048 + 0xB4, position);
+	};
+	// The root directory is at partition block 2, the layer file entries at 3 and 4.
+	putFileEntry(PARTITION + 1, 2048, 2);
+	putFileEntry(PARTITION + 3, L0_BLOCKS * 2048, L0_START - PARTITION);
+	putFileEntry(PARTITION + 4, L1_BLOCKS * 2048, L1_START - PARTITION);
+
+	ClearSector(image, PARTITION + 2);
+	size_t offset = (PARTITION + 2) * 2048;
+	auto putFileId = [&](const char *name, u32 icbPosition) {
+		const u8 nameLen = (u8)strlen(name) + 1;
+		PutLE16(image, offset, 0x0101);
+		PutLE16(image, offset + 10, 38 + nameLen - 16);
+		image[offset + 19] = nameLen;
+		PutLE32(image, offset + 20, 2048);
+		PutLE32(image, offset + 24, icbPosition);
+		image[offset + 38] = 8;
+		memcpy(&image[offset + 39], name, nameLen - 1);
+		offset += (38 + nameLen + 3) & ~3;
+	};
+	putFileId("USER_L0.IMG", 3);
+	putFileId("USER_L1.IMG", 4);
+
+	MemoryFileLoader loader(image);
+	UDFFileBlockDevice device(&loader);
+	return CheckLayeredBlockDevice(device, image, L0_START, L0_BLOCKS, L1_START, L1_BLOCKS);
+}
+
+// A minimal ISO 9660 image with USER_L0.IMG and USER_L1.IMG in the root.
+static bool TestISOContainerBlockDeviceReads() {
+	const u32 ROOT_DIR = 20;
+	const u32 L0_START = 30, L0_BLOCKS = 100;
+	const u32 L1_START = L0_START + L0_BLOCKS + 20, L1_BLOCKS = 50;
+	std::vector<u8> image((L1_START + L1_BLOCKS + 10) * 2048);
+	FillBlockDeviceImage(image);
+
+	// Primary volume descriptor, with the root directory record at offset 156.
+	ClearSector(image, 16);
+	image[16 * 2048] = 1;
+	memcpy(&image[16 * 2048 + 1], "CD001", 5);
+	PutLE32(image, 16 * 2048 + 156 + 2, ROOT_DIR);
+	PutLE32(image, 16 * 2048 + 156 + 10, 2048);
+
+	ClearSector(image, ROOT_DIR);
+	size_t offset = ROOT_DIR * 2048;
+	auto putRecord = [&](const char *name, u8 nameLen, u32 sector, u32 length, u8 flags) {
+		const u8 size = (33 + nameLen + 1) & ~1;
+		image[offset] = size;
+		PutLE32(image, offset + 2, sector);
+		PutLE32(image, offset + 10, length);
+		image[offset + 25] = flags;
+		image[offset + 32] = nameLen;
+		memcpy(&image[offset + 33], name, nameLen);
+		offset += size;
+	};
+	putRecord("\x00", 1, ROOT_DIR, 2048, 2);
+	putRecord("\x01", 1, ROOT_DIR, 2048, 2);
+	putRecord("USER_L0.IMG;1", 13, L0_START, L0_BLOCKS * 2048, 0);
+	putRecord("USER_L1.IMG;1", 13, L1_START, L1_BLOCKS * 2048, 0);
+
+	MemoryFileLoader loader(image);
+	ISOContainerFileBlockDevice device(&loader);
+	return CheckLayeredBlockDevice(device, image, L0_START, L0_BLOCKS, L1_START, L1_BLOCKS);
+}
+
+static bool TestBlockDeviceReads() {
+	const u32 BLOCKS = 8192;
+	std::vector<u8> image(BLOCKS * 2048);
+	FillBlockDeviceImage(image);
+
+	MemoryFileLoader loader(image);
+	FileBlockDevice device(&loader);
+	EXPECT_EQ_INT(device.GetNumBlocks(), BLOCKS);
+
+	std::vector<u8> out(image.size());
+	EXPECT_TRUE(device.ReadBlocks(0, BLOCKS, out.data()));
+	EXPECT_TRUE(out == image);
+	// A large read should go straight into the destination in one request.
+	EXPECT_EQ_INT(loader.readCalls, 1);
+
+	u8 block[2048];
+	EXPECT_TRUE(device.ReadBlock(1234, block));
+	EXPECT_TRUE(memcmp(block, &image[1234 * 2048], sizeof(block)) == 0);
+	EXPECT_FALSE(device.ReadBlocks(BLOCKS - 1, 2, out.data()));
+
+	// Rough throughput of large reads, whole versus block by block.
+	const int PASSES = 16;
+	double start = time_now_d();
+	for (int i = 0; i < PASSES; ++i)
+		device.ReadBlocks(0, BLOCKS, out.data());
+	double whole = time_now_d() - start;
+	start = time_now_d();
+	for (int i = 0; i < PASSES; ++i) {
+		for (u32 b = 0; b < BLOCKS; ++b)
+			device.ReadBlock(b, out.data() + b * 2048);
+	}
+	double perBlock = time_now_d() - start;
+	const double mb = (double)PASSES * image.size() / (1024.0 * 1024.0);
+	printf("BlockDevice: %0.0f MB/s with large reads, %0.0f MB/s block by block\n", mb / whole, mb / perBlock);
+
+	EXPECT_TRUE(TestUDFBlockDeviceReads());
+	EXPECT_TRUE(TestISOContainerBlockDeviceReads());
+	return true;
+}
+
+// Holds up any thread but the one that created it in Pass() while closed. Used to stop BlockCache
+// readahead at a known point.
+class BlockCacheTestGate {
+public:
+	void Pass() {
+		if (std::this_thread::get_id() == owner_)
+			return;
+		std::unique_lock<std::mutex> guard(lock_);
+		if (!closed_)
+			return;
+		waiting_++;
+		cond_.notify_all();
+		cond_.wait(guard, [this] { return !closed_; });
+		waiting_--;
+	}
+	void Close() {
+		std::lock_guard<std::mutex> guard(lock_);
+		closed_ = true;
+	}
+	void Open() {
+		std::lock_guard<std::mutex> guard(lock_);
+		closed_ = false;
+		cond_.notify_all();
+	}
+	bool WaitForWaiter() {
+		std::unique_lock<std::mutex> guard(lock_);
+		return cond_.wait_for(guard, std::chrono::seconds(5), [this] { return waiting_ > 0; });
+	}
+
+private:
+	std::thread::id owner_ = std::this_thread::get_id();
+	std::mutex lock_;
+	std::condition_variable cond_;
+	bool closed_ = false;
+	int waiting_ = 0;
+};
+
+class BlockCacheTestLoader : public MemoryFileLoader {
+public:
+	explicit BlockCacheTestLoader(const std::vector<u8> &data) : MemoryFileLoader(data) {}
+	size_t ReadAt(s64 absolutePos, size_t bytes, size_t count, void *data, Flags flags = Flags::NONE) override {
+		gate.Pass();
+		std::lock_guard<std::mutex> guard(lock_);
+		return MemoryFileLoader::ReadAt(absolutePos, bytes, count, data, flags);
+	}
+
+	BlockCacheTestGate gate;
+
+private:
+	std::mutex lock_;
+};
+
+// A RAM tier that can be made to refuse every block, as a full or failing cache file would.
+class BlockCacheTestTier : public BlockCacheTier {
+public:
+	BlockCacheTestTier(BlockCacheTestGate *gate, bool refuse) : ram_(64), gate_(gate), refuse_(refuse) {}
+
+	bool Read(s64 block, size_t offset, size_t bytes, u8 *dest) override {
+		return !refuse_ && ram_.Read(block, offset, bytes, dest);
+	}
+	bool Write(s64 block, const u8 *src, bool readingAhead) override {
+		return !refuse_ && ram_.Write(block, src, readingAhead);
+	}
+	bool Contains(s64 block) override {
+		gate_->Pass();
+		return !refuse_ && ram_.Contains(block);
+	}
+	bool HasSpaceFor(size_t blocks) override {
+		return !refuse_ && ram_.HasSpaceFor(blocks);
+	}
+	void Clear() override {
+		ram_.Clear();
+	}
+
+private:
+	RamBlockTier ram_;
+	BlockCacheTestGate *gate_;
+	bool refuse_;
+};
+
+static bool CheckBlockCacheRead(BlockCache &cache, const std::vector<u8> &image, s64 pos, size_t bytes) {
+	std::vector<u8> out(bytes);
+	size_t expected = pos >= (s64)image.size() ? 0 : std::min(bytes, (size_t)(image.size() - pos));
+	size_t readSize = cache.ReadAt(pos, bytes, out.data(), FileLoader::Flags::NONE);
+	EXPECT_EQ_INT((int)readSize, (int)expected);
+	EXPECT_TRUE(memcmp(out.data(), image.data() + std::min(pos, (s64)image.size()), expected) == 0);
+	return true;
+}
+
+template <typename F>
+static bool WaitForBlockCache(F done) {
+	double start = time_now_d();
+	while (!done()) {
+		if (time_now_d() - start > 5.0)
+			return false;
+		sleep_ms(1, "block-cache-test");
+	}
+	return true;
+}
+
+static bool TestBlockCacheReads() {
+	const s64 B = BLOCK_CACHE_BLOCK_SIZE;
+	// Not a whole number of blocks, and more than one read's worth.
+	std::vector<u8> image(40 * B + 1000);
+	FillBlockDeviceImage(image);
+	const s64 size = (s64)image.size();
+
+	// Reads straddling block edges and the end of the file, through a tier smaller than the file.
+	{
+		BlockCacheTestLoader loader(image);
+		BlockCache cache(&loader, size, new RamBlockTier(16), BlockCache::ReadAheadMode::WINDOW);
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 0, 1));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, B - 1, 2));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, B - 1, B + 2));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 3 * B, 3 * B));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 5, size));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, size - 10, 100));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, size, 10));
+	}
+
+	// WINDOW readahead fills the blocks after a read, so reading them later doesn't miss.
+	{
+		BlockCacheTestLoader loader(image);
+		BlockCache cache(&loader, size, new RamBlockTier(64), BlockCache::ReadAheadMode::WINDOW);
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 3 * B - 50, 100));
+		EXPECT_EQ_INT((int)cache.GetStats().misses, 1);
+		// The read ended in block 3, so 4-6 are read ahead.
+		EXPECT_TRUE(WaitForBlockCache([&] { return cache.GetStats().readAheadBlocks == 3; }));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 5 * B + 10, 3000));
+		EXPECT_EQ_INT((int)cache.GetStats().misses, 1);
+	}
+
+	// WHOLE_FILE readahead keeps going until everything is cached.
+	{
+		BlockCacheTestLoader loader(image);
+		FullFileBlockTier *tier = new FullFileBlockTier(size);
+		BlockCache cache(&loader, size, tier, BlockCache::ReadAheadMode::WHOLE_FILE);
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 10 * B, 100));
+		EXPECT_TRUE(WaitForBlockCache([&] { return tier->IsComplete(); }));
+		u64 misses = cache.GetStats().misses;
+		for (s64 pos = 0; pos < size; pos += 7777)
+			EXPECT_TRUE(CheckBlockCacheRead(cache, image, pos, 7777));
+		EXPECT_EQ_INT((int)cache.GetStats().misses, (int)misses);
+	}
+
+	// When the tier can't take the blocks, the data is read directly instead.
+	{
+		BlockCacheTestLoader loader(image);
+		BlockCacheTestGate gate;
+		BlockCache cache(&loader, size, new BlockCacheTestTier(&gate, true), BlockCache::ReadAheadMode::WINDOW);
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, B - 100, 3 * B));
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, size - 100, 1000));
+		EXPECT_EQ_INT((int)cache.GetStats().readAheadBlocks, 0);
+	}
+
+	// Cancel() while WINDOW readahead is deciding what to read.
+	{
+		BlockCacheTestLoader loader(image);
+		BlockCacheTestGate gate;
+		gate.Close();
+		BlockCache cache(&loader, size, new BlockCacheTestTier(&gate, false), BlockCache::ReadAheadMode::WINDOW);
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 0, 100));
+		bool blocked = gate.WaitForWaiter();
+		cache.Cancel();
+		gate.Open();
+		cache.Shutdown();
+		EXPECT_TRUE(blocked);
+		EXPECT_EQ_INT((int)cache.GetStats().readAheadBlocks, 0);
+		EXPECT_EQ_INT((int)cache.GetStats().backendReads, 1);
+	}
+
+	// Cancel() in the middle of a WHOLE_FILE readahead read stops after that read.
+	{
+		BlockCacheTestLoader loader(image);
+		loader.gate.Close();
+		BlockCache cache(&loader, size, new FullFileBlockTier(size), BlockCache::ReadAheadMode::WHOLE_FILE);
+		EXPECT_TRUE(CheckBlockCacheRead(cache, image, 0, 100));
+		bool blocked = loader.gate.WaitForWaiter();
+		cache.Cancel();
+		loader.gate.Open();
+		cache.Shutdown();
+		EXPECT_TRUE(blocked);
+		EXPECT_EQ_INT((int)cache.GetStats().readAheadBlocks, 16);
+		EXPECT_EQ_INT((int)cache.GetStats().backendReads, 2);
+	}
+
+	return true;
+}
+
+static bool TestBlockCache() {
+	g_threadManager.Init(2, 1);
+	bool result = TestBlockCacheReads();
+	g_threadManager.Teardown();
+	return result;
+}
+
 // So we can use EXPECT_TRUE, etc.
 struct AlignedMem {
 	AlignedMem(size_t sz, size_t alignment = 16) {
@@ -2225,6 +3975,150 @@ static bool TestPath() {
 	return true;
 }
 
+// Also times lookups like sceIoOpen with the wrong case does, in a savedata-sized directory.
+static bool TestFixPathCase() {
+#if HOST_IS_CASE_SENSITIVE
+	const Path base("unittest_fix_path_case");
+	const Path dir = base / "PSP/SAVEDATA";
+	File::DeleteDirRecursively(base);
+	EXPECT_TRUE(File::CreateDir(base));
+	EXPECT_TRUE(File::CreateDir(base / "PSP"));
+	EXPECT_TRUE(File::CreateDir(dir));
+
+	const int FILE_COUNT = 10000;
+	for (int i = 0; i < FILE_COUNT; i++) {
+		File::CreateEmptyFile(dir / StringFromFormat("FILE%05d.BIN", i));
+	}
+	// Like a savedata directory that's been around for a while. Recently changed ones are always listed again.
+	for (const Path &settled : { base, base / "PSP", dir }) {
+		File::ChangeMTime(settled, time(nullptr) - 60);
+	}
+
+	const int LOOKUPS = 200;
+	auto openLookups = [&](PathCaseCache *cache) {
+		double start = time_now_d();
+		for (int i = 0; i < LOOKUPS; i++) {
+			std::string path = StringFromFormat("psp/savedata/file%05d.bin", (i * 7919) % FILE_COUNT);
+			if (!FixPathCase(base, path, FPC_PATH_MUST_EXIST, cache))
+				return -1.0;
+			FILE *f = File::OpenCFile(base / path, "rb");
+			if (!f)
+				return -1.0;
+			fclose(f);
+		}
+		return time_now_d() - start;
+	};
+
+	double uncached = openLookups(nullptr);
+	PathCaseCache cache;
+	double cached = openLookups(&cache);
+	EXPECT_TRUE(uncached >= 0.0);
+	EXPECT_TRUE(cached >= 0.0);
+	printf("FixPathCase: %d opens in %d files: %0.2f ms uncached, %0.2f ms cached (%d dir reads)\n", LOOKUPS, FILE_COUNT, uncached * 1000.0, cached * 1000.0, cache.GetStats().reads);
+
+	std::string path = "PSP/SaveData/file00042.bin";
+	EXPECT_TRUE(FixPathCase(base, path, FPC_FILE_MUST_EXIST, &cache));
+	EXPECT_EQ_STR(path, std::string("PSP/SAVEDATA/FILE00042.BIN"));
+
+	// Added behind the cache's back. The directory just changed, so it should notice anyway.
+	File::CreateEmptyFile(dir / "NewFile.Bin");
+	path = "psp/savedata/newfile.bin";
+	EXPECT_TRUE(FixPathCase(base, path, FPC_FILE_MUST_EXIST, &cache));
+	EXPECT_EQ_STR(path, std::string("PSP/SAVEDATA/NewFile.Bin"));
+
+	File::Delete(dir / "NewFile.Bin");
+	cache.Invalidate(dir.ToString());
+	path = "psp/savedata/newfile.bin";
+	EXPECT_FALSE(FixPathCase(base, path, FPC_FILE_MUST_EXIST, &cache));
+	path = "psp/savedata/newfile.bin";
+	EXPECT_TRUE(FixPathCase(base, path, FPC_PATH_MUST_EXIST, &cache));
+
+	File::DeleteDirRecursively(base);
+#endif
+	return true;
+}
+
+// The parsed .ppsspp-index.lst is cached in the app cache directory, with sizes checked lazily.
+static bool TestVirtualDiscIndexCache() {
+	const Path base("unittest_virtual_disc");
+	const Path disc = base / "disc";
+	const Path cacheDir = base / "cache";
+	File::DeleteDirRecursively(base);
+	EXPECT_TRUE(File::CreateDir(base));
+	EXPECT_TRUE(File::CreateDir(disc));
+	EXPECT_TRUE(File::CreateDir(cacheDir));
+	const Path savedCacheDir = g_Config.appCacheDirectory;
+	g_Config.appCacheDirectory = cacheDir;
+
+	auto writeFile = [&](const char *name, char c, size_t size) {
+		return File::WriteStringToFile(false, std::string(size, c), disc / name);
+	};
+	EXPECT_TRUE(writeFile("A.BIN", 'A', 3000));
+	EXPECT_TRUE(writeFile("B.BIN", 'B', 5000));
+	EXPECT_TRUE(writeFile("C.BIN", 'C', 2048));
+	EXPECT_TRUE(writeFile("D.BIN", 'D', 3 * 2048));
+	// C starts at the same block as A, and D (listed later) overlaps A. The first one listed wins.
+	EXPECT_TRUE(File::WriteStringToFile(true, "; Test index\n00000010 A.BIN\n00000010 C.BIN\n00000020 B.BIN\n0000000F D.BIN\n", disc / ".ppsspp-index.lst"));
+
+	auto countCacheFiles = [&]() {
+		std::vector<File::FileInfo> files;
+		File::GetFilesInDir(cacheDir, &files, "vdiscindex");
+		return (int)files.size();
+	};
+	// Returns the first byte of the block, read through the whole disc, or 0 if nothing's there.
+	auto readBlock = [](VirtualDiscFileSystem &fs, u32 handle, u32 block) {
+		u8 data[2048]{};
+		fs.SeekFile(handle, block, FILEMOVE_BEGIN);
+		if (fs.ReadFile(handle, data, 1) != 1)
+			return (u8)0;
+		return data[0];
+	};
+
+	SequentialHandleAllocator alloc;
+	{
+		VirtualDiscFileSystem fs(&alloc, disc);
+		EXPECT_EQ_INT(countCacheFiles(), 1);
+		u32 handle = fs.OpenFile("", FILEACCESS_READ);
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x0F), 'D');
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x10), 'A');
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x11), 'A');
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x22), 'B');
+		fs.CloseFile(handle);
+	}
+
+	// Grow B from 3 to 5 blocks without touching the index, so the cached size is stale.
+	EXPECT_TRUE(writeFile("B.BIN", 'B', 9000));
+	{
+		VirtualDiscFileSystem fs(&alloc, disc);
+		EXPECT_EQ_INT(fs.GetFileInfo("A.BIN").startSector, 0x10);
+		EXPECT_EQ_INT(fs.GetFileInfo("D.BIN").startSector, 0x0F);
+		u32 handle = fs.OpenFile("", FILEACCESS_READ);
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x0F), 'D');
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x10), 'A');
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x11), 'A');
+		// The first read of B notices the new size, rebuilds the lookups and drops the cache.
+		EXPECT_EQ_INT(countCacheFiles(), 1);
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x20), 'B');
+		EXPECT_EQ_INT(countCacheFiles(), 0);
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x24), 'B');
+		fs.CloseFile(handle);
+	}
+
+	// Without a cache, the index is parsed again with the new size, and cached again.
+	{
+		VirtualDiscFileSystem fs(&alloc, disc);
+		EXPECT_EQ_INT(countCacheFiles(), 1);
+		u32 handle = fs.OpenFile("", FILEACCESS_READ);
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x24), 'B');
+		EXPECT_EQ_INT(readBlock(fs, handle, 0x10), 'A');
+		fs.CloseFile(handle);
+	}
+
+	g_Config.appCacheDirectory = savedCacheDir;
+	File::DeleteDirRecursively(base);
+	return true;
+}
+
 static bool TestAndroidContentURI() {
 	static const char *treeURIString = "content://com.android.externalstorage.documents/tree/primary%3APSP%20ISO";
 	static const char *directoryURIString = "content://com.android.externalstorage.documents/tree/primary%3APSP%20ISO/document/primary%3APSP%20ISO";
@@ -2823,6 +4717,184 @@ bool TestCmdLine() {
 	return true;
 }
 
+#ifdef SDL
+static GLuint CompileProgramBinaryTestShader(GLenum stage, const char *code) {
+	std::string source = gl_extensions.IsGLES ? std::string("#version 100\nprecision mediump float;\n") + code : std::string("#version 110\n") + code;
+	const char *src = source.c_str();
+	GLuint shader = glCreateShader(stage);
+	glShaderSource(shader, 1, &src, nullptr);
+	glCompileShader(shader);
+	GLint success = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (success != GL_TRUE) {
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+// Same steps as CREATE_PROGRAM in GLQueueRunner: the cached binary if it works, otherwise link from source and store.
+static GLuint LinkProgramWithBinaryCache(GLProgramBinaryCache &cache, uint64_t key, GLuint vs, GLuint fs, bool *fromBinary) {
+	GLuint program = glCreateProgram();
+	*fromBinary = cache.LoadProgram(key, &program);
+	if (*fromBinary) {
+		return program;
+	}
+
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glBindAttribLocation(program, 3, "position");
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus != GL_TRUE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	cache.StoreProgram(key, program);
+	return program;
+}
+
+static bool IsProgramBinaryTestProgramValid(GLuint program) {
+	if (program == 0) {
+		return false;
+	}
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	// The attribute binding is part of the binary, and the uniform has to still be there to use.
+	GLint colorLoc = glGetUniformLocation(program, "u_color");
+	bool valid = linkStatus == GL_TRUE && glGetAttribLocation(program, "position") == 3 && colorLoc >= 0;
+	glUseProgram(program);
+	glUniform4f(colorLoc, 1.0f, 0.5f, 0.25f, 1.0f);
+	glUseProgram(0);
+	return valid && glGetError() == GL_NO_ERROR;
+}
+
+static bool TestGLProgramBinaryCacheWithContext() {
+	GLuint vs = CompileProgramBinaryTestShader(GL_VERTEX_SHADER, "attribute vec4 position;\nvoid main() { gl_Position = position; }\n");
+	GLuint fs = CompileProgramBinaryTestShader(GL_FRAGMENT_SHADER, "uniform vec4 u_color;\nvoid main() { gl_FragColor = u_color; }\n");
+	EXPECT_TRUE(vs != 0 && fs != 0);
+
+	const Path filename("unittest_programs.glprogrambinary");
+	const Path corruptFilename("unittest_programs_corrupt.glprogrambinary");
+	const uint64_t key = 0x1234567890ABCDEFULL;
+	bool fromBinary = false;
+
+	// Link from source, and save the binary.
+	GLProgramBinaryCache cache;
+	GLuint program = LinkProgramWithBinaryCache(cache, key, vs, fs, &fromBinary);
+	EXPECT_FALSE(fromBinary);
+	EXPECT_TRUE(IsProgramBinaryTestProgramValid(program));
+	glDeleteProgram(program);
+	EXPECT_EQ_INT((int)cache.Size(), 1);
+	EXPECT_TRUE(cache.Save(filename));
+
+	// Reload it, and the program comes from the binary.
+	GLProgramBinaryCache reloaded;
+	EXPECT_TRUE(reloaded.Load(filename));
+	EXPECT_EQ_INT((int)reloaded.Size(), 1);
+	program = LinkProgramWithBinaryCache(reloaded, key, vs, fs, &fromBinary);
+	EXPECT_TRUE(fromBinary);
+	EXPECT_EQ_INT(reloaded.Hits(), 1);
+	EXPECT_TRUE(IsProgramBinaryTestProgramValid(program));
+	glDeleteProgram(program);
+
+	// A corrupt blob in the file gets skipped on load, and the program linked from source again.
+	std::string data;
+	EXPECT_TRUE(File::ReadBinaryFileToString(filename, &data));
+	data[data.size() - 1] ^= 0x55;
+	EXPECT_TRUE(File::WriteDataToFile(false, data.data(), data.size(), corruptFilename));
+	GLProgramBinaryCache corrupt;
+	EXPECT_TRUE(corrupt.Load(corruptFilename));
+	EXPECT_EQ_INT((int)corrupt.Size(), 0);
+	program = LinkProgramWithBinaryCache(corrupt, key, vs, fs, &fromBinary);
+	EXPECT_FALSE(fromBinary);
+	EXPECT_TRUE(IsProgramBinaryTestProgramValid(program));
+	glDeleteProgram(program);
+	EXPECT_EQ_INT((int)corrupt.Size(), 1);
+
+	// A stale binary with a good checksum gets rejected by the driver, dropped, and replaced.
+	uint32_t format = 0;
+	std::vector<uint8_t> binary;
+	EXPECT_TRUE(reloaded.Get(key, &format, &binary));
+	GLProgramBinaryCache stale;
+	stale.Put(key, format, std::vector<uint8_t>(binary.size(), 0xCD));
+	program = LinkProgramWithBinaryCache(stale, key, vs, fs, &fromBinary);
+	EXPECT_FALSE(fromBinary);
+	EXPECT_EQ_INT(stale.Rejected(), 1);
+	EXPECT_TRUE(IsProgramBinaryTestProgramValid(program));
+	glDeleteProgram(program);
+	EXPECT_EQ_INT((int)stale.Size(), 1);
+
+	// A file from another driver (or driver version) isn't loaded at all.
+	const uint64_t driverHash = gl_extensions.driverHash;
+	gl_extensions.driverHash ^= 1;
+	GLProgramBinaryCache otherDriver;
+	bool loaded = otherDriver.Load(filename);
+	gl_extensions.driverHash = driverHash;
+	EXPECT_FALSE(loaded);
+	EXPECT_EQ_INT((int)otherDriver.Size(), 0);
+	program = LinkProgramWithBinaryCache(otherDriver, key, vs, fs, &fromBinary);
+	EXPECT_FALSE(fromBinary);
+	EXPECT_TRUE(IsProgramBinaryTestProgramValid(program));
+	glDeleteProgram(program);
+
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	File::Delete(filename);
+	File::Delete(corruptFilename);
+	return true;
+}
+#endif
+
+// Needs a GL context with program binary support, skipped otherwise.
+static bool TestGLProgramBinaryCache() {
+#ifdef SDL
+	if (!SDL_Init(SDL_INIT_VIDEO)) {
+		printf("Skipping GL program binary cache test: %s\n", SDL_GetError());
+		return true;
+	}
+	SDL_Window *window = SDL_CreateWindow("PPSSPPUnitTest", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	SDL_GLContext context = window ? SDL_GL_CreateContext(window) : nullptr;
+	bool available = context != nullptr;
+	if (!available) {
+		printf("Skipping GL program binary cache test: %s\n", SDL_GetError());
+	}
+#ifndef USING_GLES2
+	if (available) {
+		glewExperimental = true;
+		available = glewInit() == GLEW_OK;
+		// glew may leave an invalid enum error behind.
+		glGetError();
+		if (!available) {
+			printf("Skipping GL program binary cache test: glewInit failed\n");
+		}
+	}
+#endif
+	if (available) {
+		CheckGLExtensions();
+		available = GLProgramBinaryCache::IsSupported();
+		if (!available) {
+			printf("Skipping GL program binary cache test: no program binary formats\n");
+		}
+	}
+
+	bool success = !available || TestGLProgramBinaryCacheWithContext();
+
+	if (context) {
+		SDL_GL_DestroyContext(context);
+	}
+	if (window) {
+		SDL_DestroyWindow(window);
+	}
+	SDL_Quit();
+	return success;
+#else
+	return true;
+#endif
+}
+
 // Check that RTTI is working.
 bool TestLang() {
 	struct Base { virtual ~Base() = default; };
@@ -2855,6 +4927,7 @@ bool TestVFS();
 bool TestZipSlip();
 bool TestLzrc();
 bool TestTextureReplacer();
+bool TestDepthRaster();
 
 TestItem availableTests[] = {
 #if PPSSPP_ARCH(ARM64) || PPSSPP_ARCH(AMD64) || PPSSPP_ARCH(X86)
@@ -2880,9 +4953,20 @@ TestItem availableTests[] = {
 	TEST_ITEM(Parsers),
 	TEST_ITEM(TruncateCpy),
 	TEST_ITEM(MemBlockInfoSaveState),
+	TEST_ITEM(MemBlockInfoTagLimit),
+	TEST_ITEM(MemBlockInfo),
+	TEST_ITEM(StereoResampler),
+	TEST_ITEM(StereoResamplerFastForward),
 	TEST_ITEM(Serializer),
+	TEST_ITEM(SerializerArena),
+	TEST_ITEM(RewindDelta),
+	TEST_ITEM(RewindDirtyPages),
+	TEST_ITEM(FunctionProfiler),
 	TEST_ITEM(BlockAllocator),
 	TEST_ITEM(SymbolMap),
+	TEST_ITEM(ThreadQueueList),
+	TEST_ITEM(KernelWaitHelpers),
+	TEST_ITEM(IoReadahead),
 	TEST_ITEM(Hashmaps),
 	TEST_ITEM(Breakpoints),
 	TEST_ITEM(TempBreakpoints),
@@ -2891,12 +4975,16 @@ TestItem availableTests[] = {
 	TEST_ITEM(Jit),
 	TEST_ITEM(VFPUMatrixTranspose),
 	TEST_ITEM(ParseLBN),
+	TEST_ITEM(BlockDeviceReads),
+	TEST_ITEM(BlockCache),
 	TEST_ITEM(QuickTexHash),
 	TEST_ITEM(CLZ),
 	TEST_ITEM(MemMap),
 	TEST_ITEM(ShaderGenerators),
 	TEST_ITEM(SoftwareGPUJit),
 	TEST_ITEM(Path),
+	TEST_ITEM(FixPathCase),
+	TEST_ITEM(VirtualDiscIndexCache),
 	TEST_ITEM(AndroidContentURI),
 	TEST_ITEM(ThreadManager),
 	TEST_ITEM(WrapText),
@@ -2922,6 +5010,8 @@ TestItem availableTests[] = {
 	TEST_ITEM(ZipSlip),
 	TEST_ITEM(Lzrc),
 	TEST_ITEM(TextureReplacer),
+	TEST_ITEM(DepthRaster),
+	TEST_ITEM(GLProgramBinaryCache),
 };
 
 int main(int argc, const char *argv[]) {